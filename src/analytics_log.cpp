@@ -0,0 +1,251 @@
+#include "analytics_log.h"
+
+#include <cerrno>
+#include <cstring>
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+
+static void PutU16( uint8_t* out, uint16_t value )
+{
+    out[0] = uint8_t(value);
+    out[1] = uint8_t(value >> 8);
+}
+
+static void PutU32( uint8_t* out, uint32_t value )
+{
+    for( int i = 0; i < 4; ++i )
+        out[i] = uint8_t(value >> ( i * 8 ));
+}
+
+static void PutU64( uint8_t* out, uint64_t value )
+{
+    for( int i = 0; i < 8; ++i )
+        out[i] = uint8_t(value >> ( i * 8 ));
+}
+
+static uint16_t GetU16( const uint8_t* in )
+{
+    return uint16_t(in[0] | ( in[1] << 8 ));
+}
+
+static uint32_t GetU32( const uint8_t* in )
+{
+    uint32_t value = 0;
+    for( int i = 3; i >= 0; --i )
+        value = ( value << 8 ) | in[i];
+
+    return value;
+}
+
+static uint64_t GetU64( const uint8_t* in )
+{
+    uint64_t value = 0;
+    for( int i = 7; i >= 0; --i )
+        value = ( value << 8 ) | in[i];
+
+    return value;
+}
+
+static bool WriteAll( int fd, const uint8_t* data, std::size_t size )
+{
+    while( size )
+    {
+        ssize_t result = write(fd,data,size);
+        if( result < 0 && errno == EINTR )
+            continue;
+
+        if( result <= 0 )
+            return false;
+
+        data += result;
+        size -= result;
+    }
+
+    return true;
+}
+
+// the size of the header and the whole records in a file of this size, what's after that is a cut off record.
+static off_t GetWholeRecordsSize( off_t size )
+{
+    if( size < ANALYTICS_LOG_HEADER_SIZE )
+        return size;
+
+    return ANALYTICS_LOG_HEADER_SIZE + ( size - ANALYTICS_LOG_HEADER_SIZE ) / ANALYTICS_RECORD_SIZE *
+                                       ANALYTICS_RECORD_SIZE;
+}
+
+bool OpenAnalyticsLog( AnalyticsLog& log, const char* path )
+{
+    if( log.m_fd >= 0 )
+        return true;
+
+    int fd = open(path,O_RDWR | O_APPEND | O_CREAT | O_CLOEXEC,0644);
+    if( fd < 0 )
+        return false;
+
+    struct stat file_status;
+    if( fstat(fd,&file_status) != 0 )
+    {
+        close(fd);
+        return false;
+    }
+
+    uint8_t header[ANALYTICS_LOG_HEADER_SIZE] = {};
+
+    if( file_status.st_size == 0 )
+    {
+        PutU32(header,ANALYTICS_LOG_MAGIC);
+        PutU16(header + 4,ANALYTICS_LOG_VERSION);
+        PutU16(header + 6,ANALYTICS_RECORD_SIZE);
+
+        if( !WriteAll(fd,header,sizeof(header)) )
+        {
+            close(fd);
+            return false;
+        }
+    }
+
+    // never append to something that isn't a log of this version. a record cut off at the end is dropped,
+    // everything appended after it would be read at the wrong offset otherwise.
+    else
+    {
+        uint64_t record_count;
+        off_t whole_size = GetWholeRecordsSize(file_status.st_size);
+
+        if( pread(fd,header,sizeof(header),0) != ssize_t(sizeof(header)) ||
+            !ReadAnalyticsLogHeader(header,sizeof(header),record_count) ||
+            ( whole_size != file_status.st_size && ftruncate(fd,whole_size) != 0 ) )
+        {
+            close(fd);
+            return false;
+        }
+    }
+
+    log.m_fd = fd;
+    log.m_buffered_count = 0;
+
+    return true;
+}
+
+void AppendAnalyticsRecord( AnalyticsLog& log, const GameAnalyticsRecord& record )
+{
+    if( log.m_fd < 0 )
+        return;
+
+    EncodeAnalyticsRecord(record,log.m_buffer + log.m_buffered_count * ANALYTICS_RECORD_SIZE);
+
+    if( ++log.m_buffered_count == ANALYTICS_BATCH_SIZE )
+        FlushAnalyticsLog(log);
+}
+
+bool FlushAnalyticsLog( AnalyticsLog& log )
+{
+    if( log.m_fd < 0 || log.m_buffered_count == 0 )
+        return true;
+
+    struct stat file_status;
+    bool has_size = fstat(log.m_fd,&file_status) == 0;
+    bool written = has_size &&
+                   WriteAll(log.m_fd,log.m_buffer,std::size_t(log.m_buffered_count) * ANALYTICS_RECORD_SIZE);
+
+    if( written )
+    {
+        log.m_written_count += log.m_buffered_count;
+    }
+
+    // the part of the batch that made it out is cut off again, so the next batch starts on a whole record. a
+    // log that can't be cut back is closed, anything appended to it would be garbage.
+    else
+    {
+        ++log.m_failed_write_count;
+
+        if( !has_size || ftruncate(log.m_fd,GetWholeRecordsSize(file_status.st_size)) != 0 )
+        {
+            close(log.m_fd);
+            log.m_fd = -1;
+        }
+    }
+
+    log.m_buffered_count = 0;
+
+    return written;
+}
+
+void CloseAnalyticsLog( AnalyticsLog& log )
+{
+    if( log.m_fd < 0 )
+        return;
+
+    FlushAnalyticsLog(log);
+    close(log.m_fd);
+    log.m_fd = -1;
+}
+
+void EncodeAnalyticsRecord( const GameAnalyticsRecord& record, uint8_t* out )
+{
+    std::memset(out,0,ANALYTICS_RECORD_SIZE);
+
+    PutU64(out,record.m_end_time);
+    PutU32(out + 8,record.m_duration_milliseconds);
+    PutU32(out + 12,record.m_ticks);
+    PutU32(out + 16,uint32_t(record.m_score));
+    PutU32(out + 20,record.m_length);
+    PutU16(out + 24,record.m_size_x);
+    PutU16(out + 26,record.m_size_y);
+    out[28] = record.m_difficulty;
+    out[29] = record.m_rules;
+    out[30] = record.m_end_cause;
+    out[31] = record.m_flags;
+    // the rest of the name was zeroed above, a name that fills the field has no terminator in the file.
+    std::memcpy(out + 32,record.m_player_name,strnlen(record.m_player_name,ANALYTICS_PLAYER_NAME_LENGTH));
+}
+
+void DecodeAnalyticsRecord( const uint8_t* in, GameAnalyticsRecord& record )
+{
+    record.m_end_time = GetU64(in);
+    record.m_duration_milliseconds = GetU32(in + 8);
+    record.m_ticks = GetU32(in + 12);
+    record.m_score = int32_t(GetU32(in + 16));
+    record.m_length = GetU32(in + 20);
+    record.m_size_x = GetU16(in + 24);
+    record.m_size_y = GetU16(in + 26);
+    record.m_difficulty = in[28];
+    record.m_rules = in[29];
+    record.m_end_cause = in[30];
+    record.m_flags = in[31];
+    std::memcpy(record.m_player_name,in + 32,ANALYTICS_PLAYER_NAME_LENGTH);
+    record.m_player_name[ANALYTICS_PLAYER_NAME_LENGTH] = '\0';
+}
+
+bool ReadAnalyticsLogHeader( const uint8_t* data, std::size_t size, uint64_t& record_count )
+{
+    if( size < ANALYTICS_LOG_HEADER_SIZE || GetU32(data) != ANALYTICS_LOG_MAGIC ||
+        GetU16(data + 4) != ANALYTICS_LOG_VERSION || GetU16(data + 6) != ANALYTICS_RECORD_SIZE )
+        return false;
+
+    record_count = ( size - ANALYTICS_LOG_HEADER_SIZE ) / ANALYTICS_RECORD_SIZE;
+
+    return true;
+}
+
+uint8_t GetSnakeGameEndCause( const SnakeGameState& state )
+{
+    if( state.m_status == GAME_STATUS_WON )
+        return ANALYTICS_END_WON;
+
+    if( state.m_status != GAME_STATUS_LOST )
+        return ANALYTICS_END_QUIT;
+
+    // a lost game never moved into the cell that killed it.
+    return state.m_field[state.Neighbor(state.Head(),state.m_direction)] == SNAKE_CELL_WALL ? ANALYTICS_END_HIT_WALL :
+                                                                                               ANALYTICS_END_HIT_BODY;
+}
+
+const char* GetAnalyticsEndCauseName( uint8_t end_cause )
+{
+    static const char* names[ANALYTICS_END_COUNT] = { "won", "hit a wall", "hit itself", "quit" };
+
+    return end_cause < ANALYTICS_END_COUNT ? names[end_cause] : "unknown";
+}
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "snake_game.h"
+
+// every finished game is appended to this log as one fixed size record, so a log of millions of games can be
+// mapped and walked like an array. all numbers are little endian:
+//
+//   header ( ANALYTICS_LOG_HEADER_SIZE bytes )
+//    0 magic               u32
+//    4 version             u16
+//    6 record size         u16
+//    8 reserved            8 bytes
+//
+//   records ( ANALYTICS_RECORD_SIZE bytes each )
+//    0 end time            u64   unix seconds
+//    8 duration            u32   milliseconds
+//   12 ticks               u32
+//   16 score               i32
+//   20 length              u32
+//   24 size x              u16
+//   26 size y              u16
+//   28 difficulty          u8
+//   29 rules               u8    SNAKE_RULE_* mask
+//   30 end cause           u8    ANALYTICS_END_*
+//   31 flags               u8    ANALYTICS_FLAG_*
+//   32 player name         21 bytes, zero padded
+//   53 reserved            11 bytes
+//
+// a log whose size isn't the header plus whole records was cut off while being written, readers ignore the
+// partial record at the end.
+#define ANALYTICS_LOG_FILE_NAME                 "games.log"
+#define ANALYTICS_LOG_MAGIC                     0x414b4e53 // "SNKA"
+#define ANALYTICS_LOG_VERSION                   1
+#define ANALYTICS_LOG_HEADER_SIZE               16
+#define ANALYTICS_RECORD_SIZE                   64
+#define ANALYTICS_PLAYER_NAME_LENGTH            20
+#define ANALYTICS_BATCH_SIZE                    64 // records buffered before they are written out.
+
+#define ANALYTICS_END_WON                       0
+#define ANALYTICS_END_HIT_WALL                  1
+#define ANALYTICS_END_HIT_BODY                  2
+#define ANALYTICS_END_QUIT                      3 // left before the game was over.
+#define ANALYTICS_END_COUNT                     4
+
+#define ANALYTICS_FLAG_AUTOPILOT                1 // the autopilot played atleast part of the game.
+#define ANALYTICS_FLAG_RESUMED                  2 // the game was continued from a save.
+#define ANALYTICS_FLAG_HEADLESS                 4 // played by a headless batch, not by a person.
+
+struct GameAnalyticsRecord
+{
+    GameAnalyticsRecord() : m_end_time(0), m_duration_milliseconds(0), m_ticks(0), m_score(0), m_length(0),
+                            m_size_x(0), m_size_y(0), m_difficulty(0), m_rules(0), m_end_cause(0), m_flags(0),
+                            m_player_name{} {}
+
+    uint64_t m_end_time;
+    uint32_t m_duration_milliseconds;
+    uint32_t m_ticks;
+    int32_t m_score;
+    uint32_t m_length;
+    uint16_t m_size_x;
+    uint16_t m_size_y;
+    uint8_t m_difficulty;
+    uint8_t m_rules;
+    uint8_t m_end_cause;
+    uint8_t m_flags;
+    char m_player_name[ANALYTICS_PLAYER_NAME_LENGTH + 1];
+};
+
+// appends records in batches: they are collected in m_buffer and go to the file with a single write once the
+// batch is full or the log is flushed. the file is opened with O_APPEND so several games writing to the same
+// log never overwrite each other's records.
+struct AnalyticsLog
+{
+    AnalyticsLog() : m_fd(-1), m_buffered_count(0), m_written_count(0), m_failed_write_count(0) {}
+
+    AnalyticsLog( const AnalyticsLog& other ) = delete;
+    AnalyticsLog& operator=( const AnalyticsLog& other ) = delete;
+
+    int m_fd;
+    uint8_t m_buffer[ANALYTICS_RECORD_SIZE * ANALYTICS_BATCH_SIZE];
+    uint32_t m_buffered_count;
+    uint64_t m_written_count;
+    uint64_t m_failed_write_count;
+};
+
+// creates the log with it's header if it doesn't exist yet. false if it can't be opened or isn't a log.
+bool OpenAnalyticsLog( AnalyticsLog& log, const char* path );
+
+void AppendAnalyticsRecord( AnalyticsLog& log, const GameAnalyticsRecord& record );
+
+bool FlushAnalyticsLog( AnalyticsLog& log );
+
+// flushes whatever is buffered and closes the file, safe to call more than once.
+void CloseAnalyticsLog( AnalyticsLog& log );
+
+void EncodeAnalyticsRecord( const GameAnalyticsRecord& record, uint8_t* out );
+void DecodeAnalyticsRecord( const uint8_t* in, GameAnalyticsRecord& record );
+
+// checks the header of a log that was read or mapped, returns how many whole records follow it.
+bool ReadAnalyticsLogHeader( const uint8_t* data, std::size_t size, uint64_t& record_count );
+
+// why a game that is over has ended, from the cell the head was about to move into.
+uint8_t GetSnakeGameEndCause( const SnakeGameState& state );
+
+const char* GetAnalyticsEndCauseName( uint8_t end_cause );
@@ -0,0 +1,47 @@
+#include "arena.h"
+
+GameArena::~GameArena()
+{
+    ::operator delete(m_block);
+}
+
+bool GameArena::Reserve( std::size_t size )
+{
+    if( size <= m_capacity )
+        return true;
+
+    ::operator delete(m_block);
+
+    // through the global operator, so the executable's heap counters see the blocks ( see heap_counter.h ).
+    m_block = static_cast<unsigned char*>(::operator new(size,std::nothrow));
+    m_used = 0;
+
+    if( !m_block )
+    {
+        m_capacity = 0;
+        return false;
+    }
+
+    m_capacity = size;
+    ++m_heap_block_count;
+
+    return true;
+}
+
+void GameArena::Reset()
+{
+    m_used = 0;
+    ++m_reset_count;
+}
+
+void* GameArena::Allocate( std::size_t size, std::size_t alignment )
+{
+    std::size_t offset = ( m_used + alignment - 1 ) & ~( alignment - 1 );
+    if( !m_block || offset + size > m_capacity )
+        return nullptr;
+
+    m_used = offset + size;
+    ++m_allocation_count;
+
+    return m_block + offset;
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <utility>
+
+// a bump allocator. memory comes from the heap only when the arena has to get a bigger block, every other
+// allocation just moves an offset forward, and Reset() moves it back to zero in O(1).
+// objects constructed inside the arena never get their destructors called, so only put trivial stuff in it.
+struct GameArena
+{
+    GameArena() : m_block(nullptr), m_capacity(0), m_used(0), m_allocation_count(0), m_heap_block_count(0),
+                  m_reset_count(0) {}
+
+    GameArena( const GameArena& other ) = delete;
+    GameArena& operator=( const GameArena& other ) = delete;
+
+    ~GameArena();
+
+    // makes sure the arena has atleast 'size' bytes, drops everything allocated so far if it needs to grow.
+    bool Reserve( std::size_t size );
+    void Reset();
+    void* Allocate( std::size_t size, std::size_t alignment );
+
+    template<typename T, typename... Args>
+    T* Construct( Args&&... args )
+    {
+        void* memory = Allocate(sizeof(T),alignof(T));
+        if( !memory )
+            return nullptr;
+
+        return new(memory) T(std::forward<Args>(args)...);
+    }
+
+    template<typename T>
+    T* AllocateArray( std::size_t count )
+    {
+        return static_cast<T*>(Allocate(sizeof(T) * count,alignof(T)));
+    }
+
+    unsigned char* m_block;
+    std::size_t m_capacity;
+    std::size_t m_used;
+    std::uint64_t m_allocation_count; // allocations served since the arena was created.
+    std::uint64_t m_heap_block_count; // times the arena itself had to go to the heap.
+    std::uint64_t m_reset_count;
+};
+
+// worst case space a single object of this type can take inside an arena, alignment padding included.
+template<typename T>
+constexpr std::size_t ArenaFootprint( std::size_t count = 1 )
+{
+    return sizeof(T) * count + alignof(T);
+}
@@ -0,0 +1,687 @@
+#include "arena_server.h"
+
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+#include <condition_variable>
+#include <deque>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "arena.h"
+
+#define ARENA_SERVER_MAX_EVENTS                 256
+#define ARENA_SERVER_MAX_QUEUED_MOVES           1024 // answers sent ahead beyond this are thrown away.
+#define ARENA_SERVER_OBSERVATION_SIZE           128
+
+// a match belongs to exactly one thread at a time: the event loop owns it while it waits for the bot, a worker
+// owns it from the moment it's queued for a step until it's handed back. so nothing in here needs a lock.
+struct ArenaMatch
+{
+    ArenaMatch() : m_fd(-1), m_id(0), m_index(0), m_output_offset(0), m_deadline(0), m_timeout_count(0),
+                   m_is_waiting(false), m_is_stepping(false), m_is_closing(false), m_is_finished(false),
+                   m_is_destroyed(false), m_observation_size(0), m_next_direction(SNAKE_DIRECTION_NONE) {}
+
+    int m_fd;
+    uint32_t m_id;
+    std::size_t m_index;        // in the list of live matches.
+    GameArena m_arena;
+    SnakeGameState m_state;
+
+    // only touched by the event loop.
+    std::string m_output;
+    std::size_t m_output_offset;
+    std::deque<uint8_t> m_moves;
+    int64_t m_deadline;         // milliseconds on the steady clock, only meaningful while m_is_waiting.
+    uint64_t m_timeout_count;
+    bool m_is_waiting;          // an observation went out and the bot's answer is due.
+    bool m_is_stepping;         // a worker has it.
+    bool m_is_closing;          // the bot went away while a worker had the match.
+    bool m_is_finished;         // the game is over, close as soon as the output is out.
+    bool m_is_destroyed;        // closed, freed once the events already taken from epoll are handled.
+
+    // handed to and back from the worker.
+    char m_observation[ARENA_SERVER_OBSERVATION_SIZE];
+    uint32_t m_observation_size;
+    uint8_t m_next_direction;
+};
+
+struct ArenaWorkerPool
+{
+    ArenaWorkerPool() : m_stop(false), m_event_fd(-1) {}
+
+    std::mutex m_job_mutex;
+    std::condition_variable m_job_condition;
+    std::deque<ArenaMatch*> m_jobs;
+    bool m_stop;
+
+    // stepped matches go back through here, the eventfd wakes up the event loop.
+    std::mutex m_done_mutex;
+    std::vector<ArenaMatch*> m_done;
+    int m_event_fd;
+
+    std::vector<std::thread> m_threads;
+};
+
+static volatile std::sig_atomic_t arena_server_should_stop = 0;
+
+static void HandleArenaServerSignal( int signal_number )
+{
+    (void)signal_number;
+    arena_server_should_stop = 1;
+}
+
+static int64_t GetSteadyMilliseconds()
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+               std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static char GetDirectionLetter( uint8_t direction )
+{
+    static const char letters[] = "-ULDR";
+
+    return direction <= SNAKE_DIRECTION_RIGHT ? letters[direction] : '-';
+}
+
+static void WriteObservation( ArenaMatch& match )
+{
+    const SnakeGameState& state = match.m_state;
+
+    int size = std::snprintf(match.m_observation,sizeof(match.m_observation),"%llu %u %u %u %u %d %c\n",
+                             (unsigned long long)state.m_tick,unsigned(state.m_status),state.Head(),state.m_food,
+                             state.m_length,int(state.m_score),GetDirectionLetter(state.m_direction));
+
+    match.m_observation_size = uint32_t(size);
+}
+
+static void RunArenaWorker( ArenaWorkerPool& pool )
+{
+    for( ;; )
+    {
+        ArenaMatch* match;
+        {
+            std::unique_lock<std::mutex> lock(pool.m_job_mutex);
+            pool.m_job_condition.wait(lock,[&]{ return pool.m_stop || !pool.m_jobs.empty(); });
+
+            if( pool.m_jobs.empty() )
+                return;
+
+            match = pool.m_jobs.front();
+            pool.m_jobs.pop_front();
+        }
+
+        StepSnakeGame(match->m_state,match->m_next_direction);
+        WriteObservation(*match);
+
+        {
+            std::lock_guard<std::mutex> lock(pool.m_done_mutex);
+            pool.m_done.push_back(match);
+        }
+
+        uint64_t one = 1;
+        if( write(pool.m_event_fd,&one,sizeof(one)) < 0 )
+            continue;
+    }
+}
+
+static bool StartArenaWorkers( ArenaWorkerPool& pool, uint32_t worker_count )
+{
+    pool.m_event_fd = eventfd(0,EFD_NONBLOCK | EFD_CLOEXEC);
+    if( pool.m_event_fd < 0 )
+        return false;
+
+    // the signals are for the event loop, the workers inherit a mask that blocks them.
+    sigset_t signals, previous_signals;
+    sigemptyset(&signals);
+    sigaddset(&signals,SIGINT);
+    sigaddset(&signals,SIGTERM);
+    pthread_sigmask(SIG_BLOCK,&signals,&previous_signals);
+
+    for( uint32_t i = 0; i < worker_count; ++i )
+        pool.m_threads.emplace_back(RunArenaWorker,std::ref(pool));
+
+    pthread_sigmask(SIG_SETMASK,&previous_signals,nullptr);
+
+    return true;
+}
+
+static void StopArenaWorkers( ArenaWorkerPool& pool )
+{
+    {
+        std::lock_guard<std::mutex> lock(pool.m_job_mutex);
+        pool.m_stop = true;
+    }
+
+    pool.m_job_condition.notify_all();
+
+    for( std::thread& thread : pool.m_threads )
+        thread.join();
+
+    if( pool.m_event_fd >= 0 )
+        close(pool.m_event_fd);
+}
+
+static int OpenArenaListener( const ArenaServerOptions& options )
+{
+    int fd;
+
+    if( options.m_unix_path )
+    {
+        sockaddr_un address;
+        std::memset(&address,0,sizeof(address));
+        address.sun_family = AF_UNIX;
+
+        if( std::strlen(options.m_unix_path) >= sizeof(address.sun_path) )
+        {
+            std::cerr << "socket path is too long.\n";
+            return -1;
+        }
+
+        std::strcpy(address.sun_path,options.m_unix_path);
+
+        fd = socket(AF_UNIX,SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC,0);
+        if( fd < 0 )
+            return -1;
+
+        // a socket file left behind by an earlier run would make bind fail.
+        unlink(options.m_unix_path);
+
+        if( bind(fd,reinterpret_cast<sockaddr*>(&address),sizeof(address)) != 0 )
+        {
+            close(fd);
+            return -1;
+        }
+    }
+
+    else
+    {
+        sockaddr_in address;
+        std::memset(&address,0,sizeof(address));
+        address.sin_family = AF_INET;
+        address.sin_port = htons(options.m_port);
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+        fd = socket(AF_INET,SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC,0);
+        if( fd < 0 )
+            return -1;
+
+        int enable = 1;
+        setsockopt(fd,SOL_SOCKET,SO_REUSEADDR,&enable,sizeof(enable));
+
+        if( bind(fd,reinterpret_cast<sockaddr*>(&address),sizeof(address)) != 0 )
+        {
+            close(fd);
+            return -1;
+        }
+    }
+
+    if( listen(fd,SOMAXCONN) != 0 )
+    {
+        close(fd);
+        return -1;
+    }
+
+    return fd;
+}
+
+struct ArenaServer
+{
+    ArenaServer( const ArenaServerOptions& options ) : m_options(options), m_epoll_fd(-1), m_listen_fd(-1),
+                                                       m_next_id(1), m_started_count(0), m_finished_count(0),
+                                                       m_rejected_count(0), m_tick_count(0), m_timeout_count(0),
+                                                       m_max_live_count(0) {}
+
+    const ArenaServerOptions& m_options;
+    int m_epoll_fd;
+    int m_listen_fd;
+    ArenaWorkerPool m_pool;
+    std::vector<ArenaMatch*> m_matches;
+    std::vector<ArenaMatch*> m_destroyed;
+    uint32_t m_next_id;
+
+    uint64_t m_started_count;
+    uint64_t m_finished_count;  // games played to the end, the rest were left by their bot.
+    uint64_t m_rejected_count;
+    uint64_t m_tick_count;
+    uint64_t m_timeout_count;
+    std::size_t m_max_live_count;
+};
+
+static void QueueMatchStep( ArenaServer& server, ArenaMatch& match, uint8_t direction )
+{
+    match.m_is_waiting = false;
+    match.m_is_stepping = true;
+    match.m_next_direction = direction;
+
+    {
+        std::lock_guard<std::mutex> lock(server.m_pool.m_job_mutex);
+        server.m_pool.m_jobs.push_back(&match);
+    }
+
+    server.m_pool.m_job_condition.notify_one();
+}
+
+static void DestroyMatch( ArenaServer& server, ArenaMatch* match )
+{
+    if( match->m_is_finished )
+    {
+        ++server.m_finished_count;
+        std::cout << "match " << match->m_id << " ended: score " << match->m_state.m_score << " ticks "
+                  << match->m_state.m_tick << " timeouts " << match->m_timeout_count << '\n';
+    }
+
+    close(match->m_fd);
+
+    ArenaMatch* last = server.m_matches.back();
+    last->m_index = match->m_index;
+    server.m_matches[match->m_index] = last;
+    server.m_matches.pop_back();
+
+    // a later event of the same epoll_wait batch may still point to it.
+    match->m_is_destroyed = true;
+    server.m_destroyed.push_back(match);
+}
+
+static void FreeDestroyedMatches( ArenaServer& server )
+{
+    for( ArenaMatch* match : server.m_destroyed )
+        delete match;
+
+    server.m_destroyed.clear();
+}
+
+// the bot is gone. a match a worker still has can't be freed yet, it's freed when it comes back.
+static void CloseMatch( ArenaServer& server, ArenaMatch* match )
+{
+    if( match->m_is_stepping )
+    {
+        match->m_is_closing = true;
+        epoll_ctl(server.m_epoll_fd,EPOLL_CTL_DEL,match->m_fd,nullptr);
+        return;
+    }
+
+    DestroyMatch(server,match);
+}
+
+// sends as much of the output as the socket takes, the rest waits for EPOLLOUT. returns false if the match
+// was closed.
+static bool FlushMatchOutput( ArenaServer& server, ArenaMatch* match )
+{
+    while( match->m_output_offset < match->m_output.size() )
+    {
+        ssize_t result = send(match->m_fd,match->m_output.data() + match->m_output_offset,
+                              match->m_output.size() - match->m_output_offset,MSG_NOSIGNAL);
+
+        if( result < 0 && errno == EINTR )
+            continue;
+
+        if( result < 0 && ( errno == EAGAIN || errno == EWOULDBLOCK ) )
+        {
+            epoll_event event;
+            event.events = EPOLLIN | EPOLLOUT;
+            event.data.ptr = match;
+            epoll_ctl(server.m_epoll_fd,EPOLL_CTL_MOD,match->m_fd,&event);
+            return true;
+        }
+
+        if( result <= 0 )
+        {
+            CloseMatch(server,match);
+            return false;
+        }
+
+        match->m_output_offset += result;
+    }
+
+    match->m_output.clear();
+    match->m_output_offset = 0;
+
+    if( match->m_is_finished )
+    {
+        DestroyMatch(server,match);
+        return false;
+    }
+
+    epoll_event event;
+    event.events = EPOLLIN;
+    event.data.ptr = match;
+    epoll_ctl(server.m_epoll_fd,EPOLL_CTL_MOD,match->m_fd,&event);
+
+    return true;
+}
+
+// the observation of the last step is out, the bot has until the deadline to answer it. an answer it sent
+// ahead is used right away.
+static void WaitForMove( ArenaServer& server, ArenaMatch& match )
+{
+    if( !match.m_moves.empty() )
+    {
+        uint8_t direction = match.m_moves.front();
+        match.m_moves.pop_front();
+        QueueMatchStep(server,match,direction);
+        return;
+    }
+
+    match.m_is_waiting = true;
+    match.m_deadline = GetSteadyMilliseconds() + server.m_options.m_deadline_milliseconds;
+}
+
+static void AcceptMatches( ArenaServer& server )
+{
+    const ArenaServerOptions& options = server.m_options;
+
+    for( ;; )
+    {
+        int fd = accept4(server.m_listen_fd,nullptr,nullptr,SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if( fd < 0 )
+        {
+            if( errno == EINTR || errno == ECONNABORTED )
+                continue;
+
+            return;
+        }
+
+        if( server.m_matches.size() >= options.m_max_matches )
+        {
+            ++server.m_rejected_count;
+            close(fd);
+            continue;
+        }
+
+        // observations are tiny and the bot is waiting for each one, don't let them sit in the socket.
+        int enable = 1;
+        if( !options.m_unix_path )
+            setsockopt(fd,IPPROTO_TCP,TCP_NODELAY,&enable,sizeof(enable));
+
+        ArenaMatch* match = new ArenaMatch;
+        match->m_fd = fd;
+        match->m_id = server.m_next_id++;
+
+        uint64_t seed = uint64_t(std::chrono::steady_clock::now().time_since_epoch().count()) ^
+                        ( uint64_t(match->m_id) * 0x9e3779b97f4a7c15ULL );
+
+        if( !match->m_arena.Reserve(ComputeSnakeGameMemorySize(options.m_size_x,options.m_size_y)) ||
+            !InitializeSnakeGameState(match->m_state,match->m_arena,options.m_size_x,options.m_size_y,seed,
+                                      options.m_rules) )
+        {
+            close(fd);
+            delete match;
+            continue;
+        }
+
+        StartSnakeGameState(match->m_state);
+
+        match->m_index = server.m_matches.size();
+        server.m_matches.push_back(match);
+        ++server.m_started_count;
+
+        if( server.m_matches.size() > server.m_max_live_count )
+            server.m_max_live_count = server.m_matches.size();
+
+        epoll_event event;
+        event.events = EPOLLIN;
+        event.data.ptr = match;
+        epoll_ctl(server.m_epoll_fd,EPOLL_CTL_ADD,fd,&event);
+
+        const SnakeGameState& state = match->m_state;
+        char header[96];
+        std::snprintf(header,sizeof(header),"snake %d %u %u %u %u\n",ARENA_SERVER_PROTOCOL_VERSION,
+                      unsigned(state.m_size_x),unsigned(state.m_size_y),unsigned(state.m_rules),
+                      unsigned(options.m_deadline_milliseconds));
+
+        match->m_output.reserve(std::strlen(header) + ( state.m_size_x + 1 ) * std::size_t(state.m_size_y) +
+                                ARENA_SERVER_OBSERVATION_SIZE);
+        match->m_output += header;
+
+        for( uint32_t y = 0; y < state.m_size_y; ++y )
+        {
+            for( uint32_t x = 0; x < state.m_size_x; ++x )
+                match->m_output += ( state.m_field[x + y * state.m_size_x] == SNAKE_CELL_WALL ) ? '#' : '.';
+
+            match->m_output += '\n';
+        }
+
+        WriteObservation(*match);
+        match->m_output.append(match->m_observation,match->m_observation_size);
+
+        if( FlushMatchOutput(server,match) )
+            WaitForMove(server,*match);
+    }
+}
+
+static void ReadMatchInput( ArenaServer& server, ArenaMatch* match )
+{
+    char buffer[4096];
+
+    for( ;; )
+    {
+        ssize_t result = recv(match->m_fd,buffer,sizeof(buffer),0);
+
+        if( result < 0 && errno == EINTR )
+            continue;
+
+        if( result < 0 && ( errno == EAGAIN || errno == EWOULDBLOCK ) )
+            break;
+
+        if( result <= 0 )
+        {
+            CloseMatch(server,match);
+            return;
+        }
+
+        for( ssize_t i = 0; i < result; ++i )
+        {
+            uint8_t direction;
+            switch( buffer[i] )
+            {
+                case ' ': case '\t': case '\r': case '\n':
+                    continue;
+
+                case 'U': case 'u': direction = SNAKE_DIRECTION_UP;    break;
+                case 'L': case 'l': direction = SNAKE_DIRECTION_LEFT;  break;
+                case 'D': case 'd': direction = SNAKE_DIRECTION_DOWN;  break;
+                case 'R': case 'r': direction = SNAKE_DIRECTION_RIGHT; break;
+                default:            direction = SNAKE_DIRECTION_NONE;  break;
+            }
+
+            if( match->m_moves.size() < ARENA_SERVER_MAX_QUEUED_MOVES )
+                match->m_moves.push_back(direction);
+        }
+    }
+
+    if( match->m_is_waiting && !match->m_moves.empty() )
+        WaitForMove(server,*match);
+}
+
+static void CollectSteppedMatches( ArenaServer& server )
+{
+    uint64_t signal_count;
+    if( read(server.m_pool.m_event_fd,&signal_count,sizeof(signal_count)) < 0 && errno != EAGAIN )
+        return;
+
+    std::vector<ArenaMatch*> done;
+    {
+        std::lock_guard<std::mutex> lock(server.m_pool.m_done_mutex);
+        done.swap(server.m_pool.m_done);
+    }
+
+    for( ArenaMatch* match : done )
+    {
+        match->m_is_stepping = false;
+        ++server.m_tick_count;
+
+        if( match->m_is_closing )
+        {
+            DestroyMatch(server,match);
+            continue;
+        }
+
+        match->m_output.append(match->m_observation,match->m_observation_size);
+        match->m_is_finished = match->m_state.m_status != GAME_STATUS_ONGOING;
+
+        if( FlushMatchOutput(server,match) )
+            WaitForMove(server,*match);
+    }
+}
+
+// a bot that missed it's deadline keeps going straight. returns how long epoll may sleep until the next deadline.
+static int ExpireDeadlines( ArenaServer& server )
+{
+    int64_t now = GetSteadyMilliseconds();
+    int64_t next_deadline = -1;
+
+    for( ArenaMatch* match : server.m_matches )
+    {
+        if( !match->m_is_waiting )
+            continue;
+
+        if( match->m_deadline <= now )
+        {
+            ++match->m_timeout_count;
+            ++server.m_timeout_count;
+            QueueMatchStep(server,*match,SNAKE_DIRECTION_NONE);
+            continue;
+        }
+
+        if( next_deadline < 0 || match->m_deadline < next_deadline )
+            next_deadline = match->m_deadline;
+    }
+
+    return next_deadline < 0 ? -1 : int(next_deadline - now);
+}
+
+bool RunArenaServer( const ArenaServerOptions& options )
+{
+    ArenaServer server(options);
+
+    server.m_listen_fd = OpenArenaListener(options);
+    if( server.m_listen_fd < 0 )
+    {
+        std::cerr << "could not listen on " << ( options.m_unix_path ? options.m_unix_path : "127.0.0.1" );
+        if( !options.m_unix_path )
+            std::cerr << ':' << options.m_port;
+        std::cerr << ": " << std::strerror(errno) << ".\n";
+        return false;
+    }
+
+    server.m_epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+
+    uint32_t worker_count = options.m_worker_count ? options.m_worker_count : std::thread::hardware_concurrency();
+    if( !worker_count )
+        worker_count = 1;
+
+    if( server.m_epoll_fd < 0 || !StartArenaWorkers(server.m_pool,worker_count) )
+    {
+        std::cerr << "could not start the arena server.\n";
+        close(server.m_listen_fd);
+        return false;
+    }
+
+    // the listener and the eventfd have null and the pool as their data, every other fd is a match.
+    epoll_event event;
+    event.events = EPOLLIN;
+    event.data.ptr = nullptr;
+    epoll_ctl(server.m_epoll_fd,EPOLL_CTL_ADD,server.m_listen_fd,&event);
+
+    event.data.ptr = &server.m_pool;
+    epoll_ctl(server.m_epoll_fd,EPOLL_CTL_ADD,server.m_pool.m_event_fd,&event);
+
+    arena_server_should_stop = 0;
+    std::signal(SIGINT,HandleArenaServerSignal);
+    std::signal(SIGTERM,HandleArenaServerSignal);
+
+    std::cout << "arena server listening on ";
+    if( options.m_unix_path )
+        std::cout << options.m_unix_path;
+    else
+        std::cout << "127.0.0.1:" << options.m_port;
+    std::cout << ", board:" << options.m_size_x << 'x' << options.m_size_y << " rules:" << unsigned(options.m_rules)
+              << " deadline:" << options.m_deadline_milliseconds << "ms workers:" << worker_count << std::endl;
+
+    auto start = std::chrono::steady_clock::now();
+    epoll_event events[ARENA_SERVER_MAX_EVENTS];
+    int timeout = -1;
+
+    while( !arena_server_should_stop )
+    {
+        int event_count = epoll_wait(server.m_epoll_fd,events,ARENA_SERVER_MAX_EVENTS,timeout);
+
+        if( event_count < 0 && errno != EINTR )
+            break;
+
+        for( int i = 0; i < event_count; ++i )
+        {
+            if( events[i].data.ptr == nullptr )
+            {
+                AcceptMatches(server);
+                continue;
+            }
+
+            if( events[i].data.ptr == &server.m_pool )
+            {
+                CollectSteppedMatches(server);
+                continue;
+            }
+
+            ArenaMatch* match = static_cast<ArenaMatch*>(events[i].data.ptr);
+            if( match->m_is_destroyed || match->m_is_closing )
+                continue;
+
+            if( ( events[i].events & EPOLLOUT ) && !FlushMatchOutput(server,match) )
+                continue;
+
+            if( events[i].events & ( EPOLLIN | EPOLLHUP | EPOLLERR ) )
+                ReadMatchInput(server,match);
+        }
+
+        FreeDestroyedMatches(server);
+        timeout = ExpireDeadlines(server);
+    }
+
+    StopArenaWorkers(server.m_pool);
+
+    // whatever the workers had is in the done list by now, those matches are freed with the rest.
+    for( ArenaMatch* match : server.m_pool.m_done )
+        match->m_is_stepping = false;
+
+    while( !server.m_matches.empty() )
+        DestroyMatch(server,server.m_matches.back());
+
+    FreeDestroyedMatches(server);
+
+    close(server.m_epoll_fd);
+    close(server.m_listen_fd);
+
+    if( options.m_unix_path )
+        unlink(options.m_unix_path);
+
+    std::signal(SIGINT,SIG_DFL);
+    std::signal(SIGTERM,SIG_DFL);
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::cout << "\nmatches:" << server.m_started_count << " played out:" << server.m_finished_count
+              << " rejected:" << server.m_rejected_count << " most at once:" << server.m_max_live_count << '\n'
+              << "ticks:" << server.m_tick_count << " in " << seconds << "s ("
+              << ( seconds > 0 ? server.m_tick_count / seconds : 0.0 ) << "/s) timeouts:" << server.m_timeout_count
+              << '\n';
+
+    return true;
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstdint>
+
+#include "snake_game.h"
+
+#define ARENA_SERVER_DEFAULT_PORT               7171
+#define ARENA_SERVER_DEFAULT_DEADLINE           50  // milliseconds a bot gets to answer an observation.
+#define ARENA_SERVER_PROTOCOL_VERSION           1
+
+// bots connect over loopback TCP or a unix socket and every connection plays one game of it's own. the protocol
+// is plain text so a bot is a few lines in any language.
+//
+// right after connecting the server sends the board once:
+//   snake <protocol version> <size x> <size y> <rules> <deadline ms>
+//   <size y lines of size x characters, '#' for a wall and '.' for anything else>
+//
+// then one observation per tick, cells are x + y * size x:
+//   <tick> <status> <head cell> <food cell> <length> <score> <direction>
+//
+// status is one of the GAME_STATUS_* values and direction the letter the snake is going to. the body is the
+// last <length> head cells, so a bot can keep it by remembering where the head has been. the bot answers each
+// observation with one of the letters U, L, D or R ( anything else that isn't white space means keep going
+// straight ). answers can be sent ahead, each tick takes the next one. when no answer is there by the deadline
+// the snake keeps going straight and a timeout is counted.
+// the connection is closed after the observation that ends the game.
+struct ArenaServerOptions
+{
+    ArenaServerOptions() : m_unix_path(nullptr), m_port(ARENA_SERVER_DEFAULT_PORT), m_size_x(20), m_size_y(20),
+                           m_rules(0), m_deadline_milliseconds(ARENA_SERVER_DEFAULT_DEADLINE), m_worker_count(0),
+                           m_max_matches(1024) {}
+
+    const char* m_unix_path;    // listens on this unix socket instead of TCP when set.
+    uint16_t m_port;            // loopback only.
+    uint16_t m_size_x;
+    uint16_t m_size_y;
+    uint8_t m_rules;
+    uint32_t m_deadline_milliseconds;
+    uint32_t m_worker_count;    // 0 means one per hardware thread.
+    uint32_t m_max_matches;     // connections beyond this are closed right away.
+};
+
+// runs until SIGINT or SIGTERM, returns false if the server could not be started.
+bool RunArenaServer( const ArenaServerOptions& options );
@@ -0,0 +1,370 @@
+#include "cpu_bench.h"
+
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <dirent.h>
+#include <termios.h>
+#include <sys/ioctl.h>
+#include <sys/wait.h>
+
+#define CPU_BENCH_MAX_KEYS                      8
+
+struct CpuBenchmarkScenario
+{
+    const char* m_name;
+    const char* m_settings;     // written to settings.ini before the game starts, nullptr for the defaults.
+    int64_t m_key_delay;        // milliseconds, 0 for CPU_BENCH_KEY_DELAY.
+    const char* m_keys[CPU_BENCH_MAX_KEYS];
+};
+
+// the games are played by the autopilot, so they keep going for the whole measurement. in turbo mode the keys
+// come quicker and the board is bigger, so the snake doesn't hit a wall before the autopilot takes over.
+static const CpuBenchmarkScenario cpu_benchmark_scenarios[] =
+{
+    { "main menu",          nullptr, 0,     {} },
+    { "options",            nullptr, 0,     { "s", "s", "\n" } },
+    { "scoreboard",         nullptr, 0,     { "s", "s", "s", "\n" } },
+    { "name prompt",        nullptr, 0,     { "\n" } },
+    { "difficulty prompt",  nullptr, 0,     { "\n", "b", "o", "b", "\n" } },
+    { "game",               nullptr, 0,     { "\n", "b", "o", "b", "\n", "1", "\t" } },
+    { "turbo game",         "turbo_tick_rate = 120\nboard_columns = 120\nboard_rows = 50\n", 60,
+                                            { "\n", "b", "o", "b", "\n", "1", "\t" } },
+    { "item game",          "item_count = 200\n", 0,
+                                            { "\n", "b", "o", "b", "\n", "1", "\t" } },
+};
+
+struct ProcessCounters
+{
+    ProcessCounters() : m_cpu_ticks(0), m_voluntary_switches(0), m_involuntary_switches(0) {}
+
+    uint64_t m_cpu_ticks;
+    uint64_t m_voluntary_switches;
+    uint64_t m_involuntary_switches;
+};
+
+static bool ReadTextFile( const char* path, char* text, std::size_t capacity )
+{
+    int fd = open(path,O_RDONLY | O_CLOEXEC);
+    if( fd < 0 )
+        return false;
+
+    ssize_t size = read(fd,text,capacity - 1);
+    close(fd);
+
+    if( size < 0 )
+        return false;
+
+    text[size] = '\0';
+    return true;
+}
+
+static uint64_t ReadStatusValue( const char* text, const char* key )
+{
+    const char* line = std::strstr(text,key);
+
+    return line ? std::strtoull(line + std::strlen(key),nullptr,10) : 0;
+}
+
+// user and system time of the whole process, the switches of every thread it has right now.
+static bool ReadProcessCounters( pid_t pid, ProcessCounters& counters )
+{
+    counters = ProcessCounters();
+    char path[64];
+    char text[4096];
+
+    std::snprintf(path,sizeof(path),"/proc/%d/stat",int(pid));
+    if( !ReadTextFile(path,text,sizeof(text)) )
+        return false;
+
+    // the name in parentheses can hold spaces, the fields are counted from after it. utime and stime are the
+    // 14th and 15th field, the 12th and 13th after the name.
+    const char* fields = std::strrchr(text,')');
+    unsigned long long user_ticks = 0, system_ticks = 0;
+    if( !fields || std::sscanf(fields + 2,"%*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %llu %llu",
+                               &user_ticks,&system_ticks) != 2 )
+        return false;
+
+    counters.m_cpu_ticks = user_ticks + system_ticks;
+
+    std::snprintf(path,sizeof(path),"/proc/%d/task",int(pid));
+    DIR* tasks = opendir(path);
+    if( !tasks )
+        return false;
+
+    while( dirent* task = readdir(tasks) )
+    {
+        if( task->d_name[0] == '.' )
+            continue;
+
+        std::string status_path = std::string(path) + '/' + task->d_name + "/status";
+        if( !ReadTextFile(status_path.c_str(),text,sizeof(text)) )
+            continue;
+
+        counters.m_voluntary_switches += ReadStatusValue(text,"\nvoluntary_ctxt_switches:");
+        counters.m_involuntary_switches += ReadStatusValue(text,"\nnonvoluntary_ctxt_switches:");
+    }
+
+    closedir(tasks);
+    return true;
+}
+
+// reads what the game writes to the terminal for milliseconds, a game that can't write would stall.
+static void DrainTerminal( int master_fd, int64_t milliseconds, uint64_t& bytes_read )
+{
+    auto end = std::chrono::steady_clock::now() + std::chrono::milliseconds(milliseconds);
+    char buffer[65536];
+
+    for( ;; )
+    {
+        int64_t left = std::chrono::duration_cast<std::chrono::milliseconds>(
+                           end - std::chrono::steady_clock::now()).count();
+        if( left <= 0 )
+            return;
+
+        pollfd descriptor = { master_fd, POLLIN, 0 };
+        int result = poll(&descriptor,1,int(left));
+        if( result < 0 && errno != EINTR )
+            return;
+
+        if( result <= 0 )
+            continue;
+
+        ssize_t size = read(master_fd,buffer,sizeof(buffer));
+
+        // the game closed the terminal, there is nothing more to wait for.
+        if( size <= 0 )
+        {
+            if( size < 0 && errno == EINTR )
+                continue;
+
+            poll(nullptr,0,int(left));
+            return;
+        }
+
+        bytes_read += uint64_t(size);
+    }
+}
+
+static pid_t StartGameInTerminal( const char* path, const char* directory, int& master_fd )
+{
+    master_fd = posix_openpt(O_RDWR | O_NOCTTY | O_CLOEXEC);
+    if( master_fd < 0 )
+        return -1;
+
+    winsize size = {};
+    size.ws_row = CPU_BENCH_TERMINAL_ROWS;
+    size.ws_col = CPU_BENCH_TERMINAL_COLUMNS;
+
+    const char* terminal_name = nullptr;
+    if( grantpt(master_fd) == 0 && unlockpt(master_fd) == 0 )
+        terminal_name = ptsname(master_fd);
+
+    if( !terminal_name || ioctl(master_fd,TIOCSWINSZ,&size) != 0 )
+    {
+        close(master_fd);
+        return -1;
+    }
+
+    std::string terminal_path = terminal_name;
+
+    pid_t pid = fork();
+    if( pid < 0 )
+    {
+        close(master_fd);
+        return -1;
+    }
+
+    if( pid == 0 )
+    {
+        // the terminal becomes the controlling one of a new session, like a shell would have it.
+        setsid();
+        int terminal_fd = open(terminal_path.c_str(),O_RDWR);
+        if( terminal_fd < 0 || ioctl(terminal_fd,TIOCSCTTY,0) != 0 || chdir(directory) != 0 )
+            _exit(127);
+
+        dup2(terminal_fd,STDIN_FILENO);
+        dup2(terminal_fd,STDOUT_FILENO);
+        dup2(terminal_fd,STDERR_FILENO);
+        if( terminal_fd > STDERR_FILENO )
+            close(terminal_fd);
+
+        execl(path,path,static_cast<char*>(nullptr));
+        _exit(127);
+    }
+
+    return pid;
+}
+
+// interrupts the game the way Ctrl+C would and times how long it takes to go away.
+static void StopGameInTerminal( pid_t pid, int master_fd, CpuBenchmarkResult& result )
+{
+    auto start = std::chrono::steady_clock::now();
+    kill(pid,SIGINT);
+
+    uint64_t bytes_read = 0;
+    int status;
+
+    for( ;; )
+    {
+        if( waitpid(pid,&status,WNOHANG) == pid )
+        {
+            result.m_exited = true;
+            break;
+        }
+
+        if( std::chrono::steady_clock::now() - start > std::chrono::milliseconds(CPU_BENCH_EXIT_TIMEOUT) )
+        {
+            kill(pid,SIGKILL);
+            waitpid(pid,&status,0);
+            break;
+        }
+
+        DrainTerminal(master_fd,5,bytes_read);
+    }
+
+    result.m_exit_milliseconds = std::chrono::duration_cast<std::chrono::milliseconds>(
+                                     std::chrono::steady_clock::now() - start).count();
+    close(master_fd);
+}
+
+// whatever the last scenario left behind, the directory itself stays.
+static void ClearDirectory( const char* directory )
+{
+    DIR* entries = opendir(directory);
+    if( !entries )
+        return;
+
+    while( dirent* entry = readdir(entries) )
+    {
+        if( std::strcmp(entry->d_name,".") != 0 && std::strcmp(entry->d_name,"..") != 0 )
+            unlink(( std::string(directory) + '/' + entry->d_name ).c_str());
+    }
+
+    closedir(entries);
+}
+
+static bool WriteSettings( const char* directory, const char* settings )
+{
+    std::string path = std::string(directory) + "/settings.ini";
+    FILE* file = std::fopen(path.c_str(),"w");
+    if( !file )
+        return false;
+
+    bool written = std::fputs(settings,file) >= 0;
+    return std::fclose(file) == 0 && written;
+}
+
+static bool RunCpuBenchmarkScenario( const char* path, const char* directory, const CpuBenchmarkScenario& scenario,
+                                     uint32_t seconds, CpuBenchmarkResult& result )
+{
+    ClearDirectory(directory);
+    if( scenario.m_settings && !WriteSettings(directory,scenario.m_settings) )
+        return false;
+
+    int master_fd;
+    pid_t pid = StartGameInTerminal(path,directory,master_fd);
+    if( pid < 0 )
+        return false;
+
+    uint64_t bytes_read = 0;
+    DrainTerminal(master_fd,CPU_BENCH_KEY_DELAY,bytes_read);
+
+    int64_t key_delay = scenario.m_key_delay ? scenario.m_key_delay : CPU_BENCH_KEY_DELAY;
+    for( const char* key : scenario.m_keys )
+    {
+        if( !key )
+            break;
+
+        if( write(master_fd,key,std::strlen(key)) < 0 )
+            break;
+
+        DrainTerminal(master_fd,key_delay,bytes_read);
+    }
+
+    DrainTerminal(master_fd,CPU_BENCH_SETTLE_DELAY,bytes_read);
+
+    ProcessCounters before, after;
+    auto start = std::chrono::steady_clock::now();
+    bool has_counters = ReadProcessCounters(pid,before);
+
+    bytes_read = 0;
+    DrainTerminal(master_fd,int64_t(seconds) * 1000,bytes_read);
+
+    has_counters = has_counters && ReadProcessCounters(pid,after);
+    result.m_wall_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    StopGameInTerminal(pid,master_fd,result);
+
+    if( !has_counters )
+        return false;
+
+    result.m_cpu_seconds = double(after.m_cpu_ticks - before.m_cpu_ticks) / double(sysconf(_SC_CLK_TCK));
+    result.m_voluntary_switches = after.m_voluntary_switches - before.m_voluntary_switches;
+    result.m_involuntary_switches = after.m_involuntary_switches - before.m_involuntary_switches;
+    result.m_bytes_written = bytes_read;
+
+    return true;
+}
+
+bool RunCpuBenchmark( const char* path, uint32_t seconds, const char* only )
+{
+    char directory[] = "/tmp/snake_cpu_bench_XXXXXX";
+    if( !mkdtemp(directory) )
+    {
+        std::fprintf(stderr,"could not create a working directory for the game.\n");
+        return false;
+    }
+
+    std::printf("%u seconds per scenario, cpu time is counted in %ld ticks per second\n",seconds,
+                sysconf(_SC_CLK_TCK));
+    std::printf("%-18s %14s %12s %14s %14s %10s\n","scenario","cpu ms/minute","wakeups/s","involuntary/s",
+                "bytes/s","exit ms");
+
+    bool succeeded = true;
+    bool found = false;
+
+    for( const CpuBenchmarkScenario& scenario : cpu_benchmark_scenarios )
+    {
+        if( only && std::strcmp(only,scenario.m_name) != 0 )
+            continue;
+
+        found = true;
+
+        CpuBenchmarkResult result;
+        if( !RunCpuBenchmarkScenario(path,directory,scenario,seconds,result) )
+        {
+            std::printf("%-18s could not be run\n",scenario.m_name);
+            succeeded = false;
+            continue;
+        }
+
+        double wall_seconds = result.m_wall_seconds > 0.0 ? result.m_wall_seconds : 1.0;
+        std::printf("%-18s %14.1f %12.1f %14.1f %14.0f %10lld%s\n",scenario.m_name,
+                    result.m_cpu_seconds * 1000.0 * 60.0 / wall_seconds,result.m_voluntary_switches / wall_seconds,
+                    result.m_involuntary_switches / wall_seconds,result.m_bytes_written / wall_seconds,
+                    (long long)result.m_exit_milliseconds,result.m_exited ? "" : "  DIDN'T EXIT, KILLED");
+        std::fflush(stdout);
+
+        succeeded = succeeded && result.m_exited;
+    }
+
+    ClearDirectory(directory);
+    rmdir(directory);
+
+    if( !found )
+    {
+        std::fprintf(stderr,"there is no scenario named %s.\n",only);
+        return false;
+    }
+
+    return succeeded;
+}
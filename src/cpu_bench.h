@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstdint>
+
+#define CPU_BENCH_DEFAULT_SECONDS               10
+#define CPU_BENCH_KEY_DELAY                     300 // milliseconds between the keys of a scenario.
+#define CPU_BENCH_SETTLE_DELAY                  1000 // after the last key, before measuring starts.
+#define CPU_BENCH_EXIT_TIMEOUT                  2000 // milliseconds the game gets to exit after SIGINT.
+#define CPU_BENCH_TERMINAL_COLUMNS              200
+#define CPU_BENCH_TERMINAL_ROWS                 60
+
+// what a scenario cost while it sat in the state it's keys led to. ticks and switches are summed over all the
+// threads of the game, a voluntary switch is a thread going to sleep, so it's also how often one was woken up.
+struct CpuBenchmarkResult
+{
+    CpuBenchmarkResult() : m_wall_seconds(0.0), m_cpu_seconds(0.0), m_voluntary_switches(0),
+                           m_involuntary_switches(0), m_bytes_written(0), m_exit_milliseconds(0), m_exited(false) {}
+
+    double m_wall_seconds;
+    double m_cpu_seconds;
+    uint64_t m_voluntary_switches;
+    uint64_t m_involuntary_switches;
+    uint64_t m_bytes_written;       // to the terminal.
+    int64_t m_exit_milliseconds;    // from SIGINT until the game was gone.
+    bool m_exited;                  // false if it was still running after CPU_BENCH_EXIT_TIMEOUT.
+};
+
+// runs the game binary at path in a pseudo terminal once per scenario, from an empty working directory so none
+// of the player's files are touched. each scenario types it's keys, waits CPU_BENCH_SETTLE_DELAY and then
+// measures for seconds before interrupting the game. only the scenario named only is run when it's set.
+// prints a line per scenario, returns false if a scenario couldn't be run or the game didn't exit on SIGINT.
+bool RunCpuBenchmark( const char* path, uint32_t seconds, const char* only );
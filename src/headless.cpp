@@ -0,0 +1,930 @@
+#include "headless.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+#include "arena.h"
+#include "arena_server.h"
+#include "snake_game.h"
+#include "reachability.h"
+#include "search.h"
+#include "sparse_board.h"
+#include "level.h"
+#include "level_generator.h"
+#include "analytics_log.h"
+#include "items.h"
+#include "replay.h"
+#include "score_writer.h"
+#include "cpu_bench.h"
+#include "perf_counters.h"
+#include "soak.h"
+
+// opened by --counters, the benchmarks read them around their loops. left closed they cost nothing.
+static PerfCounters perf_counters;
+
+// set by the executable, libsnake has no heap counters of it's own.
+static const std::atomic<uint64_t>* heap_allocations = nullptr;
+static const std::atomic<uint64_t>* heap_deallocations = nullptr;
+
+static uint32_t ReadArgument( int argc, char** argv, int index, uint32_t default_value )
+{
+    if( index >= argc )
+        return default_value;
+
+    long value = std::strtol(argv[index],nullptr,10);
+
+    return value > 0 ? uint32_t(value) : default_value;
+}
+
+// a line under the one of the benchmark, only when the counters are open.
+static void PrintPerfCounterValues( const char* label, const PerfCounterValues& values, uint64_t tick_count )
+{
+    if( !HasPerfCounters(perf_counters) )
+        return;
+
+    char text[256];
+    FormatPerfCounterValues(values,tick_count,text,sizeof(text));
+    std::cout << "  " << label << ' ' << text << '\n';
+}
+
+// how moving worked before the neighbor tables, with the border wrap done by hand. kept here as the baseline.
+static uint32_t MoveCellWithSwitch( const SnakeGameState& state, uint32_t cell, uint8_t direction )
+{
+    uint32_t x = cell % state.m_size_x, y = cell / state.m_size_x;
+    bool wrap = state.m_rules & SNAKE_RULE_PASS_BORDERS;
+
+    switch( direction )
+    {
+        case SNAKE_DIRECTION_UP:
+            if( wrap && y == 1 )
+                return x + ( state.m_size_y - 2 ) * state.m_size_x;
+
+            return cell - state.m_size_x;
+
+        case SNAKE_DIRECTION_LEFT:
+            if( wrap && x == 1 )
+                return state.m_size_x - 2 + y * state.m_size_x;
+
+            return cell - 1;
+
+        case SNAKE_DIRECTION_DOWN:
+            if( wrap && y == state.m_size_y - 2u )
+                return x + state.m_size_x;
+
+            return cell + state.m_size_x;
+
+        case SNAKE_DIRECTION_RIGHT:
+            if( wrap && x == state.m_size_x - 2u )
+                return 1 + y * state.m_size_x;
+
+            return cell + 1;
+    }
+
+    return cell;
+}
+
+// a random walk that stays put instead of walking into a wall. both ways of moving must give the same walk.
+template<typename MoveFunction>
+static uint64_t WalkSnakeField( const SnakeGameState& state, const std::vector<uint8_t>& directions,
+                                MoveFunction move, double& nanoseconds_per_move )
+{
+    uint32_t cell = state.m_size_x + 1;
+    uint64_t checksum = 0;
+
+    auto start = std::chrono::steady_clock::now();
+
+    for( uint8_t direction : directions )
+    {
+        uint32_t next = move(cell,direction);
+        cell = ( state.m_field[next] == SNAKE_CELL_WALL ) ? cell : next;
+        checksum = checksum * 31 + cell;
+    }
+
+    auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+    nanoseconds_per_move = double(elapsed.count()) / directions.size();
+
+    return checksum;
+}
+
+static int RunMoveBenchmark( int argc, char** argv )
+{
+    uint32_t size = ReadArgument(argc,argv,2,256);
+    uint32_t move_count = ReadArgument(argc,argv,3,50000000);
+
+    if( size < SNAKE_GAME_MIN_SIZE || size > SNAKE_GAME_MAX_SIZE )
+    {
+        std::cerr << "board size must be between " << SNAKE_GAME_MIN_SIZE << " and " << SNAKE_GAME_MAX_SIZE << ".\n";
+        return EXIT_FAILURE;
+    }
+
+    std::vector<uint8_t> directions(move_count);
+    uint64_t random = 0x2545f4914f6cdd1dULL;
+    for( uint8_t& direction : directions )
+    {
+        random ^= random << 13;
+        random ^= random >> 7;
+        random ^= random << 17;
+        direction = uint8_t(SNAKE_DIRECTION_UP + ( random >> 62 ));
+    }
+
+    GameArena arena;
+    if( !arena.Reserve(ComputeSnakeGameMemorySize(uint16_t(size),uint16_t(size))) )
+    {
+        std::cerr << "could not allocate the board.\n";
+        return EXIT_FAILURE;
+    }
+
+    std::cout << "moves:" << move_count << " board:" << size << 'x' << size << '\n';
+
+    for( uint8_t rules : { uint8_t(0), uint8_t(SNAKE_RULE_PASS_BORDERS) } )
+    {
+        SnakeGameState state;
+        arena.Reset();
+        InitializeSnakeGameState(state,arena,uint16_t(size),uint16_t(size),1,rules);
+
+        double switch_time, table_time;
+        uint64_t switch_checksum = WalkSnakeField(state,directions,[&]( uint32_t cell, uint8_t direction )
+        {
+            return MoveCellWithSwitch(state,cell,direction);
+        },switch_time);
+
+        uint64_t table_checksum = WalkSnakeField(state,directions,[&]( uint32_t cell, uint8_t direction )
+        {
+            return state.Neighbor(cell,direction);
+        },table_time);
+
+        std::cout << ( rules ? "passing borders" : "solid borders  " ) << "  switch:" << switch_time
+                  << "ns/move  table:" << table_time << "ns/move"
+                  << ( switch_checksum == table_checksum ? "" : "  WALKS DIFFER!" ) << '\n';
+
+        if( switch_checksum != table_checksum )
+            return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
+
+static int RunBatch( int argc, char** argv )
+{
+    uint32_t game_count = ReadArgument(argc,argv,2,20);
+    uint32_t size = ReadArgument(argc,argv,3,20);
+    uint32_t depth = ReadArgument(argc,argv,4,6);
+    uint32_t rules = ( argc > 5 ) ? uint32_t(std::strtol(argv[5],nullptr,10)) : 0;
+    const char* log_path = ( argc > 6 && argv[6][0] ) ? argv[6] : nullptr;
+    const char* replay_path = ( argc > 7 ) ? argv[7] : nullptr;
+
+    if( size < SNAKE_GAME_MIN_SIZE || size > SNAKE_GAME_MAX_SIZE || depth > SNAKE_SEARCH_MAX_DEPTH ||
+        ( rules & ~SNAKE_RULE_ALL ) )
+    {
+        std::cerr << "usage: --batch [games] [size 4-" << SNAKE_GAME_MAX_SIZE << "] [depth 1-"
+                  << SNAKE_SEARCH_MAX_DEPTH << "] [rules 0-" << SNAKE_RULE_ALL << "] [log file] [replay file]\n";
+        return EXIT_FAILURE;
+    }
+
+    AnalyticsLog log;
+    if( log_path && !OpenAnalyticsLog(log,log_path) )
+    {
+        std::cerr << "could not open the log " << log_path << ".\n";
+        return EXIT_FAILURE;
+    }
+
+    GameArena arena;
+    SnakeSearchContext search;
+    SnakeReachability reachability;
+    ReplayRecorder recorder;
+    uint32_t replay_count = 0;
+    search.m_depth = uint8_t(depth);
+
+    uint32_t won = 0, lost = 0, doomed = 0, stalled = 0;
+    uint64_t total_score = 0, total_ticks = 0, total_sweeps = 0;
+    int64_t fill_nanoseconds = 0;
+
+    auto start = std::chrono::steady_clock::now();
+    StartPerfCounters(perf_counters);
+
+    for( uint32_t game = 0; game < game_count; ++game )
+    {
+        auto game_start = std::chrono::steady_clock::now();
+        SnakeGameState state;
+        arena.Reset();
+        if( !arena.Reserve(ComputeSnakeGameMemorySize(uint16_t(size),uint16_t(size))) ||
+            !InitializeSnakeGameState(state,arena,uint16_t(size),uint16_t(size),game + 1,uint8_t(rules)) )
+        {
+            std::cerr << "could not allocate the board.\n";
+            return EXIT_FAILURE;
+        }
+
+        uint64_t random_state = state.m_random_state;
+        StartSnakeGameState(state);
+        BeginReplay(recorder,state,random_state,0);
+
+        // the autopilot can go around in circles forever when it can't get to the food.
+        uint64_t tick_limit = uint64_t(state.CellCount()) * 16;
+        bool is_doomed = false;
+
+        while( state.m_status == GAME_STATUS_ONGOING && state.m_tick < tick_limit )
+        {
+            auto fill_start = std::chrono::steady_clock::now();
+            is_doomed = IsSnakeGameDoomed(reachability,state) || is_doomed;
+            fill_nanoseconds += std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                    std::chrono::steady_clock::now() - fill_start).count();
+            total_sweeps += reachability.m_sweep_count;
+            ++total_ticks;
+
+            // a recorded game is played out, only a game that ended can be verified.
+            if( is_doomed && !replay_path )
+                break;
+
+            StepSnakeGame(state,SearchSnakeMove(search,state));
+            RecordReplayTick(recorder,state.m_direction);
+        }
+
+        if( replay_path && state.m_status != GAME_STATUS_ONGOING &&
+            FinishReplay(recorder,"batch",state.m_score) && AppendReplay(replay_path,recorder.m_replay) )
+            ++replay_count;
+
+        won += state.m_status == GAME_STATUS_WON;
+        lost += state.m_status == GAME_STATUS_LOST;
+        doomed += is_doomed;
+        stalled += state.m_status == GAME_STATUS_ONGOING && !is_doomed;
+        total_score += state.m_score;
+
+        if( log_path )
+        {
+            GameAnalyticsRecord record;
+            record.m_end_time = uint64_t(time(NULL));
+            record.m_duration_milliseconds = uint32_t(std::chrono::duration_cast<std::chrono::milliseconds>(
+                                                          std::chrono::steady_clock::now() - game_start).count());
+            record.m_ticks = uint32_t(state.m_tick);
+            record.m_score = state.m_score;
+            record.m_length = state.m_length;
+            record.m_size_x = state.m_size_x;
+            record.m_size_y = state.m_size_y;
+            record.m_rules = state.m_rules;
+            record.m_end_cause = GetSnakeGameEndCause(state);
+            record.m_flags = ANALYTICS_FLAG_AUTOPILOT | ANALYTICS_FLAG_HEADLESS;
+            std::memcpy(record.m_player_name,"batch",5);
+
+            AppendAnalyticsRecord(log,record);
+        }
+    }
+
+    PerfCounterValues counter_values;
+    StopPerfCounters(perf_counters,counter_values);
+    CloseAnalyticsLog(log);
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::cout << "games:" << game_count << " board:" << size << 'x' << size << " depth:" << depth
+              << " rules:" << rules << '\n'
+              << "won:" << won << " lost:" << lost << " ended doomed:" << doomed << " stalled:" << stalled << '\n'
+              << "average score:" << ( game_count ? double(total_score) / game_count : 0.0 )
+              << " ticks:" << total_ticks << " in " << seconds << "s\n"
+              << "reachability:" << ( total_ticks ? double(fill_nanoseconds) / total_ticks / 1000.0 : 0.0 )
+              << "us per tick, " << ( total_ticks ? double(total_sweeps) / total_ticks : 0.0 )
+              << " sweeps per tick\n";
+
+    PrintPerfCounterValues("games",counter_values,total_ticks);
+
+    if( replay_path )
+        std::cout << "replays:" << replay_count << " appended to " << replay_path << '\n';
+
+    return EXIT_SUCCESS;
+}
+
+// steers straight at the food and only turns away from walls and the body, cheap enough that the benchmark
+// measures the board and not the player. Free says whether the cell a direction leads to can be entered.
+template<typename FreeFunction>
+static uint8_t PickGreedyDirection( uint64_t head_x, uint64_t head_y, uint64_t food_x, uint64_t food_y,
+                                    FreeFunction is_free )
+{
+    uint8_t wanted[4];
+    uint8_t wanted_count = 0;
+
+    if( food_y < head_y ) wanted[wanted_count++] = SNAKE_DIRECTION_UP;
+    if( food_x < head_x ) wanted[wanted_count++] = SNAKE_DIRECTION_LEFT;
+    if( food_y > head_y ) wanted[wanted_count++] = SNAKE_DIRECTION_DOWN;
+    if( food_x > head_x ) wanted[wanted_count++] = SNAKE_DIRECTION_RIGHT;
+
+    for( uint8_t i = 0; i < wanted_count; ++i )
+    {
+        if( is_free(wanted[i]) )
+            return wanted[i];
+    }
+
+    for( uint8_t direction = SNAKE_DIRECTION_UP; direction <= SNAKE_DIRECTION_RIGHT; ++direction )
+    {
+        if( is_free(direction) )
+            return direction;
+    }
+
+    return SNAKE_DIRECTION_NONE;
+}
+
+// plays tick_count ticks on the dense board and returns nanoseconds per tick, a lost game is restarted.
+static double BenchmarkDenseBoard( uint32_t size, uint64_t tick_count, std::size_t& memory, uint64_t& food_count,
+                                   PerfCounterValues& counter_values )
+{
+    GameArena arena;
+    SnakeGameState state;
+    memory = ComputeSnakeGameMemorySize(uint16_t(size),uint16_t(size));
+    food_count = 0;
+
+    if( !arena.Reserve(memory) || !InitializeSnakeGameState(state,arena,uint16_t(size),uint16_t(size),1) )
+        return -1.0;
+
+    StartSnakeGameState(state);
+    StartPerfCounters(perf_counters);
+
+    auto start = std::chrono::steady_clock::now();
+
+    for( uint64_t tick = 0; tick < tick_count; ++tick )
+    {
+        uint32_t head = state.Head();
+        uint8_t direction = PickGreedyDirection(head % size,head / size,state.m_food % size,state.m_food / size,
+                                                [&]( uint8_t candidate )
+        {
+            char target = state.m_field[state.Neighbor(head,candidate)];
+            return target == SNAKE_CELL_EMPTY || target == SNAKE_CELL_FOOD ||
+                   state.Neighbor(head,candidate) == state.BodyCell(state.m_length - 1);
+        });
+
+        int32_t score = state.m_score;
+        if( StepSnakeGame(state,direction) != GAME_STATUS_ONGOING )
+            StartSnakeGameState(state);
+
+        food_count += state.m_score > score;
+    }
+
+    auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+    StopPerfCounters(perf_counters,counter_values);
+
+    return double(elapsed.count()) / tick_count;
+}
+
+static double BenchmarkSparseBoard( uint32_t size, uint64_t tick_count, std::size_t& memory, uint64_t& food_count,
+                                    uint32_t& chunk_count, std::size_t& length, PerfCounterValues& counter_values )
+{
+    SparseSnakeGame game;
+    food_count = 0;
+    memory = 0;
+    chunk_count = 0;
+    length = 0;
+
+    if( !InitializeSparseSnakeGame(game,size,size,1) )
+        return -1.0;
+
+    StartSparseSnakeGame(game);
+    StartPerfCounters(perf_counters);
+
+    auto start = std::chrono::steady_clock::now();
+
+    for( uint64_t tick = 0; tick < tick_count; ++tick )
+    {
+        SparseCell head = game.m_body.front();
+        SparseCell tail = game.m_body.back();
+        uint8_t direction = PickGreedyDirection(GetSparseCellX(head),GetSparseCellY(head),GetSparseCellX(game.m_food),
+                                                GetSparseCellY(game.m_food),[&]( uint8_t candidate )
+        {
+            SparseCell target = GetSparseNeighbor(game,head,candidate);
+            return target == tail || ( !IsSparseCellWall(game,target) && !IsSparseCellBody(game,target) );
+        });
+
+        int32_t score = game.m_score;
+        if( StepSparseSnakeGame(game,direction) != GAME_STATUS_ONGOING )
+            StartSparseSnakeGame(game);
+
+        food_count += game.m_score > score;
+
+        if( game.m_body.size() > length )
+        {
+            length = game.m_body.size();
+            memory = ComputeSparseMemoryUsage(game);
+            chunk_count = GetSparseChunkCount(game);
+        }
+    }
+
+    auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+    StopPerfCounters(perf_counters,counter_values);
+
+    return double(elapsed.count()) / tick_count;
+}
+
+static int RunSparseBenchmark( int argc, char** argv )
+{
+    uint64_t tick_count = ReadArgument(argc,argv,2,2000000);
+
+    std::cout << "ticks:" << tick_count << " per board, memory is at the longest the snake got\n";
+
+    for( uint32_t size : { 64u, 1024u, 4096u, 100000u, 1000000u, 100000000u } )
+    {
+        PerfCounterValues dense_values, sparse_values;
+        std::cout << "board:" << size << 'x' << size;
+
+        if( size <= SNAKE_GAME_MAX_SIZE )
+        {
+            std::size_t memory;
+            uint64_t food_count;
+            double nanoseconds = BenchmarkDenseBoard(size,tick_count,memory,food_count,dense_values);
+            std::cout << "  dense:" << nanoseconds << "ns/tick " << memory / 1024 << "KB " << food_count << " food";
+        }
+
+        else
+        {
+            std::cout << "  dense:doesn't fit";
+        }
+
+        std::size_t memory, length;
+        uint64_t food_count;
+        uint32_t chunk_count;
+        double nanoseconds = BenchmarkSparseBoard(size,tick_count,memory,food_count,chunk_count,length,
+                                                  sparse_values);
+
+        std::cout << "  sparse:" << nanoseconds << "ns/tick " << memory / 1024 << "KB " << chunk_count << " chunks "
+                  << food_count << " food, longest:" << length << '\n';
+
+        if( size <= SNAKE_GAME_MAX_SIZE )
+            PrintPerfCounterValues("dense ",dense_values,tick_count);
+
+        PrintPerfCounterValues("sparse",sparse_values,tick_count);
+    }
+
+    return EXIT_SUCCESS;
+}
+
+// what happened to the items over a benchmark, summed over the games it restarted.
+struct ItemBenchmarkCounts
+{
+    uint64_t m_spawned;
+    uint64_t m_expired;
+    uint64_t m_picked_up[ITEM_KIND_COUNT];
+    uint64_t m_failed_spawns;
+};
+
+static void AddItemBenchmarkCounts( ItemBenchmarkCounts& counts, const ItemField& items )
+{
+    counts.m_spawned += items.m_spawned_count;
+    counts.m_expired += items.m_expired_count;
+    counts.m_failed_spawns += items.m_failed_spawn_count;
+
+    for( uint8_t kind = 0; kind < ITEM_KIND_COUNT; ++kind )
+        counts.m_picked_up[kind] += items.m_picked_up_counts[kind];
+}
+
+// plays tick_count ticks with upto item_count items on the board and returns nanoseconds per tick. the greedy
+// player goes for the regular food and walks over whatever items are in the way, a lost game is restarted.
+static double BenchmarkItemBoard( uint32_t size, uint32_t item_count, uint64_t tick_count, uint32_t& capacity,
+                                  std::size_t& memory, ItemBenchmarkCounts& counts, PerfCounterValues& counter_values )
+{
+    GameArena arena, item_arena;
+    SnakeGameState state;
+    ItemField items;
+    counts = ItemBenchmarkCounts();
+    memory = 0;
+
+    if( !arena.Reserve(ComputeSnakeGameMemorySize(uint16_t(size),uint16_t(size))) ||
+        !InitializeSnakeGameState(state,arena,uint16_t(size),uint16_t(size),1) )
+        return -1.0;
+
+    StartSnakeGameState(state);
+    capacity = ComputeItemCapacity(state,item_count);
+    if( !InitializeItemField(items,item_arena,state,capacity) )
+        return -1.0;
+
+    memory = item_arena.m_used;
+    StartPerfCounters(perf_counters);
+
+    auto start = std::chrono::steady_clock::now();
+
+    for( uint64_t tick = 0; tick < tick_count; ++tick )
+    {
+        uint32_t head = state.Head();
+        uint8_t direction = PickGreedyDirection(head % size,head / size,state.m_food % size,state.m_food / size,
+                                                [&]( uint8_t candidate )
+        {
+            uint32_t next = state.Neighbor(head,candidate);
+            char target = state.m_field[next];
+            return ( target != SNAKE_CELL_WALL && target != SNAKE_CELL_BODY && target != SNAKE_CELL_HEAD ) ||
+                   next == state.BodyCell(state.m_length - 1);
+        });
+
+        int32_t score = state.m_score;
+        StepSnakeGame(state,direction);
+        UpdateItemField(items,state,score);
+
+        if( state.m_status != GAME_STATUS_ONGOING )
+        {
+            AddItemBenchmarkCounts(counts,items);
+            StartSnakeGameState(state);
+            InitializeItemField(items,item_arena,state,capacity);
+        }
+    }
+
+    auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+    StopPerfCounters(perf_counters,counter_values);
+    AddItemBenchmarkCounts(counts,items);
+
+    return double(elapsed.count()) / tick_count;
+}
+
+static int RunItemBenchmark( int argc, char** argv )
+{
+    uint32_t item_count = ReadArgument(argc,argv,2,50000);
+    uint64_t tick_count = ReadArgument(argc,argv,3,1000000);
+
+    std::cout << "ticks:" << tick_count << " per board, items:" << item_count
+              << " asked for ( a board holds atmost 1/" << ITEM_MAX_BOARD_SHARE << " of it's cells in items )\n";
+
+    for( uint32_t size : { 64u, 512u, 2048u, 4096u } )
+    {
+        uint32_t capacity;
+        std::size_t memory;
+        ItemBenchmarkCounts counts;
+        PerfCounterValues plain_values, item_values;
+
+        double plain = BenchmarkItemBoard(size,0,tick_count,capacity,memory,counts,plain_values);
+        double nanoseconds = BenchmarkItemBoard(size,item_count,tick_count,capacity,memory,counts,item_values);
+
+        std::cout << "board:" << size << 'x' << size << "  without items:" << plain << "ns/tick  with " << capacity
+                  << " items:" << nanoseconds << "ns/tick " << memory / 1024 << "KB  spawned:" << counts.m_spawned
+                  << " expired:" << counts.m_expired << " failed spawns:" << counts.m_failed_spawns << " picked up:"
+                  << counts.m_picked_up[ITEM_KIND_FOOD] << " food " << counts.m_picked_up[ITEM_KIND_SPEED]
+                  << " speed " << counts.m_picked_up[ITEM_KIND_SHRINK] << " shrink "
+                  << counts.m_picked_up[ITEM_KIND_MULTIPLIER] << " multiplier\n";
+
+        PrintPerfCounterValues("without items",plain_values,tick_count);
+        PrintPerfCounterValues("with items   ",item_values,tick_count);
+    }
+
+    return EXIT_SUCCESS;
+}
+
+// turns a text layout into a level file: every line is a row, '#' is a wall and anything else is open. short
+// lines are padded with open cells and the border is always made a wall.
+static int RunMakeLevel( int argc, char** argv )
+{
+    if( argc < 4 )
+    {
+        std::cerr << "usage: --make-level <layout text file> <level file> [name]\n";
+        return EXIT_FAILURE;
+    }
+
+    std::ifstream reader(argv[2]);
+    if( !reader )
+    {
+        std::cerr << "could not open " << argv[2] << ".\n";
+        return EXIT_FAILURE;
+    }
+
+    std::vector<std::string> rows;
+    std::size_t size_x = 0;
+
+    for( std::string row; std::getline(reader,row); )
+    {
+        if( !row.empty() && row.back() == '\r' )
+            row.pop_back();
+
+        rows.push_back(row);
+        size_x = ( row.size() > size_x ) ? row.size() : size_x;
+    }
+
+    if( size_x < SNAKE_GAME_MIN_SIZE || rows.size() < SNAKE_GAME_MIN_SIZE || size_x > SNAKE_GAME_MAX_SIZE ||
+        rows.size() > SNAKE_GAME_MAX_SIZE )
+    {
+        std::cerr << "a level must be between " << SNAKE_GAME_MIN_SIZE << " and " << SNAKE_GAME_MAX_SIZE
+                  << " cells on each side.\n";
+        return EXIT_FAILURE;
+    }
+
+    std::string layout;
+    layout.reserve(size_x * rows.size());
+    for( std::string& row : rows )
+    {
+        row.resize(size_x,' ');
+        layout += row;
+    }
+
+    const char* name = ( argc > 4 ) ? argv[4] : argv[3];
+    if( !WriteSnakeLevel(argv[3],name,uint16_t(size_x),uint16_t(rows.size()),layout.c_str()) )
+    {
+        std::cerr << "could not write " << argv[3] << ".\n";
+        return EXIT_FAILURE;
+    }
+
+    // the game only takes levels that pass the checks on load, so check right away.
+    SnakeLevel level;
+    if( !LoadSnakeLevel(level,argv[3]) )
+    {
+        std::cerr << argv[3] << " was written but is not a valid level: the open cells must all be connected and "
+                  << "there must be room to start somewhere.\n";
+        return EXIT_FAILURE;
+    }
+
+    std::cout << level.m_name << ": " << level.m_size_x << 'x' << level.m_size_y << ", " << level.m_wall_count
+              << " walls, " << level.m_spawn_cell_count << " spawn cells\n";
+
+    return EXIT_SUCCESS;
+}
+
+// generates a level and prints what it took, a written level is loaded back to check it the way the game does.
+static int RunLevelGenerator( int argc, char** argv )
+{
+    uint8_t kind = ( argc > 2 ) ? FindLevelGenerator(argv[2]) : LEVEL_GENERATOR_KIND_COUNT;
+    uint32_t size = ReadArgument(argc,argv,3,SNAKE_GAME_MAX_SIZE);
+    uint64_t seed = ( argc > 4 ) ? std::strtoull(argv[4],nullptr,10) : 1;
+    const char* path = ( argc > 5 && argv[5][0] ) ? argv[5] : nullptr;
+    uint32_t thread_count = ReadArgument(argc,argv,6,0);
+
+    if( kind == LEVEL_GENERATOR_KIND_COUNT || size < SNAKE_GAME_MIN_SIZE || size > SNAKE_GAME_MAX_SIZE )
+    {
+        std::cerr << "usage: --generate-level <maze | caves | obstacles> [size " << SNAKE_GAME_MIN_SIZE << '-'
+                  << SNAKE_GAME_MAX_SIZE << "] [seed] [level file] [threads]\n";
+        return EXIT_FAILURE;
+    }
+
+    SnakeLevel level;
+    GameArena arena;
+    auto start = std::chrono::steady_clock::now();
+
+    if( !GenerateSnakeLevel(level,arena,kind,uint16_t(size),uint16_t(size),seed,thread_count) )
+    {
+        std::cerr << "no " << GetLevelGeneratorName(kind) << " level fits on a " << size << 'x' << size << " board.\n";
+        return EXIT_FAILURE;
+    }
+
+    double milliseconds = std::chrono::duration<double,std::milli>(std::chrono::steady_clock::now() - start).count();
+    uint32_t cell_count = size * size;
+
+    std::cout << level.m_name << "  board:" << size << 'x' << size << " walls:" << level.m_wall_count << " ( "
+              << 100.0 * level.m_wall_count / cell_count << "% ) spawn cells:" << level.m_spawn_cell_count
+              << " in " << milliseconds << "ms\n";
+
+    if( !path )
+        return EXIT_SUCCESS;
+
+    SnakeLevel loaded;
+    if( !SaveSnakeLevel(path,level) || !LoadSnakeLevel(loaded,path) )
+    {
+        std::cerr << "could not write a valid level to " << path << ".\n";
+        return EXIT_FAILURE;
+    }
+
+    std::cout << "written to " << path << '\n';
+
+    return EXIT_SUCCESS;
+}
+
+// plays every game of the replay log again on all cores, then keeps only the scores whose replay is in the log,
+// played out and ended with the name and score the scores file says. the file is only rewritten when a score
+// was thrown out.
+static int RunScoreVerifier( int argc, char** argv )
+{
+    const char* scores_path = ( argc > 2 ) ? argv[2] : SCORES_FILE_NAME;
+    const char* replay_path = ( argc > 3 ) ? argv[3] : REPLAY_LOG_FILE_NAME;
+    uint32_t thread_count = ReadArgument(argc,argv,4,0);
+
+    // no log just means no game was recorded, every score with a replay id is thrown out then.
+    std::vector<uint8_t> data;
+    std::ifstream reader(replay_path,std::ios::binary);
+    if( reader )
+    {
+        reader.seekg(0,std::ios::end);
+        data.resize(std::size_t(reader.tellg()));
+        reader.seekg(0,std::ios::beg);
+        reader.read(reinterpret_cast<char*>(data.data()),std::streamsize(data.size()));
+
+        if( !reader )
+        {
+            std::cerr << "could not read " << replay_path << ".\n";
+            return EXIT_FAILURE;
+        }
+    }
+
+    std::vector<ReplayLogEntry> entries;
+    uint64_t corrupt_count = 0;
+    if( !data.empty() && !IndexReplayLog(data.data(),data.size(),entries,corrupt_count) )
+    {
+        std::cerr << replay_path << " is not a replay log.\n";
+        return EXIT_FAILURE;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<uint8_t> verified;
+    VerifyReplayLog(data.data(),entries,thread_count,verified);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::size_t verified_count = 0;
+    for( uint8_t is_verified : verified )
+        verified_count += is_verified;
+
+    std::cout << "replays:" << entries.size() << " verified:" << verified_count
+              << " failed:" << entries.size() - verified_count << " corrupt:" << corrupt_count
+              << " in " << seconds << "s, " << ( seconds > 0.0 ? entries.size() / seconds : 0.0 )
+              << " replays per second\n";
+
+    ScoreSubmission records[SCORE_RECORDS_LIMIT];
+    uint32_t count = ReadScoreRecords(scores_path,records);
+    uint32_t kept = 0;
+
+    for( uint32_t i = 0; i < count; ++i )
+    {
+        const ScoreSubmission& record = records[i];
+        const char* reason = nullptr;
+
+        auto entry = std::lower_bound(entries.begin(),entries.end(),record.m_replay_id,
+                                      []( const ReplayLogEntry& a, uint64_t id ) { return a.m_id < id; });
+        GameReplay replay;
+
+        if( !record.m_replay_id )
+            reason = "has no replay";
+
+        else if( entry == entries.end() || entry->m_id != record.m_replay_id )
+            reason = "has a replay that isn't in the log";
+
+        else if( !verified[entry - entries.begin()] )
+            reason = "has a replay that doesn't play out";
+
+        else if( !DecodeReplay(data.data() + entry->m_offset,entry->m_size,replay) ||
+                 replay.m_score != record.m_score || std::strcmp(replay.m_player_name,record.m_player_name) != 0 )
+            reason = "has the replay of an other score";
+
+        if( reason )
+            std::cout << "rejected " << record.m_player_name << ' ' << record.m_score << ": " << reason << '\n';
+        else
+            records[kept++] = record;
+    }
+
+    std::cout << "scores:" << count << " kept:" << kept << " rejected:" << count - kept << '\n';
+
+    if( kept != count && !WriteScoreRecords(scores_path,records,kept) )
+    {
+        std::cerr << "could not write " << scores_path << ".\n";
+        return EXIT_FAILURE;
+    }
+
+    return kept == count ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+static int RunCpuBenchmarkCommand( int argc, char** argv )
+{
+    uint32_t seconds = ReadArgument(argc,argv,2,CPU_BENCH_DEFAULT_SECONDS);
+    const char* only = ( argc > 3 ) ? argv[3] : nullptr;
+
+    // the game that is benchmarked is this very binary.
+    char path[4096];
+    ssize_t size = readlink("/proc/self/exe",path,sizeof(path) - 1);
+    if( size <= 0 )
+    {
+        std::cerr << "could not find the game's binary.\n";
+        return EXIT_FAILURE;
+    }
+
+    path[size] = '\0';
+
+    return RunCpuBenchmark(path,seconds,only) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+static int RunArenaServerCommand( int argc, char** argv )
+{
+    ArenaServerOptions options;
+
+    // a number is a TCP port, anything else the path of a unix socket.
+    if( argc > 2 )
+    {
+        char* end;
+        long port = std::strtol(argv[2],&end,10);
+
+        if( *end == '\0' && port > 0 && port < 65536 )
+            options.m_port = uint16_t(port);
+        else
+            options.m_unix_path = argv[2];
+    }
+
+    uint32_t size = ReadArgument(argc,argv,3,20);
+    uint32_t rules = ( argc > 4 ) ? uint32_t(std::strtol(argv[4],nullptr,10)) : 0;
+    options.m_deadline_milliseconds = ReadArgument(argc,argv,5,ARENA_SERVER_DEFAULT_DEADLINE);
+    options.m_worker_count = ReadArgument(argc,argv,6,0);
+
+    if( size < SNAKE_GAME_MIN_SIZE || size > SNAKE_GAME_MAX_SIZE || ( rules & ~SNAKE_RULE_ALL ) )
+    {
+        std::cerr << "usage: --arena-server [port | socket path] [size 4-" << SNAKE_GAME_MAX_SIZE << "] [rules 0-"
+                  << SNAKE_RULE_ALL << "] [deadline ms] [workers]\n";
+        return EXIT_FAILURE;
+    }
+
+    options.m_size_x = options.m_size_y = uint16_t(size);
+    options.m_rules = uint8_t(rules);
+
+    return RunArenaServer(options) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+static int RunSoakCommand( int argc, char** argv )
+{
+    SoakOptions options;
+    options.m_game_count = ReadArgument(argc,argv,2,options.m_game_count);
+    options.m_size = ReadArgument(argc,argv,3,options.m_size);
+    options.m_item_count = ReadArgument(argc,argv,5,0);
+    options.m_report_interval = ReadArgument(argc,argv,6,options.m_report_interval);
+    options.m_seed = ( argc > 7 ) ? std::strtoull(argv[7],nullptr,10) : options.m_seed;
+    options.m_heap_allocations = heap_allocations;
+    options.m_heap_deallocations = heap_deallocations;
+
+    // an empty rules argument cycles through all of them, like leaving it out.
+    uint32_t rules = ( argc > 4 && argv[4][0] ) ? uint32_t(std::strtol(argv[4],nullptr,10)) : SOAK_RULES_CYCLE;
+
+    if( options.m_size < SNAKE_GAME_MIN_SIZE || options.m_size > SNAKE_GAME_MAX_SIZE ||
+        ( rules != SOAK_RULES_CYCLE && ( rules & ~SNAKE_RULE_ALL ) ) )
+    {
+        std::cerr << "usage: --soak [games] [size " << SNAKE_GAME_MIN_SIZE << '-' << SNAKE_GAME_MAX_SIZE
+                  << "] [rules 0-" << SNAKE_RULE_ALL << "] [items] [report every] [seed]\n";
+        return EXIT_FAILURE;
+    }
+
+    options.m_rules = uint8_t(rules);
+
+    return RunSoakTest(options) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+void SetHeadlessHeapCounters( const std::atomic<uint64_t>* allocations, const std::atomic<uint64_t>* deallocations )
+{
+    heap_allocations = allocations;
+    heap_deallocations = deallocations;
+}
+
+bool IsHeadlessCommand( int argc, char** argv )
+{
+    return argc > 1 && std::strncmp(argv[1],"--",2) == 0;
+}
+
+// takes --counters out of the arguments wherever it is and opens the counters for the benchmarks.
+static void OpenPerfCountersIfAsked( int& argc, char** argv )
+{
+    bool asked = false;
+    int kept = 2;
+
+    for( int i = 2; i < argc; ++i )
+    {
+        if( std::strcmp(argv[i],"--counters") == 0 )
+            asked = true;
+        else
+            argv[kept++] = argv[i];
+    }
+
+    argc = kept;
+
+    if( asked && !OpenPerfCounters(perf_counters) )
+    {
+        int paranoid = -1;
+        std::ifstream("/proc/sys/kernel/perf_event_paranoid") >> paranoid;
+
+        std::cerr << "hardware counters aren't available ( " << std::strerror(perf_counters.m_error)
+                  << ", kernel.perf_event_paranoid is " << paranoid << " ), running without them.\n";
+    }
+}
+
+int RunHeadlessCommand( int argc, char** argv )
+{
+    OpenPerfCountersIfAsked(argc,argv);
+
+    if( std::strcmp(argv[1],"--bench-moves") == 0 )
+        return RunMoveBenchmark(argc,argv);
+
+    if( std::strcmp(argv[1],"--batch") == 0 )
+        return RunBatch(argc,argv);
+
+    if( std::strcmp(argv[1],"--bench-sparse") == 0 )
+        return RunSparseBenchmark(argc,argv);
+
+    if( std::strcmp(argv[1],"--bench-items") == 0 )
+        return RunItemBenchmark(argc,argv);
+
+    if( std::strcmp(argv[1],"--make-level") == 0 )
+        return RunMakeLevel(argc,argv);
+
+    if( std::strcmp(argv[1],"--generate-level") == 0 )
+        return RunLevelGenerator(argc,argv);
+
+    if( std::strcmp(argv[1],"--verify-scores") == 0 )
+        return RunScoreVerifier(argc,argv);
+
+    if( std::strcmp(argv[1],"--bench-cpu") == 0 )
+        return RunCpuBenchmarkCommand(argc,argv);
+
+    if( std::strcmp(argv[1],"--arena-server") == 0 )
+        return RunArenaServerCommand(argc,argv);
+
+    if( std::strcmp(argv[1],"--soak") == 0 )
+        return RunSoakCommand(argc,argv);
+
+    std::cerr << "unknown command " << argv[1] << ".\n";
+    return EXIT_FAILURE;
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+// the game can also be run without a terminal, for benchmarks and batch runs. a headless command is any
+// command line whose first argument starts with "--", for example:
+//
+//   snake --bench-moves [size] [moves]     compares the neighbor table against moving with a switch.
+//   snake --batch [games] [size] [depth] [rules] [log file] [replay file]
+//                                          plays games with the autopilot, a game that is doomed ends right away
+//                                          instead of playing out it's last moves. rules is a SNAKE_RULE_* mask.
+//                                          with a log file every game is appended to it as an analytics record,
+//                                          an empty name skips it. with a replay file doomed games are played
+//                                          out and every game that ended is recorded to it ( see replay.h ).
+//   snake --bench-sparse [ticks]          tick cost and memory of the dense board against the sparse chunked
+//                                          one, for worlds from 64x64 up to ones the dense board can't hold.
+//   snake --bench-items [items] [ticks]   tick cost with and without items ( see items.h ) on boards from 64x64
+//                                          to 4096x4096, and what happened to the items.
+//   snake --make-level <layout> <level file> [name]
+//                                          builds a level file from a text layout where '#' is a wall.
+//   snake --generate-level <maze | caves | obstacles> [size] [seed] [level file] [threads]
+//                                          generates a level ( see level_generator.h ) of size x size cells and
+//                                          prints how long it took. with a level file it's written there and
+//                                          loaded back, the way the game would.
+//   snake --verify-scores [scores file] [replay file] [threads]
+//                                          plays the replay log again on a thread per core and
+//                                          throws the scores without a replay that ends with them out of the
+//                                          scores file. exits with 1 if it threw one out.
+//   snake --bench-cpu [seconds] [scenario]
+//                                          runs the game in a pseudo terminal through menus and autopilot games
+//                                          and prints the cpu time, wakeups and terminal output of each. exits
+//                                          with 1 if the game didn't exit on SIGINT ( see cpu_bench.h ).
+//   snake --arena-server [port | socket path] [size] [rules] [deadline ms] [workers]
+//                                          lets bots play over a socket, one game per connection. the protocol
+//                                          is described in arena_server.h.
+//   snake --soak [games] [size] [rules] [items] [report every] [seed]
+//                                          plays games on boards upto size x size and checks the whole game
+//                                          after every tick ( see soak.h ), printing the memory of the process
+//                                          every so many games. leaving out rules or passing an empty one plays
+//                                          every rules mask in turn. exits with 1 if an invariant broke or the
+//                                          heap kept growing.
+//
+// --bench-sparse, --bench-items and --batch also take --counters anywhere after the command, which prints the
+// hardware counters of their simulation loops per tick below their results ( see perf_counters.h ).
+//
+// the terminal is never touched in headless mode and results are printed to STDOUT.
+bool IsHeadlessCommand( int argc, char** argv );
+
+// the executable counts it's heap allocations ( see heap_counter.h ), --soak reports them when they're set.
+void SetHeadlessHeapCounters( const std::atomic<uint64_t>* allocations, const std::atomic<uint64_t>* deallocations );
+
+// returns the exit code of the process.
+int RunHeadlessCommand( int argc, char** argv );
@@ -0,0 +1,32 @@
+#include "heap_counter.h"
+
+#include <cstdlib>
+#include <new>
+
+std::atomic<std::uint64_t> heap_allocation_count(0);
+std::atomic<std::uint64_t> heap_deallocation_count(0);
+
+// the rest of operator new/delete family ( array, nothrow, sized ) end up calling these two in libstdc++.
+void* operator new( std::size_t size )
+{
+    heap_allocation_count.fetch_add(1,std::memory_order_relaxed);
+
+    void* memory = std::malloc(size ? size : 1);
+    if( !memory )
+        throw std::bad_alloc();
+
+    return memory;
+}
+
+void operator delete( void* memory ) noexcept
+{
+    if( memory )
+        heap_deallocation_count.fetch_add(1,std::memory_order_relaxed);
+
+    std::free(memory);
+}
+
+void operator delete( void* memory, std::size_t ) noexcept
+{
+    operator delete(memory);
+}
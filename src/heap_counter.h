@@ -0,0 +1,10 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+// every call to the global operator new/delete of the game goes through these counters ( see heap_counter.cpp ),
+// so we can prove that a code path didn't touch the heap by comparing them before and after. only the snake
+// executable replaces the operators, libsnake leaves the heap of the program it's loaded into alone.
+extern std::atomic<std::uint64_t> heap_allocation_count;
+extern std::atomic<std::uint64_t> heap_deallocation_count;
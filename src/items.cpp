@@ -0,0 +1,313 @@
+#include "items.h"
+
+#include <cstring>
+
+// picked by the low byte of a random number, food is what the board mostly holds.
+#define ITEM_FOOD_WEIGHT                        160
+#define ITEM_SPEED_WEIGHT                       32
+#define ITEM_SHRINK_WEIGHT                      32
+
+static uint32_t NextItemRandom( ItemField& items )
+{
+    // xorshift64* like the game, it's state lives next to the items.
+    uint64_t x = items.m_random_state;
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    items.m_random_state = x;
+
+    return uint32_t(( x * 0x2545f4914f6cdd1dULL ) >> 32);
+}
+
+static uint32_t GetMapSlot( const ItemField& items, uint32_t cell )
+{
+    uint64_t hash = uint64_t(cell) * 0x9e3779b97f4a7c15ULL;
+
+    return uint32_t(hash ^ ( hash >> 32 )) & items.m_map_mask;
+}
+
+// the map slot of the cell, or the empty slot it would go into.
+static uint32_t FindMapSlot( const ItemField& items, uint32_t cell )
+{
+    uint32_t slot = GetMapSlot(items,cell);
+    while( items.m_map_cells[slot] != cell && items.m_map_cells[slot] != ITEM_NONE )
+        slot = ( slot + 1 ) & items.m_map_mask;
+
+    return slot;
+}
+
+// no tombstones, the entries after the slot that would have landed earlier are moved back. see sparse_board.cpp.
+static void ReleaseMapSlot( ItemField& items, uint32_t slot )
+{
+    uint32_t hole = slot;
+    for( uint32_t next = ( slot + 1 ) & items.m_map_mask; items.m_map_cells[next] != ITEM_NONE;
+         next = ( next + 1 ) & items.m_map_mask )
+    {
+        uint32_t home = GetMapSlot(items,items.m_map_cells[next]);
+
+        if( ( ( next - home ) & items.m_map_mask ) >= ( ( next - hole ) & items.m_map_mask ) )
+        {
+            items.m_map_cells[hole] = items.m_map_cells[next];
+            items.m_map_items[hole] = items.m_map_items[next];
+            hole = next;
+        }
+    }
+
+    items.m_map_cells[hole] = ITEM_NONE;
+}
+
+static void LinkWheelSlot( ItemField& items, uint32_t index )
+{
+    SnakeItem& item = items.m_items[index];
+    uint32_t& first = items.m_wheel[item.m_expiry_tick & ( ITEM_WHEEL_SLOTS - 1 )];
+
+    item.m_previous = ITEM_NONE;
+    item.m_next = first;
+    if( first != ITEM_NONE )
+        items.m_items[first].m_previous = index;
+
+    first = index;
+}
+
+static void UnlinkWheelSlot( ItemField& items, uint32_t index )
+{
+    SnakeItem& item = items.m_items[index];
+
+    if( item.m_previous != ITEM_NONE )
+        items.m_items[item.m_previous].m_next = item.m_next;
+    else
+        items.m_wheel[item.m_expiry_tick & ( ITEM_WHEEL_SLOTS - 1 )] = item.m_next;
+
+    if( item.m_next != ITEM_NONE )
+        items.m_items[item.m_next].m_previous = item.m_previous;
+}
+
+// takes the item out of the map and the wheel, the field is left to the caller.
+static void RemoveItem( ItemField& items, uint32_t slot )
+{
+    uint32_t index = items.m_map_items[slot];
+
+    ReleaseMapSlot(items,slot);
+    UnlinkWheelSlot(items,index);
+
+    items.m_items[index].m_next = items.m_free;
+    items.m_free = index;
+    --items.m_count;
+}
+
+static bool SpawnItem( ItemField& items, SnakeGameState& state )
+{
+    uint32_t cell_count = state.CellCount();
+    uint32_t cell = NextItemRandom(items) % cell_count;
+
+    for( int tries = 1; tries < ITEM_SPAWN_TRIES && state.m_field[cell] != SNAKE_CELL_EMPTY; ++tries )
+        cell = NextItemRandom(items) % cell_count;
+
+    if( state.m_field[cell] != SNAKE_CELL_EMPTY )
+    {
+        ++items.m_failed_spawn_count;
+        return false;
+    }
+
+    uint32_t random = NextItemRandom(items);
+    uint32_t weight = random & 0xff;
+    uint8_t kind = ITEM_KIND_MULTIPLIER;
+
+    if( weight < ITEM_FOOD_WEIGHT )
+        kind = ITEM_KIND_FOOD;
+    else if( weight < ITEM_FOOD_WEIGHT + ITEM_SPEED_WEIGHT )
+        kind = ITEM_KIND_SPEED;
+    else if( weight < ITEM_FOOD_WEIGHT + ITEM_SPEED_WEIGHT + ITEM_SHRINK_WEIGHT )
+        kind = ITEM_KIND_SHRINK;
+
+    uint32_t index = items.m_free;
+    SnakeItem& item = items.m_items[index];
+    items.m_free = item.m_next;
+
+    item.m_cell = cell;
+    item.m_kind = kind;
+    item.m_expiry_tick = state.m_tick + ITEM_MIN_LIFETIME +
+                         ( random >> 8 ) % ( ITEM_MAX_LIFETIME - ITEM_MIN_LIFETIME );
+    LinkWheelSlot(items,index);
+
+    uint32_t slot = FindMapSlot(items,cell);
+    items.m_map_cells[slot] = cell;
+    items.m_map_items[slot] = index;
+
+    state.m_field[cell] = GetItemCellValue(kind);
+    ++items.m_count;
+    ++items.m_spawned_count;
+
+    return true;
+}
+
+// a slot of the wheel only ever holds items of a single tick, since no item lives longer than the wheel turns.
+static void ExpireItems( ItemField& items, SnakeGameState& state )
+{
+    while( items.m_wheel_tick < state.m_tick )
+    {
+        ++items.m_wheel_tick;
+
+        uint32_t index = items.m_wheel[items.m_wheel_tick & ( ITEM_WHEEL_SLOTS - 1 )];
+        while( index != ITEM_NONE )
+        {
+            const SnakeItem& item = items.m_items[index];
+            uint32_t next = item.m_next;
+
+            // the regular food is only put on an item when the board has no empty cell left.
+            if( state.m_field[item.m_cell] == GetItemCellValue(item.m_kind) )
+                state.m_field[item.m_cell] = SNAKE_CELL_EMPTY;
+
+            RemoveItem(items,FindMapSlot(items,item.m_cell));
+            ++items.m_expired_count;
+
+            index = next;
+        }
+    }
+}
+
+uint32_t ComputeItemCapacity( const SnakeGameState& state, uint32_t item_count )
+{
+    uint32_t limit = state.m_free_cell_count / ITEM_MAX_BOARD_SHARE;
+    limit = limit < ITEM_MAX_COUNT ? limit : ITEM_MAX_COUNT;
+
+    return item_count < limit ? item_count : limit;
+}
+
+// the map is kept atmost half full, so probes stay short.
+static uint32_t ComputeItemMapCapacity( uint32_t capacity )
+{
+    uint32_t map_capacity = 16;
+    while( map_capacity < capacity * 2 )
+        map_capacity *= 2;
+
+    return map_capacity;
+}
+
+std::size_t ComputeItemFieldMemorySize( uint32_t capacity )
+{
+    uint32_t map_capacity = ComputeItemMapCapacity(capacity);
+
+    return ArenaFootprint<SnakeItem>(capacity) + ArenaFootprint<uint32_t>(map_capacity) * 2;
+}
+
+bool InitializeItemField( ItemField& items, GameArena& arena, SnakeGameState& state, uint32_t capacity )
+{
+    items = ItemField();
+    items.m_random_state = state.m_random_state ^ 0x9e3779b97f4a7c15ULL;
+    items.m_random_state = items.m_random_state ? items.m_random_state : 1;
+    items.m_wheel_tick = state.m_tick;
+    std::memset(items.m_wheel,0xff,sizeof(items.m_wheel));
+
+    if( capacity == 0 )
+        return true;
+
+    arena.Reset();
+    if( !arena.Reserve(ComputeItemFieldMemorySize(capacity)) )
+        return false;
+
+    uint32_t map_capacity = ComputeItemMapCapacity(capacity);
+    items.m_items = arena.AllocateArray<SnakeItem>(capacity);
+    items.m_map_cells = arena.AllocateArray<uint32_t>(map_capacity);
+    items.m_map_items = arena.AllocateArray<uint32_t>(map_capacity);
+
+    if( !items.m_items || !items.m_map_cells || !items.m_map_items )
+        return false;
+
+    std::memset(items.m_map_cells,0xff,sizeof(uint32_t) * map_capacity);
+    items.m_map_mask = map_capacity - 1;
+    items.m_capacity = capacity;
+
+    for( uint32_t i = 0; i < capacity; ++i )
+        items.m_items[i].m_next = ( i + 1 < capacity ) ? i + 1 : ITEM_NONE;
+
+    items.m_free = 0;
+
+    for( uint32_t i = 0; i < capacity; ++i )
+        SpawnItem(items,state);
+
+    return true;
+}
+
+uint8_t UpdateItemField( ItemField& items, SnakeGameState& state, int32_t score_before_step )
+{
+    if( items.m_capacity == 0 || state.m_status != GAME_STATUS_ONGOING )
+        return ITEM_KIND_NONE;
+
+    bool multiplied = IsItemEffectActive(items,ITEM_KIND_MULTIPLIER,state.m_tick);
+    if( multiplied && state.m_score > score_before_step )
+        state.m_score += state.m_score - score_before_step;
+
+    uint8_t picked_up = ITEM_KIND_NONE;
+    uint32_t slot = FindMapSlot(items,state.Head());
+
+    if( items.m_map_cells[slot] != ITEM_NONE )
+    {
+        picked_up = items.m_items[items.m_map_items[slot]].m_kind;
+        RemoveItem(items,slot);
+        ++items.m_picked_up_counts[picked_up];
+
+        switch( picked_up )
+        {
+            case ITEM_KIND_FOOD:
+                // a tail that can't grow back still gets the points.
+                GrowSnakeTail(state);
+                state.m_score += multiplied ? 20 : 10;
+            break;
+
+            case ITEM_KIND_SPEED:
+                items.m_speed_until_tick = state.m_tick + ITEM_EFFECT_TICKS;
+            break;
+
+            case ITEM_KIND_SHRINK:
+                ShrinkSnakeTail(state,ITEM_SHRINK_PARTS);
+            break;
+
+            case ITEM_KIND_MULTIPLIER:
+                items.m_multiplier_until_tick = state.m_tick + ITEM_EFFECT_TICKS;
+            break;
+        }
+    }
+
+    ExpireItems(items,state);
+
+    for( uint32_t spawns = 0; spawns < ITEM_SPAWNS_PER_TICK && items.m_count < items.m_capacity; ++spawns )
+        SpawnItem(items,state);
+
+    return picked_up;
+}
+
+bool IsItemEffectActive( const ItemField& items, uint8_t kind, uint64_t tick )
+{
+    if( kind == ITEM_KIND_SPEED )
+        return tick < items.m_speed_until_tick;
+
+    if( kind == ITEM_KIND_MULTIPLIER )
+        return tick < items.m_multiplier_until_tick;
+
+    return false;
+}
+
+char GetItemCellValue( uint8_t kind )
+{
+    switch( kind )
+    {
+        case ITEM_KIND_FOOD:
+            return SNAKE_CELL_ITEM_FOOD;
+
+        case ITEM_KIND_SPEED:
+            return SNAKE_CELL_ITEM_SPEED;
+
+        case ITEM_KIND_SHRINK:
+            return SNAKE_CELL_ITEM_SHRINK;
+
+        default:
+            return SNAKE_CELL_ITEM_MULTIPLIER;
+    }
+}
+
+bool IsItemCellValue( char value )
+{
+    return value == SNAKE_CELL_ITEM_FOOD || value == SNAKE_CELL_ITEM_SPEED || value == SNAKE_CELL_ITEM_SHRINK ||
+           value == SNAKE_CELL_ITEM_MULTIPLIER;
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "arena.h"
+#include "snake_game.h"
+
+// items lie on the field next to the regular food, the snake picks one up by moving it's head onto it.
+#define ITEM_KIND_FOOD                          0 // grows the snake by one part, worth as much as the food.
+#define ITEM_KIND_SPEED                         1 // ticks come ITEM_SPEED_FACTOR times faster for a while.
+#define ITEM_KIND_SHRINK                        2 // the tail loses ITEM_SHRINK_PARTS parts.
+#define ITEM_KIND_MULTIPLIER                    3 // everything eaten is worth double for a while.
+#define ITEM_KIND_COUNT                         4
+#define ITEM_KIND_NONE                          0xff
+
+// the characters items are drawn with, the game treats every one of them like an empty cell.
+#define SNAKE_CELL_ITEM_FOOD                    '+'
+#define SNAKE_CELL_ITEM_SPEED                   '>'
+#define SNAKE_CELL_ITEM_SHRINK                  '-'
+#define SNAKE_CELL_ITEM_MULTIPLIER              '$'
+
+#define ITEM_MAX_COUNT                          65536
+#define ITEM_MAX_BOARD_SHARE                    4 // atmost a quarter of the free cells hold items.
+#define ITEM_MIN_LIFETIME                       100 // ticks.
+#define ITEM_MAX_LIFETIME                       400
+#define ITEM_WHEEL_SLOTS                        512 // a power of 2 above ITEM_MAX_LIFETIME, so a slot holds one tick.
+#define ITEM_SPAWNS_PER_TICK                    64  // eaten and expired items come back over a few ticks.
+#define ITEM_SPAWN_TRIES                        4   // random cells tried per item, a crowded board just has fewer.
+#define ITEM_EFFECT_TICKS                       100
+#define ITEM_SPEED_FACTOR                       2
+#define ITEM_SHRINK_PARTS                       3
+#define ITEM_NONE                               0xffffffff
+
+struct SnakeItem
+{
+    uint64_t m_expiry_tick;
+    uint32_t m_cell;
+    uint32_t m_next;            // in the wheel slot, or in the free list.
+    uint32_t m_previous;        // in the wheel slot, so an item that is picked up leaves it in O(1).
+    uint8_t m_kind;
+};
+
+// the items of a single game. they are found by cell through an open addressing map sized to the item count
+// instead of the board, so a huge board with a few thousand items costs no more than a small one. every item
+// is also linked into the slot of the timer wheel for the tick it expires at, a tick only looks at it's own slot.
+// everything is carved out of the arena passed to InitializeItemField().
+struct ItemField
+{
+    ItemField() : m_items(nullptr), m_map_cells(nullptr), m_map_items(nullptr), m_map_mask(0), m_capacity(0),
+                  m_count(0), m_free(ITEM_NONE), m_wheel{}, m_wheel_tick(0), m_random_state(0),
+                  m_speed_until_tick(0), m_multiplier_until_tick(0), m_spawned_count(0), m_expired_count(0),
+                  m_picked_up_counts{}, m_failed_spawn_count(0) {}
+
+    SnakeItem* m_items;
+    uint32_t* m_map_cells;      // ITEM_NONE marks an empty slot.
+    uint32_t* m_map_items;
+    uint32_t m_map_mask;
+    uint32_t m_capacity;        // how many items the board is kept filled with.
+    uint32_t m_count;
+    uint32_t m_free;
+    uint32_t m_wheel[ITEM_WHEEL_SLOTS];
+    uint64_t m_wheel_tick;      // the last tick whose slot has expired.
+    uint64_t m_random_state;    // items have their own, so they don't change where the regular food goes.
+    uint64_t m_speed_until_tick;
+    uint64_t m_multiplier_until_tick;
+
+    // metrics.
+    uint64_t m_spawned_count;
+    uint64_t m_expired_count;
+    uint64_t m_picked_up_counts[ITEM_KIND_COUNT];
+    uint64_t m_failed_spawn_count;
+};
+
+// how many items a game of the given size is kept filled with, when item_count are asked for.
+uint32_t ComputeItemCapacity( const SnakeGameState& state, uint32_t item_count );
+
+// bytes of arena an item field of the given capacity needs, alignment padding included.
+std::size_t ComputeItemFieldMemorySize( uint32_t capacity );
+
+// resets arena, allocates the field from it and fills the board of a started game with items. a capacity of 0
+// gives an empty field that every other call does nothing with. the items are seeded from the game, so a game
+// started from the same random state gets the same items.
+bool InitializeItemField( ItemField& items, GameArena& arena, SnakeGameState& state, uint32_t capacity );
+
+// called after every StepSnakeGame() of a game that's still going. doubles the points of the step under a
+// multiplier, picks up the item under the head, expires the items that are due and spawns new ones.
+// returns the kind of item picked up, or ITEM_KIND_NONE.
+uint8_t UpdateItemField( ItemField& items, SnakeGameState& state, int32_t score_before_step );
+
+bool IsItemEffectActive( const ItemField& items, uint8_t kind, uint64_t tick );
+
+char GetItemCellValue( uint8_t kind );
+
+// whether a cell of the field holds an item, the snake moves through those like through empty cells.
+bool IsItemCellValue( char value );
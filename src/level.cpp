@@ -0,0 +1,420 @@
+#include "level.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// header layout:
+//
+//  0 magic               u32
+//  4 version             u16
+//  6 header size         u16
+//  8 size x              u16
+// 10 size y              u16
+// 12 wall count          u32
+// 16 checksum            u64   FNV-1a of the wall bitmap
+// 24 name                24 bytes, zero padded and always zero terminated
+
+static void PutU16( uint8_t* out, uint16_t value )
+{
+    out[0] = uint8_t(value);
+    out[1] = uint8_t(value >> 8);
+}
+
+static void PutU32( uint8_t* out, uint32_t value )
+{
+    for( int i = 0; i < 4; ++i )
+        out[i] = uint8_t(value >> ( i * 8 ));
+}
+
+static void PutU64( uint8_t* out, uint64_t value )
+{
+    for( int i = 0; i < 8; ++i )
+        out[i] = uint8_t(value >> ( i * 8 ));
+}
+
+static uint16_t GetU16( const uint8_t* in )
+{
+    return uint16_t(in[0] | ( in[1] << 8 ));
+}
+
+static uint32_t GetU32( const uint8_t* in )
+{
+    uint32_t value = 0;
+    for( int i = 3; i >= 0; --i )
+        value = ( value << 8 ) | in[i];
+
+    return value;
+}
+
+static uint64_t GetU64( const uint8_t* in )
+{
+    uint64_t value = 0;
+    for( int i = 7; i >= 0; --i )
+        value = ( value << 8 ) | in[i];
+
+    return value;
+}
+
+static uint64_t ComputeChecksum( const uint8_t* data, std::size_t size )
+{
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for( std::size_t i = 0; i < size; ++i )
+    {
+        hash ^= data[i];
+        hash *= 0x100000001b3ULL;
+    }
+
+    return hash;
+}
+
+static std::size_t WallBitmapSize( uint32_t cell_count )
+{
+    return ( cell_count + 7 ) / 8;
+}
+
+static bool IsWall( const uint8_t* walls, uint32_t cell )
+{
+    return walls[cell >> 3] >> ( cell & 7 ) & 1;
+}
+
+SnakeLevel::~SnakeLevel()
+{
+    UnloadSnakeLevel(*this);
+}
+
+void UnloadSnakeLevel( SnakeLevel& level )
+{
+    if( level.m_mapping )
+        munmap(level.m_mapping,level.m_mapping_size);
+
+    level.m_mapping = nullptr;
+    level.m_mapping_size = 0;
+    level.m_walls = nullptr;
+    level.m_size_x = level.m_size_y = 0;
+    level.m_wall_count = 0;
+    level.m_spawn_cells = nullptr;
+    level.m_spawn_cell_count = 0;
+    level.m_arena.Reset();
+}
+
+static bool ValidateWalls( const uint8_t* walls, uint16_t size_x, uint16_t size_y, uint32_t wall_count )
+{
+    uint32_t cell_count = uint32_t(size_x) * size_y;
+    uint32_t counted = 0;
+
+    for( std::size_t i = 0; i < WallBitmapSize(cell_count); ++i )
+        counted += __builtin_popcount(walls[i]);
+
+    // the padding bits after the last cell must be clear, or they would have been counted.
+    if( counted != wall_count || wall_count >= cell_count )
+        return false;
+
+    for( uint32_t x = 0; x < size_x; ++x )
+    {
+        if( !IsWall(walls,x) || !IsWall(walls,x + ( size_y - 1u ) * size_x) )
+            return false;
+    }
+
+    for( uint32_t y = 0; y < size_y; ++y )
+    {
+        if( !IsWall(walls,y * size_x) || !IsWall(walls,size_x - 1 + y * size_x) )
+            return false;
+    }
+
+    // a flood fill from the first open cell has to reach all of them, otherwise food could land where the
+    // snake can never get.
+    uint32_t start = 0;
+    while( IsWall(walls,start) )
+        ++start;
+
+    std::vector<uint64_t> reached(( cell_count + 63 ) / 64,0);
+    std::vector<uint32_t> queue;
+    queue.reserve(cell_count - wall_count);
+    queue.push_back(start);
+    reached[start >> 6] |= uint64_t(1) << ( start & 63 );
+
+    const int32_t offsets[4] = { -int32_t(size_x), -1, int32_t(size_x), 1 };
+
+    for( std::size_t i = 0; i < queue.size(); ++i )
+    {
+        for( int32_t offset : offsets )
+        {
+            uint32_t next = queue[i] + offset;
+            if( IsWall(walls,next) || ( reached[next >> 6] >> ( next & 63 ) & 1 ) )
+                continue;
+
+            reached[next >> 6] |= uint64_t(1) << ( next & 63 );
+            queue.push_back(next);
+        }
+    }
+
+    return queue.size() == cell_count - wall_count;
+}
+
+// the border is all walls, so the cells two steps from an open cell are always inside the field.
+static uint32_t ComputeSpawnDirections( const uint8_t* walls, uint16_t size_x, uint32_t cell )
+{
+    const int32_t offsets[4] = { -int32_t(size_x), -1, int32_t(size_x), 1 };
+    uint32_t directions = 0;
+
+    for( uint32_t i = 0; i < 4; ++i )
+    {
+        uint32_t first = cell + offsets[i];
+        if( !IsWall(walls,first) && !IsWall(walls,first + offsets[i]) )
+            directions |= 1u << i;
+    }
+
+    return directions;
+}
+
+static bool FindSpawnCells( SnakeLevel& level )
+{
+    uint32_t cell_count = uint32_t(level.m_size_x) * level.m_size_y;
+    uint32_t count = 0;
+
+    for( uint32_t cell = 0; cell < cell_count; ++cell )
+        count += !IsWall(level.m_walls,cell) && ComputeSpawnDirections(level.m_walls,level.m_size_x,cell);
+
+    level.m_arena.Reset();
+    if( !count || !level.m_arena.Reserve(ArenaFootprint<uint32_t>(count)) )
+        return false;
+
+    level.m_spawn_cells = level.m_arena.AllocateArray<uint32_t>(count);
+    level.m_spawn_cell_count = 0;
+
+    for( uint32_t cell = 0; cell < cell_count; ++cell )
+    {
+        if( IsWall(level.m_walls,cell) )
+            continue;
+
+        uint32_t directions = ComputeSpawnDirections(level.m_walls,level.m_size_x,cell);
+        if( directions )
+            level.m_spawn_cells[level.m_spawn_cell_count++] = cell | ( directions << SNAKE_SPAWN_DIRECTION_SHIFT );
+    }
+
+    return true;
+}
+
+bool LoadSnakeLevel( SnakeLevel& level, const char* path )
+{
+    UnloadSnakeLevel(level);
+
+    int fd = open(path,O_RDONLY | O_CLOEXEC);
+    if( fd < 0 )
+        return false;
+
+    struct stat file_status;
+    if( fstat(fd,&file_status) != 0 || file_status.st_size < SNAKE_LEVEL_HEADER_SIZE )
+    {
+        close(fd);
+        return false;
+    }
+
+    std::size_t size = std::size_t(file_status.st_size);
+    void* mapping = mmap(nullptr,size,PROT_READ,MAP_PRIVATE,fd,0);
+    close(fd);
+
+    if( mapping == MAP_FAILED )
+        return false;
+
+    level.m_mapping = mapping;
+    level.m_mapping_size = size;
+
+    const uint8_t* data = static_cast<const uint8_t*>(mapping);
+    uint16_t size_x = GetU16(data + 8), size_y = GetU16(data + 10);
+
+    if( GetU32(data) != SNAKE_LEVEL_MAGIC || GetU16(data + 4) != SNAKE_LEVEL_VERSION ||
+        GetU16(data + 6) != SNAKE_LEVEL_HEADER_SIZE || size_x < SNAKE_GAME_MIN_SIZE || size_y < SNAKE_GAME_MIN_SIZE ||
+        size_x > SNAKE_GAME_MAX_SIZE || size_y > SNAKE_GAME_MAX_SIZE ||
+        size != SNAKE_LEVEL_HEADER_SIZE + WallBitmapSize(uint32_t(size_x) * size_y) ||
+        data[24 + SNAKE_LEVEL_NAME_LENGTH] != '\0' )
+    {
+        UnloadSnakeLevel(level);
+        return false;
+    }
+
+    const uint8_t* walls = data + SNAKE_LEVEL_HEADER_SIZE;
+    uint32_t wall_count = GetU32(data + 12);
+
+    if( ComputeChecksum(walls,size - SNAKE_LEVEL_HEADER_SIZE) != GetU64(data + 16) ||
+        !ValidateWalls(walls,size_x,size_y,wall_count) )
+    {
+        UnloadSnakeLevel(level);
+        return false;
+    }
+
+    level.m_walls = walls;
+    level.m_size_x = size_x;
+    level.m_size_y = size_y;
+    level.m_wall_count = wall_count;
+    std::memcpy(level.m_name,data + 24,SNAKE_LEVEL_NAME_LENGTH + 1);
+
+    if( !FindSpawnCells(level) )
+    {
+        UnloadSnakeLevel(level);
+        return false;
+    }
+
+    return true;
+}
+
+bool ApplySnakeLevel( SnakeGameState& state, const SnakeLevel& level )
+{
+    if( !level.m_walls || state.m_size_x != level.m_size_x || state.m_size_y != level.m_size_y )
+        return false;
+
+    uint32_t cell_count = state.CellCount();
+
+    // whole bytes of open space or of walls are filled 8 cells at a time, which is most of any real level.
+    for( uint32_t cell = 0; cell < cell_count; cell += 8 )
+    {
+        uint8_t bits = level.m_walls[cell >> 3];
+        uint32_t count = ( cell_count - cell < 8 ) ? cell_count - cell : 8;
+
+        if( bits == 0 || bits == 0xff )
+        {
+            std::memset(state.m_field + cell,bits ? SNAKE_CELL_WALL : SNAKE_CELL_EMPTY,count);
+            continue;
+        }
+
+        for( uint32_t i = 0; i < count; ++i )
+            state.m_field[cell + i] = ( bits >> i & 1 ) ? SNAKE_CELL_WALL : SNAKE_CELL_EMPTY;
+    }
+
+    state.m_free_cell_count = cell_count - level.m_wall_count;
+    state.m_spawn_cells = level.m_spawn_cells;
+    state.m_spawn_cell_count = level.m_spawn_cell_count;
+
+    return true;
+}
+
+static bool WriteLevelFile( const char* path, const char* name, uint16_t size_x, uint16_t size_y,
+                            const uint8_t* walls, uint32_t wall_count )
+{
+    std::size_t bitmap_size = WallBitmapSize(uint32_t(size_x) * size_y);
+    uint8_t header[SNAKE_LEVEL_HEADER_SIZE] = {};
+
+    PutU32(header,SNAKE_LEVEL_MAGIC);
+    PutU16(header + 4,SNAKE_LEVEL_VERSION);
+    PutU16(header + 6,SNAKE_LEVEL_HEADER_SIZE);
+    PutU16(header + 8,size_x);
+    PutU16(header + 10,size_y);
+    PutU32(header + 12,wall_count);
+    PutU64(header + 16,ComputeChecksum(walls,bitmap_size));
+    std::strncpy(reinterpret_cast<char*>(header + 24),name,SNAKE_LEVEL_NAME_LENGTH);
+
+    FILE* output = std::fopen(path,"wb");
+    if( !output )
+        return false;
+
+    bool written = std::fwrite(header,1,sizeof(header),output) == sizeof(header) &&
+                   std::fwrite(walls,1,bitmap_size,output) == bitmap_size;
+
+    return std::fclose(output) == 0 && written;
+}
+
+bool WriteSnakeLevel( const char* path, const char* name, uint16_t size_x, uint16_t size_y, const char* layout )
+{
+    if( size_x < SNAKE_GAME_MIN_SIZE || size_y < SNAKE_GAME_MIN_SIZE || size_x > SNAKE_GAME_MAX_SIZE ||
+        size_y > SNAKE_GAME_MAX_SIZE )
+        return false;
+
+    uint32_t cell_count = uint32_t(size_x) * size_y;
+    std::vector<uint8_t> walls(WallBitmapSize(cell_count),0);
+    uint32_t wall_count = 0;
+
+    // the border is a wall whatever the layout says.
+    for( uint32_t y = 0; y < size_y; ++y )
+    {
+        for( uint32_t x = 0; x < size_x; ++x )
+        {
+            uint32_t cell = x + y * size_x;
+            if( layout[cell] == '#' || x == 0 || y == 0 || x == size_x - 1u || y == size_y - 1u )
+            {
+                walls[cell >> 3] |= uint8_t(1 << ( cell & 7 ));
+                ++wall_count;
+            }
+        }
+    }
+
+    return WriteLevelFile(path,name,size_x,size_y,walls.data(),wall_count);
+}
+
+bool SaveSnakeLevel( const char* path, const SnakeLevel& level )
+{
+    if( !level.m_walls )
+        return false;
+
+    return WriteLevelFile(path,level.m_name,level.m_size_x,level.m_size_y,level.m_walls,level.m_wall_count);
+}
+
+uint8_t* AllocateSnakeLevel( SnakeLevel& level, const char* name, uint16_t size_x, uint16_t size_y,
+                             uint32_t wall_count, uint32_t spawn_cell_count )
+{
+    UnloadSnakeLevel(level);
+
+    if( size_x < SNAKE_GAME_MIN_SIZE || size_y < SNAKE_GAME_MIN_SIZE || size_x > SNAKE_GAME_MAX_SIZE ||
+        size_y > SNAKE_GAME_MAX_SIZE )
+        return nullptr;
+
+    std::size_t bitmap_size = WallBitmapSize(uint32_t(size_x) * size_y);
+    if( !level.m_arena.Reserve(ArenaFootprint<uint8_t>(bitmap_size) + ArenaFootprint<uint32_t>(spawn_cell_count)) )
+        return nullptr;
+
+    uint8_t* walls = level.m_arena.AllocateArray<uint8_t>(bitmap_size);
+    level.m_spawn_cells = level.m_arena.AllocateArray<uint32_t>(spawn_cell_count);
+    std::memset(walls,0,bitmap_size);
+
+    level.m_walls = walls;
+    level.m_size_x = size_x;
+    level.m_size_y = size_y;
+    level.m_wall_count = wall_count;
+    level.m_spawn_cell_count = spawn_cell_count;
+    std::memset(level.m_name,0,sizeof(level.m_name));
+    std::strncpy(level.m_name,name,SNAKE_LEVEL_NAME_LENGTH);
+
+    return walls;
+}
+
+uint32_t ListSnakeLevelFiles( const char* directory, char (*paths)[SNAKE_LEVEL_PATH_LENGTH], uint32_t capacity )
+{
+    DIR* handle = opendir(directory);
+    if( !handle )
+        return 0;
+
+    std::vector<std::string> names;
+    std::size_t extension_length = std::strlen(SNAKE_LEVEL_FILE_EXTENSION);
+
+    while( dirent* entry = readdir(handle) )
+    {
+        std::size_t length = std::strlen(entry->d_name);
+        if( length > extension_length &&
+            std::strcmp(entry->d_name + length - extension_length,SNAKE_LEVEL_FILE_EXTENSION) == 0 )
+            names.push_back(entry->d_name);
+    }
+
+    closedir(handle);
+    std::sort(names.begin(),names.end());
+
+    uint32_t count = 0;
+    for( const std::string& name : names )
+    {
+        if( count == capacity )
+            break;
+
+        int length = std::snprintf(paths[count],SNAKE_LEVEL_PATH_LENGTH,"%s/%s",directory,name.c_str());
+        if( length >= 0 && length < SNAKE_LEVEL_PATH_LENGTH )
+            ++count;
+    }
+
+    return count;
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "arena.h"
+#include "snake_game.h"
+
+// a level is a board with walls anywhere, not just on the border. level files are little endian:
+//
+//   header ( SNAKE_LEVEL_HEADER_SIZE bytes, see level.cpp for the layout )
+//   wall bitmap, 1 bit per cell in the same order as the field, ( cell count + 7 ) / 8 bytes
+//
+// files are mapped into memory instead of read, the bitmap is used right where it is in the mapping, so a
+// big level costs nothing to load but the one pass that validates it.
+#define SNAKE_LEVEL_MAGIC                       0x4c4b4e53 // "SNKL"
+#define SNAKE_LEVEL_VERSION                     1
+#define SNAKE_LEVEL_HEADER_SIZE                 48
+#define SNAKE_LEVEL_NAME_LENGTH                 23
+#define SNAKE_LEVEL_DIRECTORY                   "levels"
+#define SNAKE_LEVEL_FILE_EXTENSION              ".lvl"
+#define SNAKE_LEVEL_PATH_LENGTH                 256
+
+struct SnakeLevel
+{
+    SnakeLevel() : m_mapping(nullptr), m_mapping_size(0), m_walls(nullptr), m_size_x(0), m_size_y(0),
+                   m_wall_count(0), m_name{}, m_spawn_cells(nullptr), m_spawn_cell_count(0) {}
+
+    SnakeLevel( const SnakeLevel& other ) = delete;
+    SnakeLevel& operator=( const SnakeLevel& other ) = delete;
+
+    ~SnakeLevel();
+
+    void* m_mapping;
+    std::size_t m_mapping_size;
+    const uint8_t* m_walls;     // points into the mapping.
+    uint16_t m_size_x;
+    uint16_t m_size_y;
+    uint32_t m_wall_count;
+    char m_name[SNAKE_LEVEL_NAME_LENGTH + 1];
+
+    // cells a snake can start on: not a wall and with atleast two open cells straight ahead in some direction,
+    // so nobody loses before they could even react. worked out once when the level is loaded, packed the way
+    // SNAKE_SPAWN_DIRECTION_SHIFT describes.
+    uint32_t* m_spawn_cells;
+    uint32_t m_spawn_cell_count;
+    GameArena m_arena;
+};
+
+// maps and validates the file: the header, the checksum, walls all around the border, all open cells connected
+// and atleast one spawn cell. on failure the level is left unloaded.
+bool LoadSnakeLevel( SnakeLevel& level, const char* path );
+void UnloadSnakeLevel( SnakeLevel& level );
+
+// puts the walls of the level on a game that was initialized with the same size, and makes
+// StartSnakeGameState() spawn on the level's spawn cells. the level must stay loaded while the game is played.
+bool ApplySnakeLevel( SnakeGameState& state, const SnakeLevel& level );
+
+// writes a level from a layout where '#' is a wall, size_x * size_y characters without line ends.
+bool WriteSnakeLevel( const char* path, const char* name, uint16_t size_x, uint16_t size_y, const char* layout );
+
+// writes a level that is loaded, or was made in memory, to a level file.
+bool SaveSnakeLevel( const char* path, const SnakeLevel& level );
+
+// for a level made in memory instead of loaded from a file ( see level_generator.h ). allocates a cleared wall
+// bitmap and spawn_cell_count spawn cells from the level's arena and returns the bitmap for the caller to fill
+// in, together with m_spawn_cells. nothing is validated, the caller has to keep the promises LoadSnakeLevel()
+// checks. nullptr if the size is out of range or the memory couldn't be had.
+uint8_t* AllocateSnakeLevel( SnakeLevel& level, const char* name, uint16_t size_x, uint16_t size_y,
+                             uint32_t wall_count, uint32_t spawn_cell_count );
+
+// paths of the level files in directory sorted by name, returns how many were found ( atmost capacity ).
+uint32_t ListSnakeLevelFiles( const char* directory, char (*paths)[SNAKE_LEVEL_PATH_LENGTH], uint32_t capacity );
@@ -0,0 +1,789 @@
+#include "level_generator.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+// while generating every cell is a byte, so tiles never share a byte the way they would in the wall bitmap.
+#define GENERATOR_OPEN                          0
+#define GENERATOR_WALL                          1
+#define EVERY_CELL_BYTE                         0x0101010101010101ULL // a word of 8 cells that are all walls.
+
+// the caves start as this share of walls ( out of 256 ) and are smoothed this many times.
+#define CAVE_WALL_SHARE                         115
+#define CAVE_SMOOTHING_PASSES                   4
+
+// obstacles cover about this percentage of a tile before they overlap, 1 in OBSTACLE_SEGMENT_CHANCE of them
+// is a straight wall segment instead of a block.
+#define OBSTACLE_COVERAGE                       18
+#define OBSTACLE_MAX_BLOCK_SIZE                 6
+#define OBSTACLE_MAX_SEGMENT_LENGTH             24
+#define OBSTACLE_SEGMENT_CHANCE                 4
+#define OBSTACLE_AVERAGE_AREA                   12
+
+// a maze cell is 3x3 open cells with the wall to it's right and below it, a tile of the maze holds
+// LEVEL_GENERATOR_TILE_SIZE / MAZE_PITCH of them a side.
+#define MAZE_PITCH                              4
+#define MAZE_TILE_CELLS                         ( LEVEL_GENERATOR_TILE_SIZE / MAZE_PITCH )
+#define MAZE_LOOP_CHANCE                        10 // 1 in this many walls inside a tile is taken out.
+#define MAZE_DOOR_SPACING                       16 // a door between two tiles every this many maze cells of edge.
+
+static const char* level_generator_names[LEVEL_GENERATOR_KIND_COUNT] = { "maze", "caves", "obstacles" };
+
+struct GeneratorGrid
+{
+    uint16_t m_size_x;
+    uint16_t m_size_y;
+    uint32_t m_tiles_x;
+    uint32_t m_tiles_y;
+    uint32_t m_thread_count;
+    uint64_t m_seed;
+    uint8_t* m_cells;
+};
+
+// splitmix64 of the seed and the tile, so neighboring tiles get unrelated numbers.
+static uint64_t SeedTileRandom( uint64_t seed, uint32_t tile )
+{
+    uint64_t z = seed + ( uint64_t(tile) + 1 ) * 0x9e3779b97f4a7c15ULL;
+    z = ( z ^ ( z >> 30 ) ) * 0xbf58476d1ce4e5b9ULL;
+    z = ( z ^ ( z >> 27 ) ) * 0x94d049bb133111ebULL;
+    z ^= z >> 31;
+
+    return z ? z : 1;
+}
+
+// xorshift64* like the game.
+static uint64_t NextTileRandom( uint64_t& state )
+{
+    state ^= state >> 12;
+    state ^= state << 25;
+    state ^= state >> 27;
+
+    return state * 0x2545f4914f6cdd1dULL;
+}
+
+// calls function with every index below count, spread over thread_count threads. the calling thread is one of them.
+template<typename Function>
+static void RunOnThreads( uint32_t count, uint32_t thread_count, Function function )
+{
+    std::atomic<uint32_t> next_index(0);
+    auto worker = [&]()
+    {
+        for( uint32_t index = next_index++; index < count; index = next_index++ )
+            function(index);
+    };
+
+    std::vector<std::thread> threads;
+    for( uint32_t i = 1; i < thread_count && i < count; ++i )
+        threads.emplace_back(worker);
+
+    worker();
+
+    for( std::thread& thread : threads )
+        thread.join();
+}
+
+static void GetTileBounds( const GeneratorGrid& grid, uint32_t tile, uint32_t& x0, uint32_t& y0, uint32_t& x1,
+                           uint32_t& y1 )
+{
+    x0 = ( tile % grid.m_tiles_x ) * LEVEL_GENERATOR_TILE_SIZE;
+    y0 = ( tile / grid.m_tiles_x ) * LEVEL_GENERATOR_TILE_SIZE;
+    x1 = std::min<uint32_t>(x0 + LEVEL_GENERATOR_TILE_SIZE,grid.m_size_x);
+    y1 = std::min<uint32_t>(y0 + LEVEL_GENERATOR_TILE_SIZE,grid.m_size_y);
+}
+
+// 8 cells at a time, the grid has no alignment to keep to.
+static uint64_t LoadCells( const uint8_t* cells )
+{
+    uint64_t value;
+    std::memcpy(&value,cells,sizeof(value));
+
+    return value;
+}
+
+static void StoreCells( uint8_t* cells, uint64_t value )
+{
+    std::memcpy(cells,&value,sizeof(value));
+}
+
+// walls up the cells of the tile that are on the border of the board.
+static void WallUpTileBorder( GeneratorGrid& grid, uint32_t x0, uint32_t y0, uint32_t x1, uint32_t y1 )
+{
+    uint32_t size_x = grid.m_size_x;
+
+    if( y0 == 0 )
+        std::memset(grid.m_cells + x0,GENERATOR_WALL,x1 - x0);
+
+    if( y1 == grid.m_size_y )
+        std::memset(grid.m_cells + x0 + ( y1 - 1 ) * size_x,GENERATOR_WALL,x1 - x0);
+
+    for( uint32_t y = y0; y < y1; ++y )
+    {
+        if( x0 == 0 )
+            grid.m_cells[y * size_x] = GENERATOR_WALL;
+
+        if( x1 == size_x )
+            grid.m_cells[size_x - 1 + y * size_x] = GENERATOR_WALL;
+    }
+}
+
+static void FillTile( GeneratorGrid& grid, uint32_t tile, uint8_t value )
+{
+    uint32_t x0, y0, x1, y1;
+    GetTileBounds(grid,tile,x0,y0,x1,y1);
+
+    for( uint32_t y = y0; y < y1; ++y )
+        std::memset(grid.m_cells + x0 + y * grid.m_size_x,value,x1 - x0);
+}
+
+static void FillCaveTile( GeneratorGrid& grid, uint32_t tile )
+{
+    uint32_t x0, y0, x1, y1;
+    GetTileBounds(grid,tile,x0,y0,x1,y1);
+    uint64_t random = SeedTileRandom(grid.m_seed,tile);
+
+    // a random number is 8 cells.
+    for( uint32_t y = y0; y < y1; ++y )
+    {
+        uint8_t* row = grid.m_cells + y * grid.m_size_x;
+        for( uint32_t x = x0; x < x1; x += 8 )
+        {
+            uint64_t bytes = NextTileRandom(random);
+            for( uint32_t i = 0; i < 8 && x + i < x1; ++i )
+                row[x + i] = uint8_t(bytes >> ( i * 8 )) < CAVE_WALL_SHARE;
+        }
+    }
+
+    WallUpTileBorder(grid,x0,y0,x1,y1);
+}
+
+// a cell becomes a wall when atleast 5 of the 9 cells around it and itself are walls. reads the whole grid from
+// source, so the tiles of a pass don't depend on each other.
+static void SmoothCaveTile( const GeneratorGrid& grid, const uint8_t* source, uint8_t* target, uint32_t tile )
+{
+    uint32_t x0, y0, x1, y1;
+    GetTileBounds(grid,tile,x0,y0,x1,y1);
+    uint32_t size_x = grid.m_size_x;
+
+    for( uint32_t y = y0; y < y1; ++y )
+    {
+        uint8_t* out = target + y * size_x;
+        if( y == 0 || y == grid.m_size_y - 1u )
+        {
+            std::memset(out + x0,GENERATOR_WALL,x1 - x0);
+            continue;
+        }
+
+        const uint8_t* above = source + ( y - 1 ) * size_x;
+        const uint8_t* row = above + size_x;
+        const uint8_t* below = row + size_x;
+        uint32_t first = std::max(x0,1u), last = std::min(x1,size_x - 1);
+
+        uint32_t x = first;
+
+        // 8 cells at a time, no byte of the sums gets above 9 so they never carry into the next cell. adding
+        // 128 - 5 sets the top bit of the cells that got atleast 5.
+        for( ; x + 8 <= last; x += 8 )
+        {
+            uint64_t walls = LoadCells(above + x - 1) + LoadCells(above + x) + LoadCells(above + x + 1) +
+                             LoadCells(row + x - 1) + LoadCells(row + x) + LoadCells(row + x + 1) +
+                             LoadCells(below + x - 1) + LoadCells(below + x) + LoadCells(below + x + 1);
+            StoreCells(out + x,( ( walls + 0x7b7b7b7b7b7b7b7bULL ) >> 7 ) & EVERY_CELL_BYTE);
+        }
+
+        for( ; x < last; ++x )
+        {
+            uint32_t walls = above[x - 1] + above[x] + above[x + 1] + row[x - 1] + row[x] + row[x + 1] +
+                             below[x - 1] + below[x] + below[x + 1];
+            out[x] = walls >= 5;
+        }
+
+        if( x0 == 0 )
+            out[0] = GENERATOR_WALL;
+
+        if( x1 == size_x )
+            out[size_x - 1] = GENERATOR_WALL;
+    }
+}
+
+// obstacles are kept inside their tile, so tiles can be filled at the same time.
+static void FillObstacleTile( GeneratorGrid& grid, uint32_t tile )
+{
+    uint32_t x0, y0, x1, y1;
+    GetTileBounds(grid,tile,x0,y0,x1,y1);
+    uint64_t random = SeedTileRandom(grid.m_seed,tile);
+
+    FillTile(grid,tile,GENERATOR_OPEN);
+    WallUpTileBorder(grid,x0,y0,x1,y1);
+
+    uint32_t width = x1 - x0, height = y1 - y0;
+    uint32_t count = width * height * OBSTACLE_COVERAGE / 100 / OBSTACLE_AVERAGE_AREA;
+
+    for( uint32_t i = 0; i < count; ++i )
+    {
+        uint64_t bits = NextTileRandom(random);
+        uint32_t x = x0 + uint32_t(bits & 0xffff) % width;
+        uint32_t y = y0 + uint32_t(( bits >> 16 ) & 0xffff) % height;
+        uint32_t obstacle_x, obstacle_y;
+
+        if( ( bits >> 32 ) % OBSTACLE_SEGMENT_CHANCE == 0 )
+        {
+            uint32_t length = 2 + uint32_t(bits >> 40) % ( OBSTACLE_MAX_SEGMENT_LENGTH - 1 );
+            bool horizontal = bits >> 63;
+            obstacle_x = horizontal ? length : 1;
+            obstacle_y = horizontal ? 1 : length;
+        }
+
+        else
+        {
+            obstacle_x = 1 + uint32_t(bits >> 40) % OBSTACLE_MAX_BLOCK_SIZE;
+            obstacle_y = 1 + uint32_t(bits >> 48) % OBSTACLE_MAX_BLOCK_SIZE;
+        }
+
+        obstacle_x = std::min(obstacle_x,x1 - x);
+        obstacle_y = std::min(obstacle_y,y1 - y);
+
+        for( uint32_t row = y; row < y + obstacle_y; ++row )
+            std::memset(grid.m_cells + x + row * grid.m_size_x,GENERATOR_WALL,obstacle_x);
+    }
+}
+
+struct MazeLayout
+{
+    uint32_t m_cells_x;
+    uint32_t m_cells_y;
+    uint32_t m_tiles_x;
+};
+
+// the open cells of the maze cell (i,j). the last column and row of maze cells stretch upto the border, so the
+// cells left over when the board isn't a whole number of maze cells don't end up as a band of walls.
+static void GetMazeCellArea( const GeneratorGrid& grid, const MazeLayout& maze, uint32_t i, uint32_t j,
+                             uint32_t& x, uint32_t& y, uint32_t& width, uint32_t& height )
+{
+    x = i * MAZE_PITCH + 1;
+    y = j * MAZE_PITCH + 1;
+    width = ( i + 1 == maze.m_cells_x ) ? grid.m_size_x - 1u - x : MAZE_PITCH - 1;
+    height = ( j + 1 == maze.m_cells_y ) ? grid.m_size_y - 1u - y : MAZE_PITCH - 1;
+}
+
+// opens the wall to the right of, or below, the maze cell (i,j).
+static void OpenMazeWall( GeneratorGrid& grid, const MazeLayout& maze, uint32_t i, uint32_t j, bool right )
+{
+    uint32_t x, y, width, height;
+    GetMazeCellArea(grid,maze,i,j,x,y,width,height);
+
+    if( right )
+    {
+        for( uint32_t row = y; row < y + height; ++row )
+            grid.m_cells[x + width + row * grid.m_size_x] = GENERATOR_OPEN;
+    }
+
+    else
+    {
+        std::memset(grid.m_cells + x + ( y + height ) * grid.m_size_x,GENERATOR_OPEN,width);
+    }
+}
+
+static bool IsMazeWallOpen( const GeneratorGrid& grid, const MazeLayout& maze, uint32_t i, uint32_t j, bool right )
+{
+    uint32_t x, y, width, height;
+    GetMazeCellArea(grid,maze,i,j,x,y,width,height);
+
+    return right ? grid.m_cells[x + width + y * grid.m_size_x] == GENERATOR_OPEN :
+                   grid.m_cells[x + ( y + height ) * grid.m_size_x] == GENERATOR_OPEN;
+}
+
+// a perfect maze inside the tile grown by a random depth first walk, then some loops and the doors to the tiles
+// to the right and below. a maze cell owns the walls to it's right and below it, so every tile only writes to
+// cells of it's own. the grid is all walls before.
+static void CarveMazeTile( GeneratorGrid& grid, const MazeLayout& maze, uint32_t tile )
+{
+    uint32_t i0 = ( tile % maze.m_tiles_x ) * MAZE_TILE_CELLS, j0 = ( tile / maze.m_tiles_x ) * MAZE_TILE_CELLS;
+    uint32_t i1 = std::min(i0 + MAZE_TILE_CELLS,maze.m_cells_x), j1 = std::min(j0 + MAZE_TILE_CELLS,maze.m_cells_y);
+    uint32_t width = i1 - i0, height = j1 - j0;
+    uint64_t random = SeedTileRandom(grid.m_seed,tile);
+
+    for( uint32_t j = j0; j < j1; ++j )
+    {
+        for( uint32_t i = i0; i < i1; ++i )
+        {
+            uint32_t x, y, cell_width, cell_height;
+            GetMazeCellArea(grid,maze,i,j,x,y,cell_width,cell_height);
+
+            for( uint32_t row = y; row < y + cell_height; ++row )
+                std::memset(grid.m_cells + x + row * grid.m_size_x,GENERATOR_OPEN,cell_width);
+        }
+    }
+
+    std::vector<uint8_t> visited(width * height,0);
+    std::vector<uint32_t> stack;
+    stack.reserve(width * height);
+
+    uint32_t start = uint32_t(NextTileRandom(random) >> 32) % ( width * height );
+    visited[start] = 1;
+    stack.push_back(start);
+
+    while( !stack.empty() )
+    {
+        uint32_t cell = stack.back();
+        uint32_t i = cell % width, j = cell / width;
+        uint32_t candidates[4];
+        uint32_t candidate_count = 0;
+
+        if( j > 0 && !visited[cell - width] ) candidates[candidate_count++] = cell - width;
+        if( i > 0 && !visited[cell - 1] ) candidates[candidate_count++] = cell - 1;
+        if( j + 1 < height && !visited[cell + width] ) candidates[candidate_count++] = cell + width;
+        if( i + 1 < width && !visited[cell + 1] ) candidates[candidate_count++] = cell + 1;
+
+        if( candidate_count == 0 )
+        {
+            stack.pop_back();
+            continue;
+        }
+
+        uint32_t next = candidates[uint32_t(NextTileRandom(random) >> 32) % candidate_count];
+        uint32_t first = std::min(cell,next);
+        OpenMazeWall(grid,maze,i0 + first % width,j0 + first / width,next / width == j);
+
+        visited[next] = 1;
+        stack.push_back(next);
+    }
+
+    // a perfect maze has a single way between any two cells, a snake that went the wrong way would be stuck.
+    for( uint32_t j = j0; j < j1; ++j )
+    {
+        for( uint32_t i = i0; i < i1; ++i )
+        {
+            if( i + 1 < i1 && !IsMazeWallOpen(grid,maze,i,j,true) &&
+                ( NextTileRandom(random) >> 32 ) % MAZE_LOOP_CHANCE == 0 )
+                OpenMazeWall(grid,maze,i,j,true);
+
+            if( j + 1 < j1 && !IsMazeWallOpen(grid,maze,i,j,false) &&
+                ( NextTileRandom(random) >> 32 ) % MAZE_LOOP_CHANCE == 0 )
+                OpenMazeWall(grid,maze,i,j,false);
+        }
+    }
+
+    if( i1 < maze.m_cells_x )
+    {
+        for( uint32_t door = 0; door < std::max(1u,height / MAZE_DOOR_SPACING); ++door )
+            OpenMazeWall(grid,maze,i1 - 1,j0 + uint32_t(NextTileRandom(random) >> 32) % height,true);
+    }
+
+    if( j1 < maze.m_cells_y )
+    {
+        for( uint32_t door = 0; door < std::max(1u,width / MAZE_DOOR_SPACING); ++door )
+            OpenMazeWall(grid,maze,i0 + uint32_t(NextTileRandom(random) >> 32) % width,j1 - 1,false);
+    }
+}
+
+static uint32_t FindRoot( std::vector<uint32_t>& parents, uint32_t id )
+{
+    while( parents[id] != id )
+    {
+        parents[id] = parents[parents[id]];
+        id = parents[id];
+    }
+
+    return id;
+}
+
+static void JoinRoots( std::vector<uint32_t>& parents, uint32_t first, uint32_t second )
+{
+    first = FindRoot(parents,first);
+    second = FindRoot(parents,second);
+
+    if( first != second )
+        parents[std::max(first,second)] = std::min(first,second);
+}
+
+// open cells [m_start,m_end) of a single row.
+struct OpenRun
+{
+    uint32_t m_start;
+    uint32_t m_end;
+};
+
+// the open runs of a band of LEVEL_GENERATOR_TILE_SIZE rows, joined where they touch inside the band.
+struct RunBand
+{
+    std::vector<OpenRun> m_runs;
+    std::vector<uint32_t> m_row_firsts; // the first run of every row, and one past the last run of the band.
+    std::vector<uint32_t> m_parents;
+};
+
+// joins the runs of a row with the ones of the row above it that they touch, both are sorted.
+static void JoinRunRows( const std::vector<OpenRun>& above_runs, uint32_t above_first, uint32_t above_end,
+                         const std::vector<OpenRun>& runs, uint32_t first, uint32_t end, uint32_t size_x,
+                         std::vector<uint32_t>& parents, uint32_t above_offset, uint32_t offset )
+{
+    uint32_t i = above_first, j = first;
+
+    while( i < above_end && j < end )
+    {
+        uint32_t above_start = above_runs[i].m_start + size_x, above_stop = above_runs[i].m_end + size_x;
+
+        if( above_start < runs[j].m_end && runs[j].m_start < above_stop )
+            JoinRoots(parents,above_offset + i,offset + j);
+
+        if( above_stop < runs[j].m_end )
+            ++i;
+        else
+            ++j;
+    }
+}
+
+static void FindBandRuns( const GeneratorGrid& grid, uint32_t band, RunBand& runs )
+{
+    uint32_t size_x = grid.m_size_x;
+    uint32_t y0 = band * LEVEL_GENERATOR_TILE_SIZE;
+    uint32_t y1 = std::min<uint32_t>(y0 + LEVEL_GENERATOR_TILE_SIZE,grid.m_size_y);
+
+    for( uint32_t y = y0; y < y1; ++y )
+    {
+        const uint8_t* row = grid.m_cells + y * size_x;
+        uint32_t first = uint32_t(runs.m_runs.size());
+        runs.m_row_firsts.push_back(first);
+
+        for( uint32_t x = 0; x < size_x; )
+        {
+            // walls and open cells are skipped 8 at a time while they come in whole words.
+            while( x + 8 <= size_x && LoadCells(row + x) == EVERY_CELL_BYTE )
+                x += 8;
+
+            while( x < size_x && row[x] == GENERATOR_WALL )
+                ++x;
+
+            if( x == size_x )
+                break;
+
+            uint32_t start = x;
+            while( x + 8 <= size_x && LoadCells(row + x) == 0 )
+                x += 8;
+
+            while( x < size_x && row[x] == GENERATOR_OPEN )
+                ++x;
+
+            runs.m_runs.push_back({ start + y * size_x, x + y * size_x });
+            runs.m_parents.push_back(uint32_t(runs.m_parents.size()));
+        }
+
+        if( y > y0 )
+        {
+            uint32_t above_first = runs.m_row_firsts[y - y0 - 1];
+            JoinRunRows(runs.m_runs,above_first,first,runs.m_runs,first,uint32_t(runs.m_runs.size()),size_x,
+                        runs.m_parents,0,0);
+        }
+    }
+
+    runs.m_row_firsts.push_back(uint32_t(runs.m_runs.size()));
+}
+
+// walls up every open cell that isn't part of the biggest open area. the open cells are found as runs in bands of
+// rows, one band per thread, and the bands are joined after. false if there is no open cell.
+static bool KeepBiggestOpenArea( GeneratorGrid& grid )
+{
+    uint32_t band_count = grid.m_tiles_y;
+    std::vector<RunBand> bands(band_count);
+
+    RunOnThreads(band_count,grid.m_thread_count,[&]( uint32_t band ) { FindBandRuns(grid,band,bands[band]); });
+
+    // the runs of all bands get ids one after the other.
+    std::vector<uint32_t> first_ids(band_count + 1,0);
+    for( uint32_t band = 0; band < band_count; ++band )
+        first_ids[band + 1] = first_ids[band] + uint32_t(bands[band].m_runs.size());
+
+    uint32_t id_count = first_ids[band_count];
+    if( id_count == 0 )
+        return false;
+
+    std::vector<uint32_t> parents(id_count);
+    for( uint32_t band = 0; band < band_count; ++band )
+    {
+        for( std::size_t run = 0; run < bands[band].m_runs.size(); ++run )
+            parents[first_ids[band] + run] = first_ids[band] + bands[band].m_parents[run];
+    }
+
+    for( uint32_t band = 1; band < band_count; ++band )
+    {
+        const RunBand& above = bands[band - 1];
+        const RunBand& below = bands[band];
+        uint32_t above_rows = uint32_t(above.m_row_firsts.size()) - 1;
+
+        JoinRunRows(above.m_runs,above.m_row_firsts[above_rows - 1],above.m_row_firsts[above_rows],below.m_runs,
+                    below.m_row_firsts[0],below.m_row_firsts[1],grid.m_size_x,parents,first_ids[band - 1],
+                    first_ids[band]);
+    }
+
+    // every id points straight at it's root after this, so the threads below only read.
+    std::vector<uint64_t> area_sizes(id_count,0);
+    for( uint32_t band = 0; band < band_count; ++band )
+    {
+        for( std::size_t run = 0; run < bands[band].m_runs.size(); ++run )
+        {
+            uint32_t id = first_ids[band] + uint32_t(run);
+            parents[id] = FindRoot(parents,id);
+            area_sizes[parents[id]] += bands[band].m_runs[run].m_end - bands[band].m_runs[run].m_start;
+        }
+    }
+
+    uint32_t biggest = uint32_t(std::max_element(area_sizes.begin(),area_sizes.end()) - area_sizes.begin());
+
+    RunOnThreads(band_count,grid.m_thread_count,[&]( uint32_t band )
+    {
+        for( std::size_t run = 0; run < bands[band].m_runs.size(); ++run )
+        {
+            const OpenRun& open = bands[band].m_runs[run];
+            if( parents[first_ids[band] + run] != biggest )
+                std::memset(grid.m_cells + open.m_start,GENERATOR_WALL,open.m_end - open.m_start);
+        }
+    });
+
+    return true;
+}
+
+// the same rule as a loaded level: atleast two open cells straight ahead. the border is all walls, so the cells
+// two steps from an open cell are always inside the grid.
+static uint8_t ComputeSpawnDirections( const GeneratorGrid& grid, uint32_t cell )
+{
+    if( grid.m_cells[cell] != GENERATOR_OPEN )
+        return 0;
+
+    const int32_t offsets[4] = { -int32_t(grid.m_size_x), -1, int32_t(grid.m_size_x), 1 };
+    uint8_t directions = 0;
+
+    for( uint32_t i = 0; i < 4; ++i )
+    {
+        uint32_t first = cell + offsets[i];
+        if( grid.m_cells[first] == GENERATOR_OPEN && grid.m_cells[first + offsets[i]] == GENERATOR_OPEN )
+            directions |= uint8_t(1u << i);
+    }
+
+    return directions;
+}
+
+// the spawn directions of every cell of a row, 0 for a wall, the same bit order as SNAKE_SPAWN_DIRECTION_SHIFT.
+// 8 cells at a time in the middle of the row, where all the cells two steps away are inside the row.
+// returns how many cells of the row have a direction.
+static uint32_t FindRowSpawnDirections( const GeneratorGrid& grid, uint32_t y, uint8_t* directions )
+{
+    uint32_t size_x = grid.m_size_x;
+    uint32_t count = 0;
+
+    if( y == 0 || y == grid.m_size_y - 1u )
+    {
+        std::memset(directions,0,size_x);
+        return 0;
+    }
+
+    const uint8_t* row = grid.m_cells + y * size_x;
+    bool up = y >= 2, down = y + 3 <= grid.m_size_y;
+    uint32_t x = 0;
+
+    for( ; x < 2 && x < size_x; ++x )
+        count += ( directions[x] = ComputeSpawnDirections(grid,x + y * size_x) ) != 0;
+
+    for( ; x + 10 <= size_x; x += 8 )
+    {
+        uint64_t open = LoadCells(row + x) ^ EVERY_CELL_BYTE;
+        uint64_t bits = ( LoadCells(row + x - 1) ^ EVERY_CELL_BYTE ) & ( LoadCells(row + x - 2) ^ EVERY_CELL_BYTE );
+        bits <<= 1;
+        bits |= ( ( LoadCells(row + x + 1) ^ EVERY_CELL_BYTE ) & ( LoadCells(row + x + 2) ^ EVERY_CELL_BYTE ) ) << 3;
+
+        if( up )
+        {
+            bits |= ( LoadCells(row + x - size_x) ^ EVERY_CELL_BYTE ) &
+                    ( LoadCells(row + x - 2 * size_x) ^ EVERY_CELL_BYTE );
+        }
+
+        if( down )
+        {
+            bits |= ( ( LoadCells(row + x + size_x) ^ EVERY_CELL_BYTE ) &
+                      ( LoadCells(row + x + 2 * size_x) ^ EVERY_CELL_BYTE ) ) << 2;
+        }
+
+        bits &= open * 0x0f;
+        StoreCells(directions + x,bits);
+        count += __builtin_popcountll(( bits | bits >> 1 | bits >> 2 | bits >> 3 ) & EVERY_CELL_BYTE);
+    }
+
+    for( ; x < size_x; ++x )
+        count += ( directions[x] = ComputeSpawnDirections(grid,x + y * size_x) ) != 0;
+
+    return count;
+}
+
+// packs the grid into the wall bitmap and lists the spawn cells, a band of rows per thread. a band is
+// LEVEL_GENERATOR_TILE_SIZE rows, a multiple of 8 cells, so bands never share a byte of the bitmap. the spawn
+// directions are worked out into directions first and counted, so every band knows where it's spawn cells go.
+static bool BuildLevel( const GeneratorGrid& grid, uint8_t* directions, SnakeLevel& level, const char* name )
+{
+    uint32_t size_x = grid.m_size_x;
+    uint32_t band_count = grid.m_tiles_y;
+    std::vector<uint32_t> wall_counts(band_count), spawn_counts(band_count + 1,0);
+
+    RunOnThreads(band_count,grid.m_thread_count,[&]( uint32_t band )
+    {
+        uint32_t y0 = band * LEVEL_GENERATOR_TILE_SIZE;
+        uint32_t y1 = std::min<uint32_t>(y0 + LEVEL_GENERATOR_TILE_SIZE,grid.m_size_y);
+        uint32_t walls = 0, spawns = 0;
+
+        for( uint32_t y = y0; y < y1; ++y )
+        {
+            spawns += FindRowSpawnDirections(grid,y,directions + y * size_x);
+
+            const uint8_t* row = grid.m_cells + y * size_x;
+            uint32_t x = 0;
+            for( ; x + 8 <= size_x; x += 8 )
+                walls += __builtin_popcountll(LoadCells(row + x));
+
+            for( ; x < size_x; ++x )
+                walls += row[x];
+        }
+
+        wall_counts[band] = walls;
+        spawn_counts[band + 1] = spawns;
+    });
+
+    uint32_t wall_count = 0;
+    for( uint32_t band = 0; band < band_count; ++band )
+    {
+        wall_count += wall_counts[band];
+        spawn_counts[band + 1] += spawn_counts[band];
+    }
+
+    if( spawn_counts[band_count] == 0 )
+        return false;
+
+    uint8_t* walls = AllocateSnakeLevel(level,name,grid.m_size_x,grid.m_size_y,wall_count,spawn_counts[band_count]);
+    if( !walls )
+        return false;
+
+    uint32_t cell_count = uint32_t(grid.m_size_x) * grid.m_size_y;
+
+    RunOnThreads(band_count,grid.m_thread_count,[&]( uint32_t band )
+    {
+        uint32_t start = band * LEVEL_GENERATOR_TILE_SIZE * size_x;
+        uint32_t end = std::min(start + LEVEL_GENERATOR_TILE_SIZE * size_x,cell_count);
+        uint32_t* spawn_cells = level.m_spawn_cells + spawn_counts[band];
+        uint32_t cell = start;
+
+        // 8 bytes of 0 or 1 gather into the top byte of the product, the first cell in the lowest bit.
+        for( ; cell + 8 <= end; cell += 8 )
+            walls[cell >> 3] = uint8_t(( LoadCells(grid.m_cells + cell) * 0x0102040810204080ULL ) >> 56);
+
+        for( ; cell < end; ++cell )
+            walls[cell >> 3] |= uint8_t(grid.m_cells[cell] << ( cell & 7 ));
+
+        for( cell = start; cell < end; ++cell )
+        {
+            if( cell + 8 <= end && LoadCells(directions + cell) == 0 )
+            {
+                cell += 7;
+                continue;
+            }
+
+            if( directions[cell] )
+                *spawn_cells++ = cell | ( uint32_t(directions[cell]) << SNAKE_SPAWN_DIRECTION_SHIFT );
+        }
+    });
+
+    return true;
+}
+
+std::size_t ComputeLevelGeneratorMemorySize( uint16_t size_x, uint16_t size_y )
+{
+    std::size_t cell_count = std::size_t(size_x) * size_y;
+
+    // the cells, and a second buffer the caves are smoothed into and the spawn directions are worked out in.
+    return ArenaFootprint<uint8_t>(cell_count) * 2;
+}
+
+bool GenerateSnakeLevel( SnakeLevel& level, GameArena& arena, uint8_t kind, uint16_t size_x, uint16_t size_y,
+                         uint64_t seed, uint32_t thread_count )
+{
+    UnloadSnakeLevel(level);
+
+    if( kind >= LEVEL_GENERATOR_KIND_COUNT || size_x < SNAKE_GAME_MIN_SIZE || size_y < SNAKE_GAME_MIN_SIZE ||
+        size_x > SNAKE_GAME_MAX_SIZE || size_y > SNAKE_GAME_MAX_SIZE )
+        return false;
+
+    std::size_t cell_count = std::size_t(size_x) * size_y;
+    arena.Reset();
+    if( !arena.Reserve(ComputeLevelGeneratorMemorySize(size_x,size_y)) )
+        return false;
+
+    GeneratorGrid grid;
+    grid.m_size_x = size_x;
+    grid.m_size_y = size_y;
+    grid.m_tiles_x = ( size_x + LEVEL_GENERATOR_TILE_SIZE - 1 ) / LEVEL_GENERATOR_TILE_SIZE;
+    grid.m_tiles_y = ( size_y + LEVEL_GENERATOR_TILE_SIZE - 1 ) / LEVEL_GENERATOR_TILE_SIZE;
+    grid.m_thread_count = thread_count ? thread_count : std::max(1u,std::thread::hardware_concurrency());
+    grid.m_seed = seed ^ ( uint64_t(kind) << 56 );
+    grid.m_cells = arena.AllocateArray<uint8_t>(cell_count);
+
+    uint8_t* scratch = arena.AllocateArray<uint8_t>(cell_count);
+    uint32_t tile_count = grid.m_tiles_x * grid.m_tiles_y;
+
+    if( kind == LEVEL_GENERATOR_MAZE )
+    {
+        MazeLayout maze;
+        maze.m_cells_x = ( size_x - 1u ) / MAZE_PITCH;
+        maze.m_cells_y = ( size_y - 1u ) / MAZE_PITCH;
+        maze.m_tiles_x = ( maze.m_cells_x + MAZE_TILE_CELLS - 1 ) / MAZE_TILE_CELLS;
+        uint32_t maze_tiles_y = ( maze.m_cells_y + MAZE_TILE_CELLS - 1 ) / MAZE_TILE_CELLS;
+
+        RunOnThreads(tile_count,grid.m_thread_count,[&]( uint32_t tile ) { FillTile(grid,tile,GENERATOR_WALL); });
+        RunOnThreads(maze.m_tiles_x * maze_tiles_y,grid.m_thread_count,[&]( uint32_t tile )
+        {
+            CarveMazeTile(grid,maze,tile);
+        });
+    }
+
+    else if( kind == LEVEL_GENERATOR_CAVES )
+    {
+        RunOnThreads(tile_count,grid.m_thread_count,[&]( uint32_t tile ) { FillCaveTile(grid,tile); });
+
+        for( int pass = 0; pass < CAVE_SMOOTHING_PASSES; ++pass )
+        {
+            RunOnThreads(tile_count,grid.m_thread_count,[&]( uint32_t tile )
+            {
+                SmoothCaveTile(grid,grid.m_cells,scratch,tile);
+            });
+
+            std::swap(grid.m_cells,scratch);
+        }
+    }
+
+    else
+    {
+        RunOnThreads(tile_count,grid.m_thread_count,[&]( uint32_t tile ) { FillObstacleTile(grid,tile); });
+    }
+
+    if( !KeepBiggestOpenArea(grid) )
+        return false;
+
+    char name[SNAKE_LEVEL_NAME_LENGTH + 1];
+    std::snprintf(name,sizeof(name),"%s %llu",level_generator_names[kind],(unsigned long long)seed);
+
+    return BuildLevel(grid,scratch,level,name);
+}
+
+const char* GetLevelGeneratorName( uint8_t kind )
+{
+    return kind < LEVEL_GENERATOR_KIND_COUNT ? level_generator_names[kind] : "unknown";
+}
+
+uint8_t FindLevelGenerator( const char* name )
+{
+    for( uint8_t kind = 0; kind < LEVEL_GENERATOR_KIND_COUNT; ++kind )
+    {
+        if( std::strcmp(name,level_generator_names[kind]) == 0 )
+            return kind;
+    }
+
+    return LEVEL_GENERATOR_KIND_COUNT;
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "arena.h"
+#include "level.h"
+
+// levels made from a seed instead of a file. the board is cut into tiles of LEVEL_GENERATOR_TILE_SIZE cells a
+// side that are generated on as many threads as there are cores, every tile with it's own random numbers, so a
+// seed always gives the same level whatever the thread count. the open cells are then labeled per tile and the
+// labels of neighboring tiles joined, everything that isn't part of the biggest open area is walled up, so the
+// snake can always get to the food.
+#define LEVEL_GENERATOR_MAZE                    0 // corridors 3 cells wide, with some loops so it's playable.
+#define LEVEL_GENERATOR_CAVES                   1 // random walls smoothed into caves by a cellular automaton.
+#define LEVEL_GENERATOR_OBSTACLES               2 // open ground with blocks and wall segments strewn over it.
+#define LEVEL_GENERATOR_KIND_COUNT              3
+
+#define LEVEL_GENERATOR_TILE_SIZE               256
+
+// bytes of arena GenerateSnakeLevel() works in for a board of this size.
+std::size_t ComputeLevelGeneratorMemorySize( uint16_t size_x, uint16_t size_y );
+
+// generates the level into level, as if it had been loaded from a file. arena is reset and only used while
+// generating, thread_count 0 uses one thread per core. false if the board is too small for the kind to leave an
+// open area with a spawn cell, or the memory couldn't be had.
+bool GenerateSnakeLevel( SnakeLevel& level, GameArena& arena, uint8_t kind, uint16_t size_x, uint16_t size_y,
+                         uint64_t seed, uint32_t thread_count );
+
+const char* GetLevelGeneratorName( uint8_t kind );
+
+// the kind with that name, LEVEL_GENERATOR_KIND_COUNT if there is none.
+uint8_t FindLevelGenerator( const char* name );
@@ -0,0 +1,204 @@
+#include "libsnake.h"
+
+#include <cstddef>
+#include <cstring>
+#include <new>
+
+#include "arena.h"
+#include "snake_game.h"
+#include "items.h"
+#include "search.h"
+
+static_assert(LIBSNAKE_DIRECTION_RIGHT == SNAKE_DIRECTION_RIGHT && LIBSNAKE_DIRECTION_UP == SNAKE_DIRECTION_UP,
+              "libsnake directions must match the game's");
+static_assert(LIBSNAKE_STATUS_ONGOING == GAME_STATUS_ONGOING && LIBSNAKE_STATUS_LOST == GAME_STATUS_LOST &&
+              LIBSNAKE_STATUS_WON == GAME_STATUS_WON,"libsnake statuses must match the game's");
+static_assert(LIBSNAKE_RULE_PASS_BORDERS == SNAKE_RULE_PASS_BORDERS &&
+              LIBSNAKE_RULE_CUT_ITSELF == SNAKE_RULE_CUT_ITSELF,"libsnake rules must match the game's");
+static_assert(LIBSNAKE_MIN_SIZE == SNAKE_GAME_MIN_SIZE && LIBSNAKE_MAX_SIZE == SNAKE_GAME_MAX_SIZE,
+              "libsnake sizes must match the game's");
+
+// everything a game of the library owns, the handle is a pointer to this.
+struct libsnake_game
+{
+    libsnake_game() : m_size_x(0), m_size_y(0), m_rules(0), m_item_count(0) {}
+
+    GameArena m_arena;
+    GameArena m_item_arena;
+    SnakeGameState m_state;
+    ItemField m_items;
+    SnakeSearchContext m_search;
+    uint16_t m_size_x;
+    uint16_t m_size_y;
+    uint8_t m_rules;
+    uint32_t m_item_count;
+};
+
+// whether the caller's struct reaches past field, a caller built against an older header passes a smaller struct.
+#define LIBSNAKE_HAS_FIELD(object,type,field) \
+    ( (object)->m_struct_size >= offsetof(type,field) + sizeof((object)->field) )
+
+// the arena already holds a game of this size, so starting an other one doesn't go to the heap.
+static int StartLibraryGame( libsnake_game& game, uint64_t seed )
+{
+    game.m_arena.Reset();
+    if( !InitializeSnakeGameState(game.m_state,game.m_arena,game.m_size_x,game.m_size_y,seed,game.m_rules) )
+        return LIBSNAKE_ERROR_OUT_OF_MEMORY;
+
+    StartSnakeGameState(game.m_state);
+
+    uint32_t capacity = ComputeItemCapacity(game.m_state,game.m_item_count);
+    if( !InitializeItemField(game.m_items,game.m_item_arena,game.m_state,capacity) )
+        return LIBSNAKE_ERROR_OUT_OF_MEMORY;
+
+    return LIBSNAKE_OK;
+}
+
+uint32_t libsnake_abi_version( void )
+{
+    return LIBSNAKE_ABI_VERSION;
+}
+
+void libsnake_init_config( libsnake_config* config )
+{
+    if( !config )
+        return;
+
+    std::memset(config,0,sizeof(libsnake_config));
+    config->m_struct_size = sizeof(libsnake_config);
+    config->m_size_x = 20;
+    config->m_size_y = 20;
+    config->m_seed = 1;
+}
+
+int libsnake_create( const libsnake_config* config, libsnake_game** game )
+{
+    if( game )
+        *game = nullptr;
+
+    if( !config || !game || !LIBSNAKE_HAS_FIELD(config,libsnake_config,m_seed) ||
+        config->m_size_x < SNAKE_GAME_MIN_SIZE || config->m_size_y < SNAKE_GAME_MIN_SIZE ||
+        config->m_size_x > SNAKE_GAME_MAX_SIZE || config->m_size_y > SNAKE_GAME_MAX_SIZE )
+        return LIBSNAKE_ERROR_INVALID_ARGUMENT;
+
+    uint32_t rules = LIBSNAKE_HAS_FIELD(config,libsnake_config,m_rules) ? config->m_rules : 0;
+    if( rules & ~uint32_t(SNAKE_RULE_ALL) )
+        return LIBSNAKE_ERROR_INVALID_ARGUMENT;
+
+    libsnake_game* created = new(std::nothrow) libsnake_game();
+    if( !created )
+        return LIBSNAKE_ERROR_OUT_OF_MEMORY;
+
+    // the search runs on the caller's thread, the library never starts threads of it's own.
+    created->m_search.m_thread_count = 1;
+    created->m_size_x = config->m_size_x;
+    created->m_size_y = config->m_size_y;
+    created->m_rules = uint8_t(rules);
+    created->m_item_count = LIBSNAKE_HAS_FIELD(config,libsnake_config,m_item_count) ? config->m_item_count : 0;
+
+    int result = LIBSNAKE_ERROR_OUT_OF_MEMORY;
+    if( created->m_arena.Reserve(ComputeSnakeGameMemorySize(config->m_size_x,config->m_size_y)) )
+        result = StartLibraryGame(*created,config->m_seed);
+
+    if( result != LIBSNAKE_OK )
+    {
+        delete created;
+        return result;
+    }
+
+    *game = created;
+    return LIBSNAKE_OK;
+}
+
+void libsnake_destroy( libsnake_game* game )
+{
+    delete game;
+}
+
+int libsnake_reset( libsnake_game* game, uint64_t seed )
+{
+    if( !game )
+        return LIBSNAKE_ERROR_INVALID_ARGUMENT;
+
+    return StartLibraryGame(*game,seed);
+}
+
+int libsnake_step( libsnake_game* game, uint8_t direction, uint8_t* status )
+{
+    if( !game || direction > SNAKE_DIRECTION_RIGHT )
+        return LIBSNAKE_ERROR_INVALID_ARGUMENT;
+
+    int32_t score = game->m_state.m_score;
+    StepSnakeGame(game->m_state,direction);
+    UpdateItemField(game->m_items,game->m_state,score);
+
+    if( status )
+        *status = game->m_state.m_status;
+
+    return LIBSNAKE_OK;
+}
+
+int libsnake_observe( const libsnake_game* game, libsnake_observation* observation )
+{
+    if( !game || !observation || !LIBSNAKE_HAS_FIELD(observation,libsnake_observation,m_status) )
+        return LIBSNAKE_ERROR_INVALID_ARGUMENT;
+
+    const SnakeGameState& state = game->m_state;
+
+    // a caller built against a newer header gets the fields this version knows of, the rest are zeroed.
+    uint32_t struct_size = observation->m_struct_size;
+    std::memset(observation,0,struct_size);
+    observation->m_struct_size = struct_size;
+
+    observation->m_size_x = state.m_size_x;
+    observation->m_size_y = state.m_size_y;
+    observation->m_head = state.Head();
+    observation->m_food = state.m_food;
+    observation->m_length = state.m_length;
+    observation->m_item_count = game->m_items.m_count;
+    observation->m_score = state.m_score;
+    observation->m_tick = state.m_tick;
+    observation->m_direction = state.m_direction;
+    observation->m_status = state.m_status;
+
+    return LIBSNAKE_OK;
+}
+
+int libsnake_copy_field( const libsnake_game* game, char* buffer, size_t buffer_size )
+{
+    if( !game || !buffer )
+        return LIBSNAKE_ERROR_INVALID_ARGUMENT;
+
+    if( buffer_size < game->m_state.CellCount() )
+        return LIBSNAKE_ERROR_BUFFER_TOO_SMALL;
+
+    std::memcpy(buffer,game->m_state.m_field,game->m_state.CellCount());
+
+    return LIBSNAKE_OK;
+}
+
+int libsnake_copy_body( const libsnake_game* game, uint32_t* cells, size_t capacity, size_t* count )
+{
+    if( !game || ( !cells && capacity ) )
+        return LIBSNAKE_ERROR_INVALID_ARGUMENT;
+
+    const SnakeGameState& state = game->m_state;
+    if( count )
+        *count = state.m_length;
+
+    for( uint32_t i = 0; i < state.m_length && i < capacity; ++i )
+        cells[i] = state.BodyCell(i);
+
+    return capacity < state.m_length ? LIBSNAKE_ERROR_BUFFER_TOO_SMALL : LIBSNAKE_OK;
+}
+
+int libsnake_suggest_move( libsnake_game* game, uint8_t depth, uint8_t* direction )
+{
+    if( !game || !direction )
+        return LIBSNAKE_ERROR_INVALID_ARGUMENT;
+
+    game->m_search.m_depth = depth ? depth : SNAKE_SEARCH_DEFAULT_DEPTH;
+    *direction = SearchSnakeMove(game->m_search,game->m_state);
+
+    return LIBSNAKE_OK;
+}
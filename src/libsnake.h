@@ -0,0 +1,106 @@
+#pragma once
+
+// the C interface of libsnake, the game without the terminal. everything a game needs lives behind the handle
+// libsnake_create() returns, the library has no globals, so independent games can be stepped from different
+// threads at the same time. a single game must only be used by one thread at a time.
+//
+// nothing the library returns points into it's own memory, observations are copied into structs and buffers the
+// caller owns. structs passed in start with m_struct_size, so fields can be added at the end without breaking
+// programs built against an older header. every function that can fail returns one of the LIBSNAKE_* results.
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if defined(_WIN32)
+#define LIBSNAKE_API                            __declspec(dllexport)
+#else
+#define LIBSNAKE_API                            __attribute__((visibility("default")))
+#endif
+
+// bumped whenever a change breaks programs built against an older header.
+#define LIBSNAKE_ABI_VERSION                    1
+
+#define LIBSNAKE_OK                             0
+#define LIBSNAKE_ERROR_INVALID_ARGUMENT         -1
+#define LIBSNAKE_ERROR_OUT_OF_MEMORY            -2
+#define LIBSNAKE_ERROR_BUFFER_TOO_SMALL         -3
+
+// the same values as the game uses, see snake_game.h.
+#define LIBSNAKE_DIRECTION_NONE                 0
+#define LIBSNAKE_DIRECTION_UP                   1
+#define LIBSNAKE_DIRECTION_LEFT                 2
+#define LIBSNAKE_DIRECTION_DOWN                 3
+#define LIBSNAKE_DIRECTION_RIGHT                4
+
+#define LIBSNAKE_STATUS_WON                     2
+#define LIBSNAKE_STATUS_ONGOING                 3
+#define LIBSNAKE_STATUS_LOST                    4
+
+#define LIBSNAKE_RULE_PASS_BORDERS              1
+#define LIBSNAKE_RULE_CUT_ITSELF                2
+
+#define LIBSNAKE_MIN_SIZE                       4
+#define LIBSNAKE_MAX_SIZE                       4096
+
+typedef struct libsnake_game libsnake_game;
+
+typedef struct libsnake_config
+{
+    uint32_t m_struct_size;     // sizeof(libsnake_config), libsnake_init_config() sets it.
+    uint16_t m_size_x;          // the board, border walls included.
+    uint16_t m_size_y;
+    uint64_t m_seed;
+    uint32_t m_rules;           // a mask of LIBSNAKE_RULE_* values.
+    uint32_t m_item_count;      // items besides the food, 0 plays the plain game ( see items.h ).
+} libsnake_config;
+
+typedef struct libsnake_observation
+{
+    uint32_t m_struct_size;     // sizeof(libsnake_observation), set by the caller.
+    uint16_t m_size_x;
+    uint16_t m_size_y;
+    uint32_t m_head;            // cells are x + y * m_size_x.
+    uint32_t m_food;
+    uint32_t m_length;
+    uint32_t m_item_count;
+    int32_t m_score;
+    uint64_t m_tick;
+    uint8_t m_direction;
+    uint8_t m_status;
+} libsnake_observation;
+
+LIBSNAKE_API uint32_t libsnake_abi_version( void );
+
+// a 20x20 board without rules or items.
+LIBSNAKE_API void libsnake_init_config( libsnake_config* config );
+
+// creates a game and starts it, the snake moves with the first step.
+LIBSNAKE_API int libsnake_create( const libsnake_config* config, libsnake_game** game );
+LIBSNAKE_API void libsnake_destroy( libsnake_game* game );
+
+// starts a new game on the same board, without going to the heap.
+LIBSNAKE_API int libsnake_reset( libsnake_game* game, uint64_t seed );
+
+// moves the snake one tick, direction is ignored if it's NONE or the opposite of the current one. status may be
+// null. a game that is over stays as it is until it's reset.
+LIBSNAKE_API int libsnake_step( libsnake_game* game, uint8_t direction, uint8_t* status );
+
+LIBSNAKE_API int libsnake_observe( const libsnake_game* game, libsnake_observation* observation );
+
+// copies the field, one character per cell in the order of the cells, the characters are the ones the terminal
+// game draws. buffer_size must be atleast m_size_x * m_size_y.
+LIBSNAKE_API int libsnake_copy_field( const libsnake_game* game, char* buffer, size_t buffer_size );
+
+// copies the cells of the body from the head to the tail, atmost capacity of them. count gets the length.
+LIBSNAKE_API int libsnake_copy_body( const libsnake_game* game, uint32_t* cells, size_t capacity, size_t* count );
+
+// the move the autopilot of the terminal game would make, searching depth moves ahead on the calling thread.
+LIBSNAKE_API int libsnake_suggest_move( libsnake_game* game, uint8_t depth, uint8_t* direction );
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,443 @@
+#include "lockstep.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+
+#define LOCKSTEP_MAGIC                          0x4b4c4e53 // "SNLK"
+#define LOCKSTEP_HOST_HELLO_SIZE                42
+#define LOCKSTEP_GUEST_HELLO_SIZE               26
+#define LOCKSTEP_HANDSHAKE_TIMEOUT              5000 // milliseconds.
+
+// the host hello:
+//
+//  0 magic               u32
+//  4 version             u8
+//  5 seed                u64
+// 13 size x              u16
+// 15 size y              u16
+// 17 rules               u8
+// 18 input delay         u8
+// 19 tick milliseconds   u16
+// 21 host name           21 bytes, zero padded
+//
+// and the guest answers with the magic, the version and it's name at the same offsets as above ( 0, 4, 5 ).
+
+static void PutU16( uint8_t* out, uint16_t value )
+{
+    out[0] = uint8_t(value);
+    out[1] = uint8_t(value >> 8);
+}
+
+static void PutU32( uint8_t* out, uint32_t value )
+{
+    for( int i = 0; i < 4; ++i )
+        out[i] = uint8_t(value >> ( i * 8 ));
+}
+
+static void PutU64( uint8_t* out, uint64_t value )
+{
+    for( int i = 0; i < 8; ++i )
+        out[i] = uint8_t(value >> ( i * 8 ));
+}
+
+static uint16_t GetU16( const uint8_t* in )
+{
+    return uint16_t(in[0] | ( in[1] << 8 ));
+}
+
+static uint32_t GetU32( const uint8_t* in )
+{
+    uint32_t value = 0;
+    for( int i = 3; i >= 0; --i )
+        value = ( value << 8 ) | in[i];
+
+    return value;
+}
+
+static uint64_t GetU64( const uint8_t* in )
+{
+    uint64_t value = 0;
+    for( int i = 7; i >= 0; --i )
+        value = ( value << 8 ) | in[i];
+
+    return value;
+}
+
+static uint32_t HashValue( uint32_t hash, uint64_t value, int byte_count )
+{
+    for( int i = 0; i < byte_count; ++i )
+    {
+        hash ^= uint8_t(value >> ( i * 8 ));
+        hash *= 16777619u;
+    }
+
+    return hash;
+}
+
+// FNV-1a over the state and the body. the field is left out, it follows from the body and the food.
+uint32_t HashSnakeGameState( const SnakeGameState& state, uint32_t hash )
+{
+    hash = HashValue(hash,state.m_tick,8);
+    hash = HashValue(hash,state.m_random_state,8);
+    hash = HashValue(hash,state.m_length,4);
+    hash = HashValue(hash,state.m_food,4);
+    hash = HashValue(hash,uint32_t(state.m_score),4);
+    hash = HashValue(hash,state.m_direction,1);
+    hash = HashValue(hash,state.m_status,1);
+
+    for( uint32_t i = 0; i < state.m_length; ++i )
+        hash = HashValue(hash,state.BodyCell(i),4);
+
+    return hash;
+}
+
+LockstepSession::~LockstepSession()
+{
+    if( m_fd >= 0 )
+        close(m_fd);
+
+    if( m_listen_fd >= 0 )
+        close(m_listen_fd);
+}
+
+// waits for the whole buffer to be sent or received, for the handshake only.
+static bool TransferAll( int fd, uint8_t* data, std::size_t size, bool is_sending )
+{
+    while( size )
+    {
+        pollfd descriptor = { fd, short(is_sending ? POLLOUT : POLLIN), 0 };
+        if( poll(&descriptor,1,LOCKSTEP_HANDSHAKE_TIMEOUT) <= 0 )
+            return false;
+
+        ssize_t result = is_sending ? send(fd,data,size,MSG_NOSIGNAL) : recv(fd,data,size,0);
+        if( result < 0 && ( errno == EINTR || errno == EAGAIN ) )
+            continue;
+
+        if( result <= 0 )
+            return false;
+
+        data += result;
+        size -= result;
+    }
+
+    return true;
+}
+
+static void RecordLocalHash( LockstepSession& session );
+
+// both sides build the exact same games from the settings, from here on only inputs are exchanged.
+static bool StartLockstepGames( LockstepSession& session )
+{
+    const LockstepSettings& settings = session.m_settings;
+
+    int enable = 1;
+    setsockopt(session.m_fd,IPPROTO_TCP,TCP_NODELAY,&enable,sizeof(enable));
+    fcntl(session.m_fd,F_SETFL,fcntl(session.m_fd,F_GETFL,0) | O_NONBLOCK);
+
+    for( int player = 0; player < 2; ++player )
+    {
+        session.m_arenas[player].Reset();
+        if( !session.m_arenas[player].Reserve(ComputeSnakeGameMemorySize(settings.m_size_x,settings.m_size_y)) ||
+            !InitializeSnakeGameState(session.m_games[player],session.m_arenas[player],settings.m_size_x,
+                                      settings.m_size_y,settings.m_seed,settings.m_rules) )
+            return false;
+
+        StartSnakeGameState(session.m_games[player]);
+
+        for( uint32_t i = 0; i < LOCKSTEP_WINDOW; ++i )
+            session.m_input_ticks[player][i] = session.m_hash_ticks[player][i] = UINT64_MAX;
+
+        // nobody could have picked a direction for the ticks inside the delay.
+        for( uint32_t tick = 0; tick < settings.m_input_delay; ++tick )
+        {
+            session.m_input_ticks[player][tick] = tick;
+            session.m_inputs[player][tick] = SNAKE_DIRECTION_NONE;
+        }
+    }
+
+    session.m_tick = 0;
+    session.m_next_input_tick = settings.m_input_delay;
+    session.m_receive_size = 0;
+    RecordLocalHash(session);
+
+    return true;
+}
+
+bool HostLockstepSession( LockstepSession& session, uint16_t port, const LockstepSettings& settings )
+{
+    if( settings.m_input_delay > LOCKSTEP_MAX_INPUT_DELAY )
+        return false;
+
+    session.m_settings = settings;
+    session.m_local_player = 0;
+
+    sockaddr_in6 address;
+    std::memset(&address,0,sizeof(address));
+    address.sin6_family = AF_INET6;
+    address.sin6_port = htons(port);
+    address.sin6_addr = in6addr_any;
+
+    // a dual stack socket, so the other player can come over IPv4 or IPv6.
+    session.m_listen_fd = socket(AF_INET6,SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC,0);
+    if( session.m_listen_fd < 0 )
+        return false;
+
+    int enable = 1, disable = 0;
+    setsockopt(session.m_listen_fd,SOL_SOCKET,SO_REUSEADDR,&enable,sizeof(enable));
+    setsockopt(session.m_listen_fd,IPPROTO_IPV6,IPV6_V6ONLY,&disable,sizeof(disable));
+
+    return bind(session.m_listen_fd,reinterpret_cast<sockaddr*>(&address),sizeof(address)) == 0 &&
+           listen(session.m_listen_fd,1) == 0;
+}
+
+bool AcceptLockstepPlayer( LockstepSession& session )
+{
+    int fd = accept4(session.m_listen_fd,nullptr,nullptr,SOCK_CLOEXEC);
+    if( fd < 0 )
+        return false;
+
+    const LockstepSettings& settings = session.m_settings;
+
+    uint8_t hello[LOCKSTEP_HOST_HELLO_SIZE] = {};
+    PutU32(hello,LOCKSTEP_MAGIC);
+    hello[4] = LOCKSTEP_PROTOCOL_VERSION;
+    PutU64(hello + 5,settings.m_seed);
+    PutU16(hello + 13,settings.m_size_x);
+    PutU16(hello + 15,settings.m_size_y);
+    hello[17] = settings.m_rules;
+    hello[18] = settings.m_input_delay;
+    PutU16(hello + 19,settings.m_tick_milliseconds);
+    std::memcpy(hello + 21,settings.m_player_names[0],LOCKSTEP_PLAYER_NAME_LENGTH);
+
+    uint8_t answer[LOCKSTEP_GUEST_HELLO_SIZE];
+
+    // someone who doesn't speak the protocol is dropped, and we keep waiting for the real player.
+    if( !TransferAll(fd,hello,sizeof(hello),true) || !TransferAll(fd,answer,sizeof(answer),false) ||
+        GetU32(answer) != LOCKSTEP_MAGIC || answer[4] != LOCKSTEP_PROTOCOL_VERSION )
+    {
+        close(fd);
+        return false;
+    }
+
+    std::memcpy(session.m_settings.m_player_names[1],answer + 5,LOCKSTEP_PLAYER_NAME_LENGTH);
+    session.m_settings.m_player_names[1][LOCKSTEP_PLAYER_NAME_LENGTH] = '\0';
+
+    close(session.m_listen_fd);
+    session.m_listen_fd = -1;
+    session.m_fd = fd;
+
+    return StartLockstepGames(session);
+}
+
+bool JoinLockstepSession( LockstepSession& session, const char* address, uint16_t port, const char* player_name )
+{
+    addrinfo hints;
+    std::memset(&hints,0,sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+
+    char port_string[8];
+    std::snprintf(port_string,sizeof(port_string),"%u",unsigned(port));
+
+    addrinfo* addresses;
+    if( getaddrinfo(address,port_string,&hints,&addresses) != 0 )
+        return false;
+
+    for( addrinfo* entry = addresses; entry && session.m_fd < 0; entry = entry->ai_next )
+    {
+        int fd = socket(entry->ai_family,entry->ai_socktype | SOCK_CLOEXEC,entry->ai_protocol);
+        if( fd < 0 )
+            continue;
+
+        if( connect(fd,entry->ai_addr,entry->ai_addrlen) == 0 )
+            session.m_fd = fd;
+        else
+            close(fd);
+    }
+
+    freeaddrinfo(addresses);
+
+    if( session.m_fd < 0 )
+        return false;
+
+    uint8_t hello[LOCKSTEP_HOST_HELLO_SIZE];
+    if( !TransferAll(session.m_fd,hello,sizeof(hello),false) || GetU32(hello) != LOCKSTEP_MAGIC ||
+        hello[4] != LOCKSTEP_PROTOCOL_VERSION )
+        return false;
+
+    LockstepSettings& settings = session.m_settings;
+    settings.m_seed = GetU64(hello + 5);
+    settings.m_size_x = GetU16(hello + 13);
+    settings.m_size_y = GetU16(hello + 15);
+    settings.m_rules = hello[17];
+    settings.m_input_delay = hello[18];
+    settings.m_tick_milliseconds = GetU16(hello + 19);
+    std::memcpy(settings.m_player_names[0],hello + 21,LOCKSTEP_PLAYER_NAME_LENGTH);
+    settings.m_player_names[0][LOCKSTEP_PLAYER_NAME_LENGTH] = '\0';
+    std::strncpy(settings.m_player_names[1],player_name,LOCKSTEP_PLAYER_NAME_LENGTH);
+
+    if( settings.m_size_x < SNAKE_GAME_MIN_SIZE || settings.m_size_y < SNAKE_GAME_MIN_SIZE ||
+        ( settings.m_rules & ~SNAKE_RULE_ALL ) || settings.m_input_delay > LOCKSTEP_MAX_INPUT_DELAY )
+        return false;
+
+    uint8_t answer[LOCKSTEP_GUEST_HELLO_SIZE] = {};
+    PutU32(answer,LOCKSTEP_MAGIC);
+    answer[4] = LOCKSTEP_PROTOCOL_VERSION;
+    std::memcpy(answer + 5,settings.m_player_names[1],LOCKSTEP_PLAYER_NAME_LENGTH);
+
+    if( !TransferAll(session.m_fd,answer,sizeof(answer),true) )
+        return false;
+
+    session.m_local_player = 1;
+
+    return StartLockstepGames(session);
+}
+
+static void CompareHashes( LockstepSession& session, uint64_t tick )
+{
+    uint32_t slot = tick & ( LOCKSTEP_WINDOW - 1 );
+
+    if( session.m_hash_ticks[0][slot] != tick || session.m_hash_ticks[1][slot] != tick ||
+        session.m_hashes[0][slot] == session.m_hashes[1][slot] || session.m_is_desynced )
+        return;
+
+    session.m_is_desynced = true;
+    session.m_desync_tick = tick;
+}
+
+// the hashes are kept per player too, the local ones in the slot of the local player.
+static void RecordHash( LockstepSession& session, uint8_t player, uint64_t tick, uint32_t hash )
+{
+    uint32_t slot = tick & ( LOCKSTEP_WINDOW - 1 );
+    session.m_hash_ticks[player][slot] = tick;
+    session.m_hashes[player][slot] = hash;
+
+    CompareHashes(session,tick);
+}
+
+static void RecordLocalHash( LockstepSession& session )
+{
+    uint32_t hash = HashSnakeGameState(session.m_games[1],HashSnakeGameState(session.m_games[0]));
+    RecordHash(session,session.m_local_player,session.m_tick,hash);
+}
+
+bool PollLockstepSession( LockstepSession& session )
+{
+    uint8_t remote_player = 1 - session.m_local_player;
+
+    while( !session.m_is_disconnected )
+    {
+        ssize_t result = recv(session.m_fd,session.m_receive_buffer + session.m_receive_size,
+                              LOCKSTEP_MESSAGE_SIZE - session.m_receive_size,0);
+
+        if( result < 0 && errno == EINTR )
+            continue;
+
+        if( result < 0 && ( errno == EAGAIN || errno == EWOULDBLOCK ) )
+            break;
+
+        if( result <= 0 )
+        {
+            session.m_is_disconnected = true;
+            break;
+        }
+
+        session.m_bytes_received += result;
+        session.m_receive_size += result;
+        if( session.m_receive_size < LOCKSTEP_MESSAGE_SIZE )
+            continue;
+
+        session.m_receive_size = 0;
+
+        uint64_t tick = GetU32(session.m_receive_buffer);
+        uint8_t direction = session.m_receive_buffer[4];
+        uint32_t hash = GetU32(session.m_receive_buffer + 5);
+
+        // the other side can't be more than a window ahead, it needs our inputs to get anywhere.
+        if( tick < session.m_settings.m_input_delay || tick >= session.m_tick + LOCKSTEP_WINDOW ||
+            direction > SNAKE_DIRECTION_RIGHT )
+        {
+            session.m_is_disconnected = true;
+            break;
+        }
+
+        uint32_t slot = tick & ( LOCKSTEP_WINDOW - 1 );
+        session.m_input_ticks[remote_player][slot] = tick;
+        session.m_inputs[remote_player][slot] = direction;
+
+        RecordHash(session,remote_player,tick - session.m_settings.m_input_delay,hash);
+    }
+
+    return !session.m_is_disconnected && !session.m_is_desynced;
+}
+
+bool SendLockstepInput( LockstepSession& session, uint8_t direction )
+{
+    if( session.m_next_input_tick != session.m_tick + session.m_settings.m_input_delay )
+        return true;
+
+    uint64_t tick = session.m_next_input_tick++;
+    uint32_t slot = tick & ( LOCKSTEP_WINDOW - 1 );
+    session.m_input_ticks[session.m_local_player][slot] = tick;
+    session.m_inputs[session.m_local_player][slot] = direction;
+
+    uint8_t message[LOCKSTEP_MESSAGE_SIZE];
+    PutU32(message,uint32_t(tick));
+    message[4] = direction;
+    PutU32(message + 5,session.m_hashes[session.m_local_player][session.m_tick & ( LOCKSTEP_WINDOW - 1 )]);
+
+    // 9 bytes always fit in the socket buffer unless the other side stopped reading for a long time, and then
+    // it's gone anyway.
+    if( send(session.m_fd,message,sizeof(message),MSG_NOSIGNAL) != ssize_t(sizeof(message)) )
+    {
+        session.m_is_disconnected = true;
+        return false;
+    }
+
+    session.m_bytes_sent += sizeof(message);
+
+    return true;
+}
+
+bool AdvanceLockstepSession( LockstepSession& session )
+{
+    uint32_t slot = session.m_tick & ( LOCKSTEP_WINDOW - 1 );
+
+    if( session.m_is_desynced || session.m_input_ticks[0][slot] != session.m_tick ||
+        session.m_input_ticks[1][slot] != session.m_tick )
+    {
+        if( session.m_stalled_tick != session.m_tick )
+        {
+            session.m_stalled_tick = session.m_tick;
+            ++session.m_stall_count;
+        }
+
+        return false;
+    }
+
+    // a board that is over stays as it is, it's player still sends inputs so the other one can go on.
+    for( int player = 0; player < 2; ++player )
+    {
+        if( session.m_games[player].m_status == GAME_STATUS_ONGOING )
+            StepSnakeGame(session.m_games[player],session.m_inputs[player][slot]);
+    }
+
+    ++session.m_tick;
+    RecordLocalHash(session);
+
+    return true;
+}
+
+bool IsLockstepSessionOver( const LockstepSession& session )
+{
+    return session.m_games[0].m_status != GAME_STATUS_ONGOING && session.m_games[1].m_status != GAME_STATUS_ONGOING;
+}
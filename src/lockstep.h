@@ -0,0 +1,102 @@
+#pragma once
+
+#include <cstdint>
+
+#include "arena.h"
+#include "snake_game.h"
+
+#define LOCKSTEP_DEFAULT_PORT                   7272
+#define LOCKSTEP_PROTOCOL_VERSION               1
+#define LOCKSTEP_PLAYER_NAME_LENGTH             20
+#define LOCKSTEP_MAX_INPUT_DELAY                16
+#define LOCKSTEP_WINDOW                         64 // must be a power of 2 and more than twice the input delay.
+#define LOCKSTEP_MESSAGE_SIZE                   9
+
+// two players on two machines, each steering a snake on it's own board. both boards start from the same seed
+// and both machines simulate both of them, so the only thing that crosses the network is the direction each
+// player picked for each tick:
+//
+//   0 tick                u32   the tick the input is for
+//   4 direction           u8    a SNAKE_DIRECTION_* value
+//   5 hash                u32   hash of both games before tick ( tick - input delay ) was played
+//
+// an input sampled while tick t is played is for tick t + input delay, so it has that many ticks to get to the
+// other side before it's needed, and the first input delay ticks have no input at all. a tick is only played
+// once the inputs of both players for it are there. the hashes let each side check every tick that the other
+// one simulated exactly the same games, the first mismatch ends the session as a desync.
+struct LockstepSettings
+{
+    LockstepSettings() : m_seed(0), m_size_x(0), m_size_y(0), m_rules(0), m_input_delay(3),
+                         m_tick_milliseconds(0), m_player_names{} {}
+
+    uint64_t m_seed;
+    uint16_t m_size_x;
+    uint16_t m_size_y;
+    uint8_t m_rules;
+    uint8_t m_input_delay;
+    uint16_t m_tick_milliseconds;
+    char m_player_names[2][LOCKSTEP_PLAYER_NAME_LENGTH + 1]; // the host is player 0.
+};
+
+struct LockstepSession
+{
+    LockstepSession() : m_fd(-1), m_listen_fd(-1), m_local_player(0), m_tick(0), m_next_input_tick(0),
+                        m_desync_tick(0), m_is_desynced(false), m_is_disconnected(false), m_receive_size(0),
+                        m_bytes_sent(0), m_bytes_received(0), m_stall_count(0), m_stalled_tick(UINT64_MAX) {}
+
+    LockstepSession( const LockstepSession& other ) = delete;
+    LockstepSession& operator=( const LockstepSession& other ) = delete;
+
+    ~LockstepSession();
+
+    int m_fd;
+    int m_listen_fd;
+    uint8_t m_local_player;
+    LockstepSettings m_settings;
+
+    GameArena m_arenas[2];
+    SnakeGameState m_games[2];
+
+    // rings indexed by tick, an entry is valid when it's tick matches.
+    uint64_t m_input_ticks[2][LOCKSTEP_WINDOW];
+    uint8_t m_inputs[2][LOCKSTEP_WINDOW];
+    uint64_t m_hash_ticks[2][LOCKSTEP_WINDOW];
+    uint32_t m_hashes[2][LOCKSTEP_WINDOW];
+
+    uint64_t m_tick;            // the next tick to be played.
+    uint64_t m_next_input_tick; // the tick the next local input is for.
+    uint64_t m_desync_tick;
+    bool m_is_desynced;
+    bool m_is_disconnected;
+
+    uint8_t m_receive_buffer[LOCKSTEP_MESSAGE_SIZE];
+    uint32_t m_receive_size;
+    uint64_t m_bytes_sent;
+    uint64_t m_bytes_received;
+    uint64_t m_stall_count;     // ticks that were due before the other player's input was there.
+    uint64_t m_stalled_tick;
+};
+
+// starts listening for the other player, settings are the ones the game is played with.
+bool HostLockstepSession( LockstepSession& session, uint16_t port, const LockstepSettings& settings );
+
+// never blocks, returns true once the other player has connected and the games are set up.
+bool AcceptLockstepPlayer( LockstepSession& session );
+
+// connects to a host and takes the settings from it, blocks until the host answered or the connection failed.
+bool JoinLockstepSession( LockstepSession& session, const char* address, uint16_t port, const char* player_name );
+
+// reads whatever the other player sent, never blocks. false once the session can't go on.
+bool PollLockstepSession( LockstepSession& session );
+
+// sends the local input for the tick after the input delay. must be called once for every tick played,
+// before AdvanceLockstepSession().
+bool SendLockstepInput( LockstepSession& session, uint8_t direction );
+
+// plays the next tick on both games if both inputs for it are there, returns whether it did.
+bool AdvanceLockstepSession( LockstepSession& session );
+
+bool IsLockstepSessionOver( const LockstepSession& session );
+
+// hash of everything that decides how a game goes on, both games of a session are combined.
+uint32_t HashSnakeGameState( const SnakeGameState& state, uint32_t hash = 2166136261u );
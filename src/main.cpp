@@ -1,16 +1,42 @@
 #include <iostream>
 #include <fstream>
 #include <cstdlib>
+#include <cerrno>
 #include <ctime>
 #include <cstring>
+#include <cstdio>
 #include <csignal>
 #include <ctime>
 
 #include <unistd.h>
 #include <fcntl.h>
+#include <poll.h>
 #include <sys/ioctl.h>
 #include <termios.h>
 
+#include <algorithm>
+#include <chrono>
+#include <string>
+
+#include "arena.h"
+#include "heap_counter.h"
+#include "snake_game.h"
+#include "snapshot.h"
+#include "search.h"
+#include "renderer.h"
+#include "headless.h"
+#include "score_writer.h"
+#include "lockstep.h"
+#include "level.h"
+#include "level_generator.h"
+#include "analytics_log.h"
+#include "render_thread.h"
+#include "tick_scheduler.h"
+#include "retained_screen.h"
+#include "settings.h"
+#include "items.h"
+#include "replay.h"
+
 // it would be reading data in non blocking mode, since we change STDIN behaviour by fcntl.
 // must not return char since some keystrokes return multiple bytes into STDIN instead of 1 byte ( such as arrow keys )
 int32_t ReadKeyStrokeFromSTDIN()
@@ -113,6 +139,25 @@ termios original_terminal_interface, modified_terminal_interface;
 bool application_recieved_interrupt = false;
 bool app_is_running = false;
 
+// scores are written to disk on it's own thread, so the game never waits on the disk when a game ends.
+ScoreWriter score_writer;
+
+// the game being played, so a score it submits can be checked by playing it again.
+ReplayRecorder game_replay;
+
+// one record per game that is over, read by the snake_stats tool.
+AnalyticsLog analytics_log;
+
+// games are drawn on their own thread, DisplayGameOnScreen() only hands it a copy of the game.
+RenderThread render_thread;
+
+// edits of settings.ini made while the game runs are picked up through this, see ApplySettingsFileChanges().
+SettingsWatch settings_watch;
+
+// the writer and render threads can't be joined from inside a signal handler, an interrupt leaves them to the
+// atexit() call.
+volatile std::sig_atomic_t interrupt_is_being_handled = 0;
+
 void Sleep( uint32_t macro_seconds )
 {
     usleep(macro_seconds);
@@ -126,6 +171,16 @@ void SleepIfNotInterrupted( uint32_t macro_seconds )
 
 void HandleApplicationTermination()
 {
+    if( !interrupt_is_being_handled )
+    {
+        StopScoreWriter(score_writer);
+        StopRenderThread(render_thread);
+    }
+
+    // only a write and a close, so it's fine to do from the interrupt too.
+    CloseAnalyticsLog(analytics_log);
+    StopSettingsWatch(settings_watch);
+
     tcsetattr(STDIN_FILENO,TCSANOW,&original_terminal_interface);
     HideConsoleCursor(false);
     MaximizeWindow(false);
@@ -139,7 +194,9 @@ void HandleInterruptSignal( int signal )
     //#ifndef DEBUG_MODE
         ClearConsoleScreen();
         std::cout << "\ninterrupt has been generated!";
+        interrupt_is_being_handled = 1;
         HandleApplicationTermination();
+        interrupt_is_being_handled = 0;
     //#else // on debug mode, we use interrupt signal to restore terminal i/o mode, so we can debug.
     //    HideConsoleCursor(false);
     //    tcsetattr(STDIN_FILENO,TCSANOW,&original_terminal_interface);
@@ -151,6 +208,12 @@ void InitializeApplication( int argc, char** argv, char** env )
     std::signal(SIGINT,HandleInterruptSignal);
     std::atexit(HandleApplicationTermination);
 
+    if( !StartScoreWriter(score_writer,SCORES_FILE_NAME,REPLAY_LOG_FILE_NAME) )
+        std::cerr << "could not start the score writer, scores will not be saved!\n";
+
+    if( !OpenAnalyticsLog(analytics_log,ANALYTICS_LOG_FILE_NAME) )
+        std::cerr << "could not open " << ANALYTICS_LOG_FILE_NAME << ", games will not be logged!\n";
+
     tcgetattr(STDIN_FILENO,&original_terminal_interface);
     GetConsoleCharacterSize();
     MaximizeWindow(true);
@@ -186,6 +249,7 @@ bool ApplicationShouldClose()
 // ascii values for keystrokes
 #define KEY_NONE                                0
 
+#define KEY_TAB                                 9
 #define KEY_ENTER                               10
 #define KEY_ESCAPE                              27
 #define KEY_SPACE                               32
@@ -199,12 +263,20 @@ bool ApplicationShouldClose()
 #define KEY_S_LOWERCASE                         115
 #define KEY_D_UPPERCASE                         68
 #define KEY_D_LOWERCASE                         100
+#define KEY_P_UPPERCASE                         80
+#define KEY_P_LOWERCASE                         112
 #define KEY_Z_UPPERCASE                         90
 #define KEY_Z_LOWERCASE                         122
+#define KEY_C_LOWERCASE                         99
+#define KEY_M_LOWERCASE                         109
+#define KEY_O_LOWERCASE                         111
 
 #define KEY_0                                   48
 #define KEY_1                                   49
 #define KEY_2                                   50
+#define KEY_3                                   51
+#define KEY_4                                   52
+#define KEY_9                                   57
 
 // in case of arrow keys,3 characters are inserted into STDIN when we press them, when stored
 // inside a 32 bit int, they have these values.
@@ -213,6 +285,31 @@ bool ApplicationShouldClose()
 #define KEY_RIGHT                               4414235
 #define KEY_DOWN                                4348699
 
+// an interrupt ends a wait early, this only bounds it when one lands right before the wait begins.
+#define INPUT_WAIT_LIMIT                        1000 // milliseconds.
+
+// sleeps until a key is pressed or milliseconds went by, with watch_settings also until settings.ini changes.
+// only pass watch_settings from screens that apply the changes, an unread change would end every wait at once.
+void WaitForInput( int milliseconds, bool watch_settings )
+{
+    if( !app_is_running )
+        return;
+
+    pollfd descriptors[2] = { { STDIN_FILENO, POLLIN, 0 }, { settings_watch.m_fd, POLLIN, 0 } };
+    poll(descriptors,( watch_settings && settings_watch.m_fd >= 0 ) ? 2 : 1,milliseconds);
+}
+
+// the next key, the screens waiting for one sleep until it comes instead of polling. KEY_NONE if the application
+// is closed while waiting.
+int32_t WaitForKeyStroke()
+{
+    int32_t key;
+    while( ( key = ReadKeyStrokeFromSTDIN() ) == KEY_NONE && app_is_running )
+        WaitForInput(INPUT_WAIT_LIMIT,false);
+
+    return key;
+}
+
 #define APPLICATION_STATE_MAIN_MENU             0
 #define APPLICATION_STATE_ENTER_NAME            1
 #define APPLICATION_STATE_ENTER_DIFFICULTY      2
@@ -221,20 +318,89 @@ bool ApplicationShouldClose()
 #define APPLICATION_STATE_SCOREBOARD            5
 
 #define MENU_STATUS_NEW_GAME                    0
-#define MENU_STATUS_OPTIONS                     1
-#define MENU_STATUS_SCOREBOARD                  2
-#define MENU_STATUS_EXIT                        3
+#define MENU_STATUS_CONTINUE_GAME               1
+#define MENU_STATUS_OPTIONS                     2
+#define MENU_STATUS_SCOREBOARD                  3
+#define MENU_STATUS_EXIT                        4
 
 #define OPTION_STATUS_ALLOW_SNAKE_CUT_ITSELF    0
 #define OPTION_STATUS_ALLOW_SNAKE_PASS_BORDERS  1
-#define OPTION_STATUS_BACK                      2
+#define OPTION_STATUS_COLOR_MODE                2
+#define OPTION_STATUS_THEME                     3
+#define OPTION_STATUS_DENSITY                   4
+#define OPTION_STATUS_TURBO                     5
+#define OPTION_STATUS_ITEMS                     6
+#define OPTION_STATUS_BACK                      7
+
+// what a key does during a game, the keys next to the arrows come from settings.ini.
+#define GAME_ACTION_NONE                        0
+#define GAME_ACTION_UP                          1
+#define GAME_ACTION_LEFT                        2
+#define GAME_ACTION_DOWN                        3
+#define GAME_ACTION_RIGHT                       4
+#define GAME_ACTION_PAUSE                       5
+#define GAME_ACTION_AUTOPILOT                   6
+#define GAME_ACTION_QUIT                        7
 
-bool options_read = false;
 bool options_changed = false;
-bool can_read_options = true;
 uint8_t option_menu_choise = OPTION_STATUS_ALLOW_SNAKE_CUT_ITSELF;
-bool snake_can_cut_itself = false;
-bool snake_can_pass_border = false;
+
+// everything settings.ini holds, the options menu changes some of it. what the last read of the file couldn't
+// make sense of is shown in options.
+GameSettings game_settings;
+SettingsParseResult settings_parse_result;
+
+// set when settings.ini changed during a game in a way that only a new game picks up.
+bool settings_wait_for_next_game = false;
+
+uint8_t GetGameAction( int32_t key )
+{
+    if( key == KEY_NONE )
+        return GAME_ACTION_NONE;
+
+    if( key == KEY_ESCAPE )
+        return GAME_ACTION_QUIT;
+
+    if( key == KEY_UP )
+        return GAME_ACTION_UP;
+
+    if( key == KEY_LEFT )
+        return GAME_ACTION_LEFT;
+
+    if( key == KEY_DOWN )
+        return GAME_ACTION_DOWN;
+
+    if( key == KEY_RIGHT )
+        return GAME_ACTION_RIGHT;
+
+    // bindings are kept in lowercase.
+    if( key >= KEY_A_UPPERCASE && key <= KEY_Z_UPPERCASE )
+        key += KEY_A_LOWERCASE - KEY_A_UPPERCASE;
+
+    if( key == game_settings.m_key_up )
+        return GAME_ACTION_UP;
+
+    if( key == game_settings.m_key_left )
+        return GAME_ACTION_LEFT;
+
+    if( key == game_settings.m_key_down )
+        return GAME_ACTION_DOWN;
+
+    if( key == game_settings.m_key_right )
+        return GAME_ACTION_RIGHT;
+
+    if( key == game_settings.m_key_pause )
+        return GAME_ACTION_PAUSE;
+
+    if( key == game_settings.m_key_autopilot )
+        return GAME_ACTION_AUTOPILOT;
+
+    return GAME_ACTION_NONE;
+}
+
+// draws the game field. while the render thread runs it belongs to it, the color mode, theme and density reach it
+// with every frame.
+FrameRenderer field_renderer;
 
 uint8_t menu_status = MENU_STATUS_NEW_GAME;
 uint8_t application_status = APPLICATION_STATE_MAIN_MENU;
@@ -243,7 +409,13 @@ uint8_t game_difficulty;
 const uint8_t max_allowed_name_length = 20;
 
 char current_user_name[max_allowed_name_length + 1];
-int16_t current_user_score = 0;
+
+// the game being played, it's field and body live in game_arena.
+SnakeGameState game_state;
+
+// the main menu, options, scoreboard and name entry are rebuilt every loop, this only writes what changed.
+RetainedScreen menu_screen;
+const char name_prompt[] = "please enter your name (max 20 characters):";
 
 void ClearUserName()
 {
@@ -253,54 +425,88 @@ void ClearUserName()
 
 void DisplayMainMenu()
 {
-    ClearConsoleScreen();
-
-    SetConsoleCursorPosition(64,1);
-    std::cout << "welcome to the snake game.\n";
-    SetConsoleCursorPosition(51,2);
-    std::cout << "please choose the desired option from the menu below.\n";
-    SetConsoleCursorPosition(44,3);
-    std::cout << "use 'W' And 'S' or Arrow keys 'Up' and 'Down' for menu navigation.\n";
-    SetConsoleCursorPosition(69,4);
-    std::cout << ((menu_status == MENU_STATUS_NEW_GAME)? "* " : " ") << "new game\n";
-    SetConsoleCursorPosition(69,5);
-    std::cout << ((menu_status == MENU_STATUS_OPTIONS)? "* " : " ") << "options\n";
-    SetConsoleCursorPosition(69,6);
-    std::cout << ((menu_status == MENU_STATUS_SCOREBOARD)? "* " : " ") << "scores\n";
-    SetConsoleCursorPosition(69,7);
-    std::cout << ((menu_status == MENU_STATUS_EXIT)? "* " : " ") << "exit game\n" << std::flush;
+    BeginRetainedScreen(menu_screen,APPLICATION_STATE_MAIN_MENU);
+
+    SetScreenLine(menu_screen,1,64,"welcome to the snake game.");
+    SetScreenLine(menu_screen,2,51,"please choose the desired option from the menu below.");
+    SetScreenLine(menu_screen,3,44,"use 'W' And 'S' or Arrow keys 'Up' and 'Down' for menu navigation.");
+    SetScreenLine(menu_screen,4,69,"%snew game",(menu_status == MENU_STATUS_NEW_GAME)? "* " : " ");
+    SetScreenLine(menu_screen,5,69,"%scontinue saved game",(menu_status == MENU_STATUS_CONTINUE_GAME)? "* " : " ");
+    SetScreenLine(menu_screen,6,69,"%soptions",(menu_status == MENU_STATUS_OPTIONS)? "* " : " ");
+    SetScreenLine(menu_screen,7,69,"%sscores",(menu_status == MENU_STATUS_SCOREBOARD)? "* " : " ");
+    SetScreenLine(menu_screen,8,69,"%sexit game",(menu_status == MENU_STATUS_EXIT)? "* " : " ");
+
+    PresentRetainedScreen(menu_screen);
 }
 
 void DisplayOptions()
 {
-    ClearConsoleScreen();
+    BeginRetainedScreen(menu_screen,APPLICATION_STATE_OPTIONS);
+
+    SetScreenLine(menu_screen,1,1,"options:");
+    SetScreenLine(menu_screen,2,1,"( Press arrow keys and W or S for navigation, press space to change option, press "
+                                  "Enter to save changes and Escape to get back at main menu )");
+    SetScreenLine(menu_screen,3,1,"%sALLOW_SNAKE_CUT_ITSELF\t\t%s",
+                  (option_menu_choise == OPTION_STATUS_ALLOW_SNAKE_CUT_ITSELF)? "* " : " ",
+                  ( game_settings.m_snake_can_cut_itself )? "ON" : "OFF");
+    SetScreenLine(menu_screen,4,1,"%sALLOW_SNAKE_PASS_BORDERS\t\t%s",
+                  (option_menu_choise == OPTION_STATUS_ALLOW_SNAKE_PASS_BORDERS)? "* " : " ",
+                  ( game_settings.m_snake_can_pass_border )? "ON" : "OFF");
+    SetScreenLine(menu_screen,5,1,"%sCOLOR_MODE\t\t\t\t%s",
+                  (option_menu_choise == OPTION_STATUS_COLOR_MODE)? "* " : " ",
+                  GetRenderColorModeName(game_settings.m_color_mode));
+    SetScreenLine(menu_screen,6,1,"%sTHEME\t\t\t\t\t%s",
+                  (option_menu_choise == OPTION_STATUS_THEME)? "* " : " ",
+                  render_themes[game_settings.m_theme].m_name);
+    SetScreenLine(menu_screen,7,1,"%sDENSITY\t\t\t\t%s",
+                  (option_menu_choise == OPTION_STATUS_DENSITY)? "* " : " ",
+                  GetRenderDensityName(game_settings.m_density));
+
+    if( game_settings.m_turbo_tick_rate )
+        SetScreenLine(menu_screen,8,1,"%sTURBO\t\t\t\t\t%u Hz, faster as the snake grows",
+                      (option_menu_choise == OPTION_STATUS_TURBO)? "* " : " ",game_settings.m_turbo_tick_rate);
+    else
+        SetScreenLine(menu_screen,8,1,"%sTURBO\t\t\t\t\tOFF",(option_menu_choise == OPTION_STATUS_TURBO)? "* " : " ");
+
+    if( game_settings.m_item_count )
+        SetScreenLine(menu_screen,9,1,"%sITEMS\t\t\t\t\tupto %u, + food > speed - shrink $ double score",
+                      (option_menu_choise == OPTION_STATUS_ITEMS)? "* " : " ",game_settings.m_item_count);
+    else
+        SetScreenLine(menu_screen,9,1,"%sITEMS\t\t\t\t\tOFF",(option_menu_choise == OPTION_STATUS_ITEMS)? "* " : " ");
+
+    SetScreenLine(menu_screen,10,1,"%sBack",(option_menu_choise == OPTION_STATUS_BACK)? "* " : " ");
+
+    SetScreenLine(menu_screen,12,1,"the board size, tick rate and keys are set in " SETTINGS_FILE_NAME
+                                   ", edits to it are used right away.");
+    if( settings_parse_result.m_rejected_count )
+        SetScreenLine(menu_screen,13,1,SETTINGS_FILE_NAME ": %u lines were not understood and left their setting "
+                                       "as it was, the first is line %u.",settings_parse_result.m_rejected_count,
+                      settings_parse_result.m_first_rejected_line);
+
+    SetScreenCursor(menu_screen,11,1);
 
-    std::cout << "options:\n( Press arrow keys and W or S for navigation, press space to "
-              << "change option, press Enter to save changes and Escape to get back at main menu )\n"
-              << ((option_menu_choise == OPTION_STATUS_ALLOW_SNAKE_CUT_ITSELF)? "* " : " ")
-              << "ALLOW_SNAKE_CUT_ITSELF\t\t" << (( snake_can_cut_itself )? "ON" : "OFF") << '\n'
-              << ((option_menu_choise == OPTION_STATUS_ALLOW_SNAKE_PASS_BORDERS)? "* " : " ")
-              << "ALLOW_SNAKE_PASS_BORDERS\t\t" << (( snake_can_pass_border )? "ON" : "OFF") << '\n'
-              << ((option_menu_choise == OPTION_STATUS_BACK)? "* " : " " )
-              << "Back" << std::endl;
+    PresentRetainedScreen(menu_screen);
 }
 
 #define GAME_DIFFICULTY_NOT_DEFINED             0
 #define GAME_DIFFICULTY_EASY                    1
 #define GAME_DIFFICULTY_NORMAL                  2
 #define GAME_DIFFICULTY_HARD                    3
+#define GAME_DIFFICULTY_HUGE                    4
+#define GAME_DIFFICULTY_LEVEL                   5
 
-#define GAME_STATUS_NOT_INITIALIZED             0
-#define GAME_STATUS_CAN_BEGIN                   1
-#define GAME_STATUS_WON                         2
-#define GAME_STATUS_ONGOING                     3
-#define GAME_STATUS_LOST                        4
+// levels found in the levels directory are offered on the difficulty screen with the keys 4 to 9.
+#define MAX_LISTED_LEVELS                       6
 
-#define SNAKE_DIRECTION_NONE                    0
-#define SNAKE_DIRECTION_UP                      1
-#define SNAKE_DIRECTION_LEFT                    2
-#define SNAKE_DIRECTION_DOWN                    3
-#define SNAKE_DIRECTION_RIGHT                   4
+// the huge board fills this many characters of the maximized console, how many cells that is depends on the density.
+#define HUGE_FIELD_COLUMNS                      144
+#define HUGE_FIELD_ROWS                         36
+
+char level_paths[MAX_LISTED_LEVELS][SNAKE_LEVEL_PATH_LENGTH];
+uint32_t level_path_count = 0;
+
+// the level being played, it stays mapped until another one is picked.
+SnakeLevel current_level;
 
 struct GameRecord
 {
@@ -363,11 +569,6 @@ struct GameRecordQueue
 
     GameRecordQueue( const GameRecordQueue& other ) : m_count(other.m_count), head(other.head) {}
 
-    ~GameRecordQueue()
-    {
-        delete head;
-    }
-
     bool operator!() const { return bool(*this) == false; }
 
     operator bool() const { return m_count != 0; }
@@ -380,6 +581,28 @@ struct GameRecordQueue
 GameRecordQueue records;
 bool should_read_from_file = true;
 
+// record nodes live here instead of the heap, the arena is reset whenever records are read back from the file.
+// one extra node for the score being submitted before the list is trimmed back to FILE_RECORDS_LIMIT, the node
+// that gets trimmed off is kept for the next submission.
+GameArena records_arena;
+GameRecordNode* free_record_node = nullptr;
+
+GameRecordNode* NewRecordNode( const char* player_name, uint16_t player_score )
+{
+    if( free_record_node )
+    {
+        GameRecordNode* node = free_record_node;
+        free_record_node = nullptr;
+
+        return new(node) GameRecordNode(player_name,player_score);
+    }
+
+    if( !records_arena.Reserve(ArenaFootprint<GameRecordNode>(FILE_RECORDS_LIMIT + 1)) )
+        return nullptr;
+
+    return records_arena.Construct<GameRecordNode>(player_name,player_score);
+}
+
 void SortRecordsByDescendingOrder()
 {
     // doing it for head seperately.
@@ -412,79 +635,29 @@ void SortRecordsByDescendingOrder()
     }
 }
 
+// reads settings.ini over the settings in use, what isn't in the file or is wrong in it keeps it's value.
 void ReadOptionsFromFile()
 {
-    if( options_read )
-        return;
-
-        options_read = true;
-
-    std::ifstream reader("settings.ini", std::ios::in);
-    if( !reader )
-        return;
-
-    if( can_read_options )
-    {
-        can_read_options = true;
+    if( !ReadSettingsFile(SETTINGS_FILE_NAME,game_settings,settings_parse_result) )
+        std::cerr << "could not read " << SETTINGS_FILE_NAME << ": " << std::strerror(errno) << '\n';
 
-        char buffer[30];
-
-        for( int i = 0; i < 2; ++i )
-        {    
-            //std::memset(buffer,0,30);
-            std::string buffer;
-            reader >> buffer;
-
-            if( reader.fail() || reader.bad() )
-            {
-                std::cerr << "settings.ini is modified or corrupted!";
-                return;
-            }
-
-            if( buffer == "snake_can_pass_border" )
-            {
-                char _operator;
-                reader >> _operator;
-                if( _operator == '=' )
-                    reader >> snake_can_pass_border;
-
-                buffer.clear();
-            }
-
-            else if( buffer == "snake_can_cut_itself" )
-            {
-                char _operator;
-                reader >> _operator;
-                if( _operator == '=' )
-                    reader >> snake_can_cut_itself;
-
-                buffer.clear();
-            }
-        }
-
-        reader.close();
-    }
+    else if( settings_parse_result.m_rejected_count )
+        std::cerr << SETTINGS_FILE_NAME << " is modified or corrupted! line "
+                  << settings_parse_result.m_first_rejected_line << " and "
+                  << settings_parse_result.m_rejected_count - 1 << " more were ignored.\n";
 }
 
 void WriteOptionsToFile()
 {
-    std::ofstream writer("settings.ini", std::ios::out);
-    if( !writer )
+    if( !WriteSettingsFile(SETTINGS_FILE_NAME,game_settings) )
     {
         ClearConsoleScreen();
-        std::cerr << "Error:could not access settings.ini to write settings. press any key to continue.\n";
-        while( ReadKeyStrokeFromSTDIN() == KEY_NONE )
-            SleepIfNotInterrupted(3000);
+        std::cerr << "Error:could not access " << SETTINGS_FILE_NAME
+                  << " to write settings. press any key to continue.\n";
+        WaitForKeyStroke();
 
-        return;
+        InvalidateRetainedScreen(menu_screen);
     }
-
-    writer << "snake_can_cut_itself" << ' ' << '=' << ' ' << snake_can_cut_itself << '\n'
-           << "snake_can_pass_border" << ' ' << '=' << ' ' << snake_can_pass_border << std::flush;
-
-    writer.close();
-
-    can_read_options = false;
 }
 
 void ReadRecordsFromFile()
@@ -492,29 +665,36 @@ void ReadRecordsFromFile()
     if( !should_read_from_file )
         return;
 
-    std::ifstream reader("scores.txt");
+    // no file just means no scores have been submitted yet.
+    std::ifstream reader(SCORES_FILE_NAME);
     if( !reader )
     {
-        std::cerr << "could not access the file for reading!";
+        should_read_from_file = false;
         return;
     }
 
+    records_arena.Reset();
+    free_record_node = nullptr;
+    records.head = nullptr;
+    records.m_count = 0;
+
     GameRecordNode** current_record_node = &records.head;
 
-    char player_name[max_allowed_name_length];
+    char player_name[max_allowed_name_length + 1];
     uint16_t player_score = 0;
-    std::memset(player_name,0,max_allowed_name_length);
+    std::memset(player_name,0,max_allowed_name_length + 1);
     bool once = false;
 
-    while( !reader.eof() )
+    // a line can end with the id of the score's replay, the scoreboard doesn't need it.
+    for( std::string line; std::getline(reader,line); )
     {
-        reader >> player_name;
-        if( reader.fail() || reader.bad() )
+        if( std::sscanf(line.c_str(),"%20s %hu",player_name,&player_score) != 2 )
+            break;
+
+        *current_record_node = NewRecordNode(player_name,player_score);
+        if( !*current_record_node )
             break;
-        
-        reader >> player_score;
 
-        *current_record_node = new GameRecordNode(player_name,player_score);
         ++records.m_count;
 
         if( records.m_count >= FILE_RECORDS_LIMIT )
@@ -529,40 +709,28 @@ void ReadRecordsFromFile()
     should_read_from_file = false;
 }
 
-void WriteRecordsToFile()
-{
-    std::ofstream writer("scores.txt",std::ios::out);
-    if( !writer )
-    {
-        std::cerr << "could not access the file for writing!";
-        return;
-    }
-
-    const GameRecordNode* record_node = records.head;
-
-    while( record_node )
-    {
-        writer << record_node->m_record.m_player_name << ' ' << record_node->m_record.m_player_score;
-        if( record_node->next )
-            writer << '\n'; // we don't want to have a new line at the end of last record, it causes some problems with reading them.
-        record_node = record_node->next;
-    }
-
-    should_read_from_file = true;
-}
-
+// the scoreboard in memory is updated right away, the file and the replay log are updated by the score writer.
+// the records were read at startup, so nothing here touches the disk.
 void SubmitPlayerScore()
 {
     ReadRecordsFromFile();
 
+    // a score without a replay is kept by the game, but "--verify-scores" throws it out.
+    bool has_replay = FinishReplay(game_replay,current_user_name,game_state.m_score);
+    SubmitScore(score_writer,current_user_name,game_state.m_score,has_replay ? &game_replay.m_replay : nullptr);
+
+    GameRecordNode* submitted_record = NewRecordNode(current_user_name,game_state.m_score);
+    if( !submitted_record )
+        return;
+
     if( records )
     {
         bool submitted_node = false;
 
-        if( current_user_score > records.head->m_record.m_player_score )
+        if( game_state.m_score > records.head->m_record.m_player_score )
         {
             GameRecordNode* temp = records.head;
-            records.head = new GameRecordNode(current_user_name,current_user_score);
+            records.head = submitted_record;
             records.head->next = temp;
             submitted_node = true;
             ++records.m_count;
@@ -574,9 +742,9 @@ void SubmitPlayerScore()
 
         while( record_node && !submitted_node )
         {
-            if( current_user_score > record_node->m_record.m_player_score )
+            if( game_state.m_score > record_node->m_record.m_player_score )
             {
-                current = new GameRecordNode(current_user_name,current_user_score);
+                current = submitted_record;
                 prev->next = current;
                 current->next = record_node;
 
@@ -598,177 +766,181 @@ void SubmitPlayerScore()
                 record_node = record_node->next;
             }
 
-            delete record_node; // delete the last record since we have more than 10 records and they are sorted.
+            // drop the last record since we have more than 10 records and they are sorted.
             prev->next = nullptr;
+            free_record_node = record_node;
+            --records.m_count;
         }
 
         else if( !submitted_node && records.m_count < FILE_RECORDS_LIMIT )
-            prev->next = new GameRecordNode(current_user_name,current_user_score);
+        {
+            prev->next = submitted_record;
+            ++records.m_count;
+        }
+
+        else if( !submitted_node )
+            free_record_node = submitted_record;
     }
 
     else
     {
-        records.head = new GameRecordNode(current_user_name,current_user_score);
+        records.head = submitted_record;
         records.m_count++;
     }
-
-    WriteRecordsToFile();
 }
 
 void DrawScoreBoard()
 {
     ReadRecordsFromFile();
+    BeginRetainedScreen(menu_screen,APPLICATION_STATE_SCOREBOARD);
+    uint16_t row = 1;
+
     if( !records )
-        std::cout << "no scores have been submitted yet!" << std::endl;
+        SetScreenLine(menu_screen,row++,1,"no scores have been submitted yet!");
 
     else
     {
         GameRecordNode* record_node = records.head;
         while( record_node )
         {
-            std::cout << record_node->m_record.m_player_name << '\t' << record_node->m_record.m_player_score << std::endl;
+            SetScreenLine(menu_screen,row++,1,"%s\t%u",record_node->m_record.m_player_name,
+                          unsigned(record_node->m_record.m_player_score));
             record_node = record_node->next;
         }
     }
 
-    std::cout << "Press Escape to return." << std::endl;
+#ifdef DEBUG_MODE
+    SetScreenLine(menu_screen,row++,1,"score writer: %u queued ( atmost %u ), %llu written in %llu batches, last "
+                  "write %lldus, slowest %lldus, %llu dropped, %llu failed, %llu replays failed",
+                  GetScoreQueueDepth(score_writer),score_writer.m_max_queue_depth.load(),
+                  (unsigned long long)score_writer.m_written_count,(unsigned long long)score_writer.m_batch_count,
+                  (long long)score_writer.m_last_write_microseconds,(long long)score_writer.m_max_write_microseconds,
+                  (unsigned long long)score_writer.m_dropped_count,
+                  (unsigned long long)score_writer.m_failed_batch_count,
+                  (unsigned long long)score_writer.m_failed_replay_count);
+    SetScreenLine(menu_screen,row++,1,"analytics log: %llu games written, %u buffered, %llu failed writes",
+                  (unsigned long long)analytics_log.m_written_count,unsigned(analytics_log.m_buffered_count),
+                  (unsigned long long)analytics_log.m_failed_write_count);
+    SetScreenLine(menu_screen,row++,1,"menu screen: %llu presents, %llu wrote %llu lines in %llu bytes",
+                  (unsigned long long)menu_screen.m_present_count,(unsigned long long)menu_screen.m_written_count,
+                  (unsigned long long)menu_screen.m_written_lines,(unsigned long long)menu_screen.m_written_bytes);
+#endif
+
+    SetScreenLine(menu_screen,row++,1,"Press Escape to return.");
+
+    PresentRetainedScreen(menu_screen);
 }
 
-struct SnakeBody
-{
-    SnakeBody() : m_pos_x(0), m_pos_y(0), m_direction(SNAKE_DIRECTION_NONE) {}
-    SnakeBody( uint8_t pos_x, uint8_t pos_y, uint8_t direction ) : m_pos_x(pos_x), m_pos_y(pos_y),
-                                                                   m_direction(direction) {}
-
-    SnakeBody( const SnakeBody& other )
-    {
-        *this = other;
-    }
-
-    SnakeBody& operator=( const SnakeBody& other )
-    {
-        if( this == &other )
-            return *this;
-
-        m_pos_x = other.m_pos_x;
-        m_pos_y = other.m_pos_y;
-        m_direction = other.m_direction;
-
-        return *this;
-    }
-
-    uint16_t m_pos_x;
-    uint16_t m_pos_y;
-    uint16_t m_direction;
-};
-
-struct SnakePart
-{
-    SnakePart()
-    {
-        next = nullptr;
-    }
-
-    SnakePart( const SnakeBody& part )
-    {
-        m_body = part;
-        next = nullptr;
-    }
-
-    SnakeBody m_body;
-    SnakePart* next;
-};
-
-struct Snake
-{
-    Snake() : m_head(nullptr), m_length(0) {}
-
-    SnakePart* m_head;
-    uint8_t m_length;
-};
-
 std::time_t current_user_time = 0;
-std::clock_t begin_time = 0;
-std::uint8_t game_size_x;
-std::uint8_t game_size_y;
+// when ticks are due, they are timed on the wall clock since std::clock() counts the cpu time of every thread,
+// the render thread's included.
+TickScheduler game_ticks;
+
+// no more frames than this are handed to the render thread, in turbo mode there can be many ticks per frame.
+#define GAME_MAX_FRAME_RATE                     60
+std::chrono::steady_clock::time_point last_frame_time;
+std::uint16_t game_size_x;
+std::uint16_t game_size_y;
 std::int8_t snake_direction_to_move = SNAKE_DIRECTION_NONE;
-std::uint8_t food_x;
-std::uint8_t food_y;
-std::int8_t game_status;
 float game_speed;
 char game_difficulty_string[7];
 
-Snake* snake = nullptr;
+// everything that belongs to a single game ( the field and the snake's body ) is carved out of this arena.
+// it is reset when a game is initialized, so restarting a game doesn't go to the heap unless the board grew.
+GameArena game_arena;
+uint64_t heap_allocations_on_last_restart = 0;
 
-char* snake_field = nullptr;
+// the items of the game when item_count is set, they have their own arena since a resumed game fills game_arena
+// by itself.
+GameArena item_arena;
+ItemField snake_items;
 
-struct ElapsedTime
-{
-    ElapsedTime( time_t from_time_point )
-    {
-        time_t time_elapsed = time(NULL) - from_time_point;
+#define SNAPSHOT_FILE_NAME "savegame.bin"
 
-        if( time_elapsed >= 3600 )
-        {
-            hours = time_elapsed / 3600;
-            minutes = time_elapsed - hours * 3600;
-            seconds = time_elapsed - ( hours * 3600 + minutes * 60 );
-        }
+// how long the last snapshot took to be written or loaded, only shown in debug mode.
+std::size_t last_snapshot_size = 0;
+int64_t last_snapshot_microseconds = 0;
 
-        else if( time_elapsed >= 60 && time_elapsed < 3600 )
-        {
-            hours = 0;
-            minutes = time_elapsed / 60;
-            seconds = time_elapsed - minutes * 60;
-        }
+// when the autopilot is on, the snake is steered by a lookahead search instead of the keyboard.
+bool autopilot_enabled = false;
+SnakeSearchContext autopilot_search;
 
-        else
-        {
-            hours = minutes = 0;
-            seconds = time_elapsed;
-        }
-    }
+// for the analytics record written when the game is over, see RecordFinishedGame().
+std::chrono::steady_clock::time_point game_start_time;
+uint8_t game_analytics_flags = 0;
 
-    int seconds = 0;
-    int minutes = 0;
-    int hours = 0;
-};
+#ifdef DEBUG_MODE
+SnakeReachability debug_reachability;
+#endif
 
+// copies what the screen shows into a frame for the render thread, so drawing it never delays the next tick.
 void DisplayGameOnScreen()
 {
-    ClearConsoleScreen();
-
-    ElapsedTime elapsed_time(current_user_time);
-
-    SetConsoleCursorPosition(17,1);
-    std::cout << "difficulty:" << game_difficulty_string;
-    SetConsoleCursorPosition(52,1);
-    std::cout << "game_score:" << current_user_score;
-    SetConsoleCursorPosition(92,1);
-    std::cout << "player:" << current_user_name;
-    SetConsoleCursorPosition(127,1);
-    std::cout << "time:";
-
-    if( elapsed_time.hours )
-    {
-        std::cout << elapsed_time.hours << "h "; 
-        if( elapsed_time.minutes )
-            std::cout << elapsed_time.minutes << "m ";
-    }
+    GameFrame& frame = GetRenderBackFrame(render_thread);
+    if( !CaptureGameFrame(frame,game_state) )
+        return;
 
-    else if( elapsed_time.minutes )
-        std::cout << elapsed_time.minutes << "m " ;
+    frame.m_start_time = current_user_time;
+    std::memcpy(frame.m_difficulty,game_difficulty_string,sizeof(game_difficulty_string));
+    std::memcpy(frame.m_player_name,current_user_name,max_allowed_name_length);
+    frame.m_autopilot = autopilot_enabled;
+    frame.m_autopilot_depth = autopilot_search.m_depth;
+    frame.m_autopilot_node_count = autopilot_search.m_last_node_count;
+    frame.m_color_mode = game_settings.m_color_mode;
+    frame.m_theme = game_settings.m_theme;
+    frame.m_density = game_settings.m_density;
+    frame.m_status_text[0] = '\0';
+
+    if( settings_wait_for_next_game )
+        std::snprintf(frame.m_status_text,sizeof(frame.m_status_text),"%s changed, the new rules and board size are "
+                      "used from the next game.",SETTINGS_FILE_NAME);
+
+    // the stress display, how close turbo mode gets to the rate it's asked for.
+    else if( snake_items.m_capacity && !game_settings.m_turbo_tick_rate )
+        std::snprintf(frame.m_status_text,sizeof(frame.m_status_text),"items:%u%s%s",snake_items.m_count,
+                      IsItemEffectActive(snake_items,ITEM_KIND_SPEED,game_state.m_tick) ? "  > speed" : "",
+                      IsItemEffectActive(snake_items,ITEM_KIND_MULTIPLIER,game_state.m_tick) ? "  $ double score" :
+                                                                                               "");
+
+    else if( game_settings.m_turbo_tick_rate )
+        std::snprintf(frame.m_status_text,sizeof(frame.m_status_text),
+                      "turbo:%u Hz wanted, %.1f Hz achieved, tick %lldus ( slowest %lldus, budget %lldus ), "
+                      "%llu over budget, %llu late",
+                      ComputeTurboTickRate(game_settings.m_turbo_tick_rate,game_state.m_length),
+                      game_ticks.m_achieved_rate,(long long)game_ticks.m_last_tick_microseconds,
+                      (long long)game_ticks.m_max_tick_microseconds,
+                      (long long)std::chrono::duration_cast<std::chrono::microseconds>(
+                          game_ticks.m_period / TICK_BUDGET_DIVISOR).count(),
+                      (unsigned long long)game_ticks.m_over_budget_count,
+                      (unsigned long long)game_ticks.m_late_tick_count);
+
+#ifdef DEBUG_MODE
+    bool is_doomed = IsSnakeGameDoomed(debug_reachability,game_state);
+    std::snprintf(frame.m_debug_text,sizeof(frame.m_debug_text),
+                  "arena:%zu/%zu bytes %llu allocations %llu heap blocks, heap calls on last restart:%llu "
+                  "snapshot:%zu bytes in %lldus, reachable:%u cells%s",game_arena.m_used,game_arena.m_capacity,
+                  (unsigned long long)game_arena.m_allocation_count,(unsigned long long)game_arena.m_heap_block_count,
+                  (unsigned long long)heap_allocations_on_last_restart,last_snapshot_size,
+                  (long long)last_snapshot_microseconds,debug_reachability.m_reachable_cell_count,
+                  is_doomed ? " ( doomed )" : "");
+#endif
+
+    PublishRenderFrame(render_thread);
+}
 
-    std::cout << elapsed_time.seconds << 's' << std::endl;
+// a generated level gets the board size of settings.ini, or the size of the huge board where it doesn't set one.
+bool GenerateLevel( uint8_t kind )
+{
+    uint8_t cells_x, cells_y;
+    GetRenderDensityCellSize(game_settings.m_density,cells_x,cells_y);
 
-    for( int i = 0; i < game_size_x; ++i )
-    {
-        SetConsoleCursorPosition(73 - ( (game_size_x - 10) / 2 ),i + 3);
-        for( int j = 0; j < game_size_y; ++j )
-            std::cout << snake_field[ j * game_size_x + i ];
+    uint32_t size_x = game_settings.m_board_columns > 3 ? game_settings.m_board_columns : HUGE_FIELD_COLUMNS * cells_x;
+    uint32_t size_y = game_settings.m_board_rows > 3 ? game_settings.m_board_rows : HUGE_FIELD_ROWS * cells_y;
+    size_x = std::min<uint32_t>(size_x,SNAKE_GAME_MAX_SIZE);
+    size_y = std::min<uint32_t>(size_y,SNAKE_GAME_MAX_SIZE);
 
-        std::cout << std::flush;
-    }
+    GameArena arena;
+    return GenerateSnakeLevel(current_level,arena,kind,uint16_t(size_x),uint16_t(size_y),uint64_t(time(NULL)),0);
 }
 
 void HandleGameDifficulty()
@@ -798,34 +970,39 @@ void HandleGameDifficulty()
         game_speed = 0.6f;
         std::memcpy(game_difficulty_string,"Hard",4);
     }
-}
 
-void GrowSnake()
-{
-    if( snake )
+    // only playable with the packed densities, in normal density it's just a very wide board.
+    else if( game_difficulty == GAME_DIFFICULTY_HUGE )
     {
-        SnakePart* ite = snake->m_head;
-        while( ite->next )
-            ite = ite->next;
+        uint8_t cells_x, cells_y;
+        GetRenderDensityCellSize(game_settings.m_density,cells_x,cells_y);
 
-        ite->next = new SnakePart();
-        snake->m_length++;
+        game_size_x = HUGE_FIELD_COLUMNS * cells_x;
+        game_size_y = HUGE_FIELD_ROWS * cells_y;
+        game_speed = 0.4f;
+        std::memcpy(game_difficulty_string,"Huge",4);
     }
-}
 
-void GenerateFood()
-{
-    do
+    // a game resumed from a save knows it was on a level, but not which one. it keeps the walls of the save,
+    // and a new game after it is played on an empty board of the same size.
+    else if( game_difficulty == GAME_DIFFICULTY_LEVEL )
     {
-        food_x = 1 + rand() % ( game_size_x - 1 );
-        food_y = 1 + rand() % ( game_size_y - 1 );
-     // so that food doesn't spawn on snake body or head or corners.
-    } while( 
-             (food_x == snake->m_head->m_body.m_pos_x && food_y == snake->m_head->m_body.m_pos_y) ||
-             snake_field[ food_x + game_size_y * food_y ] == '#'
-           );
-
-    snake_field[ food_x + game_size_y * food_y ] = '@';
+        game_size_x = current_level.m_walls ? current_level.m_size_x : game_size_x;
+        game_size_y = current_level.m_walls ? current_level.m_size_y : game_size_y;
+        game_speed = 0.6f;
+        std::memcpy(game_difficulty_string,"Level",5);
+    }
+
+    // a board size from settings.ini replaces the one of the difficulty, one too small to hold a snake is ignored.
+    // levels always keep their own size.
+    if( game_difficulty != GAME_DIFFICULTY_LEVEL )
+    {
+        if( game_settings.m_board_columns > 3 )
+            game_size_x = game_settings.m_board_columns;
+
+        if( game_settings.m_board_rows > 3 )
+            game_size_y = game_settings.m_board_rows;
+    }
 }
 
 bool InitializeSnakeGame()
@@ -837,213 +1014,414 @@ bool InitializeSnakeGame()
         return false;
     }
 
-    std::srand(time(NULL));
-
-    if( snake )
-        delete snake;
-
-    snake = new Snake();
-
-    snake->m_head = new SnakePart();
-
-    if( snake_field )
-        delete snake_field;
-
-    snake_field = new char[game_size_x * game_size_y];
-    if( !snake_field )
+    game_arena.Reset();
+    if( !game_arena.Reserve(ComputeSnakeGameMemorySize(game_size_x,game_size_y)) )
     {
         std::cerr << "could not allocate enough space for game! quiting." << std::endl;
         HandleApplicationTermination();
+        return false;
     }
 
-    for( int i = 0; i < game_size_x; ++i )
-    {
-        for( int j = 0; j < game_size_y; ++j )
-        {
-            if( i == 0 || i == game_size_x - 1 )
-                snake_field[ i * game_size_x + j ] = '#';
-                
-            else
-            {
-                if( ( j == 0 ) || ( j == game_size_y - 1 ) )
-                    snake_field[ i * game_size_x + j ] = '#';
-            }
-        }
-    }
+    uint8_t rules = ( game_settings.m_snake_can_pass_border ? SNAKE_RULE_PASS_BORDERS : 0 ) |
+                    ( game_settings.m_snake_can_cut_itself ? SNAKE_RULE_CUT_ITSELF : 0 );
 
-    game_status = GAME_STATUS_CAN_BEGIN;
+    if( !InitializeSnakeGameState(game_state,game_arena,game_size_x,game_size_y,time(NULL),rules) )
+        return false;
+
+    if( game_difficulty == GAME_DIFFICULTY_LEVEL )
+        ApplySnakeLevel(game_state,current_level);
 
     return true;
 }
 
-void StartSnakeGame()
+void RecordFinishedGame()
 {
-    current_user_score = 0;
-    current_user_time = time(NULL);
-    begin_time = std::clock();
+    GameAnalyticsRecord record;
+    record.m_end_time = uint64_t(time(NULL));
+    record.m_duration_milliseconds = uint32_t(std::chrono::duration_cast<std::chrono::milliseconds>(
+                                                  std::chrono::steady_clock::now() - game_start_time).count());
+    record.m_ticks = uint32_t(game_state.m_tick);
+    record.m_score = game_state.m_score;
+    record.m_length = game_state.m_length;
+    record.m_size_x = game_state.m_size_x;
+    record.m_size_y = game_state.m_size_y;
+    record.m_difficulty = game_difficulty;
+    record.m_rules = game_state.m_rules;
+    record.m_end_cause = GetSnakeGameEndCause(game_state);
+    record.m_flags = game_analytics_flags;
+    std::memcpy(record.m_player_name,current_user_name,max_allowed_name_length);
+
+    AppendAnalyticsRecord(analytics_log,record);
+}
 
-    // clear game inner field.
-    for( int i = 1; i < game_size_x - 1; ++i )
-    {
-        for( int j = 1; j < game_size_y - 1; ++j )
-            snake_field[ i + j * game_size_y ] = ' ';
-    }
+// in turbo mode it depends on the length of the snake and with items on a speed item, so it's asked for again
+// after every tick.
+std::chrono::nanoseconds GetGameTickPeriod()
+{
+    std::chrono::nanoseconds period;
 
-    int16_t snake_pos_x, snake_pos_y;
-    do
-    {
-        snake_pos_x = 2 + std::rand() % ( game_size_x - 2 );
-        snake_pos_y = 2 + std::rand() % ( game_size_y - 2 );
-    } while (snake_field[snake_pos_x + snake_pos_y * game_size_y] == '#'); // so that snake doesn't spawn at borders.
+    if( game_settings.m_turbo_tick_rate )
+        period = GetTickRatePeriod(ComputeTurboTickRate(game_settings.m_turbo_tick_rate,game_state.m_length));
 
-    int16_t snake_direction_need_to_be_avoided_1 = SNAKE_DIRECTION_NONE;
-    int16_t snake_direction_need_to_be_avoided_2 = SNAKE_DIRECTION_NONE;
+    else if( game_settings.m_tick_rate )
+        period = GetTickRatePeriod(game_settings.m_tick_rate);
 
-    if( snake_pos_x == 1 && snake_pos_y == 1 )
-    {
-        snake_direction_need_to_be_avoided_1 = SNAKE_DIRECTION_UP;
-        snake_direction_need_to_be_avoided_2 = SNAKE_DIRECTION_LEFT;
-    }
+    else
+        period = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::duration<float>(0.8f * game_speed));
 
-    else if( snake_pos_x == game_size_x - 1 && snake_pos_y == 1 )
-    {
-        snake_direction_need_to_be_avoided_1 = SNAKE_DIRECTION_UP;
-        snake_direction_need_to_be_avoided_2 = SNAKE_DIRECTION_RIGHT;
-    }
+    if( IsItemEffectActive(snake_items,ITEM_KIND_SPEED,game_state.m_tick) )
+        period /= ITEM_SPEED_FACTOR;
 
-    else if( snake_pos_x == 1 && snake_pos_y == game_size_y - 1 )
-    {
-        snake_direction_need_to_be_avoided_1 = SNAKE_DIRECTION_DOWN;
-        snake_direction_need_to_be_avoided_2 = SNAKE_DIRECTION_LEFT;
-    }
+    return period;
+}
 
-    else if( snake_pos_x == game_size_x - 1 && snake_pos_y == game_size_y - 1 )
-    {
-        snake_direction_need_to_be_avoided_1 = SNAKE_DIRECTION_DOWN;
-        snake_direction_need_to_be_avoided_2 = SNAKE_DIRECTION_RIGHT;
-    }
+// the autopilot's search is the only part of a tick that can go over the budget, in turbo mode it looks less far
+// ahead while it does and further again when there's room.
+void AdaptAutopilotDepth()
+{
+    int64_t budget = std::chrono::duration_cast<std::chrono::microseconds>(
+                         game_ticks.m_period / TICK_BUDGET_DIVISOR).count();
 
-    else if( snake_field[snake_pos_x + 1] == '#' )
-    {
-        snake_direction_need_to_be_avoided_1 = SNAKE_DIRECTION_RIGHT;
-        snake_direction_need_to_be_avoided_2 = SNAKE_DIRECTION_NONE;
-    }
+    if( game_ticks.m_last_tick_microseconds > budget && autopilot_search.m_depth > 1 )
+        --autopilot_search.m_depth;
+
+    else if( game_ticks.m_last_tick_microseconds < budget / 4 && autopilot_search.m_depth < SNAKE_SEARCH_DEFAULT_DEPTH )
+        ++autopilot_search.m_depth;
+}
+
+// fills the board of a started or resumed game with items, a resumed game gets new ones since they aren't saved.
+void StartSnakeItems()
+{
+    uint32_t capacity = ComputeItemCapacity(game_state,game_settings.m_item_count);
 
-    else if( snake_field[snake_pos_x - 1] == '#' )
+    if( !InitializeItemField(snake_items,item_arena,game_state,capacity) )
     {
-        snake_direction_need_to_be_avoided_1 = SNAKE_DIRECTION_LEFT;
-        snake_direction_need_to_be_avoided_2 = SNAKE_DIRECTION_NONE;
+        std::cerr << "could not allocate the items, the game is played without them." << std::endl;
+        InitializeItemField(snake_items,item_arena,game_state,0);
+        InvalidateRetainedScreen(menu_screen);
     }
+}
+
+void StartSnakeGame()
+{
+    current_user_time = time(NULL);
+    game_start_time = std::chrono::steady_clock::now();
+    game_analytics_flags = autopilot_enabled ? ANALYTICS_FLAG_AUTOPILOT : 0;
+    snake_direction_to_move = SNAKE_DIRECTION_NONE;
 
-    else if( snake_field[snake_pos_y + 1] == '#' )
+    uint64_t random_state = game_state.m_random_state;
+    StartSnakeGameState(game_state);
+    StartSnakeItems();
+
+    // the walls of a level aren't in the replay, so a level game can't be played again from it.
+    if( game_difficulty == GAME_DIFFICULTY_LEVEL )
+        CancelReplay(game_replay);
+    else
+        BeginReplay(game_replay,game_state,random_state,snake_items.m_capacity);
+
+    ResetTickScheduler(game_ticks,GetGameTickPeriod());
+    autopilot_search.m_depth = SNAKE_SEARCH_DEFAULT_DEPTH;
+    settings_wait_for_next_game = false;
+}
+
+void HandleSnakeGameLogic()
+{
+    if( autopilot_enabled )
+        snake_direction_to_move = SearchSnakeMove(autopilot_search,game_state);
+
+    int32_t score = game_state.m_score;
+    StepSnakeGame(game_state,snake_direction_to_move);
+    UpdateItemField(snake_items,game_state,score);
+    RecordReplayTick(game_replay,game_state.m_direction);
+    uint8_t status = game_state.m_status;
+
+    if( game_settings.m_turbo_tick_rate || snake_items.m_capacity )
+        SetTickPeriod(game_ticks,GetGameTickPeriod());
+
+    if( status == GAME_STATUS_WON || status == GAME_STATUS_LOST )
     {
-        snake_direction_need_to_be_avoided_1 = SNAKE_DIRECTION_DOWN;
-        snake_direction_need_to_be_avoided_2 = SNAKE_DIRECTION_NONE;
+        SubmitPlayerScore();
+        RecordFinishedGame();
     }
+}
 
-    else if( snake_field[snake_pos_y - 1] == '#' )
+// reads settings.ini again when it changed since the last call, between ticks and from the menus.
+void ApplySettingsFileChanges()
+{
+    if( !HasSettingsFileChanged(settings_watch) )
+        return;
+
+    GameSettings previous_settings = game_settings;
+    if( !ReadSettingsFile(SETTINGS_FILE_NAME,game_settings,settings_parse_result) )
+        return;
+
+    if( application_status != APPLICATION_STATE_SNAKE_GAME || game_state.m_status != GAME_STATUS_ONGOING )
+        return;
+
+    if( SettingsDiffer(previous_settings,game_settings,SETTING_APPLY_NEXT_GAME) )
+        settings_wait_for_next_game = true;
+
+    if( SettingsDiffer(previous_settings,game_settings,SETTING_APPLY_NOW) )
+        SetTickPeriod(game_ticks,GetGameTickPeriod());
+}
+
+// pauses the game to disk, it can be picked up later from the main menu.
+bool SuspendSnakeGame()
+{
+    SnakeGameSnapshotInfo info;
+    info.m_difficulty = game_difficulty;
+    info.m_elapsed_seconds = uint32_t(time(NULL) - current_user_time);
+    std::memcpy(info.m_player_name,current_user_name,max_allowed_name_length);
+
+    auto start = std::chrono::steady_clock::now();
+    bool saved = SaveSnakeGameSnapshot(SNAPSHOT_FILE_NAME,game_state,info);
+    last_snapshot_microseconds = std::chrono::duration_cast<std::chrono::microseconds>(
+                                     std::chrono::steady_clock::now() - start).count();
+    last_snapshot_size = ComputeSnakeGameSnapshotSize(game_state);
+
+    return saved;
+}
+
+bool ResumeSnakeGame()
+{
+    SnakeGameSnapshotInfo info;
+
+    auto start = std::chrono::steady_clock::now();
+    bool loaded = LoadSnakeGameSnapshot(SNAPSHOT_FILE_NAME,game_state,game_arena,info);
+    last_snapshot_microseconds = std::chrono::duration_cast<std::chrono::microseconds>(
+                                     std::chrono::steady_clock::now() - start).count();
+
+    if( !loaded )
     {
-        snake_direction_need_to_be_avoided_1 = SNAKE_DIRECTION_UP;
-        snake_direction_need_to_be_avoided_2 = SNAKE_DIRECTION_NONE;
+        game_state = SnakeGameState();
+        return false;
     }
 
-    uint16_t snake_direction = SNAKE_DIRECTION_NONE;
+    last_snapshot_size = ComputeSnakeGameSnapshotSize(game_state);
+
+    game_difficulty = info.m_difficulty;
+    if( game_difficulty < GAME_DIFFICULTY_EASY || game_difficulty > GAME_DIFFICULTY_LEVEL )
+        game_difficulty = GAME_DIFFICULTY_NORMAL;
 
-    while( snake_direction == snake_direction_need_to_be_avoided_1 ||
-           snake_direction == snake_direction_need_to_be_avoided_2 )
-        snake_direction = 1 + rand() % 4;
+    HandleGameDifficulty();
+    game_size_x = game_state.m_size_x;
+    game_size_y = game_state.m_size_y;
 
-    snake->m_length = 1;
-    snake->m_head->m_body.m_pos_x = snake_pos_x;
-    snake->m_head->m_body.m_pos_y = snake_pos_y;
-    snake->m_head->m_body.m_direction = snake_direction;
+    ClearUserName();
+    std::memcpy(current_user_name,info.m_player_name,max_allowed_name_length);
+    word_entered_count = uint8_t(std::strlen(current_user_name));
 
-    GenerateFood();
+    current_user_time = time(NULL) - info.m_elapsed_seconds;
+    game_start_time = std::chrono::steady_clock::now() - std::chrono::seconds(info.m_elapsed_seconds);
+    game_analytics_flags = ANALYTICS_FLAG_RESUMED | ( autopilot_enabled ? ANALYTICS_FLAG_AUTOPILOT : 0 );
+    snake_direction_to_move = SNAKE_DIRECTION_NONE;
+    StartSnakeItems();
+    CancelReplay(game_replay);
+    ResetTickScheduler(game_ticks,GetGameTickPeriod());
+    settings_wait_for_next_game = false;
 
-    game_status = GAME_STATUS_ONGOING;
+    return true;
 }
 
-void HandleSnakeGameLogic()
+// two terminals playing against each other: "snake host [port] [difficulty 0-2] [input delay]" waits for the
+// other player, "snake join <address> [port]" connects to it. the host's difficulty and rules are used.
+bool IsMultiplayerCommand( int argc, char** argv )
 {
-    bool lost = false, win = false;
-    uint16_t& snake_pos_x = snake->m_head->m_body.m_pos_x;
-    uint16_t& snake_pos_y = snake->m_head->m_body.m_pos_y;
-    uint16_t& snake_direction = snake->m_head->m_body.m_direction;
+    return argc > 1 && ( std::strcmp(argv[1],"host") == 0 || std::strcmp(argv[1],"join") == 0 );
+}
 
-    if( snake_direction_to_move != SNAKE_DIRECTION_NONE )
-    {
-        if( snake_direction == SNAKE_DIRECTION_UP && snake_direction_to_move != SNAKE_DIRECTION_DOWN )
-            snake_direction = snake_direction_to_move;
+void WaitForAnyKey()
+{
+    WaitForKeyStroke();
+}
 
-        else if( snake_direction == SNAKE_DIRECTION_DOWN && snake_direction_to_move != SNAKE_DIRECTION_UP )
-            snake_direction = snake_direction_to_move;
+void DisplayMultiplayerGame( const LockstepSession& session )
+{
+    ClearConsoleScreen();
 
-        else if( snake_direction == SNAKE_DIRECTION_LEFT && snake_direction_to_move != SNAKE_DIRECTION_RIGHT )
-            snake_direction = snake_direction_to_move;
+    uint16_t field_columns, field_rows;
+    GetRenderedFieldSize(field_renderer,session.m_games[0],field_columns,field_rows);
 
-        else if( snake_direction == SNAKE_DIRECTION_RIGHT && snake_direction_to_move != SNAKE_DIRECTION_LEFT )
-            snake_direction = snake_direction_to_move;
+    for( uint8_t player = 0; player < 2; ++player )
+    {
+        const SnakeGameState& state = session.m_games[player];
+        uint16_t origin_x = 2 + player * ( field_columns + 6 );
+
+        SetConsoleCursorPosition(origin_x,1);
+        std::cout << session.m_settings.m_player_names[player] << ( player == session.m_local_player ? "(you)" : "" )
+                  << " score:" << state.m_score
+                  << ( state.m_status == GAME_STATUS_LOST ? " LOST" : state.m_status == GAME_STATUS_WON ? " WON" : "" )
+                  << std::flush;
+
+        RenderSnakeField(field_renderer,state,origin_x,3);
     }
 
-    snake_field[ snake_pos_x + snake_pos_y * game_size_y ] = ' ';
+    // everything that went over the network, a tick costs one message each way.
+    SetConsoleCursorPosition(2,field_rows + 4);
+    std::cout << "tick:" << session.m_tick << " input delay:" << int(session.m_settings.m_input_delay)
+              << " ticks, sent:" << session.m_bytes_sent << " received:" << session.m_bytes_received
+              << " bytes, stalls:" << session.m_stall_count << " ( Escape to leave )" << std::flush;
+}
+
+int RunMultiplayerGame( int argc, char** argv )
+{
+    LockstepSession session;
+    bool is_host = std::strcmp(argv[1],"host") == 0;
+
+    const char* user_name = std::getenv("USER");
+    char player_name[LOCKSTEP_PLAYER_NAME_LENGTH + 1] = {};
+    std::strncpy(player_name,user_name ? user_name : "player",LOCKSTEP_PLAYER_NAME_LENGTH);
 
-    switch( snake_direction )
+    ClearConsoleScreen();
+
+    if( is_host )
     {
-        case SNAKE_DIRECTION_UP:
-            --snake_pos_y;
-        break;
+        long port = argc > 2 ? std::strtol(argv[2],nullptr,10) : LOCKSTEP_DEFAULT_PORT;
+        long difficulty = argc > 3 ? std::strtol(argv[3],nullptr,10) : 1;
+        long input_delay = argc > 4 ? std::strtol(argv[4],nullptr,10) : 3;
 
-        case SNAKE_DIRECTION_LEFT:
-            --snake_pos_x;
-        break;
+        // two huge boards don't fit next to each other.
+        if( port <= 0 || port > 65535 || difficulty < 0 || difficulty > 2 || input_delay < 0 ||
+            input_delay > LOCKSTEP_MAX_INPUT_DELAY )
+        {
+            std::cerr << "usage: host [port] [difficulty 0-2] [input delay 0-" << LOCKSTEP_MAX_INPUT_DELAY
+                      << "]. press any key to quit.\n";
+            WaitForAnyKey();
+            return EXIT_FAILURE;
+        }
 
-        case SNAKE_DIRECTION_DOWN:
-            ++snake_pos_y;
-        break;
+        game_difficulty = uint8_t(GAME_DIFFICULTY_EASY + difficulty);
+        HandleGameDifficulty();
 
-        case SNAKE_DIRECTION_RIGHT:
-            ++snake_pos_x;
-        break;
-    }
+        LockstepSettings settings;
+        settings.m_seed = uint64_t(time(NULL)) ^ uint64_t(std::chrono::steady_clock::now().time_since_epoch().count());
+        settings.m_size_x = game_size_x;
+        settings.m_size_y = game_size_y;
+        settings.m_rules = ( game_settings.m_snake_can_pass_border ? SNAKE_RULE_PASS_BORDERS : 0 ) |
+                           ( game_settings.m_snake_can_cut_itself ? SNAKE_RULE_CUT_ITSELF : 0 );
+        settings.m_input_delay = uint8_t(input_delay);
+        settings.m_tick_milliseconds = uint16_t(800 * game_speed);
+        std::memcpy(settings.m_player_names[0],player_name,LOCKSTEP_PLAYER_NAME_LENGTH);
 
-    if( snake_field[ snake_pos_x + snake_pos_y * game_size_y ] == '@' )
-    {
-        snake_field[ snake_pos_x + snake_pos_y * game_size_y ] = 'x';
-        current_user_score += 10;
-        if( snake->m_length == game_size_x * game_size_y )
-            win = true;
-        
-        else
+        if( !HostLockstepSession(session,uint16_t(port),settings) )
         {
-            GrowSnake();
-            GenerateFood();
+            std::cerr << "could not listen on port " << port << ": " << std::strerror(errno)
+                      << ". press any key to quit.\n";
+            WaitForAnyKey();
+            return EXIT_FAILURE;
         }
 
-        if( win )
+        std::cout << "waiting for the other player on port " << port << ", Escape to cancel." << std::flush;
+
+        while( !AcceptLockstepPlayer(session) )
         {
-            SubmitPlayerScore();
-            game_status = GAME_STATUS_WON;
+            if( ReadKeyStrokeFromSTDIN() == KEY_ESCAPE || !app_is_running )
+                return EXIT_SUCCESS;
+
+            SleepIfNotInterrupted(20000);
         }
     }
 
     else
     {
-        if( snake_field[ snake_pos_x + snake_pos_y * game_size_y ] == '#' ||
-            snake_field[ snake_pos_x + snake_pos_y * game_size_y ] == 'o' )
-            lost = true;
+        const char* address = argc > 2 ? argv[2] : "localhost";
+        long port = argc > 3 ? std::strtol(argv[3],nullptr,10) : LOCKSTEP_DEFAULT_PORT;
+
+        std::cout << "connecting to " << address << ':' << port << "..." << std::flush;
+
+        if( port <= 0 || port > 65535 || !JoinLockstepSession(session,address,uint16_t(port),player_name) )
+        {
+            std::cerr << "\ncould not join a game at " << address << ':' << port << ". press any key to quit.\n";
+            WaitForAnyKey();
+            return EXIT_FAILURE;
+        }
+    }
 
-        if( lost )
+    auto tick_length = std::chrono::milliseconds(session.m_settings.m_tick_milliseconds);
+    auto next_tick_time = std::chrono::steady_clock::now() + tick_length;
+    uint8_t direction_to_send = SNAKE_DIRECTION_NONE;
+    bool has_left = false;
+
+    DisplayMultiplayerGame(session);
+
+    while( app_is_running && PollLockstepSession(session) && !IsLockstepSessionOver(session) )
+    {
+        switch( GetGameAction(ReadKeyStrokeFromSTDIN()) )
         {
-            SubmitPlayerScore();
-            game_status = GAME_STATUS_LOST;
-            return;
+            case GAME_ACTION_UP:
+                direction_to_send = SNAKE_DIRECTION_UP;
+            break;
+
+            case GAME_ACTION_LEFT:
+                direction_to_send = SNAKE_DIRECTION_LEFT;
+            break;
+
+            case GAME_ACTION_DOWN:
+                direction_to_send = SNAKE_DIRECTION_DOWN;
+            break;
+
+            case GAME_ACTION_RIGHT:
+                direction_to_send = SNAKE_DIRECTION_RIGHT;
+            break;
+
+            case GAME_ACTION_QUIT:
+                has_left = true;
+            break;
         }
 
-        else
+        if( has_left )
+            break;
+
+        auto now = std::chrono::steady_clock::now();
+        if( now >= next_tick_time )
         {
-            snake_field[ snake_pos_x + snake_pos_y * game_size_y ] = 'x';
+            // the key pressed during this tick goes out once, for the tick input delay ticks from now.
+            uint64_t input_tick = session.m_next_input_tick;
+            if( !SendLockstepInput(session,direction_to_send) )
+                break;
+
+            if( session.m_next_input_tick != input_tick )
+                direction_to_send = SNAKE_DIRECTION_NONE;
+
+            // while the other player's input is late the tick just waits for it, both sides slow down together.
+            if( AdvanceLockstepSession(session) )
+            {
+                next_tick_time += tick_length;
+                if( next_tick_time < now )
+                    next_tick_time = now + tick_length;
+
+                DisplayMultiplayerGame(session);
+            }
         }
+
+        SleepIfNotInterrupted(2000);
     }
+
+    if( !app_is_running )
+        return EXIT_SUCCESS;
+
+    DisplayMultiplayerGame(session);
+    SetConsoleCursorPosition(2,2);
+
+    const SnakeGameState& local_game = session.m_games[session.m_local_player];
+    const SnakeGameState& remote_game = session.m_games[1 - session.m_local_player];
+
+    if( session.m_is_desynced )
+        std::cout << "the games went out of sync at tick " << session.m_desync_tick << ", the game is stopped.";
+    else if( has_left )
+        std::cout << "you left the game.";
+    else if( session.m_is_disconnected )
+        std::cout << "the other player left the game.";
+    else if( local_game.m_score != remote_game.m_score )
+        std::cout << ( local_game.m_score > remote_game.m_score ? "you won" : "you lost" ) << " with the score of:"
+                  << local_game.m_score << " against " << remote_game.m_score << '.';
+    else
+        std::cout << "it's a draw with the score of:" << local_game.m_score << '.';
+
+    std::cout << " press any key to quit." << std::flush;
+    WaitForAnyKey();
+
+    return EXIT_SUCCESS;
 }
 
 void HandleApplicationUpdate()
@@ -1054,7 +1432,8 @@ void HandleApplicationUpdate()
 
         case APPLICATION_STATE_MAIN_MENU:
             HideConsoleCursor(true);
-            
+            ApplySettingsFileChanges();
+
             user_key_input = ReadKeyStrokeFromSTDIN();
 
             switch( user_key_input )
@@ -1084,6 +1463,22 @@ void HandleApplicationUpdate()
                     if( menu_status == MENU_STATUS_NEW_GAME )
                         application_status = APPLICATION_STATE_ENTER_NAME;
 
+                    else if( menu_status == MENU_STATUS_CONTINUE_GAME )
+                    {
+                        if( ResumeSnakeGame() )
+                            application_status = APPLICATION_STATE_SNAKE_GAME;
+
+                        else
+                        {
+                            ClearConsoleScreen();
+                            std::cerr << "Error:there is no saved game or " << SNAPSHOT_FILE_NAME
+                                      << " is corrupted. press any key to continue.\n";
+                            WaitForKeyStroke();
+
+                            InvalidateRetainedScreen(menu_screen);
+                        }
+                    }
+
                     else if( menu_status == MENU_STATUS_OPTIONS )
                         application_status = APPLICATION_STATE_OPTIONS;
 
@@ -1095,18 +1490,22 @@ void HandleApplicationUpdate()
                 break;
             }
 
-            DisplayMainMenu();
-            SleepIfNotInterrupted(50000);
+            // only writes the lines a key changed, an idle menu writes nothing.
+            if( application_status == APPLICATION_STATE_MAIN_MENU )
+                DisplayMainMenu();
+
+            WaitForInput(INPUT_WAIT_LIMIT,true);
         break;
 
         case APPLICATION_STATE_ENTER_NAME:
-            ClearConsoleScreen();
             HideConsoleCursor(false);
 
-            std::cout << "please enter your name (max 20 characters):" << current_user_name << std::flush;
+            BeginRetainedScreen(menu_screen,APPLICATION_STATE_ENTER_NAME);
+            SetScreenLine(menu_screen,1,1,"%s%s",name_prompt,current_user_name);
+            SetScreenCursor(menu_screen,1,sizeof(name_prompt) + word_entered_count);
+            PresentRetainedScreen(menu_screen);
 
-            while( ( user_key_input = ReadKeyStrokeFromSTDIN() ) == KEY_NONE )
-                SleepIfNotInterrupted(3000);
+            user_key_input = WaitForKeyStroke();
 
             if( user_key_input == KEY_ESCAPE )
             {
@@ -1143,20 +1542,26 @@ void HandleApplicationUpdate()
         break;
 
         case APPLICATION_STATE_ENTER_DIFFICULTY:
+            InvalidateRetainedScreen(menu_screen);
             ClearConsoleScreen();
             HideConsoleCursor(true);
 
-            std::cout << "please enter difficulty( 0 for easy, 1 for normal, 2 for hard ):" << std::flush;
+            std::cout << "please enter difficulty( 0 for easy, 1 for normal, 2 for hard, 3 for huge ):";
+
+            level_path_count = ListSnakeLevelFiles(SNAKE_LEVEL_DIRECTORY,level_paths,MAX_LISTED_LEVELS);
+            for( uint32_t i = 0; i < level_path_count; ++i )
+                std::cout << "\n  " << i + 4 << " for level " << level_paths[i] + sizeof(SNAKE_LEVEL_DIRECTORY);
+
+            std::cout << "\n  m for a maze, c for caves or o for obstacles on a new level";
+
+            std::cout << std::flush;
             game_difficulty = GAME_DIFFICULTY_NOT_DEFINED;
 
             while( game_difficulty == GAME_DIFFICULTY_NOT_DEFINED )
             {
-                user_key_input = ReadKeyStrokeFromSTDIN();
+                user_key_input = WaitForKeyStroke();
                 if( user_key_input == KEY_NONE )
-                {
-                    SleepIfNotInterrupted(3000);                    
-                    continue;
-                }
+                    return; // the application is closing.
 
                 else if( user_key_input == KEY_ESCAPE )
                 {
@@ -1174,6 +1579,36 @@ void HandleApplicationUpdate()
                 
                 else if( user_key_input == KEY_2 )
                     game_difficulty = GAME_DIFFICULTY_HARD;
+
+                else if( user_key_input == KEY_3 )
+                    game_difficulty = GAME_DIFFICULTY_HUGE;
+
+                else if( user_key_input >= KEY_4 && user_key_input <= KEY_9 &&
+                         uint32_t(user_key_input - KEY_4) < level_path_count )
+                {
+                    const char* path = level_paths[user_key_input - KEY_4];
+
+                    if( LoadSnakeLevel(current_level,path) )
+                        game_difficulty = GAME_DIFFICULTY_LEVEL;
+                    else
+                        std::cout << "\n" << path << " is not a valid level." << std::flush;
+                }
+
+                else if( user_key_input == KEY_M_LOWERCASE || user_key_input == KEY_C_LOWERCASE ||
+                         user_key_input == KEY_O_LOWERCASE )
+                {
+                    uint8_t kind = LEVEL_GENERATOR_OBSTACLES;
+                    if( user_key_input == KEY_M_LOWERCASE )
+                        kind = LEVEL_GENERATOR_MAZE;
+                    else if( user_key_input == KEY_C_LOWERCASE )
+                        kind = LEVEL_GENERATOR_CAVES;
+
+                    if( GenerateLevel(kind) )
+                        game_difficulty = GAME_DIFFICULTY_LEVEL;
+                    else
+                        std::cout << "\nthe board is too small for " << GetLevelGeneratorName(kind) << '.'
+                                  << std::flush;
+                }
             }
 
             if( application_status != APPLICATION_STATE_MAIN_MENU )
@@ -1185,7 +1620,9 @@ void HandleApplicationUpdate()
         break;
 
         case APPLICATION_STATE_SNAKE_GAME:
-            switch( game_status )
+            InvalidateRetainedScreen(menu_screen);
+
+            switch( game_state.m_status )
             {
                 case GAME_STATUS_NOT_INITIALIZED:
                     InitializeSnakeGame();
@@ -1198,89 +1635,129 @@ void HandleApplicationUpdate()
                 case GAME_STATUS_ONGOING:
                     user_key_input = ReadKeyStrokeFromSTDIN();
 
-                    switch( user_key_input )
+                    switch( GetGameAction(user_key_input) )
                     {
-                        case KEY_W_LOWERCASE:
-                        case KEY_W_UPPERCASE:
-                        case KEY_UP:
+                        case GAME_ACTION_UP:
+                            snake_direction_to_move = SNAKE_DIRECTION_UP;
+                        break;
+
+                        case GAME_ACTION_LEFT:
                             snake_direction_to_move = SNAKE_DIRECTION_LEFT;
                         break;
 
-                        case KEY_A_LOWERCASE:
-                        case KEY_A_UPPERCASE:
-                        case KEY_LEFT:
-                            snake_direction_to_move = SNAKE_DIRECTION_UP;
+                        case GAME_ACTION_DOWN:
+                            snake_direction_to_move = SNAKE_DIRECTION_DOWN;
                         break;
 
-                        case KEY_S_LOWERCASE:
-                        case KEY_S_UPPERCASE:
-                        case KEY_DOWN:
+                        case GAME_ACTION_RIGHT:
                             snake_direction_to_move = SNAKE_DIRECTION_RIGHT;
                         break;
 
-                        case KEY_D_LOWERCASE:
-                        case KEY_D_UPPERCASE:
-                        case KEY_RIGHT:
-                            snake_direction_to_move = SNAKE_DIRECTION_DOWN;
+                        case GAME_ACTION_AUTOPILOT:
+                            autopilot_enabled = !autopilot_enabled;
+                            if( autopilot_enabled )
+                                game_analytics_flags |= ANALYTICS_FLAG_AUTOPILOT;
                         break;
 
-                        case KEY_ESCAPE:
+                        case GAME_ACTION_PAUSE:
+                            if( SuspendSnakeGame() )
+                            {
+                                application_status = APPLICATION_STATE_MAIN_MENU;
+                                game_state.m_status = GAME_STATUS_NOT_INITIALIZED;
+                            }
+                        break;
+
+                        case GAME_ACTION_QUIT:
+                            RecordFinishedGame();
                             application_status = APPLICATION_STATE_MAIN_MENU;
-                            game_status = GAME_STATUS_NOT_INITIALIZED;
+                            game_state.m_status = GAME_STATUS_NOT_INITIALIZED;
                         break;
                     }
 
                     // if user hasn't pressed escape while playing the game
                     if( application_status == APPLICATION_STATE_SNAKE_GAME )
                     {
-                        if( static_cast<float>(( std::clock() - begin_time )) / CLOCKS_PER_SEC >= 0.8f * game_speed )
+                        auto now = std::chrono::steady_clock::now();
+                        if( IsTickDue(game_ticks,now) )
                         {
+                            BeginTick(game_ticks,now);
                             HandleSnakeGameLogic();
-                            DisplayGameOnScreen();
 
-                            begin_time = clock();
+                            if( now - last_frame_time >= std::chrono::microseconds(1000000 / GAME_MAX_FRAME_RATE) )
+                            {
+                                last_frame_time = now;
+                                DisplayGameOnScreen();
+                            }
+
+                            EndTick(game_ticks);
+
+                            if( game_settings.m_turbo_tick_rate && autopilot_enabled )
+                                AdaptAutopilotDepth();
+
+                            ApplySettingsFileChanges();
                         }
+
+                        // instead of spinning, sleeps until a key is pressed or the next tick is due.
+                        else
+                            WaitForTickOrInput(game_ticks,STDIN_FILENO);
                     }
 
+                    // the menus write to the terminal themselves, the last frame must be out before they do.
                     else
+                    {
+                        WaitForRenderThread(render_thread);
                         ClearUserName();
+                    }
                 break;
 
                 case GAME_STATUS_LOST:
+                    WaitForRenderThread(render_thread);
                     ClearConsoleScreen();
-                    std::cout << "you lost the game with the score of:" << current_user_score << '\n'
+                    std::cout << "you lost the game with the score of:" << game_state.m_score << '\n'
                               << "press Enter to play again, Escape to return to main menu and space "
                               << "to change difficulty." << std::flush;
 
-                    while( ( user_key_input = ReadKeyStrokeFromSTDIN() ) == KEY_NONE )
-                        SleepIfNotInterrupted(3000);
+                    user_key_input = WaitForKeyStroke();
 
                     if( user_key_input == KEY_ENTER )
-                        StartSnakeGame();
+                    {
+                        uint64_t heap_allocations_before_restart = heap_allocation_count.load();
+
+                        // picks up a board size that changed in settings.ini during the last game.
+                        HandleGameDifficulty();
+                        if( InitializeSnakeGame() )
+                            StartSnakeGame();
+
+                        heap_allocations_on_last_restart = heap_allocation_count.load() -
+                                                           heap_allocations_before_restart;
+                    }
 
                     else if( user_key_input == KEY_ESCAPE )
                     {
-                        game_status = GAME_STATUS_NOT_INITIALIZED;
+                        game_state.m_status = GAME_STATUS_NOT_INITIALIZED;
                         application_status = APPLICATION_STATE_MAIN_MENU;
                         ClearUserName();
                     }
 
                     else if( user_key_input == KEY_SPACE )
+                    {
+                        game_state.m_status = GAME_STATUS_NOT_INITIALIZED;
                         application_status = APPLICATION_STATE_ENTER_DIFFICULTY;
+                    }
                 break;
 
                 case GAME_STATUS_WON:
+                    WaitForRenderThread(render_thread);
                     ClearConsoleScreen();
-                    std::cout << "congratulations!you won the game with the score of:" << current_user_score << '\n'
+                    std::cout << "congratulations!you won the game with the score of:" << game_state.m_score << '\n'
                               << "Press Escape to go to main menu. if you want, you can check your score "
                               << "by selecting scores option from main menu." << std::endl;
 
-                    while( ( user_key_input = ReadKeyStrokeFromSTDIN() ) == KEY_NONE )
-                        SleepIfNotInterrupted(3000);
+                    user_key_input = WaitForKeyStroke();
 
                     if( user_key_input == KEY_ESCAPE )
                     {
-                        game_status = GAME_STATUS_NOT_INITIALIZED;
+                        game_state.m_status = GAME_STATUS_NOT_INITIALIZED;
                         application_status = APPLICATION_STATE_MAIN_MENU;
                         ClearUserName();
                     }
@@ -1289,12 +1766,9 @@ void HandleApplicationUpdate()
         break;
 
         case APPLICATION_STATE_OPTIONS:
-            ClearConsoleScreen();
             HideConsoleCursor(false);
 
-            ReadOptionsFromFile();
-
-            DisplayOptions();
+            ApplySettingsFileChanges();
 
             user_key_input = ReadKeyStrokeFromSTDIN();
             switch( user_key_input )
@@ -1312,13 +1786,53 @@ void HandleApplicationUpdate()
                 case KEY_SPACE:
                     if( option_menu_choise == OPTION_STATUS_ALLOW_SNAKE_CUT_ITSELF )
                     {
-                        snake_can_cut_itself = !snake_can_cut_itself;
+                        game_settings.m_snake_can_cut_itself = !game_settings.m_snake_can_cut_itself;
                         options_changed = true;
                     }
 
                     else if( option_menu_choise == OPTION_STATUS_ALLOW_SNAKE_PASS_BORDERS )
                     {
-                        snake_can_pass_border = !snake_can_pass_border;
+                        game_settings.m_snake_can_pass_border = !game_settings.m_snake_can_pass_border;
+                        options_changed = true;
+                    }
+
+                    else if( option_menu_choise == OPTION_STATUS_COLOR_MODE )
+                    {
+                        game_settings.m_color_mode = ( game_settings.m_color_mode + 1 ) % RENDER_COLOR_MODE_COUNT;
+                        options_changed = true;
+                    }
+
+                    else if( option_menu_choise == OPTION_STATUS_THEME )
+                    {
+                        game_settings.m_theme = ( game_settings.m_theme + 1 ) % RENDER_THEME_COUNT;
+                        options_changed = true;
+                    }
+
+                    else if( option_menu_choise == OPTION_STATUS_DENSITY )
+                    {
+                        game_settings.m_density = ( game_settings.m_density + 1 ) % RENDER_DENSITY_COUNT;
+                        options_changed = true;
+                    }
+
+                    else if( option_menu_choise == OPTION_STATUS_TURBO )
+                    {
+                        uint32_t next = 0;
+                        while( turbo_tick_rates[next] != game_settings.m_turbo_tick_rate )
+                            ++next;
+
+                        game_settings.m_turbo_tick_rate = turbo_tick_rates[( next + 1 ) % TURBO_TICK_RATE_COUNT];
+                        options_changed = true;
+                    }
+
+                    // a count from settings.ini that isn't one of the choices steps to the next bigger one.
+                    else if( option_menu_choise == OPTION_STATUS_ITEMS )
+                    {
+                        uint32_t next = 0;
+                        while( next < ITEM_COUNT_CHOICE_COUNT &&
+                               item_count_choices[next] <= game_settings.m_item_count )
+                            ++next;
+
+                        game_settings.m_item_count = item_count_choices[next % ITEM_COUNT_CHOICE_COUNT];
                         options_changed = true;
                     }
 
@@ -1357,15 +1871,15 @@ void HandleApplicationUpdate()
                 break;
             }
 
-            SleepIfNotInterrupted(50000);
+            if( application_status == APPLICATION_STATE_OPTIONS )
+                DisplayOptions();
+
+            WaitForInput(INPUT_WAIT_LIMIT,true);
         break;
 
         case APPLICATION_STATE_SCOREBOARD:
-            ClearConsoleScreen();
             HideConsoleCursor(true);
 
-            DrawScoreBoard();
-
             user_key_input = ReadKeyStrokeFromSTDIN();
 
             switch( user_key_input )
@@ -1375,14 +1889,39 @@ void HandleApplicationUpdate()
                 break;
             }
 
-            SleepIfNotInterrupted(50000);
+            if( application_status == APPLICATION_STATE_SCOREBOARD )
+                DrawScoreBoard();
+
+            WaitForInput(INPUT_WAIT_LIMIT,false);
         break;
     }
 }
 
 int main( int argc, char** argv, char** env )
 {
+    if( IsHeadlessCommand(argc,argv) )
+    {
+        SetHeadlessHeapCounters(&heap_allocation_count,&heap_deallocation_count);
+        return RunHeadlessCommand(argc,argv);
+    }
+
     InitializeApplication(argc,argv,env);
+    ReadOptionsFromFile();
+    ReadRecordsFromFile();
+
+    // the render thread isn't running yet, multiplayer games are drawn on this one.
+    field_renderer.m_color_mode = game_settings.m_color_mode;
+    field_renderer.m_theme = game_settings.m_theme;
+    field_renderer.m_density = game_settings.m_density;
+
+    if( IsMultiplayerCommand(argc,argv) )
+        return RunMultiplayerGame(argc,argv);
+
+    if( !StartSettingsWatch(settings_watch,SETTINGS_FILE_NAME) )
+        std::cerr << "could not watch " << SETTINGS_FILE_NAME << ", edits to it are only read at startup.\n";
+
+    if( !StartRenderThread(render_thread,field_renderer) )
+        std::cerr << "could not start the render thread, games will be drawn between ticks.\n";
 
     while( ApplicationShouldClose() )
         HandleApplicationUpdate();
@@ -0,0 +1,140 @@
+#include "perf_counters.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+static const char* perf_counter_names[PERF_COUNTER_COUNT] =
+{
+    "cycles", "instructions", "L1d misses", "LLC misses", "branch misses"
+};
+
+static uint64_t GetCacheMissConfig( uint64_t cache )
+{
+    return cache | ( uint64_t(PERF_COUNT_HW_CACHE_OP_READ) << 8 ) |
+           ( uint64_t(PERF_COUNT_HW_CACHE_RESULT_MISS) << 16 );
+}
+
+static void OpenPerfCounter( PerfCounters& counters, int counter, uint32_t type, uint64_t config )
+{
+    perf_event_attr attributes;
+    std::memset(&attributes,0,sizeof(attributes));
+    attributes.size = sizeof(attributes);
+    attributes.type = type;
+    attributes.config = config;
+    attributes.disabled = 1;
+    attributes.inherit = 1;
+    attributes.exclude_kernel = 1;
+    attributes.exclude_hv = 1;
+    attributes.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+    counters.m_fds[counter] = int(syscall(SYS_perf_event_open,&attributes,0,-1,-1,PERF_FLAG_FD_CLOEXEC));
+    if( counters.m_fds[counter] < 0 && counters.m_error == 0 )
+        counters.m_error = errno;
+}
+
+bool OpenPerfCounters( PerfCounters& counters )
+{
+    ClosePerfCounters(counters);
+    counters.m_error = 0;
+
+    OpenPerfCounter(counters,PERF_COUNTER_CYCLES,PERF_TYPE_HARDWARE,PERF_COUNT_HW_CPU_CYCLES);
+    OpenPerfCounter(counters,PERF_COUNTER_INSTRUCTIONS,PERF_TYPE_HARDWARE,PERF_COUNT_HW_INSTRUCTIONS);
+    OpenPerfCounter(counters,PERF_COUNTER_L1D_MISSES,PERF_TYPE_HW_CACHE,GetCacheMissConfig(PERF_COUNT_HW_CACHE_L1D));
+    OpenPerfCounter(counters,PERF_COUNTER_LLC_MISSES,PERF_TYPE_HW_CACHE,GetCacheMissConfig(PERF_COUNT_HW_CACHE_LL));
+    OpenPerfCounter(counters,PERF_COUNTER_BRANCH_MISSES,PERF_TYPE_HARDWARE,PERF_COUNT_HW_BRANCH_MISSES);
+
+    return HasPerfCounters(counters);
+}
+
+void ClosePerfCounters( PerfCounters& counters )
+{
+    for( int& fd : counters.m_fds )
+    {
+        if( fd >= 0 )
+            close(fd);
+
+        fd = -1;
+    }
+}
+
+bool HasPerfCounters( const PerfCounters& counters )
+{
+    for( int fd : counters.m_fds )
+    {
+        if( fd >= 0 )
+            return true;
+    }
+
+    return false;
+}
+
+void StartPerfCounters( PerfCounters& counters )
+{
+    for( int fd : counters.m_fds )
+    {
+        if( fd >= 0 )
+        {
+            ioctl(fd,PERF_EVENT_IOC_RESET,0);
+            ioctl(fd,PERF_EVENT_IOC_ENABLE,0);
+        }
+    }
+}
+
+void StopPerfCounters( PerfCounters& counters, PerfCounterValues& values )
+{
+    values = PerfCounterValues();
+
+    // disabled first, so reading the first counters isn't counted by the last ones.
+    for( int fd : counters.m_fds )
+    {
+        if( fd >= 0 )
+            ioctl(fd,PERF_EVENT_IOC_DISABLE,0);
+    }
+
+    for( int i = 0; i < PERF_COUNTER_COUNT; ++i )
+    {
+        // value, time enabled, time running.
+        uint64_t data[3];
+        if( counters.m_fds[i] < 0 || read(counters.m_fds[i],data,sizeof(data)) != ssize_t(sizeof(data)) ||
+            data[2] == 0 )
+            continue;
+
+        values.m_values[i] = data[2] < data[1] ? uint64_t(double(data[0]) * data[1] / data[2]) : data[0];
+        values.m_valid[i] = true;
+    }
+}
+
+void FormatPerfCounterValues( const PerfCounterValues& values, uint64_t tick_count, char* text, uint32_t size )
+{
+    uint32_t length = 0;
+    text[0] = 0;
+    double ticks = tick_count ? double(tick_count) : 1.0;
+
+    for( int i = 0; i < PERF_COUNTER_COUNT && length < size; ++i )
+    {
+        int written = values.m_valid[i] ?
+                      std::snprintf(text + length,size - length,"%s:%.2f ",perf_counter_names[i],
+                                    values.m_values[i] / ticks) :
+                      std::snprintf(text + length,size - length,"%s:n/a ",perf_counter_names[i]);
+
+        length += written > 0 ? uint32_t(written) : 0;
+
+        if( i == PERF_COUNTER_INSTRUCTIONS && length < size && values.m_valid[PERF_COUNTER_CYCLES] &&
+            values.m_valid[PERF_COUNTER_INSTRUCTIONS] && values.m_values[PERF_COUNTER_CYCLES] )
+        {
+            written = std::snprintf(text + length,size - length,"ipc:%.2f ",
+                                    double(values.m_values[PERF_COUNTER_INSTRUCTIONS]) /
+                                    values.m_values[PERF_COUNTER_CYCLES]);
+            length += written > 0 ? uint32_t(written) : 0;
+        }
+    }
+
+    if( length < size )
+        std::snprintf(text + length,size - length,"per tick");
+}
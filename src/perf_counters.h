@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstdint>
+
+#define PERF_COUNTER_CYCLES                     0
+#define PERF_COUNTER_INSTRUCTIONS               1
+#define PERF_COUNTER_L1D_MISSES                 2 // reads that missed the level 1 data cache.
+#define PERF_COUNTER_LLC_MISSES                 3 // reads that missed the last level cache and went to memory.
+#define PERF_COUNTER_BRANCH_MISSES              4
+#define PERF_COUNTER_COUNT                      5
+
+// what a loop cost in hardware events, read from perf_event_open() counters of the calling thread and the
+// threads it starts while counting. the kernel is left out, only the game's own code is counted.
+struct PerfCounterValues
+{
+    PerfCounterValues() : m_values{}, m_valid{} {}
+
+    // scaled up when the cpu had to share it's counters between events and only counted part of the time.
+    uint64_t m_values[PERF_COUNTER_COUNT];
+    bool m_valid[PERF_COUNTER_COUNT];
+};
+
+// a counter the cpu or the kernel doesn't offer is left closed. a virtual machine often has none at all and
+// kernel.perf_event_paranoid above 2 forbids them to users.
+struct PerfCounters
+{
+    PerfCounters() : m_fds{-1,-1,-1,-1,-1}, m_error(0) {}
+
+    int m_fds[PERF_COUNTER_COUNT];
+    int m_error;                    // errno of the first counter that couldn't be opened.
+};
+
+// opens what it can, false if not a single counter could be opened.
+bool OpenPerfCounters( PerfCounters& counters );
+void ClosePerfCounters( PerfCounters& counters );
+bool HasPerfCounters( const PerfCounters& counters );
+
+// resets and starts the counters, stopping reads them. both are a few syscalls, call them around a loop and not
+// inside it.
+void StartPerfCounters( PerfCounters& counters );
+void StopPerfCounters( PerfCounters& counters, PerfCounterValues& values );
+
+// writes the values divided by the ticks they were counted over, with the instructions per cycle, for example
+// "cycles:312.5 instructions:801.2 ipc:2.56 L1d misses:3.1 LLC misses:0.02 branch misses:1.4 per tick".
+void FormatPerfCounterValues( const PerfCounterValues& values, uint64_t tick_count, char* text, uint32_t size );
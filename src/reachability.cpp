@@ -0,0 +1,293 @@
+#include "reachability.h"
+
+#include <cstring>
+
+#include "items.h"
+
+static bool PrepareSnakeReachability( SnakeReachability& reachability, const SnakeGameState& state )
+{
+    if( reachability.m_open && reachability.m_size_x == state.m_size_x && reachability.m_size_y == state.m_size_y )
+        return true;
+
+    uint32_t words_per_row = ( uint32_t(state.m_size_x) + 63 ) / 64;
+    std::size_t word_count = std::size_t(words_per_row) * state.m_size_y;
+
+    reachability.m_arena.Reset();
+    if( !reachability.m_arena.Reserve(ArenaFootprint<uint64_t>(word_count) * 2) )
+        return false;
+
+    reachability.m_open = reachability.m_arena.AllocateArray<uint64_t>(word_count);
+    reachability.m_reached = reachability.m_arena.AllocateArray<uint64_t>(word_count);
+    reachability.m_words_per_row = words_per_row;
+    reachability.m_size_x = state.m_size_x;
+    reachability.m_size_y = state.m_size_y;
+
+    return true;
+}
+
+// 0x80 in every byte of chars that equals value, 0 in the others.
+static uint64_t MatchBytes( uint64_t chars, char value )
+{
+    uint64_t x = chars ^ ( 0x0101010101010101ULL * uint8_t(value) );
+
+    return ~( ( ( x & 0x7f7f7f7f7f7f7f7fULL ) + 0x7f7f7f7f7f7f7f7fULL ) | x | 0x7f7f7f7f7f7f7f7fULL );
+}
+
+// moves the top bit of byte i to bit i, the multiply lands every one of them on a different bit of the top byte.
+static uint64_t GatherByteBits( uint64_t matches )
+{
+    return ( ( matches >> 7 ) * 0x0102040810204080ULL ) >> 56;
+}
+
+static bool IsOpenCell( char value, bool body_is_open )
+{
+    return value == SNAKE_CELL_EMPTY || value == SNAKE_CELL_FOOD || IsItemCellValue(value) ||
+           ( body_is_open && value == SNAKE_CELL_BODY );
+}
+
+// the field is read 8 cells at a time, each compared against the open cell values all at once. items are
+// walked over like empty cells ( see items.h ).
+static void BuildOpenBitboard( SnakeReachability& reachability, const SnakeGameState& state )
+{
+    bool body_is_open = state.m_rules & SNAKE_RULE_CUT_ITSELF;
+    uint64_t body_mask = body_is_open ? ~0ULL : 0;
+
+    for( uint32_t y = 0; y < state.m_size_y; ++y )
+    {
+        const char* row = state.m_field + std::size_t(y) * state.m_size_x;
+        uint64_t* out = reachability.m_open + std::size_t(y) * reachability.m_words_per_row;
+
+        for( uint32_t word = 0; word < reachability.m_words_per_row; ++word )
+        {
+            uint32_t x = word * 64;
+            uint32_t end = ( x + 64 < state.m_size_x ) ? x + 64 : state.m_size_x;
+            uint64_t bits = 0;
+
+            for( ; x + 8 <= end; x += 8 )
+            {
+                uint64_t chars;
+                std::memcpy(&chars,row + x,8);
+
+                uint64_t matches = MatchBytes(chars,SNAKE_CELL_EMPTY) | MatchBytes(chars,SNAKE_CELL_FOOD) |
+                                   MatchBytes(chars,SNAKE_CELL_ITEM_FOOD) | MatchBytes(chars,SNAKE_CELL_ITEM_SPEED) |
+                                   MatchBytes(chars,SNAKE_CELL_ITEM_SHRINK) |
+                                   MatchBytes(chars,SNAKE_CELL_ITEM_MULTIPLIER) |
+                                   ( MatchBytes(chars,SNAKE_CELL_BODY) & body_mask );
+                bits |= GatherByteBits(matches) << ( x & 63 );
+            }
+
+            for( ; x < end; ++x )
+                bits |= uint64_t(IsOpenCell(row[x],body_is_open)) << ( x & 63 );
+
+            out[word] = bits;
+        }
+    }
+}
+
+// occluded fills: spreads the reached bits through runs of open bits, 6 shifts cover a whole word.
+static uint64_t FillTowardsHigherBits( uint64_t reached, uint64_t open )
+{
+    reached |= open & ( reached << 1 );  open &= open << 1;
+    reached |= open & ( reached << 2 );  open &= open << 2;
+    reached |= open & ( reached << 4 );  open &= open << 4;
+    reached |= open & ( reached << 8 );  open &= open << 8;
+    reached |= open & ( reached << 16 ); open &= open << 16;
+    reached |= open & ( reached << 32 );
+
+    return reached;
+}
+
+static uint64_t FillTowardsLowerBits( uint64_t reached, uint64_t open )
+{
+    reached |= open & ( reached >> 1 );  open &= open >> 1;
+    reached |= open & ( reached >> 2 );  open &= open >> 2;
+    reached |= open & ( reached >> 4 );  open &= open >> 4;
+    reached |= open & ( reached >> 8 );  open &= open >> 8;
+    reached |= open & ( reached >> 16 ); open &= open >> 16;
+    reached |= open & ( reached >> 32 );
+
+    return reached;
+}
+
+// one pass each way is enough for a row, the bit that falls off the end of a word is carried into the next one.
+static void FillRow( uint64_t* reached, const uint64_t* open, uint32_t word_count )
+{
+    uint64_t carry = 0;
+    for( uint32_t word = 0; word < word_count; ++word )
+    {
+        reached[word] = FillTowardsHigherBits(reached[word] | ( carry & open[word] ),open[word]);
+        carry = reached[word] >> 63;
+    }
+
+    carry = 0;
+    for( uint32_t word = word_count; word-- > 0; )
+    {
+        reached[word] = FillTowardsLowerBits(reached[word] | ( carry & open[word] ),open[word]);
+        carry = ( reached[word] & 1 ) << 63;
+    }
+}
+
+// spreads reached from the row next to it into row, then along row. the row loops are plain word and/or, which
+// the compiler vectorizes.
+static void SpreadIntoRow( uint64_t* row, const uint64_t* next_to_row, const uint64_t* open, uint32_t word_count )
+{
+    uint64_t any = 0;
+    for( uint32_t word = 0; word < word_count; ++word )
+    {
+        row[word] |= next_to_row[word] & open[word];
+        any |= row[word];
+    }
+
+    if( any )
+        FillRow(row,open,word_count);
+}
+
+static bool GetBit( const uint64_t* bits, uint32_t words_per_row, uint32_t x, uint32_t y )
+{
+    return ( bits[std::size_t(y) * words_per_row + x / 64] >> ( x & 63 ) ) & 1;
+}
+
+static void SetBit( uint64_t* bits, uint32_t words_per_row, uint32_t x, uint32_t y )
+{
+    bits[std::size_t(y) * words_per_row + x / 64] |= 1ULL << ( x & 63 );
+}
+
+// the inner cells next to the border see the ones on the other side as neighbors when passing borders is on.
+static void SpreadAcrossBorders( SnakeReachability& reachability )
+{
+    uint32_t words_per_row = reachability.m_words_per_row;
+    uint32_t last_x = reachability.m_size_x - 2, last_y = reachability.m_size_y - 2;
+    uint64_t* first_row = reachability.m_reached + std::size_t(words_per_row);
+    uint64_t* last_row = reachability.m_reached + std::size_t(last_y) * words_per_row;
+
+    for( uint32_t word = 0; word < words_per_row; ++word )
+    {
+        first_row[word] |= last_row[word] & reachability.m_open[words_per_row + word];
+        last_row[word] |= first_row[word] & reachability.m_open[std::size_t(last_y) * words_per_row + word];
+    }
+
+    for( uint32_t y = 1; y <= last_y; ++y )
+    {
+        if( GetBit(reachability.m_reached,words_per_row,1,y) && GetBit(reachability.m_open,words_per_row,last_x,y) )
+            SetBit(reachability.m_reached,words_per_row,last_x,y);
+
+        if( GetBit(reachability.m_reached,words_per_row,last_x,y) && GetBit(reachability.m_open,words_per_row,1,y) )
+            SetBit(reachability.m_reached,words_per_row,1,y);
+    }
+}
+
+static uint64_t CountBits( const uint64_t* bits, std::size_t word_count )
+{
+    uint64_t count = 0;
+    for( std::size_t word = 0; word < word_count; ++word )
+        count += __builtin_popcountll(bits[word]);
+
+    return count;
+}
+
+uint32_t ComputeSnakeReachableArea( SnakeReachability& reachability, const SnakeGameState& state )
+{
+    reachability.m_reachable_cell_count = 0;
+    reachability.m_sweep_count = 0;
+
+    if( !state.m_field || !state.m_length || !PrepareSnakeReachability(reachability,state) )
+        return 0;
+
+    uint32_t words_per_row = reachability.m_words_per_row;
+    std::size_t word_count = std::size_t(words_per_row) * state.m_size_y;
+    uint64_t* open = reachability.m_open;
+    uint64_t* reached = reachability.m_reached;
+
+    BuildOpenBitboard(reachability,state);
+
+    // the fill starts from the head, so the head has to count as open for it. it is left out of the count.
+    uint32_t head = state.Head();
+    SetBit(open,words_per_row,head % state.m_size_x,head / state.m_size_x);
+
+    std::memset(reached,0,word_count * sizeof(uint64_t));
+    SetBit(reached,words_per_row,head % state.m_size_x,head / state.m_size_x);
+    FillRow(reached + std::size_t(head / state.m_size_x) * words_per_row,
+            open + std::size_t(head / state.m_size_x) * words_per_row,words_per_row);
+
+    // sweep down and up until a whole round adds nothing. open boards settle in a couple of rounds, every round
+    // after that is a corridor that turns back on itself.
+    uint64_t count = 0, last_count;
+    do
+    {
+        last_count = count;
+
+        for( uint32_t y = 1; y < state.m_size_y; ++y )
+            SpreadIntoRow(reached + std::size_t(y) * words_per_row,reached + std::size_t(y - 1) * words_per_row,
+                          open + std::size_t(y) * words_per_row,words_per_row);
+
+        for( uint32_t y = state.m_size_y - 1; y-- > 0; )
+            SpreadIntoRow(reached + std::size_t(y) * words_per_row,reached + std::size_t(y + 1) * words_per_row,
+                          open + std::size_t(y) * words_per_row,words_per_row);
+
+        if( state.m_rules & SNAKE_RULE_PASS_BORDERS )
+            SpreadAcrossBorders(reachability);
+
+        count = CountBits(reached,word_count);
+        ++reachability.m_sweep_count;
+    } while( count != last_count );
+
+    reachability.m_reachable_cell_count = uint32_t(count - 1);
+
+    return reachability.m_reachable_cell_count;
+}
+
+bool IsSnakeCellReachable( const SnakeReachability& reachability, uint32_t cell )
+{
+    if( !reachability.m_reached || cell >= uint32_t(reachability.m_size_x) * reachability.m_size_y )
+        return false;
+
+    return GetBit(reachability.m_reached,reachability.m_words_per_row,cell % reachability.m_size_x,
+                  cell / reachability.m_size_x);
+}
+
+bool IsSnakeGameDoomed( SnakeReachability& reachability, const SnakeGameState& state )
+{
+    if( state.m_status != GAME_STATUS_ONGOING )
+        return false;
+
+    uint32_t reachable = ComputeSnakeReachableArea(reachability,state);
+
+    // eating the food that fills the board wins, even if there is no move after it.
+    if( state.m_length + reachable >= state.m_free_cell_count )
+        return false;
+
+    // the body can be walked through, so only being walled in can end the game.
+    if( state.m_rules & SNAKE_RULE_CUT_ITSELF )
+        return reachable == 0;
+
+    // a shrink item drops parts off the tail all at once, so the body can be gone sooner than what's below says.
+    const char* field_end = state.m_field + state.CellCount();
+    for( const char* item = state.m_field;
+         ( item = static_cast<const char*>(std::memchr(item,SNAKE_CELL_ITEM_SHRINK,field_end - item)) ); ++item )
+    {
+        if( IsSnakeCellReachable(reachability,uint32_t(item - state.m_field)) )
+            return false;
+    }
+
+    // part i of the body leaves it's cell after length - i moves, the tail after the first. the snake can spend
+    // one move per reachable cell, so it only gets out if a part next to the area ( or to the head ) is gone by
+    // the move after that. food eaten on the way makes the body wait even longer, which only makes it worse.
+    // the head itself is in the reached bits, so the part right behind it always counts.
+    uint32_t moves_until_free = state.m_length;
+    for( uint32_t i = state.m_length - 1; i > 0; --i )
+    {
+        uint32_t part = state.BodyCell(i);
+        bool next_to_area = false;
+
+        for( uint8_t direction = SNAKE_DIRECTION_UP; direction <= SNAKE_DIRECTION_RIGHT; ++direction )
+            next_to_area |= IsSnakeCellReachable(reachability,state.Neighbor(part,direction));
+
+        if( next_to_area )
+        {
+            moves_until_free = state.m_length - i;
+            break;
+        }
+    }
+
+    return reachable + 1 < moves_until_free;
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstdint>
+
+#include "arena.h"
+#include "snake_game.h"
+
+// the field as bitboards, one bit per cell and every row starting on a new 64 bit word. the flood fill spreads
+// through whole words at once: along a row with shifts and masks, and between rows with a single and/or per
+// word. so a fill costs a few passes over m_size_y * m_words_per_row words instead of a visit of every cell.
+struct SnakeReachability
+{
+    SnakeReachability() : m_open(nullptr), m_reached(nullptr), m_words_per_row(0), m_size_x(0), m_size_y(0),
+                          m_reachable_cell_count(0), m_sweep_count(0) {}
+
+    GameArena m_arena;
+    uint64_t* m_open;           // cells the head can move through.
+    uint64_t* m_reached;        // cells the head can get to, filled by ComputeSnakeReachableArea().
+    uint32_t m_words_per_row;
+    uint16_t m_size_x;
+    uint16_t m_size_y;
+
+    // results of the last fill.
+    uint32_t m_reachable_cell_count;
+    uint32_t m_sweep_count;     // passes over the board the fill needed before nothing changed anymore.
+};
+
+// finds every cell the head of the snake can get to from where it is now, without going through walls or the
+// body ( unless the body can be cut ). returns how many cells that is, the head itself not included.
+uint32_t ComputeSnakeReachableArea( SnakeReachability& reachability, const SnakeGameState& state );
+
+// whether cell was reached by the last ComputeSnakeReachableArea().
+bool IsSnakeCellReachable( const SnakeReachability& reachability, uint32_t cell );
+
+// true when the snake can't survive anymore, no matter how it moves: the area it can get to runs out before any
+// part of it's body next to that area moves out of the way. this never says a game is doomed when it is not, but
+// it doesn't catch every doomed game either. fills the reachable area on the way.
+bool IsSnakeGameDoomed( SnakeReachability& reachability, const SnakeGameState& state );
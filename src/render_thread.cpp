@@ -0,0 +1,274 @@
+#include "render_thread.h"
+
+#include <cerrno>
+#include <chrono>
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+
+#include <unistd.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+
+// formats into the header part of a frame, text that doesn't fit is cut off.
+static char* AppendText( char* out, char* end, const char* format, ... )
+{
+    va_list arguments;
+    va_start(arguments,format);
+    int length = std::vsnprintf(out,end - out,format,arguments);
+    va_end(arguments);
+
+    if( length < 0 )
+        return out;
+
+    return ( length < end - out ) ? out + length : end - 1;
+}
+
+bool DrawGameFrame( RenderThread& render, const GameFrame& frame )
+{
+    FrameRenderer& renderer = *render.m_renderer;
+    renderer.m_color_mode = frame.m_color_mode;
+    renderer.m_theme = frame.m_theme;
+    renderer.m_density = frame.m_density;
+
+    uint16_t field_columns, field_rows;
+    GetRenderedFieldSize(renderer,frame.m_state,field_columns,field_rows);
+
+    std::size_t field_size = BuildSnakeFieldFrame(renderer,frame.m_state,
+                                                  field_columns < 146 ? 78 - field_columns / 2 : 1,3);
+
+    char* buffer = BeginTerminalFrame(render.m_output,RENDER_HEADER_CAPACITY + field_size);
+    if( !buffer )
+        return GetUnflushedBytes(render.m_output) == 0;
+
+    char* out = buffer;
+    char* end = buffer + RENDER_HEADER_CAPACITY;
+
+    std::time_t elapsed = time(NULL) - frame.m_start_time;
+    int hours = int(elapsed / 3600);
+    int minutes = int(elapsed / 60 % 60);
+    int seconds = int(elapsed % 60);
+
+    out = AppendText(out,end,"\x1b[H\x1b[2J\x1b[3J\x1b[1;17fdifficulty:%s\x1b[1;52fgame_score:%d"
+                             "\x1b[1;92fplayer:%s\x1b[1;127ftime:",frame.m_difficulty,int(frame.m_state.m_score),
+                     frame.m_player_name);
+
+    if( hours )
+    {
+        out = AppendText(out,end,"%dh ",hours);
+        if( minutes )
+            out = AppendText(out,end,"%dm ",minutes);
+    }
+
+    else if( minutes )
+        out = AppendText(out,end,"%dm ",minutes);
+
+    out = AppendText(out,end,"%ds",seconds);
+
+    if( frame.m_autopilot )
+        out = AppendText(out,end,"\x1b[2;17fautopilot:depth %d, %llu moves searched ( Tab to take back control )",
+                         int(frame.m_autopilot_depth),(unsigned long long)frame.m_autopilot_node_count);
+
+    if( frame.m_status_text[0] )
+        out = AppendText(out,end,"\x1b[%d;17f%s",field_rows + 3,frame.m_status_text);
+
+#ifdef DEBUG_MODE
+    uint64_t average_bytes = renderer.m_frame_count ? renderer.m_total_bytes / renderer.m_frame_count : 0;
+
+    out = AppendText(out,end,"\x1b[%d;17f%s",field_rows + 4,frame.m_debug_text);
+    out = AppendText(out,end,"\x1b[%d;17fframe:%zu bytes, %u color changes, average %llu bytes per frame, "
+                             "drawn:%llu dropped:%llu backlogged:%llu ( atmost %zu bytes unflushed ) draw:%lldus",
+                     field_rows + 5,renderer.m_last_frame_bytes,renderer.m_last_frame_color_changes,
+                     (unsigned long long)average_bytes,
+                     (unsigned long long)render.m_drawn_count.load(),(unsigned long long)render.m_dropped_count.load(),
+                     (unsigned long long)render.m_backlogged_count.load(),render.m_output.m_max_unflushed_bytes,
+                     (long long)render.m_last_draw_microseconds.load());
+#endif
+
+    std::memcpy(out,renderer.m_buffer,field_size);
+    out += field_size;
+
+    return SubmitTerminalFrame(render.m_output,out - buffer);
+}
+
+// takes the newest frame and starts writing it, only called when the last one is all out.
+static void DrawFreshFrame( RenderThread& render )
+{
+    uint8_t shared = render.m_shared_index.exchange(render.m_front_index,std::memory_order_acq_rel);
+    render.m_front_index = shared & RENDER_FRAME_INDEX_MASK;
+
+    const GameFrame& frame = render.m_frames[render.m_front_index];
+    render.m_writing_sequence = frame.m_sequence;
+
+    auto start = std::chrono::steady_clock::now();
+    bool written = DrawGameFrame(render,frame);
+    int64_t microseconds = std::chrono::duration_cast<std::chrono::microseconds>(
+                               std::chrono::steady_clock::now() - start).count();
+
+    render.m_last_draw_microseconds = microseconds;
+    if( microseconds > render.m_max_draw_microseconds )
+        render.m_max_draw_microseconds = microseconds;
+
+    ++render.m_drawn_count;
+
+    if( written )
+        render.m_drawn_sequence.store(render.m_writing_sequence,std::memory_order_release);
+    else
+        ++render.m_backlogged_count;
+}
+
+static void RunRenderLoop( RenderThread& render )
+{
+    for( ;; )
+    {
+        bool is_backlogged = GetUnflushedBytes(render.m_output) != 0;
+
+        // wakes up when a frame is published or a stop is asked for, and when the terminal can take more of a
+        // frame that didn't go out at once.
+        pollfd descriptors[2] = { { render.m_event_fd, POLLIN, 0 },
+                                  { render.m_output.m_fd, short(is_backlogged ? POLLOUT : 0), 0 } };
+
+        if( poll(descriptors,is_backlogged ? 2 : 1,-1) < 0 )
+        {
+            if( errno == EINTR )
+                continue;
+
+            return;
+        }
+
+        if( descriptors[0].revents & POLLIN )
+        {
+            uint64_t signal_count;
+            if( read(render.m_event_fd,&signal_count,sizeof(signal_count)) < 0 && errno != EAGAIN )
+                continue;
+        }
+
+        if( is_backlogged && WriteTerminalOutput(render.m_output) )
+            render.m_drawn_sequence.store(render.m_writing_sequence,std::memory_order_release);
+
+        // frames published meanwhile stay in the triple buffer, the newest one is drawn once the terminal is free.
+        if( GetUnflushedBytes(render.m_output) == 0 &&
+            ( render.m_shared_index.load(std::memory_order_relaxed) & RENDER_FRAME_FRESH ) )
+            DrawFreshFrame(render);
+
+        // only after the last frame is out, so stopping never leaves an old frame on the screen.
+        if( render.m_stop.load(std::memory_order_acquire) )
+        {
+            if( !FlushTerminalOutput(render.m_output,RENDER_STOP_FLUSH_MILLISECONDS) )
+                return;
+
+            if( render.m_shared_index.load(std::memory_order_relaxed) & RENDER_FRAME_FRESH )
+            {
+                DrawFreshFrame(render);
+                FlushTerminalOutput(render.m_output,RENDER_STOP_FLUSH_MILLISECONDS);
+            }
+
+            render.m_drawn_sequence.store(render.m_writing_sequence,std::memory_order_release);
+            return;
+        }
+    }
+}
+
+// the thread stays joinable after the loop gave up on a failed poll, m_exited tells waiters nothing will be drawn
+// anymore.
+static void RunRenderThread( RenderThread& render )
+{
+    RunRenderLoop(render);
+    render.m_exited.store(true,std::memory_order_release);
+}
+
+static void SignalRenderThread( RenderThread& render )
+{
+    uint64_t one = 1;
+    if( write(render.m_event_fd,&one,sizeof(one)) < 0 )
+        return;
+}
+
+bool StartRenderThread( RenderThread& render, FrameRenderer& renderer )
+{
+    render.m_renderer = &renderer;
+
+    if( render.m_thread.joinable() )
+        return true;
+
+    OpenTerminalOutput(render.m_output);
+
+    render.m_event_fd = eventfd(0,EFD_CLOEXEC | EFD_NONBLOCK);
+    if( render.m_event_fd < 0 )
+        return false;
+
+    render.m_stop = false;
+    render.m_exited = false;
+    render.m_thread = std::thread(RunRenderThread,std::ref(render));
+
+    return true;
+}
+
+void StopRenderThread( RenderThread& render )
+{
+    if( render.m_thread.joinable() )
+    {
+        render.m_stop.store(true,std::memory_order_release);
+        SignalRenderThread(render);
+        render.m_thread.join();
+
+        close(render.m_event_fd);
+        render.m_event_fd = -1;
+    }
+
+    CloseTerminalOutput(render.m_output);
+}
+
+GameFrame& GetRenderBackFrame( RenderThread& render )
+{
+    return render.m_frames[render.m_back_index];
+}
+
+bool CaptureGameFrame( GameFrame& frame, const SnakeGameState& state )
+{
+    frame.m_arena.Reset();
+    if( !frame.m_arena.Reserve(ComputeSnakeGameMemorySize(state.m_size_x,state.m_size_y)) )
+        return false;
+
+    return CloneSnakeGameState(state,frame.m_state,frame.m_arena);
+}
+
+void PublishRenderFrame( RenderThread& render )
+{
+    GameFrame& frame = render.m_frames[render.m_back_index];
+    uint64_t sequence = render.m_published_sequence.load(std::memory_order_relaxed) + 1;
+    frame.m_sequence = sequence;
+
+    // drawn right here, waiting for the terminal like writing to std::cout would.
+    if( !render.m_thread.joinable() )
+    {
+        if( render.m_renderer && render.m_output.m_fd >= 0 )
+        {
+            DrawGameFrame(render,frame);
+            FlushTerminalOutput(render.m_output,-1);
+        }
+
+        render.m_published_sequence.store(sequence,std::memory_order_release);
+        render.m_drawn_sequence.store(sequence,std::memory_order_release);
+        return;
+    }
+
+    uint8_t shared = render.m_shared_index.exchange(render.m_back_index | RENDER_FRAME_FRESH,
+                                                    std::memory_order_acq_rel);
+    render.m_back_index = shared & RENDER_FRAME_INDEX_MASK;
+
+    // the renderer never took the frame we got back, a newer one replaced it.
+    if( shared & RENDER_FRAME_FRESH )
+        ++render.m_dropped_count;
+
+    render.m_published_sequence.store(sequence,std::memory_order_release);
+    SignalRenderThread(render);
+}
+
+void WaitForRenderThread( RenderThread& render )
+{
+    while( render.m_thread.joinable() && !render.m_exited.load(std::memory_order_acquire) &&
+           render.m_drawn_sequence.load(std::memory_order_acquire) <
+           render.m_published_sequence.load(std::memory_order_acquire) )
+        std::this_thread::sleep_for(std::chrono::microseconds(500));
+}
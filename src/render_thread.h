@@ -0,0 +1,114 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <ctime>
+#include <thread>
+
+#include "arena.h"
+#include "renderer.h"
+#include "snake_game.h"
+#include "terminal_output.h"
+
+#define RENDER_FRAME_COUNT                      3 // one being written by the game, one being drawn, one in between.
+#define RENDER_FRAME_INDEX_MASK                 3
+#define RENDER_FRAME_FRESH                      4 // set on the shared index while the frame there wasn't drawn yet.
+#define RENDER_PLAYER_NAME_LENGTH               20
+#define RENDER_DEBUG_TEXT_LENGTH                256
+#define RENDER_STATUS_TEXT_LENGTH               160
+#define RENDER_HEADER_CAPACITY                  1024 // bytes of a frame before the field: the header and debug lines.
+#define RENDER_STOP_FLUSH_MILLISECONDS          500  // how long stopping waits for a stuck terminal.
+
+// everything the screen of a game shows, as it was at one tick. the state is a clone whose field and body live in
+// m_arena, it shares the neighbor table with the game, which the renderer never looks at.
+struct GameFrame
+{
+    GameFrame() : m_sequence(0), m_start_time(0), m_difficulty{}, m_player_name{}, m_autopilot_node_count(0),
+                  m_autopilot_depth(0), m_autopilot(false), m_color_mode(RENDER_COLOR_MODE_MONOCHROME),
+                  m_theme(RENDER_THEME_FOREST), m_density(RENDER_DENSITY_NORMAL), m_status_text{}, m_debug_text{} {}
+
+    GameFrame( const GameFrame& other ) = delete;
+    GameFrame& operator=( const GameFrame& other ) = delete;
+
+    SnakeGameState m_state;
+    GameArena m_arena;
+    uint64_t m_sequence;
+    std::time_t m_start_time;
+    char m_difficulty[8];
+    char m_player_name[RENDER_PLAYER_NAME_LENGTH + 1];
+    uint64_t m_autopilot_node_count;
+    uint8_t m_autopilot_depth;
+    bool m_autopilot;
+    // how to draw it, settings.ini can change them during a game and the renderer belongs to the render thread.
+    uint8_t m_color_mode;
+    uint8_t m_theme;
+    uint8_t m_density;
+    char m_status_text[RENDER_STATUS_TEXT_LENGTH]; // drawn right under the field when it's not empty.
+    char m_debug_text[RENDER_DEBUG_TEXT_LENGTH];   // drawn under that, only filled in debug mode.
+};
+
+// draws the game on it's own thread, so a slow terminal never holds up a tick. the game and the renderer hand
+// frames to each other through a triple buffer: the game fills the back frame and swaps it with the shared one,
+// the renderer swaps the shared one with it's front frame when it's marked fresh. neither side ever waits for the
+// other, the renderer always draws the newest frame and frames the game published faster than they could be
+// drawn are dropped. the renderer sleeps in poll() on an eventfd until a frame is published.
+//
+// frames go out through a TerminalOutput. while the terminal hasn't taken all of the last frame the renderer
+// also waits for it to become writable, and leaves new frames in the triple buffer, where newer ones replace them.
+// that way a backlogged terminal costs dropped frames instead of falling behind the game.
+//
+// while the thread runs it owns the FrameRenderer, WaitForRenderThread() hands the terminal back to the caller.
+struct RenderThread
+{
+    RenderThread() : m_renderer(nullptr), m_event_fd(-1), m_back_index(0), m_front_index(1),
+                     m_writing_sequence(0), m_shared_index(2), m_stop(false), m_exited(false),
+                     m_published_sequence(0), m_drawn_sequence(0), m_drawn_count(0), m_dropped_count(0),
+                     m_backlogged_count(0), m_last_draw_microseconds(0), m_max_draw_microseconds(0) {}
+
+    RenderThread( const RenderThread& other ) = delete;
+    RenderThread& operator=( const RenderThread& other ) = delete;
+
+    FrameRenderer* m_renderer;
+    int m_event_fd;
+    std::thread m_thread;
+    GameFrame m_frames[RENDER_FRAME_COUNT];
+    uint8_t m_back_index;       // only touched by the game.
+    uint8_t m_front_index;      // only touched by the renderer.
+    TerminalOutput m_output;    // only touched by the renderer while it runs.
+    uint64_t m_writing_sequence; // the frame that is going out through m_output.
+
+    // on their own cache lines, the game writes one and the renderer the other every frame.
+    alignas(64) std::atomic<uint8_t> m_shared_index;
+    alignas(64) std::atomic<bool> m_stop;
+    std::atomic<bool> m_exited; // set by the renderer when it returns, also when it gave up on an error.
+    alignas(64) std::atomic<uint64_t> m_published_sequence;
+    alignas(64) std::atomic<uint64_t> m_drawn_sequence;
+
+    // metrics, written by the renderer ( except m_dropped_count ) and safe to read from anywhere.
+    std::atomic<uint64_t> m_drawn_count;
+    std::atomic<uint64_t> m_dropped_count;    // frames replaced by a newer one before they were drawn.
+    std::atomic<uint64_t> m_backlogged_count; // frames the terminal couldn't take all at once.
+    std::atomic<int64_t> m_last_draw_microseconds;
+    std::atomic<int64_t> m_max_draw_microseconds;
+};
+
+bool StartRenderThread( RenderThread& render, FrameRenderer& renderer );
+
+// draws whatever was published last, then stops the thread. safe to call more than once.
+void StopRenderThread( RenderThread& render );
+
+// the frame the game fills before publishing it, it belongs to the game until then.
+GameFrame& GetRenderBackFrame( RenderThread& render );
+
+// copies the game into the frame, only allocates when the board grew since the frame was last used.
+bool CaptureGameFrame( GameFrame& frame, const SnakeGameState& state );
+
+// hands the back frame to the renderer and never blocks. without a running thread the frame is drawn right away.
+void PublishRenderFrame( RenderThread& render );
+
+// waits until the last published frame is written to the terminal, after that the caller can use the terminal
+// and the FrameRenderer until it publishes again.
+void WaitForRenderThread( RenderThread& render );
+
+// builds the frame with it's header line into the output and starts writing it, true if it all went out already.
+bool DrawGameFrame( RenderThread& render, const GameFrame& frame );
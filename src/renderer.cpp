@@ -0,0 +1,456 @@
+#include "renderer.h"
+
+#include <cstring>
+#include <iostream>
+
+#include "items.h"
+
+const RenderTheme render_themes[RENDER_THEME_COUNT] =
+{
+    { "forest", { 139, 115, 85 }, { 230, 57, 70 }, { 255, 221, 87 }, { 64, 192, 87 }, { 20, 90, 50 } },
+    { "ocean", { 90, 110, 140 }, { 255, 166, 48 }, { 240, 248, 255 }, { 72, 202, 228 }, { 0, 80, 160 } },
+    { "ember", { 110, 110, 110 }, { 120, 220, 90 }, { 255, 255, 180 }, { 255, 140, 0 }, { 150, 20, 20 } },
+};
+
+const char* GetRenderDensityName( uint8_t density )
+{
+    switch( density )
+    {
+        case RENDER_DENSITY_HALF_BLOCK:
+            return "half blocks";
+
+        case RENDER_DENSITY_BRAILLE:
+            return "braille";
+    }
+
+    return "normal";
+}
+
+const char* GetRenderColorModeName( uint8_t color_mode )
+{
+    switch( color_mode )
+    {
+        case RENDER_COLOR_MODE_256:
+            return "256 colors";
+
+        case RENDER_COLOR_MODE_TRUECOLOR:
+            return "truecolor";
+    }
+
+    return "monochrome";
+}
+
+// attributes are packed into 32 bits so comparing them is cheap, 0 is the terminal's default color.
+#define ATTRIBUTE_DEFAULT                       0
+#define ATTRIBUTE_TRUECOLOR                     0x01000000
+#define ATTRIBUTE_256                           0x02000000
+
+static uint32_t MakeAttribute( uint8_t color_mode, RenderColor color )
+{
+    if( color_mode == RENDER_COLOR_MODE_TRUECOLOR )
+        return ATTRIBUTE_TRUECOLOR | ( uint32_t(color.m_red) << 16 ) | ( uint32_t(color.m_green) << 8 ) | color.m_blue;
+
+    if( color_mode == RENDER_COLOR_MODE_256 )
+    {
+        // nearest entry of the 6x6x6 color cube of xterm's palette.
+        uint32_t red = ( color.m_red * 5 + 127 ) / 255;
+        uint32_t green = ( color.m_green * 5 + 127 ) / 255;
+        uint32_t blue = ( color.m_blue * 5 + 127 ) / 255;
+
+        return ATTRIBUTE_256 | ( 16 + red * 36 + green * 6 + blue );
+    }
+
+    return ATTRIBUTE_DEFAULT;
+}
+
+static RenderColor BlendColor( RenderColor from, RenderColor to, uint32_t step, uint32_t step_count )
+{
+    int32_t numerator = int32_t(step), denominator = int32_t(step_count);
+
+    RenderColor color;
+    color.m_red = uint8_t(from.m_red + ( int32_t(to.m_red) - from.m_red ) * numerator / denominator);
+    color.m_green = uint8_t(from.m_green + ( int32_t(to.m_green) - from.m_green ) * numerator / denominator);
+    color.m_blue = uint8_t(from.m_blue + ( int32_t(to.m_blue) - from.m_blue ) * numerator / denominator);
+
+    return color;
+}
+
+static char* AppendNumber( char* out, uint32_t value )
+{
+    char digits[10];
+    int count = 0;
+
+    do
+    {
+        digits[count++] = char('0' + value % 10);
+        value /= 10;
+    } while( value );
+
+    while( count )
+        *out++ = digits[--count];
+
+    return out;
+}
+
+static char* AppendString( char* out, const char* text )
+{
+    while( *text )
+        *out++ = *text++;
+
+    return out;
+}
+
+static char* AppendAttribute( char* out, uint32_t attribute )
+{
+    if( attribute == ATTRIBUTE_DEFAULT )
+        return AppendString(out,"\x1b[0m");
+
+    if( attribute & ATTRIBUTE_TRUECOLOR )
+    {
+        out = AppendString(out,"\x1b[38;2;");
+        out = AppendNumber(out,( attribute >> 16 ) & 0xff);
+        *out++ = ';';
+        out = AppendNumber(out,( attribute >> 8 ) & 0xff);
+        *out++ = ';';
+        out = AppendNumber(out,attribute & 0xff);
+    }
+
+    else
+    {
+        out = AppendString(out,"\x1b[38;5;");
+        out = AppendNumber(out,attribute & 0xff);
+    }
+
+    *out++ = 'm';
+
+    return out;
+}
+
+// a paint says how a cell is drawn: 0 is empty, then wall, the body gradient bands, food and head. when several
+// cells share one character the highest paint decides the color.
+#define PAINT_EMPTY                             0
+#define PAINT_WALL                              1
+#define PAINT_BODY                              2
+#define PAINT_FOOD                              ( PAINT_BODY + RENDER_BODY_GRADIENT_STEPS )
+#define PAINT_HEAD                              ( PAINT_FOOD + 1 )
+#define PAINT_COUNT                             ( PAINT_HEAD + 1 )
+
+struct FramePalette
+{
+    uint8_t m_cell_paints[256];         // indexed by the field character.
+    uint32_t m_attributes[PAINT_COUNT];
+    uint8_t m_band_mask;                // 0xff when body bands are filled in, 0 when they are not needed.
+};
+
+struct Glyph
+{
+    char m_bytes[3];
+    uint8_t m_size;
+};
+
+// indexed by ( top occupied ) | ( bottom occupied << 1 ).
+static const Glyph half_block_glyphs[4] =
+{
+    { { ' ' }, 1 },
+    { { '\xe2', '\x96', '\x80' }, 3 }, // upper half block
+    { { '\xe2', '\x96', '\x84' }, 3 }, // lower half block
+    { { '\xe2', '\x96', '\x88' }, 3 }, // full block
+};
+
+// braille patterns start at U+2800 and the low 8 bits are the dots, so every pattern is E2 A0|(bits>>6) 80|(bits&3f).
+struct BrailleGlyphTable
+{
+    BrailleGlyphTable()
+    {
+        for( int bits = 0; bits < 256; ++bits )
+        {
+            m_glyphs[bits].m_bytes[0] = '\xe2';
+            m_glyphs[bits].m_bytes[1] = char(0xa0 | ( bits >> 6 ));
+            m_glyphs[bits].m_bytes[2] = char(0x80 | ( bits & 0x3f ));
+            m_glyphs[bits].m_size = 3;
+        }
+
+        // an empty pattern is drawn as a plain space, it's shorter and doesn't need a color.
+        m_glyphs[0] = { { ' ' }, 1 };
+    }
+
+    Glyph m_glyphs[256];
+};
+
+static const BrailleGlyphTable braille_glyphs;
+
+// dot bit of each cell of a 2x4 braille character, indexed by [row][column].
+static const uint8_t braille_dots[4][2] =
+{
+    { 0x01, 0x08 },
+    { 0x02, 0x10 },
+    { 0x04, 0x20 },
+    { 0x40, 0x80 },
+};
+
+static bool PrepareFrameRenderer( FrameRenderer& renderer, const SnakeGameState& state )
+{
+    uint32_t cell_count = state.CellCount();
+    if( renderer.m_buffer && renderer.m_cell_count == cell_count )
+        return true;
+
+    // worst case is a full truecolor sequence before every cell, plus a cursor move for every row.
+    std::size_t buffer_capacity = std::size_t(cell_count) * 20 + std::size_t(state.m_size_y) * 16 + 16;
+
+    renderer.m_arena.Reset();
+    if( !renderer.m_arena.Reserve(ArenaFootprint<char>(buffer_capacity) + ArenaFootprint<uint8_t>(cell_count)) )
+        return false;
+
+    renderer.m_buffer = renderer.m_arena.AllocateArray<char>(buffer_capacity);
+    renderer.m_body_band = renderer.m_arena.AllocateArray<uint8_t>(cell_count);
+    renderer.m_buffer_capacity = buffer_capacity;
+    renderer.m_cell_count = cell_count;
+
+    return true;
+}
+
+void GetRenderDensityCellSize( uint8_t density, uint8_t& cells_x, uint8_t& cells_y )
+{
+    cells_x = 1;
+    cells_y = 1;
+
+    if( density == RENDER_DENSITY_HALF_BLOCK )
+        cells_y = 2;
+
+    else if( density == RENDER_DENSITY_BRAILLE )
+    {
+        cells_x = 2;
+        cells_y = 4;
+    }
+}
+
+void GetRenderedFieldSize( const FrameRenderer& renderer, const SnakeGameState& state, uint16_t& columns,
+                           uint16_t& rows )
+{
+    uint8_t cells_x, cells_y;
+    GetRenderDensityCellSize(renderer.m_density,cells_x,cells_y);
+
+    columns = uint16_t(( state.m_size_x + cells_x - 1 ) / cells_x);
+    rows = uint16_t(( state.m_size_y + cells_y - 1 ) / cells_y);
+}
+
+static void BuildFramePalette( FrameRenderer& renderer, const SnakeGameState& state, FramePalette& palette )
+{
+    const RenderTheme& theme = render_themes[renderer.m_theme < RENDER_THEME_COUNT ? renderer.m_theme : 0];
+    uint8_t color_mode = renderer.m_color_mode;
+
+    std::memset(palette.m_cell_paints,PAINT_EMPTY,sizeof(palette.m_cell_paints));
+    palette.m_cell_paints[uint8_t(SNAKE_CELL_WALL)] = PAINT_WALL;
+    palette.m_cell_paints[uint8_t(SNAKE_CELL_BODY)] = PAINT_BODY;
+    palette.m_cell_paints[uint8_t(SNAKE_CELL_FOOD)] = PAINT_FOOD;
+    palette.m_cell_paints[uint8_t(SNAKE_CELL_HEAD)] = PAINT_HEAD;
+
+    // items keep their own characters in normal density, in the packed ones and in color they look like food.
+    for( uint8_t kind = 0; kind < ITEM_KIND_COUNT; ++kind )
+        palette.m_cell_paints[uint8_t(GetItemCellValue(kind))] = PAINT_FOOD;
+
+    palette.m_attributes[PAINT_EMPTY] = ATTRIBUTE_DEFAULT;
+    palette.m_attributes[PAINT_WALL] = MakeAttribute(color_mode,theme.m_wall);
+    palette.m_attributes[PAINT_FOOD] = MakeAttribute(color_mode,theme.m_food);
+    palette.m_attributes[PAINT_HEAD] = MakeAttribute(color_mode,theme.m_head);
+
+    for( uint32_t band = 0; band < RENDER_BODY_GRADIENT_STEPS; ++band )
+        palette.m_attributes[PAINT_BODY + band] = MakeAttribute(color_mode,BlendColor(theme.m_body_start,
+                                                                theme.m_body_end,band,RENDER_BODY_GRADIENT_STEPS - 1));
+
+    palette.m_band_mask = 0;
+
+    if( color_mode != RENDER_COLOR_MODE_MONOCHROME )
+    {
+        palette.m_band_mask = 0xff;
+
+        for( uint32_t i = 1; i < state.m_length; ++i )
+            renderer.m_body_band[state.BodyCell(i)] = uint8_t(( i - 1 ) * RENDER_BODY_GRADIENT_STEPS / state.m_length);
+    }
+}
+
+// the band is only meaningful on body cells, on every other cell it is masked away instead of branched around.
+static uint8_t GetCellPaint( const FrameRenderer& renderer, const FramePalette& palette, const SnakeGameState& state,
+                             uint32_t cell )
+{
+    char value = state.m_field[cell];
+    uint8_t band = renderer.m_body_band[cell] & palette.m_band_mask & -uint8_t(value == SNAKE_CELL_BODY);
+
+    return palette.m_cell_paints[uint8_t(value)] + band;
+}
+
+static char* AppendCursorPosition( char* out, uint32_t x, uint32_t y )
+{
+    *out++ = '\x1b';
+    *out++ = '[';
+    out = AppendNumber(out,y);
+    *out++ = ';';
+    out = AppendNumber(out,x);
+    *out++ = 'f';
+
+    return out;
+}
+
+struct FrameWriter
+{
+    char* m_out;
+    uint32_t m_current_attribute;
+    uint32_t m_color_changes;
+    bool m_colored;
+};
+
+// empty characters keep whatever color is current, only drawn ones may need to switch it.
+static void WriteGlyph( FrameWriter& writer, const FramePalette& palette, const Glyph& glyph, uint8_t paint )
+{
+    if( writer.m_colored && paint != PAINT_EMPTY && palette.m_attributes[paint] != writer.m_current_attribute )
+    {
+        writer.m_current_attribute = palette.m_attributes[paint];
+        writer.m_out = AppendAttribute(writer.m_out,writer.m_current_attribute);
+        ++writer.m_color_changes;
+    }
+
+    writer.m_out[0] = glyph.m_bytes[0];
+    writer.m_out[1] = glyph.m_bytes[1];
+    writer.m_out[2] = glyph.m_bytes[2];
+    writer.m_out += glyph.m_size;
+}
+
+static void RenderCells( FrameRenderer& renderer, const FramePalette& palette, const SnakeGameState& state,
+                         FrameWriter& writer, uint16_t origin_x, uint16_t origin_y )
+{
+    Glyph glyph = { { 0 }, 1 };
+
+    for( uint16_t y = 0; y < state.m_size_y; ++y )
+    {
+        writer.m_out = AppendCursorPosition(writer.m_out,origin_x,origin_y + y);
+
+        uint32_t row_cell = uint32_t(y) * state.m_size_x;
+        for( uint16_t x = 0; x < state.m_size_x; ++x )
+        {
+            glyph.m_bytes[0] = state.m_field[row_cell + x];
+            WriteGlyph(writer,palette,glyph,GetCellPaint(renderer,palette,state,row_cell + x));
+        }
+    }
+}
+
+static void RenderHalfBlocks( FrameRenderer& renderer, const FramePalette& palette, const SnakeGameState& state,
+                              FrameWriter& writer, uint16_t origin_x, uint16_t origin_y )
+{
+    for( uint16_t y = 0; y < state.m_size_y; y += 2 )
+    {
+        writer.m_out = AppendCursorPosition(writer.m_out,origin_x,origin_y + y / 2);
+
+        uint32_t top_row = uint32_t(y) * state.m_size_x;
+        // on an odd height the last character row only has a top half, the bottom is read from the top again
+        // and masked out.
+        bool has_bottom = y + 1 < state.m_size_y;
+        uint32_t bottom_row = has_bottom ? top_row + state.m_size_x : top_row;
+        uint8_t bottom_mask = has_bottom ? 0xff : 0;
+
+        for( uint16_t x = 0; x < state.m_size_x; ++x )
+        {
+            uint8_t top = GetCellPaint(renderer,palette,state,top_row + x);
+            uint8_t bottom = GetCellPaint(renderer,palette,state,bottom_row + x) & bottom_mask;
+
+            uint8_t shape = uint8_t(top != PAINT_EMPTY) | uint8_t(( bottom != PAINT_EMPTY ) << 1);
+            WriteGlyph(writer,palette,half_block_glyphs[shape],top > bottom ? top : bottom);
+        }
+    }
+}
+
+static void RenderBraille( FrameRenderer& renderer, const FramePalette& palette, const SnakeGameState& state,
+                           FrameWriter& writer, uint16_t origin_x, uint16_t origin_y )
+{
+    for( uint16_t y = 0; y < state.m_size_y; y += 4 )
+    {
+        writer.m_out = AppendCursorPosition(writer.m_out,origin_x,origin_y + y / 4);
+
+        // rows past the bottom of the field are read from the first row of the block and masked out.
+        uint32_t rows[4];
+        uint8_t row_masks[4];
+        for( int row = 0; row < 4; ++row )
+        {
+            bool inside = y + row < state.m_size_y;
+            rows[row] = uint32_t(inside ? y + row : y) * state.m_size_x;
+            row_masks[row] = inside ? 0xff : 0;
+        }
+
+        for( uint16_t x = 0; x < state.m_size_x; x += 2 )
+        {
+            bool has_right = x + 1 < state.m_size_x;
+            uint16_t right = has_right ? x + 1 : x;
+            uint8_t right_mask = has_right ? 0xff : 0;
+
+            uint8_t dots = 0;
+            uint8_t paint = PAINT_EMPTY;
+
+            for( int row = 0; row < 4; ++row )
+            {
+                uint8_t left_paint = GetCellPaint(renderer,palette,state,rows[row] + x) & row_masks[row];
+                uint8_t right_paint = GetCellPaint(renderer,palette,state,rows[row] + right) & row_masks[row] &
+                                      right_mask;
+
+                dots |= braille_dots[row][0] & -uint8_t(left_paint != PAINT_EMPTY);
+                dots |= braille_dots[row][1] & -uint8_t(right_paint != PAINT_EMPTY);
+                paint = left_paint > paint ? left_paint : paint;
+                paint = right_paint > paint ? right_paint : paint;
+            }
+
+            WriteGlyph(writer,palette,braille_glyphs.m_glyphs[dots],paint);
+        }
+    }
+}
+
+std::size_t BuildSnakeFieldFrame( FrameRenderer& renderer, const SnakeGameState& state, uint16_t origin_x,
+                                  uint16_t origin_y )
+{
+    if( !state.m_field || !PrepareFrameRenderer(renderer,state) )
+        return 0;
+
+    FramePalette palette;
+    BuildFramePalette(renderer,state,palette);
+
+    FrameWriter writer;
+    writer.m_out = renderer.m_buffer;
+    writer.m_current_attribute = ATTRIBUTE_DEFAULT;
+    writer.m_color_changes = 0;
+    writer.m_colored = renderer.m_color_mode != RENDER_COLOR_MODE_MONOCHROME;
+
+    switch( renderer.m_density )
+    {
+        case RENDER_DENSITY_HALF_BLOCK:
+            RenderHalfBlocks(renderer,palette,state,writer,origin_x,origin_y);
+        break;
+
+        case RENDER_DENSITY_BRAILLE:
+            RenderBraille(renderer,palette,state,writer,origin_x,origin_y);
+        break;
+
+        default:
+            RenderCells(renderer,palette,state,writer,origin_x,origin_y);
+        break;
+    }
+
+    // so whatever is printed after the field is not colored.
+    if( writer.m_current_attribute != ATTRIBUTE_DEFAULT )
+        writer.m_out = AppendAttribute(writer.m_out,ATTRIBUTE_DEFAULT);
+
+    char* out = writer.m_out;
+    uint32_t color_changes = writer.m_color_changes;
+
+    renderer.m_size = out - renderer.m_buffer;
+    renderer.m_last_frame_bytes = renderer.m_size;
+    renderer.m_last_frame_color_changes = color_changes;
+    renderer.m_total_bytes += renderer.m_size;
+    ++renderer.m_frame_count;
+
+    return renderer.m_size;
+}
+
+void RenderSnakeField( FrameRenderer& renderer, const SnakeGameState& state, uint16_t origin_x, uint16_t origin_y )
+{
+    std::size_t size = BuildSnakeFieldFrame(renderer,state,origin_x,origin_y);
+
+    std::cout.write(renderer.m_buffer,size);
+    std::cout << std::flush;
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "arena.h"
+#include "snake_game.h"
+
+#define RENDER_COLOR_MODE_MONOCHROME            0
+#define RENDER_COLOR_MODE_256                   1
+#define RENDER_COLOR_MODE_TRUECOLOR             2
+#define RENDER_COLOR_MODE_COUNT                 3
+
+#define RENDER_THEME_FOREST                     0
+#define RENDER_THEME_OCEAN                      1
+#define RENDER_THEME_EMBER                      2
+#define RENDER_THEME_COUNT                      3
+
+// how many cells of the field end up in one character of the terminal.
+#define RENDER_DENSITY_NORMAL                   0 // 1 cell per character, drawn with the field characters.
+#define RENDER_DENSITY_HALF_BLOCK               1 // 1x2 cells per character, drawn with half block glyphs.
+#define RENDER_DENSITY_BRAILLE                  2 // 2x4 cells per character, drawn with braille patterns.
+#define RENDER_DENSITY_COUNT                    3
+
+// the body gradient is split into this many bands, so neighbouring parts share a color and the run stays unbroken.
+#define RENDER_BODY_GRADIENT_STEPS              8
+
+struct RenderColor
+{
+    uint8_t m_red;
+    uint8_t m_green;
+    uint8_t m_blue;
+};
+
+struct RenderTheme
+{
+    const char* m_name;
+    RenderColor m_wall;
+    RenderColor m_food;
+    RenderColor m_head;
+    RenderColor m_body_start; // right behind the head.
+    RenderColor m_body_end;   // at the tail.
+};
+
+extern const RenderTheme render_themes[RENDER_THEME_COUNT];
+
+const char* GetRenderColorModeName( uint8_t color_mode );
+const char* GetRenderDensityName( uint8_t density );
+
+// how many cells of the field one character holds in the given density.
+void GetRenderDensityCellSize( uint8_t density, uint8_t& cells_x, uint8_t& cells_y );
+
+// builds a whole frame of the field into one buffer and writes it with a single call. color changes are only
+// emitted when the color actually changes along the output, and empty cells never change it since a space looks
+// the same in any foreground color, so a colored frame is only a little bigger than a monochrome one.
+// in the packed densities a character takes the color of the most important cell in it ( head, food, body, wall ).
+struct FrameRenderer
+{
+    FrameRenderer() : m_color_mode(RENDER_COLOR_MODE_MONOCHROME), m_theme(RENDER_THEME_FOREST),
+                      m_density(RENDER_DENSITY_NORMAL), m_buffer(nullptr),
+                      m_buffer_capacity(0), m_size(0), m_body_band(nullptr), m_cell_count(0),
+                      m_last_frame_bytes(0), m_last_frame_color_changes(0), m_frame_count(0), m_total_bytes(0) {}
+
+    uint8_t m_color_mode;
+    uint8_t m_theme;
+    uint8_t m_density;
+
+    char* m_buffer;
+    std::size_t m_buffer_capacity;
+    std::size_t m_size;
+    uint8_t* m_body_band;     // gradient band of every body part, indexed by cell.
+    uint32_t m_cell_count;
+    GameArena m_arena;
+
+    // bytes per frame counters, so the cost of colors can be checked against monochrome.
+    std::size_t m_last_frame_bytes;
+    uint32_t m_last_frame_color_changes;
+    uint64_t m_frame_count;
+    uint64_t m_total_bytes;
+};
+
+// size of the field on the terminal in characters for the current density.
+void GetRenderedFieldSize( const FrameRenderer& renderer, const SnakeGameState& state, uint16_t& columns,
+                           uint16_t& rows );
+
+// builds the field of state with it's top left corner at the given console position ( 1 based like the
+// escape sequences ) into m_buffer, returns it's size or 0 if there is nothing to draw.
+std::size_t BuildSnakeFieldFrame( FrameRenderer& renderer, const SnakeGameState& state, uint16_t origin_x,
+                                  uint16_t origin_y );
+
+// builds the field like BuildSnakeFieldFrame() and writes it to STDOUT.
+void RenderSnakeField( FrameRenderer& renderer, const SnakeGameState& state, uint16_t origin_x, uint16_t origin_y );
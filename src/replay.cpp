@@ -0,0 +1,417 @@
+#include "replay.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <thread>
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+
+// entries a thread takes from the shared counter at once, so threads don't keep fighting over it's line.
+#define REPLAY_VERIFY_BATCH                     16
+#define REPLAY_MAX_VARINT_SIZE                  5
+
+static void PutU16( uint8_t* out, uint16_t value )
+{
+    out[0] = uint8_t(value);
+    out[1] = uint8_t(value >> 8);
+}
+
+static void PutU32( uint8_t* out, uint32_t value )
+{
+    for( int i = 0; i < 4; ++i )
+        out[i] = uint8_t(value >> ( i * 8 ));
+}
+
+static void PutU64( uint8_t* out, uint64_t value )
+{
+    for( int i = 0; i < 8; ++i )
+        out[i] = uint8_t(value >> ( i * 8 ));
+}
+
+static uint16_t GetU16( const uint8_t* in )
+{
+    return uint16_t(in[0] | ( in[1] << 8 ));
+}
+
+static uint32_t GetU32( const uint8_t* in )
+{
+    uint32_t value = 0;
+    for( int i = 3; i >= 0; --i )
+        value = ( value << 8 ) | in[i];
+
+    return value;
+}
+
+static uint64_t GetU64( const uint8_t* in )
+{
+    uint64_t value = 0;
+    for( int i = 7; i >= 0; --i )
+        value = ( value << 8 ) | in[i];
+
+    return value;
+}
+
+static uint64_t HashReplayBytes( const uint8_t* data, std::size_t size )
+{
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for( std::size_t i = 0; i < size; ++i )
+    {
+        hash ^= data[i];
+        hash *= 0x100000001b3ULL;
+    }
+
+    // 0 is what AppendReplay() returns when it fails, and what the scores file writes without a replay.
+    return hash ? hash : 1;
+}
+
+static bool WriteAll( int fd, const uint8_t* data, std::size_t size )
+{
+    while( size )
+    {
+        ssize_t result = write(fd,data,size);
+        if( result < 0 && errno == EINTR )
+            continue;
+
+        if( result <= 0 )
+            return false;
+
+        data += result;
+        size -= result;
+    }
+
+    return true;
+}
+
+static void FlushReplayRun( ReplayRecorder& recorder )
+{
+    if( !recorder.m_run_length )
+        return;
+
+    uint32_t value = ( ( recorder.m_run_length - 1 ) << 2 ) | uint32_t(recorder.m_run_direction - SNAKE_DIRECTION_UP);
+    do
+    {
+        uint8_t byte = uint8_t(value & 0x7f);
+        value >>= 7;
+        recorder.m_replay.m_inputs.push_back(value ? byte | 0x80 : byte);
+    } while( value );
+
+    recorder.m_run_length = 0;
+}
+
+// false at the end of the inputs or on a varint that is cut off or too long.
+static bool ReadReplayRun( const uint8_t*& input, const uint8_t* end, uint32_t& ticks, uint8_t& direction )
+{
+    uint32_t value = 0;
+    for( int shift = 0; shift < REPLAY_MAX_VARINT_SIZE * 7; shift += 7 )
+    {
+        if( input == end )
+            return false;
+
+        uint8_t byte = *input++;
+        value |= uint32_t(byte & 0x7f) << shift;
+
+        if( !( byte & 0x80 ) )
+        {
+            ticks = ( value >> 2 ) + 1;
+            direction = uint8_t(( value & 3 ) + SNAKE_DIRECTION_UP);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void BeginReplay( ReplayRecorder& recorder, const SnakeGameState& state, uint64_t random_state, uint32_t item_count )
+{
+    GameReplay& replay = recorder.m_replay;
+    replay.m_random_state = random_state;
+    replay.m_ticks = 0;
+    replay.m_score = 0;
+    replay.m_item_count = item_count;
+    replay.m_size_x = state.m_size_x;
+    replay.m_size_y = state.m_size_y;
+    replay.m_rules = state.m_rules;
+    std::memset(replay.m_player_name,0,sizeof(replay.m_player_name));
+    replay.m_inputs.clear();
+
+    recorder.m_run_direction = SNAKE_DIRECTION_NONE;
+    recorder.m_run_length = 0;
+    recorder.m_active = true;
+}
+
+void CancelReplay( ReplayRecorder& recorder )
+{
+    recorder.m_active = false;
+    recorder.m_run_length = 0;
+    recorder.m_replay.m_inputs.clear();
+}
+
+void RecordReplayTick( ReplayRecorder& recorder, uint8_t direction )
+{
+    if( !recorder.m_active )
+        return;
+
+    // a run is flushed before it's length would overflow the varint.
+    if( direction != recorder.m_run_direction || recorder.m_run_length == ( UINT32_MAX >> 2 ) + 1 )
+    {
+        FlushReplayRun(recorder);
+        recorder.m_run_direction = direction;
+    }
+
+    ++recorder.m_run_length;
+    ++recorder.m_replay.m_ticks;
+}
+
+bool FinishReplay( ReplayRecorder& recorder, const char* player_name, int32_t score )
+{
+    if( !recorder.m_active )
+        return false;
+
+    FlushReplayRun(recorder);
+    recorder.m_active = false;
+
+    GameReplay& replay = recorder.m_replay;
+    replay.m_score = score;
+    std::memset(replay.m_player_name,0,sizeof(replay.m_player_name));
+    std::strncpy(replay.m_player_name,player_name,REPLAY_PLAYER_NAME_LENGTH);
+
+    return true;
+}
+
+uint64_t AppendReplay( const char* path, const GameReplay& replay )
+{
+    std::size_t size = REPLAY_RECORD_HEADER_SIZE + replay.m_inputs.size() + sizeof(uint64_t);
+    if( size > REPLAY_MAX_RECORD_SIZE )
+        return 0;
+
+    int fd = open(path,O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC,0644);
+    if( fd < 0 )
+        return 0;
+
+    struct stat file_stat;
+    if( fstat(fd,&file_stat) != 0 )
+    {
+        close(fd);
+        return 0;
+    }
+
+    // the header only goes in front of the first record, so the record still goes out with a single write.
+    std::size_t header_size = file_stat.st_size == 0 ? REPLAY_LOG_HEADER_SIZE : 0;
+    std::vector<uint8_t> bytes(header_size + size,0);
+
+    if( header_size )
+    {
+        PutU32(bytes.data(),REPLAY_LOG_MAGIC);
+        PutU16(bytes.data() + 4,REPLAY_LOG_VERSION);
+    }
+
+    uint8_t* record = bytes.data() + header_size;
+    PutU32(record,uint32_t(size));
+    PutU64(record + 4,replay.m_random_state);
+    PutU32(record + 12,replay.m_ticks);
+    PutU32(record + 16,uint32_t(replay.m_score));
+    PutU32(record + 20,uint32_t(replay.m_inputs.size()));
+    PutU32(record + 24,replay.m_item_count);
+    PutU16(record + 28,replay.m_size_x);
+    PutU16(record + 30,replay.m_size_y);
+    record[32] = replay.m_rules;
+    std::memcpy(record + 36,replay.m_player_name,REPLAY_PLAYER_NAME_LENGTH);
+
+    if( !replay.m_inputs.empty() )
+        std::memcpy(record + REPLAY_RECORD_HEADER_SIZE,replay.m_inputs.data(),replay.m_inputs.size());
+
+    uint64_t id = HashReplayBytes(record,size - sizeof(uint64_t));
+    PutU64(record + size - sizeof(uint64_t),id);
+
+    bool written = WriteAll(fd,bytes.data(),bytes.size());
+    close(fd);
+
+    return written ? id : 0;
+}
+
+bool IndexReplayLog( const uint8_t* data, std::size_t size, std::vector<ReplayLogEntry>& entries,
+                     uint64_t& corrupt_count )
+{
+    entries.clear();
+    corrupt_count = 0;
+
+    if( size < REPLAY_LOG_HEADER_SIZE || GetU32(data) != REPLAY_LOG_MAGIC || GetU16(data + 4) != REPLAY_LOG_VERSION )
+        return false;
+
+    std::size_t offset = REPLAY_LOG_HEADER_SIZE;
+    while( size - offset >= REPLAY_RECORD_HEADER_SIZE + sizeof(uint64_t) )
+    {
+        uint32_t record_size = GetU32(data + offset);
+
+        // a size that can't be right leaves nothing to find the next record by.
+        if( record_size < REPLAY_RECORD_HEADER_SIZE + sizeof(uint64_t) || record_size > REPLAY_MAX_RECORD_SIZE )
+        {
+            ++corrupt_count;
+            break;
+        }
+
+        if( record_size > size - offset )
+            break;
+
+        const uint8_t* record = data + offset;
+        uint64_t id = GetU64(record + record_size - sizeof(uint64_t));
+
+        if( id == HashReplayBytes(record,record_size - sizeof(uint64_t)) &&
+            GetU32(record + 20) == record_size - REPLAY_RECORD_HEADER_SIZE - sizeof(uint64_t) )
+        {
+            ReplayLogEntry entry;
+            entry.m_id = id;
+            entry.m_offset = offset;
+            entry.m_size = record_size;
+            entries.push_back(entry);
+        }
+
+        else
+            ++corrupt_count;
+
+        offset += record_size;
+    }
+
+    std::sort(entries.begin(),entries.end(),[]( const ReplayLogEntry& a, const ReplayLogEntry& b )
+    {
+        return a.m_id < b.m_id;
+    });
+
+    return true;
+}
+
+// everything but the inputs, which stay where they are.
+static bool DecodeReplayHeader( const uint8_t* record, std::size_t size, GameReplay& replay )
+{
+    if( size < REPLAY_RECORD_HEADER_SIZE + sizeof(uint64_t) || GetU32(record) != size ||
+        GetU32(record + 20) != size - REPLAY_RECORD_HEADER_SIZE - sizeof(uint64_t) )
+        return false;
+
+    replay.m_random_state = GetU64(record + 4);
+    replay.m_ticks = GetU32(record + 12);
+    replay.m_score = int32_t(GetU32(record + 16));
+    replay.m_item_count = GetU32(record + 24);
+    replay.m_size_x = GetU16(record + 28);
+    replay.m_size_y = GetU16(record + 30);
+    replay.m_rules = record[32];
+    std::memset(replay.m_player_name,0,sizeof(replay.m_player_name));
+    std::memcpy(replay.m_player_name,record + 36,REPLAY_PLAYER_NAME_LENGTH);
+
+    return true;
+}
+
+bool DecodeReplay( const uint8_t* record, std::size_t size, GameReplay& replay )
+{
+    if( !DecodeReplayHeader(record,size,replay) )
+        return false;
+
+    replay.m_inputs.assign(record + REPLAY_RECORD_HEADER_SIZE,record + size - sizeof(uint64_t));
+
+    return true;
+}
+
+bool VerifyReplayRecord( ReplaySimulation& simulation, const uint8_t* record, std::size_t size )
+{
+    GameReplay replay;
+    if( !DecodeReplayHeader(record,size,replay) )
+        return false;
+
+    if( replay.m_size_x < SNAKE_GAME_MIN_SIZE || replay.m_size_y < SNAKE_GAME_MIN_SIZE ||
+        replay.m_size_x > SNAKE_GAME_MAX_SIZE || replay.m_size_y > SNAKE_GAME_MAX_SIZE ||
+        ( replay.m_rules & ~SNAKE_RULE_ALL ) || replay.m_item_count > ITEM_MAX_COUNT )
+        return false;
+
+    SnakeGameState& state = simulation.m_state;
+    simulation.m_arena.Reset();
+    if( !simulation.m_arena.Reserve(ComputeSnakeGameMemorySize(replay.m_size_x,replay.m_size_y)) ||
+        !InitializeSnakeGameState(state,simulation.m_arena,replay.m_size_x,replay.m_size_y,1,replay.m_rules) )
+        return false;
+
+    // the seed only went into the random state, the one the game really started from replaces it.
+    state.m_random_state = replay.m_random_state;
+    StartSnakeGameState(state);
+
+    // the capacity the game got is never more than it's board allows, so asking for it again gives it back.
+    uint32_t capacity = ComputeItemCapacity(state,replay.m_item_count);
+    if( capacity != replay.m_item_count ||
+        !InitializeItemField(simulation.m_items,simulation.m_item_arena,state,capacity) )
+        return false;
+
+    const uint8_t* input = record + REPLAY_RECORD_HEADER_SIZE;
+    const uint8_t* end = record + size - sizeof(uint64_t);
+    uint64_t ticks = 0;
+
+    while( input != end )
+    {
+        uint32_t run_ticks;
+        uint8_t direction;
+        if( !ReadReplayRun(input,end,run_ticks,direction) || ticks + run_ticks > replay.m_ticks )
+            return false;
+
+        for( uint32_t i = 0; i < run_ticks; ++i )
+        {
+            // a recording that goes on after the game ended wasn't played.
+            if( state.m_status != GAME_STATUS_ONGOING )
+                return false;
+
+            int32_t score = state.m_score;
+            StepSnakeGame(state,direction);
+            UpdateItemField(simulation.m_items,state,score);
+
+            // every step ends up moving the way it was recorded, or the recording was made up.
+            if( state.m_direction != direction )
+                return false;
+        }
+
+        ticks += run_ticks;
+    }
+
+    return ticks == replay.m_ticks && state.m_score == replay.m_score &&
+           ( state.m_status == GAME_STATUS_WON || state.m_status == GAME_STATUS_LOST );
+}
+
+static void RunReplayVerifier( const uint8_t* data, const std::vector<ReplayLogEntry>& entries,
+                               std::atomic<std::size_t>& next_entry, std::vector<uint8_t>& verified )
+{
+    ReplaySimulation simulation;
+
+    for( ;; )
+    {
+        std::size_t first = next_entry.fetch_add(REPLAY_VERIFY_BATCH,std::memory_order_relaxed);
+        if( first >= entries.size() )
+            return;
+
+        std::size_t last = std::min(first + REPLAY_VERIFY_BATCH,entries.size());
+        for( std::size_t i = first; i < last; ++i )
+            verified[i] = VerifyReplayRecord(simulation,data + entries[i].m_offset,entries[i].m_size) ? 1 : 0;
+    }
+}
+
+void VerifyReplayLog( const uint8_t* data, const std::vector<ReplayLogEntry>& entries, uint32_t thread_count,
+                      std::vector<uint8_t>& verified )
+{
+    verified.assign(entries.size(),0);
+
+    if( thread_count == 0 )
+        thread_count = std::max(1u,std::thread::hardware_concurrency());
+
+    std::size_t batch_count = ( entries.size() + REPLAY_VERIFY_BATCH - 1 ) / REPLAY_VERIFY_BATCH;
+    if( thread_count > batch_count )
+        thread_count = uint32_t(std::max<std::size_t>(batch_count,1));
+
+    std::atomic<std::size_t> next_entry(0);
+
+    // the calling thread is one of the workers.
+    std::vector<std::thread> threads;
+    for( uint32_t i = 1; i < thread_count; ++i )
+        threads.emplace_back(RunReplayVerifier,data,std::cref(entries),std::ref(next_entry),std::ref(verified));
+
+    RunReplayVerifier(data,entries,next_entry,verified);
+
+    for( std::thread& thread : threads )
+        thread.join();
+}
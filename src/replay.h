@@ -0,0 +1,120 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "arena.h"
+#include "snake_game.h"
+#include "items.h"
+
+// every game that submits a score is appended to the replay log, with what it takes to play it again: the random
+// state it started from, it's board and rules and the direction the snake moved in at every tick. the scores
+// file names the replay of each score by it's id, so "snake --verify-scores" can play the games again and throw
+// out the scores that weren't played. all numbers are little endian:
+//
+//   header ( REPLAY_LOG_HEADER_SIZE bytes )
+//    0 magic               u32
+//    4 version             u16
+//    6 reserved            10 bytes
+//
+//   records, one after the other
+//    0 record size         u32   all of the record, the id included
+//    4 random state        u64   of the game right before StartSnakeGameState()
+//   12 ticks               u32
+//   16 score               i32
+//   20 input size          u32
+//   24 item count          u32   the capacity of the item field, 0 without items
+//   28 size x              u16
+//   30 size y              u16
+//   32 rules               u8    SNAKE_RULE_* mask
+//   33 reserved            3 bytes
+//   36 player name         21 bytes, zero padded
+//   57 reserved            7 bytes
+//   64 inputs              input size bytes
+//    . id                  u64   FNV-1a of everything before it
+//
+// the inputs are runs of ticks that moved in the same direction, each run is a varint of
+// ( ( ticks - 1 ) << 2 ) | ( direction - SNAKE_DIRECTION_UP ). a snake that goes straight for a while costs a byte.
+#define REPLAY_LOG_FILE_NAME                    "replays.bin"
+#define REPLAY_LOG_MAGIC                        0x524b4e53 // "SNKR"
+#define REPLAY_LOG_VERSION                      1
+#define REPLAY_LOG_HEADER_SIZE                  16
+#define REPLAY_RECORD_HEADER_SIZE               64
+#define REPLAY_PLAYER_NAME_LENGTH               20
+#define REPLAY_MAX_RECORD_SIZE                  ( 64 * 1024 * 1024 )
+
+struct GameReplay
+{
+    GameReplay() : m_random_state(0), m_ticks(0), m_score(0), m_item_count(0), m_size_x(0), m_size_y(0),
+                   m_rules(0), m_player_name{} {}
+
+    uint64_t m_random_state;
+    uint32_t m_ticks;
+    int32_t m_score;
+    uint32_t m_item_count;
+    uint16_t m_size_x;
+    uint16_t m_size_y;
+    uint8_t m_rules;
+    char m_player_name[REPLAY_PLAYER_NAME_LENGTH + 1];
+    std::vector<uint8_t> m_inputs;
+};
+
+// records the game being played, a tick costs a compare unless the snake turned.
+struct ReplayRecorder
+{
+    ReplayRecorder() : m_active(false), m_run_direction(SNAKE_DIRECTION_NONE), m_run_length(0) {}
+
+    bool m_active;
+    uint8_t m_run_direction;
+    uint32_t m_run_length;
+    GameReplay m_replay;
+};
+
+// call right after the game and it's items were started, random_state is the one the game had before
+// StartSnakeGameState() and item_count the capacity the item field got.
+void BeginReplay( ReplayRecorder& recorder, const SnakeGameState& state, uint64_t random_state, uint32_t item_count );
+
+// the game can't be played again from it's start ( it was resumed, or it's walls came from a level ).
+void CancelReplay( ReplayRecorder& recorder );
+
+// call after every step with the direction the snake moved in.
+void RecordReplayTick( ReplayRecorder& recorder, uint8_t direction );
+
+// ends the inputs and fills in the result. false if nothing was being recorded.
+bool FinishReplay( ReplayRecorder& recorder, const char* player_name, int32_t score );
+
+// appends a finished replay to the log at path with a single write, creating the log if needed.
+// returns the id the scores file refers to it by, 0 if it couldn't be written.
+uint64_t AppendReplay( const char* path, const GameReplay& replay );
+
+// where a record sits in a log that was read into memory.
+struct ReplayLogEntry
+{
+    uint64_t m_id;
+    std::size_t m_offset;
+    uint32_t m_size;
+};
+
+// finds the records of a log read into memory, sorted by id. records with a wrong id are counted as corrupt and
+// left out, a record cut off at the end of the log is ignored. false if it isn't a replay log.
+bool IndexReplayLog( const uint8_t* data, std::size_t size, std::vector<ReplayLogEntry>& entries,
+                     uint64_t& corrupt_count );
+
+bool DecodeReplay( const uint8_t* record, std::size_t size, GameReplay& replay );
+
+// what a replay is played with, one per thread. after the biggest board it saw it needs no more heap.
+struct ReplaySimulation
+{
+    GameArena m_arena;
+    GameArena m_item_arena;
+    SnakeGameState m_state;
+    ItemField m_items;
+};
+
+// plays the record again and returns true if it ends with the ticks and the score it says it did.
+bool VerifyReplayRecord( ReplaySimulation& simulation, const uint8_t* record, std::size_t size );
+
+// verifies every entry on thread_count threads, 0 uses one per core. verified[i] is set for entries[i].
+void VerifyReplayLog( const uint8_t* data, const std::vector<ReplayLogEntry>& entries, uint32_t thread_count,
+                      std::vector<uint8_t>& verified );
@@ -0,0 +1,166 @@
+#include "retained_screen.h"
+
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+void BeginRetainedScreen( RetainedScreen& screen, uint32_t screen_id )
+{
+    if( screen.m_screen_id != screen_id )
+    {
+        screen.m_screen_id = screen_id;
+        screen.m_needs_clear = true;
+    }
+
+    for( ScreenLine& line : screen.m_lines )
+        line.m_touched = false;
+
+    screen.m_cursor_row = screen.m_cursor_column = 0;
+}
+
+void SetScreenLine( RetainedScreen& screen, uint16_t row, uint16_t column, const char* format, ... )
+{
+    if( row == 0 || row > RETAINED_SCREEN_MAX_LINES )
+        return;
+
+    char formatted[RETAINED_SCREEN_LINE_LENGTH];
+
+    va_list arguments;
+    va_start(arguments,format);
+    int formatted_length = std::vsnprintf(formatted,sizeof(formatted),format,arguments);
+    va_end(arguments);
+
+    if( formatted_length < 0 )
+        formatted_length = 0;
+    else if( formatted_length >= int(sizeof(formatted)) )
+        formatted_length = sizeof(formatted) - 1;
+
+    // tabs are turned into spaces, a tab only moves the cursor and would leave the old text under it.
+    char text[RETAINED_SCREEN_LINE_LENGTH];
+    int length = 0;
+    for( int i = 0; i < formatted_length && length < int(sizeof(text)); ++i )
+    {
+        if( formatted[i] != '\t' )
+        {
+            text[length++] = formatted[i];
+            continue;
+        }
+
+        int cell = column - 1 + length;
+        for( int stop = ( cell / 8 + 1 ) * 8; cell < stop && length < int(sizeof(text)); ++cell )
+            text[length++] = ' ';
+    }
+
+    ScreenLine& line = screen.m_lines[row - 1];
+    line.m_touched = true;
+
+    if( line.m_used && line.m_column == column && line.m_length == length &&
+        std::memcmp(line.m_text,text,length) == 0 )
+        return;
+
+    // text moving to an other column leaves the old text in front of it, the whole line is erased instead.
+    if( line.m_used && line.m_column != column )
+        line.m_used = false;
+
+    std::memcpy(line.m_text,text,length);
+    line.m_column = column;
+    line.m_length = length;
+    line.m_dirty = true;
+}
+
+void SetScreenCursor( RetainedScreen& screen, uint16_t row, uint16_t column )
+{
+    screen.m_cursor_row = row;
+    screen.m_cursor_column = column;
+}
+
+void InvalidateRetainedScreen( RetainedScreen& screen )
+{
+    screen.m_screen_id = RETAINED_SCREEN_NONE;
+    screen.m_needs_clear = true;
+}
+
+std::size_t PresentRetainedScreen( RetainedScreen& screen )
+{
+    ++screen.m_present_count;
+
+    char* out = screen.m_output;
+    uint64_t written_lines = 0;
+
+    if( screen.m_needs_clear )
+    {
+        std::memcpy(out,"\x1b[H\x1b[2J\x1b[3J",11);
+        out += 11;
+
+        for( ScreenLine& line : screen.m_lines )
+        {
+            line.m_used = false;
+            line.m_dirty = line.m_touched;
+        }
+
+        screen.m_needs_clear = false;
+        screen.m_drawn_cursor_row = screen.m_drawn_cursor_column = 0;
+    }
+
+    for( uint16_t row = 1; row <= RETAINED_SCREEN_MAX_LINES; ++row )
+    {
+        ScreenLine& line = screen.m_lines[row - 1];
+
+        // lines that weren't set again are gone from the screen.
+        if( !line.m_touched )
+        {
+            if( line.m_used )
+            {
+                out += std::sprintf(out,"\x1b[%d;1H\x1b[2K",row);
+                line.m_used = false;
+                ++written_lines;
+            }
+
+            line.m_dirty = false;
+            continue;
+        }
+
+        if( !line.m_dirty )
+            continue;
+
+        // a line that isn't on the screen can have other text in front of it's column, only a line that was
+        // written at the same column before can be overwritten from there.
+        if( line.m_used )
+            out += std::sprintf(out,"\x1b[%d;%dH",row,line.m_column);
+        else
+            out += std::sprintf(out,"\x1b[%d;1H\x1b[2K\x1b[%d;%dH",row,row,line.m_column);
+
+        std::memcpy(out,line.m_text,line.m_length);
+        out += line.m_length;
+        std::memcpy(out,"\x1b[K",3);
+        out += 3;
+
+        line.m_used = true;
+        line.m_dirty = false;
+        ++written_lines;
+    }
+
+    // writing moves the cursor, so it's put back even when it was asked for the same place as before.
+    if( screen.m_cursor_row != 0 &&
+        ( out != screen.m_output || screen.m_cursor_row != screen.m_drawn_cursor_row ||
+          screen.m_cursor_column != screen.m_drawn_cursor_column ) )
+    {
+        out += std::sprintf(out,"\x1b[%d;%dH",screen.m_cursor_row,screen.m_cursor_column);
+        screen.m_drawn_cursor_row = screen.m_cursor_row;
+        screen.m_drawn_cursor_column = screen.m_cursor_column;
+    }
+
+    std::size_t size = out - screen.m_output;
+    if( size == 0 )
+        return 0;
+
+    std::cout.write(screen.m_output,size);
+    std::cout.flush();
+
+    ++screen.m_written_count;
+    screen.m_written_bytes += size;
+    screen.m_written_lines += written_lines;
+
+    return size;
+}
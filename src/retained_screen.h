@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#define RETAINED_SCREEN_MAX_LINES               32
+#define RETAINED_SCREEN_LINE_LENGTH             192 // bytes of text on a line, longer text is cut off.
+#define RETAINED_SCREEN_NONE                    0xffffffff
+// a line costs atmost it's text plus two cursor moves and an erase.
+#define RETAINED_SCREEN_OUTPUT_CAPACITY     ( RETAINED_SCREEN_MAX_LINES * ( RETAINED_SCREEN_LINE_LENGTH + 32 ) + 64 )
+
+// a line of text that starts at a fixed column of the screen. it must not contain newlines, tabs are expanded.
+struct ScreenLine
+{
+    ScreenLine() : m_column(1), m_length(0), m_used(false), m_touched(false), m_dirty(false), m_text{} {}
+
+    uint16_t m_column;
+    uint16_t m_length;
+    bool m_used;        // the line is on the terminal.
+    bool m_touched;     // the line was set since the last BeginRetainedScreen().
+    bool m_dirty;       // the text or column changed since the line was last written.
+    char m_text[RETAINED_SCREEN_LINE_LENGTH];
+};
+
+// keeps what the menus put on the terminal, so they can be rebuilt every loop without redrawing anything. a screen
+// sets all of it's lines between BeginRetainedScreen() and PresentRetainedScreen(), the present only writes the
+// lines whose text changed and erases the lines that were not set again. when nothing changed, nothing is written.
+//
+// the screen is cleared whenever a different screen id begins, or after InvalidateRetainedScreen(). anything else
+// that writes to the terminal ( the game, error messages ) has to invalidate the screen, since it can't know.
+struct RetainedScreen
+{
+    RetainedScreen() : m_screen_id(RETAINED_SCREEN_NONE), m_needs_clear(true), m_cursor_row(0), m_cursor_column(0),
+                       m_drawn_cursor_row(0), m_drawn_cursor_column(0), m_present_count(0), m_written_count(0),
+                       m_written_bytes(0), m_written_lines(0) {}
+
+    RetainedScreen( const RetainedScreen& other ) = delete;
+    RetainedScreen& operator=( const RetainedScreen& other ) = delete;
+
+    uint32_t m_screen_id;
+    bool m_needs_clear;
+    ScreenLine m_lines[RETAINED_SCREEN_MAX_LINES];
+
+    // where the cursor is left after a present, 0 leaves it after the last line written.
+    uint16_t m_cursor_row;
+    uint16_t m_cursor_column;
+    uint16_t m_drawn_cursor_row;
+    uint16_t m_drawn_cursor_column;
+
+    char m_output[RETAINED_SCREEN_OUTPUT_CAPACITY];
+
+    // metrics.
+    uint64_t m_present_count;
+    uint64_t m_written_count;   // presents that wrote anything.
+    uint64_t m_written_bytes;
+    uint64_t m_written_lines;
+};
+
+// starts setting the lines of screen_id, if an other screen was on the terminal the next present clears it first.
+void BeginRetainedScreen( RetainedScreen& screen, uint32_t screen_id );
+
+// row and column start at 1, like the terminal's. rows past RETAINED_SCREEN_MAX_LINES are ignored.
+void SetScreenLine( RetainedScreen& screen, uint16_t row, uint16_t column, const char* format, ... );
+
+void SetScreenCursor( RetainedScreen& screen, uint16_t row, uint16_t column );
+
+// the terminal was written to by something else, the next present clears it and writes every line.
+void InvalidateRetainedScreen( RetainedScreen& screen );
+
+// writes what changed since the last present in one write, returns how many bytes that took.
+std::size_t PresentRetainedScreen( RetainedScreen& screen );
@@ -0,0 +1,274 @@
+#include "score_writer.h"
+
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <utility>
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/eventfd.h>
+
+uint32_t InsertScoreRecord( ScoreSubmission* records, uint32_t count, const ScoreSubmission& submission )
+{
+    uint32_t position = 0;
+    while( position < count && records[position].m_score >= submission.m_score )
+        ++position;
+
+    if( position == SCORE_RECORDS_LIMIT )
+        return count;
+
+    uint32_t last = ( count < SCORE_RECORDS_LIMIT ) ? count : SCORE_RECORDS_LIMIT - 1;
+    for( uint32_t i = last; i > position; --i )
+        records[i] = records[i - 1];
+
+    records[position] = submission;
+
+    return ( count < SCORE_RECORDS_LIMIT ) ? count + 1 : count;
+}
+
+// same format the scoreboard reads: a line per score, without a new line after the last one.
+uint32_t ReadScoreRecords( const char* path, ScoreSubmission* records )
+{
+    std::ifstream reader(path);
+    if( !reader )
+        return 0;
+
+    uint32_t count = 0;
+
+    for( std::string line; count < SCORE_RECORDS_LIMIT && std::getline(reader,line); )
+    {
+        ScoreSubmission record;
+        std::memset(record.m_player_name,0,sizeof(record.m_player_name));
+
+        int score;
+        unsigned long long replay_id = 0;
+        if( std::sscanf(line.c_str(),"%20s %d %llx",record.m_player_name,&score,&replay_id) < 2 )
+            break;
+
+        record.m_score = score;
+        record.m_replay_id = replay_id;
+
+        records[count++] = record;
+    }
+
+    return count;
+}
+
+static bool WriteAll( int fd, const char* data, std::size_t size )
+{
+    while( size )
+    {
+        ssize_t result = write(fd,data,size);
+        if( result <= 0 )
+            return false;
+
+        data += result;
+        size -= result;
+    }
+
+    return true;
+}
+
+// the new file is synced before it replaces the old one and the directory after, so a crash leaves either the
+// old scores or the new ones, never half a file.
+bool WriteScoreRecords( const char* path, const ScoreSubmission* records, uint32_t count )
+{
+    char text[SCORE_RECORDS_LIMIT * ( SCORE_PLAYER_NAME_LENGTH + 32 )];
+    std::size_t size = 0;
+
+    for( uint32_t i = 0; i < count; ++i )
+    {
+        if( records[i].m_replay_id )
+            size += std::snprintf(text + size,sizeof(text) - size,"%s %d %016llx",records[i].m_player_name,
+                                  int(records[i].m_score),(unsigned long long)records[i].m_replay_id);
+        else
+            size += std::snprintf(text + size,sizeof(text) - size,"%s %d",records[i].m_player_name,
+                                  int(records[i].m_score));
+
+        if( i + 1 < count )
+            text[size++] = '\n';
+    }
+
+    char temporary_path[256];
+    if( std::snprintf(temporary_path,sizeof(temporary_path),"%s.tmp",path) >= int(sizeof(temporary_path)) )
+        return false;
+
+    int fd = open(temporary_path,O_WRONLY | O_CREAT | O_TRUNC,0644);
+    if( fd < 0 )
+        return false;
+
+    if( !WriteAll(fd,text,size) || fsync(fd) != 0 )
+    {
+        close(fd);
+        unlink(temporary_path);
+        return false;
+    }
+
+    close(fd);
+
+    if( rename(temporary_path,path) != 0 )
+        return false;
+
+    // the file name is relative to the working directory, that is the directory to sync.
+    int directory_fd = open(".",O_RDONLY | O_DIRECTORY);
+    if( directory_fd >= 0 )
+    {
+        fsync(directory_fd);
+        close(directory_fd);
+    }
+
+    return true;
+}
+
+static void WriteScoreBatch( ScoreWriter& writer, const ScoreSubmission* batch, uint32_t batch_size )
+{
+    auto start = std::chrono::steady_clock::now();
+
+    // read back every time, the file is the only copy the writer trusts.
+    ScoreSubmission records[SCORE_RECORDS_LIMIT];
+    uint32_t count = ReadScoreRecords(writer.m_path,records);
+
+    for( uint32_t i = 0; i < batch_size; ++i )
+        count = InsertScoreRecord(records,count,batch[i]);
+
+    if( WriteScoreRecords(writer.m_path,records,count) )
+        writer.m_written_count += batch_size;
+    else
+        ++writer.m_failed_batch_count;
+
+    int64_t microseconds = std::chrono::duration_cast<std::chrono::microseconds>(
+                               std::chrono::steady_clock::now() - start).count();
+
+    writer.m_last_write_microseconds = microseconds;
+    if( microseconds > writer.m_max_write_microseconds )
+        writer.m_max_write_microseconds = microseconds;
+
+    writer.m_last_batch_size = batch_size;
+    ++writer.m_batch_count;
+}
+
+static void RunScoreWriter( ScoreWriter& writer )
+{
+    ScoreSubmission batch[SCORE_QUEUE_CAPACITY];
+
+    for( ;; )
+    {
+        // blocks until something is pushed or a stop is asked for, the count itself doesn't matter.
+        uint64_t signal_count;
+        if( read(writer.m_event_fd,&signal_count,sizeof(signal_count)) < 0 && errno == EINTR )
+            continue;
+
+        uint32_t read_index = writer.m_read_index.load(std::memory_order_relaxed);
+        uint32_t write_index = writer.m_write_index.load(std::memory_order_acquire);
+        uint32_t batch_size = 0;
+
+        for( ; read_index != write_index; ++read_index )
+        {
+            uint32_t slot = read_index & ( SCORE_QUEUE_CAPACITY - 1 );
+            ScoreSubmission& submission = batch[batch_size++];
+            submission = writer.m_queue[slot];
+
+            // the slot is still ours until the read index moves past it.
+            if( writer.m_has_replay[slot] )
+            {
+                submission.m_replay_id = AppendReplay(writer.m_replay_path,writer.m_replays[slot]);
+                if( !submission.m_replay_id )
+                    ++writer.m_failed_replay_count;
+
+                writer.m_replays[slot].m_inputs.clear();
+            }
+        }
+
+        writer.m_read_index.store(read_index,std::memory_order_release);
+
+        if( batch_size )
+            WriteScoreBatch(writer,batch,batch_size);
+
+        if( writer.m_stop.load(std::memory_order_acquire) &&
+            writer.m_read_index.load(std::memory_order_relaxed) ==
+            writer.m_write_index.load(std::memory_order_acquire) )
+            return;
+    }
+}
+
+static void SignalScoreWriter( ScoreWriter& writer )
+{
+    uint64_t one = 1;
+    if( write(writer.m_event_fd,&one,sizeof(one)) < 0 )
+        return;
+}
+
+bool StartScoreWriter( ScoreWriter& writer, const char* path, const char* replay_path )
+{
+    if( writer.m_thread.joinable() )
+        return true;
+
+    writer.m_event_fd = eventfd(0,EFD_CLOEXEC);
+    if( writer.m_event_fd < 0 )
+        return false;
+
+    writer.m_path = path;
+    writer.m_replay_path = replay_path;
+    writer.m_stop = false;
+    writer.m_thread = std::thread(RunScoreWriter,std::ref(writer));
+
+    return true;
+}
+
+bool SubmitScore( ScoreWriter& writer, const char* player_name, int32_t score, GameReplay* replay )
+{
+    if( !writer.m_thread.joinable() )
+        return false;
+
+    uint32_t write_index = writer.m_write_index.load(std::memory_order_relaxed);
+    uint32_t depth = write_index - writer.m_read_index.load(std::memory_order_acquire);
+
+    if( depth == SCORE_QUEUE_CAPACITY )
+    {
+        ++writer.m_dropped_count;
+        return false;
+    }
+
+    uint32_t slot = write_index & ( SCORE_QUEUE_CAPACITY - 1 );
+    ScoreSubmission& submission = writer.m_queue[slot];
+    std::memset(submission.m_player_name,0,sizeof(submission.m_player_name));
+    std::strncpy(submission.m_player_name,player_name,SCORE_PLAYER_NAME_LENGTH);
+    submission.m_score = score;
+    submission.m_replay_id = 0;
+
+    // a swap moves the inputs without copying them, and the game gets the cleared inputs of the slot back.
+    writer.m_has_replay[slot] = replay != nullptr;
+    if( replay )
+        std::swap(writer.m_replays[slot],*replay);
+
+    writer.m_write_index.store(write_index + 1,std::memory_order_release);
+
+    if( depth + 1 > writer.m_max_queue_depth.load(std::memory_order_relaxed) )
+        writer.m_max_queue_depth.store(depth + 1,std::memory_order_relaxed);
+
+    SignalScoreWriter(writer);
+
+    return true;
+}
+
+uint32_t GetScoreQueueDepth( const ScoreWriter& writer )
+{
+    return writer.m_write_index.load(std::memory_order_acquire) - writer.m_read_index.load(std::memory_order_acquire);
+}
+
+void StopScoreWriter( ScoreWriter& writer )
+{
+    if( !writer.m_thread.joinable() )
+        return;
+
+    writer.m_stop.store(true,std::memory_order_release);
+    SignalScoreWriter(writer);
+    writer.m_thread.join();
+
+    close(writer.m_event_fd);
+    writer.m_event_fd = -1;
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+
+#include "replay.h"
+
+#define SCORES_FILE_NAME                        "scores.txt"
+#define SCORE_QUEUE_CAPACITY                    64 // must be a power of 2.
+#define SCORE_PLAYER_NAME_LENGTH                20
+#define SCORE_RECORDS_LIMIT                     10
+
+struct ScoreSubmission
+{
+    char m_player_name[SCORE_PLAYER_NAME_LENGTH + 1];
+    int32_t m_score;
+    uint64_t m_replay_id;       // the record of the game in the replay log ( see replay.h ), 0 without one.
+};
+
+// keeps the scores file up to date without the game ever waiting on the disk. submissions go through a single
+// producer single consumer ring: only the game thread pushes and only the writer thread pops, so the two indices
+// are all they share. the writer sleeps on an eventfd until something is pushed, then takes everything that is
+// queued at once, merges it into the file and syncs it to disk with one write. the replay of a score rides
+// along in the same slot and is appended to the replay log by the writer too, before the score that names it.
+struct ScoreWriter
+{
+    ScoreWriter() : m_path(nullptr), m_replay_path(nullptr), m_event_fd(-1), m_has_replay{}, m_read_index(0),
+                    m_write_index(0), m_stop(false), m_max_queue_depth(0), m_last_batch_size(0), m_batch_count(0),
+                    m_written_count(0), m_dropped_count(0), m_failed_batch_count(0), m_failed_replay_count(0),
+                    m_last_write_microseconds(0), m_max_write_microseconds(0) {}
+
+    ScoreWriter( const ScoreWriter& other ) = delete;
+    ScoreWriter& operator=( const ScoreWriter& other ) = delete;
+
+    const char* m_path;
+    const char* m_replay_path;
+    int m_event_fd;
+    std::thread m_thread;
+    ScoreSubmission m_queue[SCORE_QUEUE_CAPACITY];
+    GameReplay m_replays[SCORE_QUEUE_CAPACITY]; // the inputs keep their memory, it's handed back to the game.
+    bool m_has_replay[SCORE_QUEUE_CAPACITY];
+
+    // on their own cache lines, so pushing and popping don't keep stealing each others line.
+    alignas(64) std::atomic<uint32_t> m_read_index;
+    alignas(64) std::atomic<uint32_t> m_write_index;
+    alignas(64) std::atomic<bool> m_stop;
+
+    // metrics, written by the writer thread ( except m_max_queue_depth and m_dropped_count ) and safe to read
+    // from anywhere.
+    std::atomic<uint32_t> m_max_queue_depth;
+    std::atomic<uint32_t> m_last_batch_size;
+    std::atomic<uint64_t> m_batch_count;
+    std::atomic<uint64_t> m_written_count;
+    std::atomic<uint64_t> m_dropped_count;      // submissions that found the queue full.
+    std::atomic<uint64_t> m_failed_batch_count; // batches that couldn't be written to the file.
+    std::atomic<uint64_t> m_failed_replay_count; // replays that couldn't be appended, their scores have no id.
+    std::atomic<int64_t> m_last_write_microseconds;
+    std::atomic<int64_t> m_max_write_microseconds;
+};
+
+// starts the writer thread for the scores file at path and the replay log at replay_path, both must stay valid
+// until StopScoreWriter().
+bool StartScoreWriter( ScoreWriter& writer, const char* path, const char* replay_path );
+
+// queues a score to be merged into the file, never blocks. with a finished replay ( see FinishReplay() ) it is
+// swapped into the queue and the score gets the id the writer appends it under, replay is left with an empty
+// one that reuses the memory of an earlier replay. returns false if the queue is full or the writer is not
+// running, the score and the replay are lost then.
+bool SubmitScore( ScoreWriter& writer, const char* player_name, int32_t score, GameReplay* replay );
+
+// scores that are queued but not written yet.
+uint32_t GetScoreQueueDepth( const ScoreWriter& writer );
+
+// writes whatever is still queued, then stops the writer thread. safe to call more than once.
+void StopScoreWriter( ScoreWriter& writer );
+
+// puts a score into a table sorted from the highest score down, the way the scoreboard does it: after the scores
+// that are atleast as high, and dropped if the table is full and it is the lowest. returns the new count.
+uint32_t InsertScoreRecord( ScoreSubmission* records, uint32_t count, const ScoreSubmission& submission );
+
+// the scores file holds a "name score" line per score, followed by the replay id in hex when there is one.
+// reads atmost SCORE_RECORDS_LIMIT of them.
+uint32_t ReadScoreRecords( const char* path, ScoreSubmission* records );
+
+// replaces the file with the records without ever leaving half of it behind.
+bool WriteScoreRecords( const char* path, const ScoreSubmission* records, uint32_t count );
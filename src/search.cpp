@@ -0,0 +1,207 @@
+#include "search.h"
+
+#include <climits>
+#include <thread>
+
+#include "items.h"
+
+#define SEARCH_VALUE_LOST                       -1000000000000LL
+#define SEARCH_VALUE_WON                        1000000000000LL
+
+static int64_t EvaluateSnakeGame( const SnakeGameState& state, uint8_t ply )
+{
+    // losing later is better than losing sooner, it gives the next search a chance to find a way out.
+    if( state.m_status == GAME_STATUS_LOST )
+        return SEARCH_VALUE_LOST + int64_t(ply) * 1000000000LL;
+
+    if( state.m_status == GAME_STATUS_WON )
+        return SEARCH_VALUE_WON - ply;
+
+    int32_t head_x = state.Head() % state.m_size_x, head_y = state.Head() / state.m_size_x;
+    int32_t food_x = state.m_food % state.m_size_x, food_y = state.m_food / state.m_size_x;
+    int32_t distance = ( head_x > food_x ? head_x - food_x : food_x - head_x ) +
+                       ( head_y > food_y ? head_y - food_y : food_y - head_y );
+
+    // open cells around the head, so the snake doesn't crawl into pockets while chasing food.
+    int32_t free_neighbours = 0;
+    for( uint8_t direction = SNAKE_DIRECTION_UP; direction <= SNAKE_DIRECTION_RIGHT; ++direction )
+    {
+        char value = state.m_field[state.Neighbor(state.Head(),direction)];
+        if( value == SNAKE_CELL_EMPTY || value == SNAKE_CELL_FOOD || IsItemCellValue(value) )
+            ++free_neighbours;
+    }
+
+    return int64_t(state.m_score) * 1000 - distance * 10 + free_neighbours * 50;
+}
+
+static int64_t SearchSnakeGame( SnakeGameState& state, uint8_t depth, uint8_t ply, uint64_t& node_count )
+{
+    if( depth == 0 || state.m_status != GAME_STATUS_ONGOING )
+        return EvaluateSnakeGame(state,ply);
+
+    int64_t best_value = LLONG_MIN;
+    SnakeGameUndoRecord undo;
+
+    for( uint8_t direction = SNAKE_DIRECTION_UP; direction <= SNAKE_DIRECTION_RIGHT; ++direction )
+    {
+        // moving backwards is ignored by the game, it would just repeat going straight.
+        if( IsOppositeDirection(state.m_direction,direction) )
+            continue;
+
+        StepSnakeGame(state,direction,undo);
+        ++node_count;
+
+        int64_t value = SearchSnakeGame(state,depth - 1,ply + 1,node_count);
+        UndoSnakeGameStep(state,undo);
+
+        if( value > best_value )
+            best_value = value;
+    }
+
+    return best_value;
+}
+
+static void SearchRootMove( SnakeSearchContext& context, uint8_t index, const SnakeGameState& state )
+{
+    SnakeSearchRootMove& move = context.m_root_moves[index];
+    GameArena& arena = context.m_arenas[index];
+    SnakeGameState clone;
+
+    arena.Reset();
+    if( !arena.Reserve(ComputeSnakeGameMemorySize(state.m_size_x,state.m_size_y)) ||
+        !CloneSnakeGameState(state,clone,arena) )
+    {
+        move.m_value = LLONG_MIN;
+        return;
+    }
+
+    StepSnakeGame(clone,move.m_direction);
+    move.m_node_count = 1;
+
+    if( IsSnakeGameDoomed(context.m_reachabilities[index],clone) )
+    {
+        move.m_value = SEARCH_VALUE_LOST + int64_t(context.m_depth + 1) * 1000000000LL;
+        return;
+    }
+
+    move.m_value = SearchSnakeGame(clone,context.m_depth - 1,1,move.m_node_count);
+}
+
+static void RunSearchWorker( SnakeSearchContext& context, uint8_t worker, uint64_t generation )
+{
+    for( ;; )
+    {
+        const SnakeGameState* state;
+        {
+            std::unique_lock<std::mutex> lock(context.m_job_mutex);
+            context.m_job_condition.wait(lock,[&]{ return context.m_stop ||
+                                                          context.m_job_generation != generation; });
+
+            if( context.m_stop )
+                return;
+
+            generation = context.m_job_generation;
+            if( worker >= context.m_job_count )
+                continue;
+
+            state = context.m_job_state;
+        }
+
+        SearchRootMove(context,uint8_t(worker + 1),*state);
+
+        bool is_last;
+        {
+            std::lock_guard<std::mutex> lock(context.m_job_mutex);
+            is_last = --context.m_jobs_left == 0;
+        }
+
+        if( is_last )
+            context.m_done_condition.notify_one();
+    }
+}
+
+SnakeSearchContext::~SnakeSearchContext()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_job_mutex);
+        m_stop = true;
+    }
+
+    m_job_condition.notify_all();
+
+    for( uint8_t i = 0; i < m_worker_count; ++i )
+        m_workers[i].join();
+}
+
+uint8_t SearchSnakeMove( SnakeSearchContext& context, const SnakeGameState& state )
+{
+    if( state.m_status != GAME_STATUS_ONGOING )
+        return SNAKE_DIRECTION_NONE;
+
+    if( context.m_depth == 0 )
+        context.m_depth = 1;
+
+    else if( context.m_depth > SNAKE_SEARCH_MAX_DEPTH )
+        context.m_depth = SNAKE_SEARCH_MAX_DEPTH;
+
+    // current direction goes first, so on equal values the snake keeps going straight.
+    SnakeSearchRootMove* moves = context.m_root_moves;
+    uint8_t move_count = 0;
+    moves[move_count++] = { state.m_direction, 0, 0 };
+
+    for( uint8_t direction = SNAKE_DIRECTION_UP; direction <= SNAKE_DIRECTION_RIGHT; ++direction )
+    {
+        if( direction != state.m_direction && !IsOppositeDirection(state.m_direction,direction) )
+            moves[move_count++] = { direction, 0, 0 };
+    }
+
+    // the calling thread takes the first move itself, and the moves that didn't get a worker.
+    uint8_t job_count = move_count - 1;
+    if( context.m_thread_count != 0 && context.m_thread_count - 1 < job_count )
+        job_count = uint8_t(context.m_thread_count - 1);
+
+    if( job_count )
+    {
+        while( context.m_worker_count < job_count )
+        {
+            context.m_workers[context.m_worker_count] = std::thread(RunSearchWorker,std::ref(context),
+                                                                    context.m_worker_count,context.m_job_generation);
+            ++context.m_worker_count;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(context.m_job_mutex);
+            context.m_job_state = &state;
+            context.m_job_count = job_count;
+            context.m_jobs_left = job_count;
+            ++context.m_job_generation;
+        }
+
+        context.m_job_condition.notify_all();
+    }
+
+    SearchRootMove(context,0,state);
+
+    for( uint8_t i = job_count + 1; i < move_count; ++i )
+        SearchRootMove(context,i,state);
+
+    if( job_count )
+    {
+        std::unique_lock<std::mutex> lock(context.m_job_mutex);
+        context.m_done_condition.wait(lock,[&]{ return context.m_jobs_left == 0; });
+    }
+
+    SnakeSearchRootMove* best = &moves[0];
+    context.m_last_node_count = 0;
+
+    for( uint8_t i = 0; i < move_count; ++i )
+    {
+        context.m_last_node_count += moves[i].m_node_count;
+        if( moves[i].m_value > best->m_value )
+            best = &moves[i];
+    }
+
+    context.m_last_value = best->m_value;
+
+    return best->m_direction;
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+
+#include "arena.h"
+#include "snake_game.h"
+#include "reachability.h"
+
+#define SNAKE_SEARCH_DEFAULT_DEPTH              9
+#define SNAKE_SEARCH_MAX_DEPTH                  16
+
+struct SnakeSearchRootMove
+{
+    uint8_t m_direction;
+    int64_t m_value;
+    uint64_t m_node_count;
+};
+
+// state the search keeps between calls. every root move gets it's own arena to clone the game into and it's own
+// bitboards for the reachability check, so the searching threads never share memory. the threads that search
+// the second and third root move are started by the first search that wants them and wait for the next one
+// until the context is destroyed, so after the first search no more heap is needed and no threads are started.
+// a context must only be used by one search at a time, use one context per game that is being searched.
+struct SnakeSearchContext
+{
+    SnakeSearchContext() : m_depth(SNAKE_SEARCH_DEFAULT_DEPTH), m_thread_count(0), m_last_node_count(0),
+                           m_last_value(0), m_root_moves{}, m_worker_count(0), m_job_state(nullptr), m_job_count(0),
+                           m_job_generation(0), m_jobs_left(0), m_stop(false) {}
+
+    SnakeSearchContext( const SnakeSearchContext& other ) = delete;
+    SnakeSearchContext& operator=( const SnakeSearchContext& other ) = delete;
+
+    // stops and joins the workers.
+    ~SnakeSearchContext();
+
+    GameArena m_arenas[4];
+    SnakeReachability m_reachabilities[4];
+    uint8_t m_depth;
+    uint8_t m_thread_count;     // 0 means one thread per root move.
+    uint64_t m_last_node_count;
+    int64_t m_last_value;
+
+    // handed to the workers, worker i searches root move i + 1 when i is below m_job_count.
+    SnakeSearchRootMove m_root_moves[3];
+    std::thread m_workers[2];
+    uint8_t m_worker_count;
+    std::mutex m_job_mutex;
+    std::condition_variable m_job_condition;
+    std::condition_variable m_done_condition;
+    const SnakeGameState* m_job_state;
+    uint8_t m_job_count;
+    uint64_t m_job_generation;  // goes up with every search the workers take part in.
+    uint8_t m_jobs_left;
+    bool m_stop;
+};
+
+// looks m_depth moves ahead from state with a depth first search over step/undo, every root move is searched
+// on it's own thread. a root move that leaves the snake doomed ( see IsSnakeGameDoomed() ) is scored as a loss
+// right after the search horizon without being searched, so pockets further away than m_depth are avoided too.
+// state itself is never modified. returns the direction to move, or SNAKE_DIRECTION_NONE if the game is not
+// ongoing.
+uint8_t SearchSnakeMove( SnakeSearchContext& context, const SnakeGameState& state );
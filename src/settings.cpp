@@ -0,0 +1,403 @@
+#include "settings.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/inotify.h>
+
+#include "renderer.h"
+
+const uint32_t turbo_tick_rates[TURBO_TICK_RATE_COUNT] = { 0, 30, 60, 120, 250, 500 };
+const uint32_t item_count_choices[ITEM_COUNT_CHOICE_COUNT] = { 0, 20, 200, 2000 };
+
+#define SETTING_FIELD(member) offsetof(GameSettings,member),sizeof(GameSettings::member)
+
+const SettingDefinition setting_definitions[] =
+{
+    { "snake_can_cut_itself",  SETTING_TYPE_BOOL, SETTING_APPLY_NEXT_GAME, SETTING_FIELD(m_snake_can_cut_itself),
+      0, 1, nullptr, 0 },
+    { "snake_can_pass_border", SETTING_TYPE_BOOL, SETTING_APPLY_NEXT_GAME, SETTING_FIELD(m_snake_can_pass_border),
+      0, 1, nullptr, 0 },
+    { "color_mode",            SETTING_TYPE_UINT, SETTING_APPLY_NOW, SETTING_FIELD(m_color_mode),
+      0, RENDER_COLOR_MODE_COUNT - 1, nullptr, 0 },
+    { "theme",                 SETTING_TYPE_UINT, SETTING_APPLY_NOW, SETTING_FIELD(m_theme),
+      0, RENDER_THEME_COUNT - 1, nullptr, 0 },
+    { "density",               SETTING_TYPE_UINT, SETTING_APPLY_NOW, SETTING_FIELD(m_density),
+      0, RENDER_DENSITY_COUNT - 1, nullptr, 0 },
+    { "turbo_tick_rate",       SETTING_TYPE_UINT, SETTING_APPLY_NOW, SETTING_FIELD(m_turbo_tick_rate),
+      0, 0, turbo_tick_rates, TURBO_TICK_RATE_COUNT },
+    { "tick_rate",             SETTING_TYPE_UINT, SETTING_APPLY_NOW, SETTING_FIELD(m_tick_rate),
+      0, SETTINGS_MAX_TICK_RATE, nullptr, 0 },
+    { "board_columns",         SETTING_TYPE_UINT, SETTING_APPLY_NEXT_GAME, SETTING_FIELD(m_board_columns),
+      0, SETTINGS_MAX_BOARD_SIZE, nullptr, 0 },
+    { "board_rows",            SETTING_TYPE_UINT, SETTING_APPLY_NEXT_GAME, SETTING_FIELD(m_board_rows),
+      0, SETTINGS_MAX_BOARD_SIZE, nullptr, 0 },
+    { "item_count",            SETTING_TYPE_UINT, SETTING_APPLY_NEXT_GAME, SETTING_FIELD(m_item_count),
+      0, SETTINGS_MAX_ITEM_COUNT, nullptr, 0 },
+    { "key_up",                SETTING_TYPE_KEY, SETTING_APPLY_NOW, SETTING_FIELD(m_key_up), 0, 0, nullptr, 0 },
+    { "key_left",              SETTING_TYPE_KEY, SETTING_APPLY_NOW, SETTING_FIELD(m_key_left), 0, 0, nullptr, 0 },
+    { "key_down",              SETTING_TYPE_KEY, SETTING_APPLY_NOW, SETTING_FIELD(m_key_down), 0, 0, nullptr, 0 },
+    { "key_right",             SETTING_TYPE_KEY, SETTING_APPLY_NOW, SETTING_FIELD(m_key_right), 0, 0, nullptr, 0 },
+    { "key_pause",             SETTING_TYPE_KEY, SETTING_APPLY_NOW, SETTING_FIELD(m_key_pause), 0, 0, nullptr, 0 },
+    { "key_autopilot",         SETTING_TYPE_KEY, SETTING_APPLY_NOW, SETTING_FIELD(m_key_autopilot), 0, 0, nullptr, 0 },
+};
+
+const uint32_t setting_definition_count = sizeof(setting_definitions) / sizeof(setting_definitions[0]);
+
+// values are kept in the smallest type that fits them, they all go through these.
+static uint32_t LoadSettingValue( const GameSettings& settings, const SettingDefinition& definition )
+{
+    const uint8_t* field = reinterpret_cast<const uint8_t*>(&settings) + definition.m_offset;
+
+    if( definition.m_type == SETTING_TYPE_BOOL )
+        return *reinterpret_cast<const bool*>(field);
+
+    uint32_t value = 0;
+    if( definition.m_size == 1 )
+        value = *field;
+    else if( definition.m_size == 2 )
+        value = *reinterpret_cast<const uint16_t*>(field);
+    else
+        value = *reinterpret_cast<const uint32_t*>(field);
+
+    return value;
+}
+
+static void StoreSettingValue( GameSettings& settings, const SettingDefinition& definition, uint32_t value )
+{
+    uint8_t* field = reinterpret_cast<uint8_t*>(&settings) + definition.m_offset;
+
+    if( definition.m_type == SETTING_TYPE_BOOL )
+        *reinterpret_cast<bool*>(field) = value != 0;
+    else if( definition.m_size == 1 )
+        *field = uint8_t(value);
+    else if( definition.m_size == 2 )
+        *reinterpret_cast<uint16_t*>(field) = uint16_t(value);
+    else
+        *reinterpret_cast<uint32_t*>(field) = value;
+}
+
+static bool IsSameWord( const char* word, std::size_t length, const char* name )
+{
+    return std::strlen(name) == length && std::strncmp(word,name,length) == 0;
+}
+
+static bool ParseSettingValue( const SettingDefinition& definition, const char* value, std::size_t length,
+                               uint32_t& out )
+{
+    if( length == 0 )
+        return false;
+
+    if( definition.m_type == SETTING_TYPE_BOOL )
+    {
+        if( IsSameWord(value,length,"1") || IsSameWord(value,length,"true") || IsSameWord(value,length,"on") )
+            out = 1;
+        else if( IsSameWord(value,length,"0") || IsSameWord(value,length,"false") || IsSameWord(value,length,"off") )
+            out = 0;
+        else
+            return false;
+
+        return true;
+    }
+
+    if( definition.m_type == SETTING_TYPE_KEY )
+    {
+        if( IsSameWord(value,length,"tab") )
+            out = '\t';
+        else if( IsSameWord(value,length,"space") )
+            out = ' ';
+        else if( length == 1 && value[0] > ' ' && value[0] < 127 && value[0] != '#' && value[0] != ';' )
+            out = ( value[0] >= 'A' && value[0] <= 'Z' ) ? value[0] - 'A' + 'a' : value[0];
+        else
+            return false;
+
+        return true;
+    }
+
+    uint64_t number = 0;
+    for( std::size_t i = 0; i < length; ++i )
+    {
+        if( value[i] < '0' || value[i] > '9' || number > 0xffffffffULL )
+            return false;
+
+        number = number * 10 + uint64_t(value[i] - '0');
+    }
+
+    if( number > 0xffffffffULL )
+        return false;
+
+    if( definition.m_choices )
+    {
+        for( uint32_t i = 0; i < definition.m_choice_count; ++i )
+        {
+            if( definition.m_choices[i] == number )
+            {
+                out = uint32_t(number);
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    if( number < definition.m_minimum || number > definition.m_maximum )
+        return false;
+
+    out = uint32_t(number);
+    return true;
+}
+
+static bool IsBlank( char c )
+{
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+static bool IsNameCharacter( char c )
+{
+    return ( c >= 'a' && c <= 'z' ) || ( c >= 'A' && c <= 'Z' ) || ( c >= '0' && c <= '9' ) || c == '_';
+}
+
+SettingsParseResult ParseSettings( const char* text, std::size_t size, GameSettings& settings )
+{
+    SettingsParseResult result;
+    const char* end = text + size;
+    uint32_t line_number = 0;
+
+    for( const char* line = text; line < end; )
+    {
+        const char* line_end = static_cast<const char*>(std::memchr(line,'\n',end - line));
+        if( !line_end )
+            line_end = end;
+
+        ++line_number;
+        const char* p = line;
+        line = line_end + 1;
+
+        while( p < line_end && IsBlank(*p) )
+            ++p;
+
+        if( p == line_end || *p == '#' || *p == ';' )
+            continue;
+
+        const char* name = p;
+        while( p < line_end && IsNameCharacter(*p) )
+            ++p;
+
+        std::size_t name_length = p - name;
+
+        while( p < line_end && IsBlank(*p) )
+            ++p;
+
+        bool is_valid = name_length != 0 && p < line_end && *p == '=';
+        const char* value = p;
+        std::size_t value_length = 0;
+
+        // the value is a single word, anything but a comment after it makes the line wrong.
+        if( is_valid )
+        {
+            ++value;
+            while( value < line_end && IsBlank(*value) )
+                ++value;
+
+            p = value;
+            while( p < line_end && !IsBlank(*p) && *p != '#' && *p != ';' )
+                ++p;
+
+            value_length = p - value;
+
+            while( p < line_end && IsBlank(*p) )
+                ++p;
+
+            is_valid = p == line_end || *p == '#' || *p == ';';
+        }
+
+        const SettingDefinition* definition = nullptr;
+        for( uint32_t i = 0; is_valid && i < setting_definition_count; ++i )
+        {
+            if( IsSameWord(name,name_length,setting_definitions[i].m_name) )
+                definition = &setting_definitions[i];
+        }
+
+        uint32_t parsed = 0;
+        if( definition && ParseSettingValue(*definition,value,value_length,parsed) )
+        {
+            StoreSettingValue(settings,*definition,parsed);
+            ++result.m_read_count;
+            continue;
+        }
+
+        if( !result.m_rejected_count )
+            result.m_first_rejected_line = line_number;
+
+        ++result.m_rejected_count;
+    }
+
+    return result;
+}
+
+bool ReadSettingsFile( const char* path, GameSettings& settings, SettingsParseResult& result )
+{
+    result = SettingsParseResult();
+
+    int fd = open(path,O_RDONLY | O_CLOEXEC);
+    if( fd < 0 )
+        return errno == ENOENT;
+
+    char text[SETTINGS_FILE_CAPACITY];
+    std::size_t size = 0;
+
+    while( size < sizeof(text) )
+    {
+        ssize_t count = read(fd,text + size,sizeof(text) - size);
+        if( count < 0 && errno == EINTR )
+            continue;
+
+        if( count < 0 )
+        {
+            close(fd);
+            return false;
+        }
+
+        if( count == 0 )
+            break;
+
+        size += count;
+    }
+
+    close(fd);
+
+    result = ParseSettings(text,size,settings);
+    return true;
+}
+
+bool WriteSettingsFile( const char* path, const GameSettings& settings )
+{
+    char text[SETTINGS_FILE_CAPACITY];
+    std::size_t size = 0;
+
+    for( uint32_t i = 0; i < setting_definition_count; ++i )
+    {
+        const SettingDefinition& definition = setting_definitions[i];
+        uint32_t value = LoadSettingValue(settings,definition);
+
+        if( definition.m_type != SETTING_TYPE_KEY )
+            size += std::snprintf(text + size,sizeof(text) - size,"%s = %u\n",definition.m_name,value);
+        else if( value == '\t' )
+            size += std::snprintf(text + size,sizeof(text) - size,"%s = tab\n",definition.m_name);
+        else if( value == ' ' )
+            size += std::snprintf(text + size,sizeof(text) - size,"%s = space\n",definition.m_name);
+        else
+            size += std::snprintf(text + size,sizeof(text) - size,"%s = %c\n",definition.m_name,char(value));
+    }
+
+    char temporary_path[256];
+    if( std::snprintf(temporary_path,sizeof(temporary_path),"%s.tmp",path) >= int(sizeof(temporary_path)) )
+        return false;
+
+    int fd = open(temporary_path,O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC,0644);
+    if( fd < 0 )
+        return false;
+
+    std::size_t written = 0;
+    while( written < size )
+    {
+        ssize_t result = write(fd,text + written,size - written);
+        if( result <= 0 )
+        {
+            close(fd);
+            unlink(temporary_path);
+            return false;
+        }
+
+        written += result;
+    }
+
+    close(fd);
+
+    return rename(temporary_path,path) == 0;
+}
+
+bool SettingsDiffer( const GameSettings& first, const GameSettings& second, uint8_t apply )
+{
+    for( uint32_t i = 0; i < setting_definition_count; ++i )
+    {
+        const SettingDefinition& definition = setting_definitions[i];
+        if( definition.m_apply == apply && LoadSettingValue(first,definition) != LoadSettingValue(second,definition) )
+            return true;
+    }
+
+    return false;
+}
+
+bool StartSettingsWatch( SettingsWatch& watch, const char* path )
+{
+    StopSettingsWatch(watch);
+
+    const char* slash = std::strrchr(path,'/');
+    char directory[256] = ".";
+    if( slash )
+    {
+        std::size_t length = slash == path ? 1 : slash - path;
+        if( length >= sizeof(directory) )
+            return false;
+
+        std::memcpy(directory,path,length);
+        directory[length] = '\0';
+    }
+
+    watch.m_file_name = slash ? slash + 1 : path;
+    watch.m_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if( watch.m_fd < 0 )
+        return false;
+
+    // a write that is done, or a file renamed over it. plain modifications would report every half written state.
+    watch.m_watch = inotify_add_watch(watch.m_fd,directory,IN_CLOSE_WRITE | IN_MOVED_TO);
+    if( watch.m_watch < 0 )
+    {
+        StopSettingsWatch(watch);
+        return false;
+    }
+
+    return true;
+}
+
+void StopSettingsWatch( SettingsWatch& watch )
+{
+    if( watch.m_fd >= 0 )
+        close(watch.m_fd);
+
+    watch.m_fd = watch.m_watch = -1;
+}
+
+bool HasSettingsFileChanged( SettingsWatch& watch )
+{
+    if( watch.m_fd < 0 )
+        return false;
+
+    bool has_changed = false;
+    alignas(inotify_event) char events[4096];
+
+    for( ;; )
+    {
+        ssize_t size = read(watch.m_fd,events,sizeof(events));
+        if( size <= 0 )
+            break;
+
+        for( ssize_t offset = 0; offset < size; )
+        {
+            const inotify_event* event = reinterpret_cast<const inotify_event*>(events + offset);
+            if( event->len && std::strcmp(event->name,watch.m_file_name) == 0 )
+            {
+                has_changed = true;
+                ++watch.m_event_count;
+            }
+
+            offset += sizeof(inotify_event) + event->len;
+        }
+    }
+
+    return has_changed;
+}
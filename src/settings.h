@@ -0,0 +1,115 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#define SETTINGS_FILE_NAME                      "settings.ini"
+#define SETTINGS_FILE_CAPACITY                  8192 // a file bigger than this is only read this far.
+#define SETTINGS_MAX_BOARD_SIZE                 512
+#define SETTINGS_MAX_TICK_RATE                  500
+#define SETTINGS_MAX_ITEM_COUNT                 65536
+
+// the rates turbo mode can start at, 0 plays at the speed of the difficulty or the tick_rate setting.
+#define TURBO_TICK_RATE_COUNT                   6
+extern const uint32_t turbo_tick_rates[TURBO_TICK_RATE_COUNT];
+
+// the item counts the options menu steps through, settings.ini takes any count upto SETTINGS_MAX_ITEM_COUNT.
+#define ITEM_COUNT_CHOICE_COUNT                 4
+extern const uint32_t item_count_choices[ITEM_COUNT_CHOICE_COUNT];
+
+#define SETTING_TYPE_BOOL                       0 // 0 or 1, true or false, on or off.
+#define SETTING_TYPE_UINT                       1 // a number between the minimum and maximum, or one of the choices.
+#define SETTING_TYPE_KEY                        2 // a character, or tab or space.
+
+// when a changed setting takes effect, the game checks for edits of the file at every tick.
+#define SETTING_APPLY_NOW                       0 // from the next tick or frame on.
+#define SETTING_APPLY_NEXT_GAME                 1 // the board is built with it, a game in progress keeps the old value.
+
+// every tunable of the game, as read from settings.ini. the defaults are what a missing file or key gets.
+struct GameSettings
+{
+    GameSettings() : m_snake_can_cut_itself(false), m_snake_can_pass_border(false), m_color_mode(0), m_theme(0),
+                     m_density(0), m_turbo_tick_rate(0), m_tick_rate(0), m_board_columns(0), m_board_rows(0),
+                     m_item_count(0), m_key_up('w'), m_key_left('a'), m_key_down('s'), m_key_right('d'),
+                     m_key_pause('p'), m_key_autopilot('\t') {}
+
+    bool m_snake_can_cut_itself;
+    bool m_snake_can_pass_border;
+    uint8_t m_color_mode;
+    uint8_t m_theme;
+    uint8_t m_density;
+    uint32_t m_turbo_tick_rate;
+    uint32_t m_tick_rate;       // ticks per second outside turbo mode, 0 keeps the speed of the difficulty.
+    uint16_t m_board_columns;   // 0 keeps the board size of the difficulty, levels always keep their own.
+    uint16_t m_board_rows;
+    uint32_t m_item_count;      // items on the board besides the food ( see items.h ), a small board gets fewer.
+
+    // the arrow keys and Escape always work, these are the keys next to them. letters match either case.
+    int32_t m_key_up;
+    int32_t m_key_left;
+    int32_t m_key_down;
+    int32_t m_key_right;
+    int32_t m_key_pause;
+    int32_t m_key_autopilot;
+};
+
+// the schema of settings.ini, one entry per key in the order they are written.
+struct SettingDefinition
+{
+    const char* m_name;
+    uint8_t m_type;
+    uint8_t m_apply;
+    std::size_t m_offset;           // of the value in GameSettings.
+    std::size_t m_size;             // of the value, bools and all unsigned sizes are read and written through it.
+    uint32_t m_minimum;
+    uint32_t m_maximum;
+    const uint32_t* m_choices;      // when set the value must be one of these instead of in the range.
+    uint32_t m_choice_count;
+};
+
+extern const SettingDefinition setting_definitions[];
+extern const uint32_t setting_definition_count;
+
+// what the last read of the file found wrong, lines that are wrong leave their setting as it was.
+struct SettingsParseResult
+{
+    SettingsParseResult() : m_read_count(0), m_rejected_count(0), m_first_rejected_line(0) {}
+
+    uint32_t m_read_count;
+    uint32_t m_rejected_count;      // unknown keys, missing '=' and values of the wrong type or out of range.
+    uint32_t m_first_rejected_line;
+};
+
+// parses "key = value" lines in a single pass, '#' and ';' start comments. settings not in the text keep their
+// value, so a file written by an older version only changes what it has.
+SettingsParseResult ParseSettings( const char* text, std::size_t size, GameSettings& settings );
+
+// false if the file couldn't be read, a missing file is not an error and leaves the settings as they are.
+bool ReadSettingsFile( const char* path, GameSettings& settings, SettingsParseResult& result );
+
+// writes to a temporary file and renames it over path, so nothing ever reads half of the file.
+bool WriteSettingsFile( const char* path, const GameSettings& settings );
+
+// true if any setting with the given apply mode differs between the two.
+bool SettingsDiffer( const GameSettings& first, const GameSettings& second, uint8_t apply );
+
+// watches the directory of the settings file with inotify, editors and WriteSettingsFile() replace the file by
+// renaming, which a watch on the file itself wouldn't survive.
+struct SettingsWatch
+{
+    SettingsWatch() : m_fd(-1), m_watch(-1), m_file_name(nullptr), m_event_count(0) {}
+
+    SettingsWatch( const SettingsWatch& other ) = delete;
+    SettingsWatch& operator=( const SettingsWatch& other ) = delete;
+
+    int m_fd;
+    int m_watch;
+    const char* m_file_name;        // the part of the path after the directory.
+    uint64_t m_event_count;         // changes of the file seen so far.
+};
+
+bool StartSettingsWatch( SettingsWatch& watch, const char* path );
+void StopSettingsWatch( SettingsWatch& watch );
+
+// never blocks, true if the file was written or replaced since the last call.
+bool HasSettingsFileChanged( SettingsWatch& watch );
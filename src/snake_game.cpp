@@ -0,0 +1,408 @@
+#include "snake_game.h"
+
+#include <cstring>
+
+static uint64_t MixSeed( uint64_t seed )
+{
+    // splitmix64, so that close seeds ( like consecutive time(NULL) values ) don't give close sequences.
+    seed += 0x9e3779b97f4a7c15ULL;
+    seed = ( seed ^ ( seed >> 30 ) ) * 0xbf58476d1ce4e5b9ULL;
+    seed = ( seed ^ ( seed >> 27 ) ) * 0x94d049bb133111ebULL;
+    seed ^= seed >> 31;
+
+    return seed ? seed : 1;
+}
+
+uint32_t NextSnakeGameRandom( SnakeGameState& state )
+{
+    // xorshift64*, the whole generator is a single 64 bit word so it can be saved and restored with the game.
+    uint64_t x = state.m_random_state;
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    state.m_random_state = x;
+
+    return uint32_t(( x * 0x2545f4914f6cdd1dULL ) >> 32);
+}
+
+bool IsOppositeDirection( uint8_t first, uint8_t second )
+{
+    return ( first == SNAKE_DIRECTION_UP && second == SNAKE_DIRECTION_DOWN ) ||
+           ( first == SNAKE_DIRECTION_DOWN && second == SNAKE_DIRECTION_UP ) ||
+           ( first == SNAKE_DIRECTION_LEFT && second == SNAKE_DIRECTION_RIGHT ) ||
+           ( first == SNAKE_DIRECTION_RIGHT && second == SNAKE_DIRECTION_LEFT );
+}
+
+// the table is built once per game, so a move is a single lookup no matter the direction, the edges or the rules.
+// with passing borders on, the inside of the walls is a torus: stepping onto the border lands on the opposite
+// inner cell. border cells themselves lead to themselves, the snake never stands on them.
+static void BuildNeighborTable( uint32_t* neighbors, uint16_t size_x, uint16_t size_y, uint8_t rules )
+{
+    bool wrap = rules & SNAKE_RULE_PASS_BORDERS;
+    uint32_t inner_x = size_x - 2, inner_y = size_y - 2;
+
+    for( uint32_t y = 0; y < size_y; ++y )
+    {
+        for( uint32_t x = 0; x < size_x; ++x )
+        {
+            uint32_t cell = x + y * size_x;
+            uint32_t* out = neighbors + cell * 4;
+
+            if( x == 0 || y == 0 || x + 1 == size_x || y + 1 == size_y )
+            {
+                out[0] = out[1] = out[2] = out[3] = cell;
+                continue;
+            }
+
+            uint32_t up = y - 1, left = x - 1, down = y + 1, right = x + 1;
+            if( wrap )
+            {
+                up = ( y - 1 + inner_y - 1 ) % inner_y + 1;
+                left = ( x - 1 + inner_x - 1 ) % inner_x + 1;
+                down = y % inner_y + 1;
+                right = x % inner_x + 1;
+            }
+
+            out[SNAKE_DIRECTION_UP - 1] = x + up * size_x;
+            out[SNAKE_DIRECTION_LEFT - 1] = left + y * size_x;
+            out[SNAKE_DIRECTION_DOWN - 1] = x + down * size_x;
+            out[SNAKE_DIRECTION_RIGHT - 1] = right + y * size_x;
+        }
+    }
+}
+
+std::size_t ComputeSnakeGameMemorySize( uint16_t size_x, uint16_t size_y )
+{
+    std::size_t cell_count = std::size_t(size_x) * size_y;
+
+    return ArenaFootprint<char>(cell_count) + ArenaFootprint<uint32_t>(cell_count + SNAKE_GAME_MAX_UNDO_STEPS) +
+           ArenaFootprint<uint32_t>(cell_count * 4);
+}
+
+bool InitializeSnakeGameState( SnakeGameState& state, GameArena& arena, uint16_t size_x, uint16_t size_y,
+                               uint64_t seed, uint8_t rules )
+{
+    if( size_x < SNAKE_GAME_MIN_SIZE || size_y < SNAKE_GAME_MIN_SIZE ||
+        size_x > SNAKE_GAME_MAX_SIZE || size_y > SNAKE_GAME_MAX_SIZE )
+        return false;
+
+    uint32_t cell_count = uint32_t(size_x) * size_y;
+
+    char* field = arena.AllocateArray<char>(cell_count);
+    uint32_t* body = arena.AllocateArray<uint32_t>(cell_count + SNAKE_GAME_MAX_UNDO_STEPS);
+    uint32_t* neighbors = arena.AllocateArray<uint32_t>(std::size_t(cell_count) * 4);
+    if( !field || !body || !neighbors )
+        return false;
+
+    BuildNeighborTable(neighbors,size_x,size_y,rules & SNAKE_RULE_ALL);
+
+    state = SnakeGameState();
+    state.m_size_x = size_x;
+    state.m_size_y = size_y;
+    state.m_field = field;
+    state.m_body = body;
+    state.m_neighbors = neighbors;
+    state.m_body_capacity = cell_count + SNAKE_GAME_MAX_UNDO_STEPS;
+    state.m_rules = rules & SNAKE_RULE_ALL;
+    state.m_spawn_cells = nullptr;
+    state.m_spawn_cell_count = 0;
+    state.m_free_cell_count = uint32_t(size_x - 2) * ( size_y - 2 );
+    state.m_random_state = MixSeed(seed);
+
+    std::memset(field,SNAKE_CELL_EMPTY,cell_count);
+
+    for( uint16_t x = 0; x < size_x; ++x )
+    {
+        field[x] = SNAKE_CELL_WALL;
+        field[x + ( size_y - 1 ) * size_x] = SNAKE_CELL_WALL;
+    }
+
+    for( uint16_t y = 0; y < size_y; ++y )
+    {
+        field[y * size_x] = SNAKE_CELL_WALL;
+        field[size_x - 1 + y * size_x] = SNAKE_CELL_WALL;
+    }
+
+    state.m_status = GAME_STATUS_CAN_BEGIN;
+
+    return true;
+}
+
+// every write a step makes to the field goes through here, so it can be recorded when the step must be undoable.
+static void SetCell( SnakeGameState& state, uint32_t cell, char value, SnakeGameUndoRecord* undo )
+{
+    if( undo )
+    {
+        undo->m_cells[undo->m_cell_count] = cell;
+        undo->m_cell_values[undo->m_cell_count] = state.m_field[cell];
+        ++undo->m_cell_count;
+    }
+
+    state.m_field[cell] = value;
+}
+
+static void PlaceSnakeFood( SnakeGameState& state, SnakeGameUndoRecord* undo )
+{
+    uint32_t cell_count = state.CellCount();
+    uint32_t cell = NextSnakeGameRandom(state) % cell_count;
+
+    // random tries are fine while the board is mostly empty, after that we just walk to the next empty cell.
+    for( int tries = 0; tries < 64 && state.m_field[cell] != SNAKE_CELL_EMPTY; ++tries )
+        cell = NextSnakeGameRandom(state) % cell_count;
+
+    for( uint32_t i = 0; i < cell_count && state.m_field[cell] != SNAKE_CELL_EMPTY; ++i )
+        cell = ( cell + 1 == cell_count ) ? 0 : cell + 1;
+
+    // items ( see items.h ) can take every cell the snake left free, the food then goes on top of one of them.
+    // the walk above came back to where it started then, which could be anything.
+    for( uint32_t i = 0; i < cell_count && ( state.m_field[cell] == SNAKE_CELL_WALL ||
+         state.m_field[cell] == SNAKE_CELL_HEAD || state.m_field[cell] == SNAKE_CELL_BODY ); ++i )
+        cell = ( cell + 1 == cell_count ) ? 0 : cell + 1;
+
+    state.m_food = cell;
+    SetCell(state,cell,SNAKE_CELL_FOOD,undo);
+}
+
+void PlaceSnakeFood( SnakeGameState& state )
+{
+    PlaceSnakeFood(state,nullptr);
+}
+
+bool GrowSnakeTail( SnakeGameState& state )
+{
+    // the ring slot behind the tail still holds the cell the tail was on before the last step. when the step grew
+    // the slot is one the snake never got to, early in a game it was never written and holds anything.
+    uint32_t cell = state.BodyCell(state.m_length);
+    if( state.m_status != GAME_STATUS_ONGOING || cell >= state.CellCount() ||
+        state.m_field[cell] != SNAKE_CELL_EMPTY )
+        return false;
+
+    // and a stale cell that happens to be empty has to be next to the tail, or the body would have a gap.
+    uint32_t tail = state.BodyCell(state.m_length - 1);
+    uint8_t direction = SNAKE_DIRECTION_UP;
+    while( direction <= SNAKE_DIRECTION_RIGHT && state.Neighbor(tail,direction) != cell )
+        ++direction;
+
+    if( direction > SNAKE_DIRECTION_RIGHT )
+        return false;
+
+    state.m_field[cell] = SNAKE_CELL_BODY;
+    ++state.m_length;
+
+    if( state.m_length == state.m_free_cell_count )
+        state.m_status = GAME_STATUS_WON;
+
+    return true;
+}
+
+uint32_t ShrinkSnakeTail( SnakeGameState& state, uint32_t count )
+{
+    uint32_t dropped = 0;
+    for( ; dropped < count && state.m_length > 1; ++dropped )
+    {
+        --state.m_length;
+        state.m_field[state.BodyCell(state.m_length)] = SNAKE_CELL_EMPTY;
+    }
+
+    return dropped;
+}
+
+void StartSnakeGameState( SnakeGameState& state )
+{
+    for( uint32_t cell = 0; cell < state.CellCount(); ++cell )
+    {
+        if( state.m_field[cell] != SNAKE_CELL_WALL )
+            state.m_field[cell] = SNAKE_CELL_EMPTY;
+    }
+
+    uint32_t head;
+    uint8_t directions[4];
+    uint8_t direction_count = 0;
+
+    // a level has worked out where it's safe to start and which way, one random pick is enough.
+    if( state.m_spawn_cell_count )
+    {
+        uint32_t spawn = state.m_spawn_cells[NextSnakeGameRandom(state) % state.m_spawn_cell_count];
+        head = spawn & SNAKE_SPAWN_CELL_MASK;
+
+        for( uint8_t direction = SNAKE_DIRECTION_UP; direction <= SNAKE_DIRECTION_RIGHT; ++direction )
+        {
+            if( spawn >> ( SNAKE_SPAWN_DIRECTION_SHIFT + direction - SNAKE_DIRECTION_UP ) & 1 )
+                directions[direction_count++] = direction;
+        }
+    }
+
+    else
+    {
+        do
+        {
+            head = NextSnakeGameRandom(state) % state.CellCount();
+        } while( state.m_field[head] == SNAKE_CELL_WALL ); // so that snake doesn't spawn at borders.
+
+        // don't start the game by facing a wall.
+        for( uint8_t direction = SNAKE_DIRECTION_UP; direction <= SNAKE_DIRECTION_RIGHT; ++direction )
+        {
+            if( state.m_field[state.Neighbor(head,direction)] != SNAKE_CELL_WALL )
+                directions[direction_count++] = direction;
+        }
+    }
+
+    state.m_direction = direction_count ? directions[NextSnakeGameRandom(state) % direction_count] :
+                                          SNAKE_DIRECTION_UP;
+
+    state.m_body_head = 0;
+    state.m_body[0] = head;
+    state.m_length = 1;
+    state.m_field[head] = SNAKE_CELL_HEAD;
+    state.m_score = 0;
+    state.m_tick = 0;
+
+    PlaceSnakeFood(state);
+
+    state.m_status = GAME_STATUS_ONGOING;
+}
+
+static uint8_t StepSnakeGame( SnakeGameState& state, uint8_t direction_to_move, SnakeGameUndoRecord* undo )
+{
+    if( state.m_status != GAME_STATUS_ONGOING )
+        return state.m_status;
+
+    if( undo )
+    {
+        undo->m_random_state = state.m_random_state;
+        undo->m_tick = state.m_tick;
+        undo->m_body_head = state.m_body_head;
+        undo->m_length = state.m_length;
+        undo->m_food = state.m_food;
+        undo->m_score = state.m_score;
+        undo->m_cut_index = 0;
+        undo->m_cell_count = 0;
+        undo->m_direction = state.m_direction;
+        undo->m_status = state.m_status;
+    }
+
+    if( direction_to_move != SNAKE_DIRECTION_NONE && !IsOppositeDirection(state.m_direction,direction_to_move) )
+        state.m_direction = direction_to_move;
+
+    uint32_t head = state.Head();
+    uint32_t next = state.Neighbor(head,state.m_direction);
+    uint32_t tail = state.BodyCell(state.m_length - 1);
+    char target = state.m_field[next];
+
+    ++state.m_tick;
+
+    // the tail leaves it's cell in the same tick, so chasing our own tail is not a collision.
+    bool bites_body = target == SNAKE_CELL_BODY && next != tail;
+
+    if( target == SNAKE_CELL_WALL || ( bites_body && !( state.m_rules & SNAKE_RULE_CUT_ITSELF ) ) )
+    {
+        state.m_status = GAME_STATUS_LOST;
+        return state.m_status;
+    }
+
+    if( target == SNAKE_CELL_FOOD )
+        ++state.m_length;
+
+    else if( bites_body )
+    {
+        // everything from the bitten part to the tail falls off, the head then moves into the freed cell.
+        // the dropped parts stay in the ring, which is what lets undo put them back.
+        uint32_t cut_index = 1;
+        while( state.BodyCell(cut_index) != next )
+            ++cut_index;
+
+        for( uint32_t i = cut_index; i < state.m_length; ++i )
+            state.m_field[state.BodyCell(i)] = SNAKE_CELL_EMPTY;
+
+        if( undo )
+            undo->m_cut_index = cut_index;
+
+        state.m_length = cut_index + 1;
+    }
+
+    else
+    {
+        SetCell(state,tail,SNAKE_CELL_EMPTY,undo);
+    }
+
+    if( state.m_length > 1 )
+        SetCell(state,head,SNAKE_CELL_BODY,undo);
+
+    // the slot in front of the head is outside the live body until the snake fills the whole ring, so undo
+    // doesn't need it back.
+    state.m_body_head = ( state.m_body_head == 0 ) ? state.m_body_capacity - 1 : state.m_body_head - 1;
+    state.m_body[state.m_body_head] = next;
+    SetCell(state,next,SNAKE_CELL_HEAD,undo);
+
+    if( target == SNAKE_CELL_FOOD )
+    {
+        state.m_score += 10;
+
+        if( state.m_length == state.m_free_cell_count )
+            state.m_status = GAME_STATUS_WON;
+        else
+            PlaceSnakeFood(state,undo);
+    }
+
+    return state.m_status;
+}
+
+uint8_t StepSnakeGame( SnakeGameState& state, uint8_t direction_to_move )
+{
+    return StepSnakeGame(state,direction_to_move,nullptr);
+}
+
+uint8_t StepSnakeGame( SnakeGameState& state, uint8_t direction_to_move, SnakeGameUndoRecord& undo )
+{
+    undo.m_cell_count = 0;
+    undo.m_status = GAME_STATUS_NOT_INITIALIZED; // marks a step that didn't change anything.
+
+    return StepSnakeGame(state,direction_to_move,&undo);
+}
+
+void UndoSnakeGameStep( SnakeGameState& state, const SnakeGameUndoRecord& undo )
+{
+    if( undo.m_status == GAME_STATUS_NOT_INITIALIZED )
+        return;
+
+    for( int i = undo.m_cell_count - 1; i >= 0; --i )
+        state.m_field[undo.m_cells[i]] = undo.m_cell_values[i];
+
+    state.m_random_state = undo.m_random_state;
+    state.m_tick = undo.m_tick;
+    state.m_body_head = undo.m_body_head;
+    state.m_length = undo.m_length;
+    state.m_food = undo.m_food;
+    state.m_score = undo.m_score;
+    state.m_direction = undo.m_direction;
+    state.m_status = undo.m_status;
+
+    for( uint32_t i = undo.m_cut_index; i && i < state.m_length; ++i )
+        state.m_field[state.BodyCell(i)] = SNAKE_CELL_BODY;
+}
+
+bool CloneSnakeGameState( const SnakeGameState& source, SnakeGameState& clone, GameArena& arena )
+{
+    uint32_t cell_count = source.CellCount();
+
+    char* field = arena.AllocateArray<char>(cell_count);
+    uint32_t* body = arena.AllocateArray<uint32_t>(source.m_body_capacity);
+    if( !field || !body )
+        return false;
+
+    std::memcpy(field,source.m_field,cell_count);
+
+    // only the live part of the ring buffer matters, copy it in at most two pieces.
+    uint32_t first_piece = source.m_body_capacity - source.m_body_head;
+    if( first_piece > source.m_length )
+        first_piece = source.m_length;
+
+    std::memcpy(body + source.m_body_head,source.m_body + source.m_body_head,first_piece * sizeof(uint32_t));
+    std::memcpy(body,source.m_body,( source.m_length - first_piece ) * sizeof(uint32_t));
+
+    clone = source;
+    clone.m_field = field;
+    clone.m_body = body;
+
+    return true;
+}
@@ -0,0 +1,144 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "arena.h"
+
+#define GAME_STATUS_NOT_INITIALIZED             0
+#define GAME_STATUS_CAN_BEGIN                   1
+#define GAME_STATUS_WON                         2
+#define GAME_STATUS_ONGOING                     3
+#define GAME_STATUS_LOST                        4
+
+#define SNAKE_DIRECTION_NONE                    0
+#define SNAKE_DIRECTION_UP                      1
+#define SNAKE_DIRECTION_LEFT                    2
+#define SNAKE_DIRECTION_DOWN                    3
+#define SNAKE_DIRECTION_RIGHT                   4
+
+// what each cell of the field holds, these are also the characters the field is drawn with.
+#define SNAKE_CELL_EMPTY                        ' '
+#define SNAKE_CELL_WALL                         '#'
+#define SNAKE_CELL_FOOD                         '@'
+#define SNAKE_CELL_HEAD                         'x'
+#define SNAKE_CELL_BODY                         'o'
+
+#define SNAKE_GAME_MIN_SIZE                     4
+#define SNAKE_GAME_MAX_SIZE                     4096
+
+// optional rules of a game, fixed when the game is initialized.
+#define SNAKE_RULE_PASS_BORDERS                 1 // leaving through the border comes back in from the other side.
+#define SNAKE_RULE_CUT_ITSELF                   2 // biting the body cuts it off there instead of losing.
+#define SNAKE_RULE_ALL                          ( SNAKE_RULE_PASS_BORDERS | SNAKE_RULE_CUT_ITSELF )
+
+// a spawn cell keeps the directions that are safe to start in above the cell index, one bit per direction
+// starting with SNAKE_DIRECTION_UP at SNAKE_SPAWN_DIRECTION_SHIFT.
+#define SNAKE_SPAWN_DIRECTION_SHIFT             28
+#define SNAKE_SPAWN_CELL_MASK                   ( ( 1u << SNAKE_SPAWN_DIRECTION_SHIFT ) - 1 )
+
+// the body ring has this many slots more than the field has cells, so the parts a cut drops are still in the
+// ring for this many steps and the cut can be undone.
+#define SNAKE_GAME_MAX_UNDO_STEPS               64
+
+// everything a single game consists of. the field and the body are not owned by the state, they are carved out
+// of the arena passed to InitializeSnakeGameState(), so copying a game is just copying those two buffers.
+// the neighbor table never changes after initialization, so clones share it.
+struct SnakeGameState
+{
+    SnakeGameState() : m_size_x(0), m_size_y(0), m_field(nullptr), m_body(nullptr), m_neighbors(nullptr),
+                       m_body_capacity(0), m_body_head(0), m_length(0), m_free_cell_count(0), m_food(0), m_score(0),
+                       m_tick(0), m_random_state(0), m_spawn_cells(nullptr), m_spawn_cell_count(0),
+                       m_direction(SNAKE_DIRECTION_NONE), m_status(GAME_STATUS_NOT_INITIALIZED), m_rules(0) {}
+
+    uint32_t CellCount() const { return uint32_t(m_size_x) * m_size_y; }
+
+    uint32_t Head() const { return m_body[m_body_head]; }
+
+    // 0 is the head, m_length - 1 is the tail.
+    uint32_t BodyCell( uint32_t index ) const
+    {
+        uint32_t slot = m_body_head + index;
+        if( slot >= m_body_capacity )
+            slot -= m_body_capacity;
+
+        return m_body[slot];
+    }
+
+    // the cell a move from cell in direction lands on, borders and wrapping are already taken care of by the table.
+    uint32_t Neighbor( uint32_t cell, uint8_t direction ) const { return m_neighbors[cell * 4 + direction - 1]; }
+
+    uint16_t m_size_x;
+    uint16_t m_size_y;
+    char* m_field;              // m_size_x * m_size_y cells, a cell at (x,y) is m_field[ x + y * m_size_x ].
+    uint32_t* m_body;           // ring buffer of cell indices, the head is at m_body_head and the body follows it.
+    const uint32_t* m_neighbors; // 4 cells per cell, in the order of the SNAKE_DIRECTION_* values.
+    uint32_t m_body_capacity;
+    uint32_t m_body_head;
+    uint32_t m_length;
+    uint32_t m_free_cell_count; // cells that are not walls, the game is won when the snake fills all of them.
+    uint32_t m_food;
+    int32_t m_score;
+    uint64_t m_tick;
+    uint64_t m_random_state;
+    const uint32_t* m_spawn_cells; // set by a level ( see level.h ), nullptr lets the snake spawn anywhere.
+    uint32_t m_spawn_cell_count;
+    uint8_t m_direction;
+    uint8_t m_status;
+    uint8_t m_rules;
+};
+
+// what StepSnakeGame() needs to take a step back. a step writes to atmost 4 cells: the tail, the old head,
+// the new head and the new food. a cut also empties the dropped parts, those are put back from the body ring.
+struct SnakeGameUndoRecord
+{
+    uint64_t m_random_state;
+    uint64_t m_tick;
+    uint32_t m_body_head;
+    uint32_t m_length;
+    uint32_t m_food;
+    int32_t m_score;
+    uint32_t m_cut_index;       // body index the head bit into, 0 when the step didn't cut.
+    uint32_t m_cells[4];
+    char m_cell_values[4];
+    uint8_t m_cell_count;
+    uint8_t m_direction;
+    uint8_t m_status;
+};
+
+// bytes of arena a game of this size needs, alignment padding included.
+std::size_t ComputeSnakeGameMemorySize( uint16_t size_x, uint16_t size_y );
+
+// allocates the field, body and neighbor table of the game from arena and builds the border walls.
+// rules is a mask of SNAKE_RULE_* values. does not reset the arena.
+bool InitializeSnakeGameState( SnakeGameState& state, GameArena& arena, uint16_t size_x, uint16_t size_y,
+                               uint64_t seed, uint8_t rules = 0 );
+
+// clears whatever is inside the borders, then spawns the snake and the first food.
+void StartSnakeGameState( SnakeGameState& state );
+
+// moves the game one tick forward, direction_to_move is ignored if it is NONE or the opposite of current direction.
+// returns the status of the game after the move.
+uint8_t StepSnakeGame( SnakeGameState& state, uint8_t direction_to_move );
+
+// same as above, but records everything the step changed so UndoSnakeGameStep() can put it back.
+// steps must be undone in reverse order, and a cut only stays undoable for SNAKE_GAME_MAX_UNDO_STEPS steps.
+uint8_t StepSnakeGame( SnakeGameState& state, uint8_t direction_to_move, SnakeGameUndoRecord& undo );
+void UndoSnakeGameStep( SnakeGameState& state, const SnakeGameUndoRecord& undo );
+
+// copies source into clone, with the field and body of the clone allocated from arena. the neighbor table is shared.
+bool CloneSnakeGameState( const SnakeGameState& source, SnakeGameState& clone, GameArena& arena );
+
+void PlaceSnakeFood( SnakeGameState& state );
+
+// puts the part the tail left in the last step back, as if that step had eaten. false when the cell was taken
+// since ( the head chased the tail into it, or the step already grew ). neither this nor the shrink below can
+// be undone, they are for what happens between steps.
+bool GrowSnakeTail( SnakeGameState& state );
+
+// drops upto count parts off the tail, the head always stays. returns how many were dropped.
+uint32_t ShrinkSnakeTail( SnakeGameState& state, uint32_t count );
+
+bool IsOppositeDirection( uint8_t first, uint8_t second );
+
+uint32_t NextSnakeGameRandom( SnakeGameState& state );
@@ -0,0 +1,323 @@
+#include "snapshot.h"
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include <unistd.h>
+#include <fcntl.h>
+
+// header layout, offsets in bytes:
+//  0 magic              u32     36 rules              u8, zero in snapshots from before the rules were saved
+//  4 version            u16     37 reserved           3 bytes
+//  6 header size        u16     40 tick               u64
+//  8 size x             u16     48 random state       u64
+// 10 size y             u16     56 checksum           u64
+// 12 status             u8      64 player name        20 bytes, not null terminated
+// 13 direction          u8      84 reserved           4 bytes
+// 14 difficulty         u8
+// 15 player name length u8
+// 16 length             u32
+// 20 head cell          u32
+// 24 food cell          u32
+// 28 score              i32
+// 32 elapsed seconds    u32
+
+static void PutU16( uint8_t* out, uint16_t value )
+{
+    out[0] = uint8_t(value);
+    out[1] = uint8_t(value >> 8);
+}
+
+static void PutU32( uint8_t* out, uint32_t value )
+{
+    for( int i = 0; i < 4; ++i )
+        out[i] = uint8_t(value >> ( i * 8 ));
+}
+
+static void PutU64( uint8_t* out, uint64_t value )
+{
+    for( int i = 0; i < 8; ++i )
+        out[i] = uint8_t(value >> ( i * 8 ));
+}
+
+static uint16_t GetU16( const uint8_t* in )
+{
+    return uint16_t(in[0] | ( in[1] << 8 ));
+}
+
+static uint32_t GetU32( const uint8_t* in )
+{
+    uint32_t value = 0;
+    for( int i = 3; i >= 0; --i )
+        value = ( value << 8 ) | in[i];
+
+    return value;
+}
+
+static uint64_t GetU64( const uint8_t* in )
+{
+    uint64_t value = 0;
+    for( int i = 7; i >= 0; --i )
+        value = ( value << 8 ) | in[i];
+
+    return value;
+}
+
+// FNV-1a over the whole snapshot with the checksum field itself read as zeros. we only need to catch
+// corrupted or hand edited files, not attackers.
+static uint64_t ComputeChecksum( const uint8_t* data, std::size_t size )
+{
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for( std::size_t i = 0; i < size; ++i )
+    {
+        hash ^= ( i >= 56 && i < 64 ) ? 0 : data[i];
+        hash *= 0x100000001b3ULL;
+    }
+
+    return hash;
+}
+
+static std::size_t WallBitmapSize( uint32_t cell_count )
+{
+    return ( std::size_t(cell_count) + 7 ) / 8;
+}
+
+static std::size_t BodyChainSize( uint32_t length )
+{
+    return length > 1 ? ( std::size_t(length - 1) * 2 + 7 ) / 8 : 0;
+}
+
+// the 2 bit code is the direction minus one. steps go through the neighbor table, so a body that wraps around
+// the border when passing borders is on is encoded the same way.
+static uint8_t EncodeBodyStep( const SnakeGameState& state, uint32_t from, uint32_t to )
+{
+    uint8_t direction = SNAKE_DIRECTION_UP;
+    while( direction < SNAKE_DIRECTION_RIGHT && state.Neighbor(from,direction) != to )
+        ++direction;
+
+    return direction - 1;
+}
+
+static uint32_t DecodeBodyStep( const SnakeGameState& state, uint32_t from, uint8_t code )
+{
+    return state.Neighbor(from,code + 1);
+}
+
+std::size_t ComputeSnakeGameSnapshotSize( const SnakeGameState& state )
+{
+    return SNAKE_SNAPSHOT_HEADER_SIZE + WallBitmapSize(state.CellCount()) + BodyChainSize(state.m_length);
+}
+
+std::size_t WriteSnakeGameSnapshot( const SnakeGameState& state, const SnakeGameSnapshotInfo& info,
+                                    uint8_t* buffer, std::size_t capacity )
+{
+    std::size_t size = ComputeSnakeGameSnapshotSize(state);
+    if( capacity < size || !state.m_field )
+        return 0;
+
+    std::memset(buffer,0,size);
+
+    uint8_t* walls = buffer + SNAKE_SNAPSHOT_HEADER_SIZE;
+    uint8_t* chain = walls + WallBitmapSize(state.CellCount());
+
+    for( uint32_t cell = 0; cell < state.CellCount(); ++cell )
+    {
+        if( state.m_field[cell] == SNAKE_CELL_WALL )
+            walls[cell >> 3] |= uint8_t(1 << ( cell & 7 ));
+    }
+
+    for( uint32_t i = 1; i < state.m_length; ++i )
+    {
+        uint8_t code = EncodeBodyStep(state,state.BodyCell(i - 1),state.BodyCell(i));
+        uint32_t bit = ( i - 1 ) * 2;
+        chain[bit >> 3] |= uint8_t(code << ( bit & 7 ));
+    }
+
+    std::size_t name_length = strnlen(info.m_player_name,SNAKE_SNAPSHOT_PLAYER_NAME_LENGTH);
+
+    PutU32(buffer,SNAKE_SNAPSHOT_MAGIC);
+    PutU16(buffer + 4,SNAKE_SNAPSHOT_VERSION);
+    PutU16(buffer + 6,SNAKE_SNAPSHOT_HEADER_SIZE);
+    PutU16(buffer + 8,state.m_size_x);
+    PutU16(buffer + 10,state.m_size_y);
+    buffer[12] = state.m_status;
+    buffer[13] = state.m_direction;
+    buffer[14] = info.m_difficulty;
+    buffer[15] = uint8_t(name_length);
+    PutU32(buffer + 16,state.m_length);
+    PutU32(buffer + 20,state.m_length ? state.Head() : 0);
+    PutU32(buffer + 24,state.m_food);
+    PutU32(buffer + 28,uint32_t(state.m_score));
+    PutU32(buffer + 32,info.m_elapsed_seconds);
+    buffer[36] = state.m_rules;
+    PutU64(buffer + 40,state.m_tick);
+    PutU64(buffer + 48,state.m_random_state);
+    std::memcpy(buffer + 64,info.m_player_name,name_length);
+    PutU64(buffer + 56,ComputeChecksum(buffer,size));
+
+    return size;
+}
+
+bool ReadSnakeGameSnapshotBoardSize( const uint8_t* data, std::size_t size, uint16_t& size_x, uint16_t& size_y )
+{
+    if( size < SNAKE_SNAPSHOT_HEADER_SIZE || GetU32(data) != SNAKE_SNAPSHOT_MAGIC ||
+        GetU16(data + 4) != SNAKE_SNAPSHOT_VERSION || GetU16(data + 6) != SNAKE_SNAPSHOT_HEADER_SIZE )
+        return false;
+
+    size_x = GetU16(data + 8);
+    size_y = GetU16(data + 10);
+
+    return size_x >= SNAKE_GAME_MIN_SIZE && size_y >= SNAKE_GAME_MIN_SIZE &&
+           size_x <= SNAKE_GAME_MAX_SIZE && size_y <= SNAKE_GAME_MAX_SIZE;
+}
+
+bool ReadSnakeGameSnapshot( SnakeGameState& state, GameArena& arena, SnakeGameSnapshotInfo& info,
+                            const uint8_t* data, std::size_t size )
+{
+    uint16_t size_x, size_y;
+    if( !ReadSnakeGameSnapshotBoardSize(data,size,size_x,size_y) )
+        return false;
+
+    uint32_t cell_count = uint32_t(size_x) * size_y;
+    uint8_t status = data[12];
+    uint8_t direction = data[13];
+    uint8_t name_length = data[15];
+    uint32_t length = GetU32(data + 16);
+    uint32_t head = GetU32(data + 20);
+    uint32_t food = GetU32(data + 24);
+    uint8_t rules = data[36];
+
+    if( status < GAME_STATUS_CAN_BEGIN || status > GAME_STATUS_LOST ||
+        direction < SNAKE_DIRECTION_UP || direction > SNAKE_DIRECTION_RIGHT ||
+        name_length > SNAKE_SNAPSHOT_PLAYER_NAME_LENGTH || length == 0 || length > cell_count ||
+        head >= cell_count || food >= cell_count || ( rules & ~SNAKE_RULE_ALL ) )
+        return false;
+
+    if( size != SNAKE_SNAPSHOT_HEADER_SIZE + WallBitmapSize(cell_count) + BodyChainSize(length) ||
+        GetU64(data + 56) != ComputeChecksum(data,size) )
+        return false;
+
+    // the walls are replaced by the ones in the snapshot, so the seed doesn't matter here.
+    if( !InitializeSnakeGameState(state,arena,size_x,size_y,1,rules) )
+        return false;
+
+    char* field = state.m_field;
+    uint32_t* body = state.m_body;
+    state.m_free_cell_count = 0;
+
+    const uint8_t* walls = data + SNAKE_SNAPSHOT_HEADER_SIZE;
+    const uint8_t* chain = walls + WallBitmapSize(cell_count);
+
+    for( uint32_t cell = 0; cell < cell_count; ++cell )
+    {
+        bool wall = walls[cell >> 3] & ( 1 << ( cell & 7 ) );
+        field[cell] = wall ? SNAKE_CELL_WALL : SNAKE_CELL_EMPTY;
+        state.m_free_cell_count += !wall;
+    }
+
+    uint32_t cell = head;
+    for( uint32_t i = 0; i < length; ++i )
+    {
+        if( i != 0 )
+        {
+            uint32_t bit = ( i - 1 ) * 2;
+            cell = DecodeBodyStep(state,cell,( chain[bit >> 3] >> ( bit & 7 ) ) & 3);
+        }
+
+        // a body part on a wall or on another part can only come from a broken snapshot.
+        if( field[cell] != SNAKE_CELL_EMPTY )
+            return false;
+
+        field[cell] = ( i == 0 ) ? SNAKE_CELL_HEAD : SNAKE_CELL_BODY;
+        body[i] = cell;
+    }
+
+    // once the game is won the snake is sitting on the last food.
+    if( status != GAME_STATUS_WON )
+    {
+        if( field[food] != SNAKE_CELL_EMPTY )
+            return false;
+
+        field[food] = SNAKE_CELL_FOOD;
+    }
+
+    state.m_body_head = 0;
+    state.m_length = length;
+    state.m_food = food;
+    state.m_score = int32_t(GetU32(data + 28));
+    state.m_tick = GetU64(data + 40);
+    state.m_random_state = GetU64(data + 48);
+    state.m_direction = direction;
+    state.m_status = status;
+
+    if( !state.m_random_state )
+        return false;
+
+    info.m_difficulty = data[14];
+    info.m_elapsed_seconds = GetU32(data + 32);
+    std::memset(info.m_player_name,0,sizeof(info.m_player_name));
+    std::memcpy(info.m_player_name,data + 64,name_length);
+
+    return true;
+}
+
+bool SaveSnakeGameSnapshot( const char* path, const SnakeGameState& state, const SnakeGameSnapshotInfo& info )
+{
+    std::vector<uint8_t> buffer(ComputeSnakeGameSnapshotSize(state));
+    std::size_t size = WriteSnakeGameSnapshot(state,info,buffer.data(),buffer.size());
+    if( !size )
+        return false;
+
+    char temporary_path[256];
+    if( std::snprintf(temporary_path,sizeof(temporary_path),"%s.tmp",path) >= int(sizeof(temporary_path)) )
+        return false;
+
+    int fd = open(temporary_path,O_WRONLY | O_CREAT | O_TRUNC,0644);
+    if( fd < 0 )
+        return false;
+
+    std::size_t written = 0;
+    while( written < size )
+    {
+        ssize_t result = write(fd,buffer.data() + written,size - written);
+        if( result <= 0 )
+        {
+            close(fd);
+            unlink(temporary_path);
+            return false;
+        }
+
+        written += result;
+    }
+
+    close(fd);
+
+    return rename(temporary_path,path) == 0;
+}
+
+bool LoadSnakeGameSnapshot( const char* path, SnakeGameState& state, GameArena& arena, SnakeGameSnapshotInfo& info )
+{
+    int fd = open(path,O_RDONLY);
+    if( fd < 0 )
+        return false;
+
+    std::vector<uint8_t> buffer;
+    uint8_t chunk[4096];
+    ssize_t result;
+
+    while( ( result = read(fd,chunk,sizeof(chunk)) ) > 0 )
+        buffer.insert(buffer.end(),chunk,chunk + result);
+
+    close(fd);
+
+    uint16_t size_x, size_y;
+    if( result < 0 || !ReadSnakeGameSnapshotBoardSize(buffer.data(),buffer.size(),size_x,size_y) )
+        return false;
+
+    arena.Reset();
+    if( !arena.Reserve(ComputeSnakeGameMemorySize(size_x,size_y)) )
+        return false;
+
+    return ReadSnakeGameSnapshot(state,arena,info,buffer.data(),buffer.size());
+}
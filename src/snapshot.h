@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "snake_game.h"
+
+// binary snapshot of a game, all numbers are little endian:
+//
+//   header ( SNAKE_SNAPSHOT_HEADER_SIZE bytes, see snapshot.cpp for the layout )
+//   wall bitmap, 1 bit per cell, ( cell count + 7 ) / 8 bytes
+//   body chain, 2 bits per body part after the head telling where the next part is,
+//   ( ( length - 1 ) * 2 + 7 ) / 8 bytes
+//
+// empty cells, food and the snake on the field are rebuilt from those while loading, so a snapshot is about an
+// eighth of the field size. the header carries a checksum of the whole file.
+// bump SNAKE_SNAPSHOT_VERSION whenever the layout changes, snapshots with another version are rejected.
+#define SNAKE_SNAPSHOT_MAGIC                    0x534b4e53 // "SNKS"
+#define SNAKE_SNAPSHOT_VERSION                  1
+#define SNAKE_SNAPSHOT_HEADER_SIZE              88
+#define SNAKE_SNAPSHOT_PLAYER_NAME_LENGTH       20
+
+// the parts of a snapshot that belong to the application around the game rather than the game itself.
+struct SnakeGameSnapshotInfo
+{
+    SnakeGameSnapshotInfo() : m_difficulty(0), m_elapsed_seconds(0), m_player_name{} {}
+
+    uint8_t m_difficulty;
+    uint32_t m_elapsed_seconds;
+    char m_player_name[SNAKE_SNAPSHOT_PLAYER_NAME_LENGTH + 1];
+};
+
+std::size_t ComputeSnakeGameSnapshotSize( const SnakeGameState& state );
+
+// returns the number of bytes written, or 0 if buffer is too small.
+std::size_t WriteSnakeGameSnapshot( const SnakeGameState& state, const SnakeGameSnapshotInfo& info,
+                                    uint8_t* buffer, std::size_t capacity );
+
+// rebuilds state from the snapshot, it's field and body are allocated from arena ( the arena is not reset here ).
+// the snapshot is fully validated, on failure false is returned and state must not be used.
+bool ReadSnakeGameSnapshot( SnakeGameState& state, GameArena& arena, SnakeGameSnapshotInfo& info,
+                            const uint8_t* data, std::size_t size );
+
+// reads just the header, so the caller can size an arena before loading the snapshot.
+bool ReadSnakeGameSnapshotBoardSize( const uint8_t* data, std::size_t size, uint16_t& size_x, uint16_t& size_y );
+
+// file versions of the above. saving replaces the file atomically so a crash never leaves half a snapshot behind,
+// loading resets arena and reserves enough of it for the board in the file.
+bool SaveSnakeGameSnapshot( const char* path, const SnakeGameState& state, const SnakeGameSnapshotInfo& info );
+bool LoadSnakeGameSnapshot( const char* path, SnakeGameState& state, GameArena& arena, SnakeGameSnapshotInfo& info );
@@ -0,0 +1,500 @@
+#include "soak.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+#include <unistd.h>
+
+#include "arena.h"
+#include "items.h"
+#include "reachability.h"
+#include "snake_game.h"
+
+// one move in this many ignores the board and goes anywhere, so games also end in walls and bites.
+#define SOAK_RECKLESS_MOVE_CHANCE               32
+// the greedy player can circle forever on a board it can't win, a game is called off after this many ticks a cell.
+#define SOAK_TICKS_PER_CELL                     16
+
+struct SoakCounts
+{
+    SoakCounts() : m_games(0), m_ticks(0), m_won(0), m_lost(0), m_called_off(0), m_items_picked_up(0) {}
+
+    uint64_t m_games;
+    uint64_t m_ticks;
+    uint64_t m_won;
+    uint64_t m_lost;
+    uint64_t m_called_off;
+    uint64_t m_items_picked_up;
+};
+
+// what the process holds at a report.
+struct SoakMemory
+{
+    uint64_t m_resident_kilobytes;
+    uint64_t m_heap_allocations;
+    uint64_t m_heap_deallocations;
+    uint64_t m_arena_heap_blocks;
+};
+
+// a plain flood fill over the neighbor table, what the bitboard fill of reachability.h has to agree with.
+struct SoakFloodFill
+{
+    SoakFloodFill() : m_queue(nullptr), m_seen(nullptr) {}
+
+    GameArena m_arena;
+    uint32_t* m_queue;
+    uint8_t* m_seen;
+};
+
+static uint64_t NextSoakRandom( uint64_t& state )
+{
+    state ^= state >> 12;
+    state ^= state << 25;
+    state ^= state >> 27;
+
+    return state * 0x2545f4914f6cdd1dULL;
+}
+
+static bool IsBorderCell( const SnakeGameState& state, uint32_t cell )
+{
+    uint32_t x = cell % state.m_size_x;
+    uint32_t y = cell / state.m_size_x;
+
+    return x == 0 || y == 0 || x + 1 == state.m_size_x || y + 1 == state.m_size_y;
+}
+
+// returns what's wrong with the state, nullptr when nothing is. cell is set to the cell it went wrong at, if any.
+static const char* CheckSnakeGameInvariants( const SnakeGameState& state, const ItemField& items, uint32_t& cell )
+{
+    uint32_t cell_count = state.CellCount();
+    cell = cell_count;
+
+    if( state.m_length == 0 || state.m_length > state.m_free_cell_count )
+        return "the length is outside 1 and the free cell count";
+
+    if( state.m_body_head >= state.m_body_capacity )
+        return "the body head is outside the ring";
+
+    for( uint32_t i = 0; i < state.m_length; ++i )
+    {
+        cell = state.BodyCell(i);
+        if( cell >= cell_count )
+            return "a body part is outside the field";
+
+        if( state.m_field[cell] != ( i == 0 ? SNAKE_CELL_HEAD : SNAKE_CELL_BODY ) )
+            return i == 0 ? "the head cell doesn't hold the head" : "a body cell doesn't hold a body part";
+    }
+
+    uint32_t snake_cells = 0, food_cells = 0, wall_cells = 0, item_cells = 0;
+
+    for( cell = 0; cell < cell_count; ++cell )
+    {
+        char value = state.m_field[cell];
+
+        if( value == SNAKE_CELL_HEAD || value == SNAKE_CELL_BODY )
+            ++snake_cells;
+        else if( value == SNAKE_CELL_FOOD )
+            ++food_cells;
+        else if( value == SNAKE_CELL_WALL )
+            ++wall_cells;
+        else if( IsItemCellValue(value) )
+            ++item_cells;
+        else if( value != SNAKE_CELL_EMPTY )
+            return "a cell holds something that isn't part of the game";
+
+        if( IsBorderCell(state,cell) && value != SNAKE_CELL_WALL )
+            return "a border cell isn't a wall";
+    }
+
+    cell = cell_count;
+
+    // every part was found on it's own cell above, so more snake cells than parts means one was left behind.
+    if( snake_cells != state.m_length )
+        return "the snake cells on the field don't add upto the length";
+
+    if( wall_cells != cell_count - state.m_free_cell_count )
+        return "the walls don't add upto the cells that aren't free";
+
+    if( state.m_status == GAME_STATUS_ONGOING )
+    {
+        cell = state.m_food;
+        if( food_cells != 1 )
+            return "an ongoing game doesn't have exactly one food";
+
+        if( state.m_food >= cell_count || state.m_field[state.m_food] != SNAKE_CELL_FOOD )
+            return "the food isn't where the game thinks it is";
+    }
+
+    else if( food_cells > 1 )
+    {
+        return "a game that ended has more than one food";
+    }
+
+    if( items.m_capacity == 0 )
+        return item_cells ? "items are on the field of a game without them" : nullptr;
+
+    if( items.m_count > items.m_capacity )
+        return "there are more items than the capacity";
+
+    // the regular food is only put on an item when the board had no empty cell left, it hides that item. eating
+    // it picks the item up too, unless that won the game, items aren't updated anymore then.
+    uint32_t mapped_items = 0, hidden_items = 0;
+
+    for( uint32_t slot = 0; slot <= items.m_map_mask; ++slot )
+    {
+        cell = items.m_map_cells[slot];
+        if( cell == ITEM_NONE )
+            continue;
+
+        ++mapped_items;
+        uint32_t index = items.m_map_items[slot];
+
+        if( cell >= cell_count || index >= items.m_capacity || items.m_items[index].m_cell != cell )
+            return "the item map points at the wrong item";
+
+        if( state.m_field[cell] == SNAKE_CELL_FOOD ||
+            ( state.m_status == GAME_STATUS_WON && cell == state.Head() ) )
+            ++hidden_items;
+        else if( state.m_field[cell] != GetItemCellValue(items.m_items[index].m_kind) )
+            return "an item cell doesn't hold it's item";
+    }
+
+    cell = cell_count;
+
+    if( mapped_items != items.m_count )
+        return "the item map doesn't hold every item";
+
+    if( item_cells + hidden_items != items.m_count )
+        return "the item cells on the field don't add upto the item count";
+
+    return nullptr;
+}
+
+static void PrintSoakBoard( const SnakeGameState& state )
+{
+    for( uint16_t y = 0; y < state.m_size_y; ++y )
+        std::cout.write(state.m_field + uint32_t(y) * state.m_size_x,state.m_size_x) << '\n';
+}
+
+static bool IsSoakCellOpen( const SnakeGameState& state, uint32_t cell )
+{
+    char value = state.m_field[cell];
+
+    return value == SNAKE_CELL_EMPTY || value == SNAKE_CELL_FOOD || IsItemCellValue(value) ||
+           ( value == SNAKE_CELL_BODY && ( state.m_rules & SNAKE_RULE_CUT_ITSELF ) );
+}
+
+// the cells the head can get to, found one at a time. the head itself isn't counted, like the bitboard fill.
+static uint32_t FloodFillSnakeGame( SoakFloodFill& fill, const SnakeGameState& state )
+{
+    uint32_t cell_count = state.CellCount();
+    fill.m_arena.Reset();
+    fill.m_queue = fill.m_arena.AllocateArray<uint32_t>(cell_count);
+    fill.m_seen = fill.m_arena.AllocateArray<uint8_t>(cell_count);
+    std::memset(fill.m_seen,0,cell_count);
+
+    uint32_t first = 0, last = 0;
+    fill.m_queue[last++] = state.Head();
+    fill.m_seen[state.Head()] = 1;
+
+    while( first < last )
+    {
+        uint32_t cell = fill.m_queue[first++];
+
+        for( uint8_t direction = SNAKE_DIRECTION_UP; direction <= SNAKE_DIRECTION_RIGHT; ++direction )
+        {
+            uint32_t next = state.Neighbor(cell,direction);
+            if( !fill.m_seen[next] && IsSoakCellOpen(state,next) )
+            {
+                fill.m_seen[next] = 1;
+                fill.m_queue[last++] = next;
+            }
+        }
+    }
+
+    return last - 1;
+}
+
+static const char* CheckSnakeReachability( SnakeReachability& reachability, SoakFloodFill& fill,
+                                           const SnakeGameState& state, uint32_t& cell )
+{
+    cell = state.CellCount();
+    if( state.m_status != GAME_STATUS_ONGOING )
+        return nullptr;
+
+    if( ComputeSnakeReachableArea(reachability,state) != FloodFillSnakeGame(fill,state) )
+        return "the reachable area doesn't match a flood fill";
+
+    cell = state.m_food;
+    if( IsSnakeCellReachable(reachability,state.m_food) != bool(fill.m_seen[state.m_food]) )
+        return "the reachable area and a flood fill don't agree on the food";
+
+    return nullptr;
+}
+
+// #######
+// #######
+// #ox$ @#      the snake goes right, the multiplier lies on the only way to the food.
+// #######
+// #######
+static bool CheckItemOnTheOnlyPath()
+{
+    GameArena arena;
+    SnakeGameState state;
+    SnakeReachability reachability;
+
+    if( !arena.Reserve(ComputeSnakeGameMemorySize(7,5)) || !InitializeSnakeGameState(state,arena,7,5,1) )
+        return false;
+
+    std::memset(state.m_field + 7,SNAKE_CELL_WALL,7);
+    std::memset(state.m_field + 21,SNAKE_CELL_WALL,7);
+    state.m_free_cell_count = 5;
+    StartSnakeGameState(state);
+    std::memset(state.m_field + 15,SNAKE_CELL_EMPTY,5);
+
+    state.m_body_head = 0;
+    state.m_body[0] = 16;
+    state.m_body[1] = 15;
+    state.m_length = 2;
+    state.m_direction = SNAKE_DIRECTION_RIGHT;
+    state.m_food = 19;
+    state.m_field[15] = SNAKE_CELL_BODY;
+    state.m_field[16] = SNAKE_CELL_HEAD;
+    state.m_field[17] = SNAKE_CELL_ITEM_MULTIPLIER;
+    state.m_field[19] = SNAKE_CELL_FOOD;
+
+    const char* broken = nullptr;
+    if( ComputeSnakeReachableArea(reachability,state) != 3 || !IsSnakeCellReachable(reachability,state.m_food) )
+        broken = "an item on the only way to the food walls the food off";
+    else if( IsSnakeGameDoomed(reachability,state) )
+        broken = "an item on the only way to the food dooms the game";
+
+    if( broken )
+    {
+        std::cout << broken << ".\n";
+        PrintSoakBoard(state);
+    }
+
+    return !broken;
+}
+
+// most moves go towards the food without hitting anything, the tail and with cuts the body count as free.
+static uint8_t PickSoakDirection( const SnakeGameState& state, uint64_t& random_state )
+{
+    uint64_t random = NextSoakRandom(random_state);
+    if( random % SOAK_RECKLESS_MOVE_CHANCE == 0 )
+        return uint8_t(SNAKE_DIRECTION_UP + ( random >> 32 ) % 4);
+
+    uint32_t head = state.Head();
+    uint32_t tail = state.BodyCell(state.m_length - 1);
+    uint32_t head_x = head % state.m_size_x, head_y = head / state.m_size_x;
+    uint32_t food_x = state.m_food % state.m_size_x, food_y = state.m_food / state.m_size_x;
+
+    uint8_t safe = SNAKE_DIRECTION_NONE;
+    uint8_t first = uint8_t(( random >> 40 ) % 4);
+
+    // starting from a random direction, so ties and dead ends don't always go the same way.
+    for( uint8_t i = 0; i < 4; ++i )
+    {
+        uint8_t direction = uint8_t(SNAKE_DIRECTION_UP + ( first + i ) % 4);
+        if( IsOppositeDirection(state.m_direction,direction) )
+            continue;
+
+        uint32_t next = state.Neighbor(head,direction);
+        char target = state.m_field[next];
+        bool is_free = target != SNAKE_CELL_WALL && ( target != SNAKE_CELL_BODY || next == tail ||
+                                                      ( state.m_rules & SNAKE_RULE_CUT_ITSELF ) );
+        if( !is_free )
+            continue;
+
+        bool closer = ( direction == SNAKE_DIRECTION_UP && food_y < head_y ) ||
+                      ( direction == SNAKE_DIRECTION_LEFT && food_x < head_x ) ||
+                      ( direction == SNAKE_DIRECTION_DOWN && food_y > head_y ) ||
+                      ( direction == SNAKE_DIRECTION_RIGHT && food_x > head_x );
+        if( closer )
+            return direction;
+
+        if( safe == SNAKE_DIRECTION_NONE )
+            safe = direction;
+    }
+
+    return safe;
+}
+
+// upto 4 rules masks and 4 sizes, all picked from the seed of the game.
+static void PickSoakGame( const SoakOptions& options, uint64_t seed, uint16_t& size_x, uint16_t& size_y,
+                          uint8_t& rules )
+{
+    uint64_t random_state = seed * 0x9e3779b97f4a7c15ULL | 1;
+    uint64_t random = NextSoakRandom(random_state);
+    uint32_t sizes = options.m_size - SNAKE_GAME_MIN_SIZE + 1;
+
+    size_x = uint16_t(SNAKE_GAME_MIN_SIZE + random % sizes);
+    size_y = uint16_t(SNAKE_GAME_MIN_SIZE + ( random >> 32 ) % sizes);
+    rules = ( options.m_rules == SOAK_RULES_CYCLE ) ? uint8_t(seed & SNAKE_RULE_ALL) : options.m_rules;
+}
+
+static SoakMemory ReadSoakMemory( const SoakOptions& options, const GameArena& arena, const GameArena& item_arena,
+                                   const SnakeReachability& reachability, const SoakFloodFill& fill )
+{
+    SoakMemory memory;
+    uint64_t pages = 0, resident_pages = 0;
+    std::ifstream("/proc/self/statm") >> pages >> resident_pages;
+
+    memory.m_resident_kilobytes = resident_pages * uint64_t(sysconf(_SC_PAGESIZE)) / 1024;
+    memory.m_heap_allocations = options.m_heap_allocations ? options.m_heap_allocations->load() : 0;
+    memory.m_heap_deallocations = options.m_heap_deallocations ? options.m_heap_deallocations->load() : 0;
+    memory.m_arena_heap_blocks = arena.m_heap_block_count + item_arena.m_heap_block_count +
+                                 reachability.m_arena.m_heap_block_count + fill.m_arena.m_heap_block_count;
+
+    return memory;
+}
+
+static void PrintSoakReport( const SoakOptions& options, const SoakCounts& counts, const SoakMemory& memory,
+                             double seconds )
+{
+    std::cout << "games:" << counts.m_games << " ticks:" << counts.m_ticks << " ( " << uint64_t(counts.m_ticks /
+              ( seconds > 0.0 ? seconds : 1.0 )) << "/s ) won:" << counts.m_won << " lost:" << counts.m_lost
+              << " called off:" << counts.m_called_off << " items picked up:" << counts.m_items_picked_up
+              << "  rss:" << memory.m_resident_kilobytes << "KB heap ";
+
+    if( options.m_heap_allocations && options.m_heap_deallocations )
+    {
+        std::cout << "allocations:" << memory.m_heap_allocations << " frees:" << memory.m_heap_deallocations
+                  << " live:" << memory.m_heap_allocations - memory.m_heap_deallocations;
+    }
+
+    else
+    {
+        std::cout << "allocations:n/a";
+    }
+
+    std::cout << " arena blocks:" << memory.m_arena_heap_blocks << std::endl;
+}
+
+bool RunSoakTest( const SoakOptions& options )
+{
+    if( options.m_size < SNAKE_GAME_MIN_SIZE || options.m_size > SNAKE_GAME_MAX_SIZE ||
+        options.m_report_interval == 0 ||
+        ( options.m_rules != SOAK_RULES_CYCLE && ( options.m_rules & ~SNAKE_RULE_ALL ) ) )
+        return false;
+
+    if( !CheckItemOnTheOnlyPath() )
+        return false;
+
+    GameArena arena, item_arena;
+    SnakeGameState state;
+    ItemField items;
+    SnakeReachability reachability;
+    SoakFloodFill fill;
+    SoakCounts counts;
+
+    // the biggest game is reserved up front, so the arenas never have to grow and any heap traffic is a leak.
+    uint16_t size = uint16_t(options.m_size);
+    if( !arena.Reserve(ComputeSnakeGameMemorySize(size,size)) || !InitializeSnakeGameState(state,arena,size,size,1) )
+        return false;
+
+    uint32_t biggest_capacity = ComputeItemCapacity(state,options.m_item_count);
+    if( biggest_capacity && !item_arena.Reserve(ComputeItemFieldMemorySize(biggest_capacity)) )
+        return false;
+
+    uint32_t biggest_cell_count = state.CellCount();
+    if( !fill.m_arena.Reserve(ArenaFootprint<uint32_t>(biggest_cell_count) +
+                              ArenaFootprint<uint8_t>(biggest_cell_count)) )
+        return false;
+
+    // a fill of the biggest board sizes the bitboards, smaller ones fit in them after that.
+    StartSnakeGameState(state);
+    ComputeSnakeReachableArea(reachability,state);
+
+    SoakMemory warm_memory = ReadSoakMemory(options,arena,item_arena,reachability,fill);
+    bool warmed_up = false;
+    auto start = std::chrono::steady_clock::now();
+
+    for( uint32_t game = 0; game < options.m_game_count; ++game )
+    {
+        uint64_t seed = options.m_seed + game;
+        uint16_t size_x, size_y;
+        uint8_t rules;
+        PickSoakGame(options,seed,size_x,size_y,rules);
+
+        arena.Reset();
+        if( !InitializeSnakeGameState(state,arena,size_x,size_y,seed,rules) )
+            return false;
+
+        StartSnakeGameState(state);
+        if( !InitializeItemField(items,item_arena,state,ComputeItemCapacity(state,options.m_item_count)) )
+            return false;
+
+        uint64_t random_state = seed ^ 0xd1b54a32d192ed03ULL;
+        random_state = random_state ? random_state : 1;
+        uint64_t tick_limit = uint64_t(state.CellCount()) * SOAK_TICKS_PER_CELL;
+        uint32_t cell;
+        const char* broken = CheckSnakeGameInvariants(state,items,cell);
+        if( !broken )
+            broken = CheckSnakeReachability(reachability,fill,state,cell);
+
+        while( !broken && state.m_status == GAME_STATUS_ONGOING && state.m_tick < tick_limit )
+        {
+            int32_t score = state.m_score;
+            StepSnakeGame(state,PickSoakDirection(state,random_state));
+            counts.m_items_picked_up += UpdateItemField(items,state,score) != ITEM_KIND_NONE;
+            ++counts.m_ticks;
+
+            broken = CheckSnakeGameInvariants(state,items,cell);
+            if( !broken )
+                broken = CheckSnakeReachability(reachability,fill,state,cell);
+        }
+
+        if( broken )
+        {
+            std::cout << "game " << game << " ( seed " << seed << ", " << size_x << 'x' << size_y << ", rules "
+                      << int(rules) << ", " << items.m_capacity << " items ) broke at tick " << state.m_tick << ": "
+                      << broken;
+
+            if( cell < state.CellCount() )
+                std::cout << " at cell " << cell % size_x << ',' << cell / size_x;
+
+            std::cout << ".\n";
+            PrintSoakBoard(state);
+
+            return false;
+        }
+
+        ++counts.m_games;
+        counts.m_won += state.m_status == GAME_STATUS_WON;
+        counts.m_lost += state.m_status == GAME_STATUS_LOST;
+        counts.m_called_off += state.m_status == GAME_STATUS_ONGOING;
+
+        if( counts.m_games % options.m_report_interval == 0 || game + 1 == options.m_game_count )
+        {
+            double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            SoakMemory memory = ReadSoakMemory(options,arena,item_arena,reachability,fill);
+            PrintSoakReport(options,counts,memory,seconds);
+
+            // the first interval is the warm up, the stream buffers and such are allocated by then.
+            if( !warmed_up )
+                warm_memory = memory;
+
+            warmed_up = true;
+        }
+    }
+
+    SoakMemory memory = ReadSoakMemory(options,arena,item_arena,reachability,fill);
+    bool heap_grew = memory.m_heap_allocations - memory.m_heap_deallocations >
+                     warm_memory.m_heap_allocations - warm_memory.m_heap_deallocations;
+
+    std::cout << "since the first report: rss "
+              << int64_t(memory.m_resident_kilobytes - warm_memory.m_resident_kilobytes) << "KB, live heap allocations "
+              << int64_t(( memory.m_heap_allocations - memory.m_heap_deallocations ) -
+                         ( warm_memory.m_heap_allocations - warm_memory.m_heap_deallocations ))
+              << ", arena blocks " << memory.m_arena_heap_blocks - warm_memory.m_arena_heap_blocks << '\n';
+
+    if( heap_grew )
+        std::cout << "the heap kept growing after the warm up, something leaks.\n";
+
+    return !heap_grew;
+}
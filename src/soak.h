@@ -0,0 +1,33 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+#define SOAK_RULES_CYCLE                        0xff // every game takes the next SNAKE_RULE_* mask.
+
+// plays a lot of short games with a player that is greedy most of the time and reckless some of it, so walls,
+// bites, cuts, wins and items all come up. after every tick the whole state is checked against what the game
+// promises ( see CheckSnakeGameInvariants() in soak.cpp ) and the reachable area of reachability.h against a
+// plain flood fill, the first broken promise stops the run with the game, seed, tick and board printed. a hand
+// made board is checked before the first game. every m_report_interval games the memory of the process is
+// printed, so a leak shows up as a column that keeps growing.
+struct SoakOptions
+{
+    SoakOptions() : m_game_count(100000), m_size(16), m_rules(SOAK_RULES_CYCLE), m_item_count(0),
+                    m_report_interval(10000), m_seed(1), m_heap_allocations(nullptr),
+                    m_heap_deallocations(nullptr) {}
+
+    uint32_t m_game_count;
+    uint32_t m_size;            // games are played on boards from SNAKE_GAME_MIN_SIZE up to this a side.
+    uint8_t m_rules;
+    uint32_t m_item_count;      // items asked for per game, 0 plays without them.
+    uint32_t m_report_interval;
+    uint64_t m_seed;            // game g is seeded with m_seed + g, so a failing game can be played again alone.
+
+    // the heap counters of the executable ( see heap_counter.h ), libsnake has none and leaves these nullptr.
+    const std::atomic<uint64_t>* m_heap_allocations;
+    const std::atomic<uint64_t>* m_heap_deallocations;
+};
+
+// false if an invariant broke, or the heap held more allocations at the end than after the first report.
+bool RunSoakTest( const SoakOptions& options );
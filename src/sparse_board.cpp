@@ -0,0 +1,382 @@
+#include "sparse_board.h"
+
+#include <cstring>
+
+#define SPARSE_INITIAL_MAP_CAPACITY             64 // must be a power of 2.
+#define SPARSE_FOOD_RANDOM_TRIES                64
+#define SPARSE_NO_CHUNK                         UINT32_MAX
+
+static uint64_t NextSparseRandom( SparseSnakeGame& game )
+{
+    // xorshift64* like the dense game, but all 64 bits are used since a world can have more than 2^32 cells.
+    uint64_t x = game.m_random_state;
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    game.m_random_state = x;
+
+    return x * 0x2545f4914f6cdd1dULL;
+}
+
+static uint64_t GetChunkKey( SparseCell cell )
+{
+    return uint64_t(GetSparseCellX(cell) >> SPARSE_CHUNK_SHIFT) |
+           ( uint64_t(GetSparseCellY(cell) >> SPARSE_CHUNK_SHIFT) << 32 );
+}
+
+static uint32_t GetMapSlot( const SparseSnakeGame& game, uint64_t key )
+{
+    uint64_t hash = key * 0x9e3779b97f4a7c15ULL;
+
+    return uint32_t(hash ^ ( hash >> 32 )) & game.m_map_mask;
+}
+
+// the map slot of the chunk, or the empty slot it would go into.
+static uint32_t FindMapSlot( const SparseSnakeGame& game, uint64_t key )
+{
+    uint32_t slot = GetMapSlot(game,key);
+    while( game.m_map_keys[slot] != key && game.m_map_keys[slot] != SPARSE_EMPTY_KEY )
+        slot = ( slot + 1 ) & game.m_map_mask;
+
+    return slot;
+}
+
+static const SparseChunk* FindChunk( const SparseSnakeGame& game, SparseCell cell )
+{
+    uint32_t slot = FindMapSlot(game,GetChunkKey(cell));
+
+    return game.m_map_keys[slot] == SPARSE_EMPTY_KEY ? nullptr : &game.m_chunks[game.m_map_chunks[slot]];
+}
+
+static void ResizeChunkMap( SparseSnakeGame& game, uint32_t capacity )
+{
+    std::vector<uint64_t> keys(capacity,SPARSE_EMPTY_KEY);
+    std::vector<uint32_t> chunks(capacity,SPARSE_NO_CHUNK);
+    keys.swap(game.m_map_keys);
+    chunks.swap(game.m_map_chunks);
+    game.m_map_mask = capacity - 1;
+
+    for( std::size_t i = 0; i < keys.size(); ++i )
+    {
+        if( keys[i] == SPARSE_EMPTY_KEY )
+            continue;
+
+        uint32_t slot = FindMapSlot(game,keys[i]);
+        game.m_map_keys[slot] = keys[i];
+        game.m_map_chunks[slot] = chunks[i];
+    }
+}
+
+static SparseChunk& AcquireChunk( SparseSnakeGame& game, SparseCell cell )
+{
+    uint64_t key = GetChunkKey(cell);
+    uint32_t slot = FindMapSlot(game,key);
+
+    if( game.m_map_keys[slot] == key )
+        return game.m_chunks[game.m_map_chunks[slot]];
+
+    // kept atmost half full, probes stay short.
+    if( ( game.m_map_count + 1 ) * 2 > game.m_map_mask + 1 )
+    {
+        ResizeChunkMap(game,( game.m_map_mask + 1 ) * 2);
+        slot = FindMapSlot(game,key);
+    }
+
+    uint32_t index;
+    if( !game.m_free_chunks.empty() )
+    {
+        index = game.m_free_chunks.back();
+        game.m_free_chunks.pop_back();
+    }
+
+    else
+    {
+        index = uint32_t(game.m_chunks.size());
+        game.m_chunks.emplace_back();
+    }
+
+    std::memset(&game.m_chunks[index],0,sizeof(SparseChunk));
+
+    game.m_map_keys[slot] = key;
+    game.m_map_chunks[slot] = index;
+    ++game.m_map_count;
+
+    return game.m_chunks[index];
+}
+
+// takes the chunk out of the map without tombstones: the entries after it that would have landed earlier are
+// moved back, so lookups never have to walk over holes.
+static void ReleaseChunk( SparseSnakeGame& game, uint32_t slot )
+{
+    game.m_free_chunks.push_back(game.m_map_chunks[slot]);
+    --game.m_map_count;
+
+    uint32_t hole = slot;
+    for( uint32_t next = ( slot + 1 ) & game.m_map_mask; game.m_map_keys[next] != SPARSE_EMPTY_KEY;
+         next = ( next + 1 ) & game.m_map_mask )
+    {
+        uint32_t home = GetMapSlot(game,game.m_map_keys[next]);
+
+        // the entry can fill the hole if the hole lies on the way from it's home slot to where it is.
+        if( ( ( next - home ) & game.m_map_mask ) >= ( ( next - hole ) & game.m_map_mask ) )
+        {
+            game.m_map_keys[hole] = game.m_map_keys[next];
+            game.m_map_chunks[hole] = game.m_map_chunks[next];
+            hole = next;
+        }
+    }
+
+    game.m_map_keys[hole] = SPARSE_EMPTY_KEY;
+    game.m_map_chunks[hole] = SPARSE_NO_CHUNK;
+}
+
+static void SetBodyBit( SparseSnakeGame& game, SparseCell cell )
+{
+    SparseChunk& chunk = AcquireChunk(game,cell);
+    chunk.m_body[GetSparseCellY(cell) & ( SPARSE_CHUNK_SIZE - 1 )] |=
+        uint64_t(1) << ( GetSparseCellX(cell) & ( SPARSE_CHUNK_SIZE - 1 ) );
+    ++chunk.m_population;
+}
+
+static void ClearBodyBit( SparseSnakeGame& game, SparseCell cell )
+{
+    uint32_t slot = FindMapSlot(game,GetChunkKey(cell));
+    SparseChunk& chunk = game.m_chunks[game.m_map_chunks[slot]];
+
+    chunk.m_body[GetSparseCellY(cell) & ( SPARSE_CHUNK_SIZE - 1 )] &=
+        ~( uint64_t(1) << ( GetSparseCellX(cell) & ( SPARSE_CHUNK_SIZE - 1 ) ) );
+
+    if( --chunk.m_population == 0 )
+        ReleaseChunk(game,slot);
+}
+
+bool IsSparseCellWall( const SparseSnakeGame& game, SparseCell cell )
+{
+    uint32_t x = GetSparseCellX(cell), y = GetSparseCellY(cell);
+    if( x == 0 || y == 0 || x == game.m_size_x - 1 || y == game.m_size_y - 1 )
+        return true;
+
+    const SparseChunk* chunk = FindChunk(game,cell);
+
+    return chunk && ( chunk->m_walls[y & ( SPARSE_CHUNK_SIZE - 1 )] >> ( x & ( SPARSE_CHUNK_SIZE - 1 ) ) & 1 );
+}
+
+bool IsSparseCellBody( const SparseSnakeGame& game, SparseCell cell )
+{
+    const SparseChunk* chunk = FindChunk(game,cell);
+    uint32_t x = GetSparseCellX(cell), y = GetSparseCellY(cell);
+
+    return chunk && ( chunk->m_body[y & ( SPARSE_CHUNK_SIZE - 1 )] >> ( x & ( SPARSE_CHUNK_SIZE - 1 ) ) & 1 );
+}
+
+SparseCell GetSparseNeighbor( const SparseSnakeGame& game, SparseCell cell, uint8_t direction )
+{
+    uint32_t x = GetSparseCellX(cell), y = GetSparseCellY(cell);
+    bool wrap = game.m_rules & SNAKE_RULE_PASS_BORDERS;
+
+    switch( direction )
+    {
+        case SNAKE_DIRECTION_UP:
+            y = ( wrap && y == 1 ) ? game.m_size_y - 2 : y - 1;
+        break;
+
+        case SNAKE_DIRECTION_LEFT:
+            x = ( wrap && x == 1 ) ? game.m_size_x - 2 : x - 1;
+        break;
+
+        case SNAKE_DIRECTION_DOWN:
+            y = ( wrap && y == game.m_size_y - 2 ) ? 1 : y + 1;
+        break;
+
+        case SNAKE_DIRECTION_RIGHT:
+            x = ( wrap && x == game.m_size_x - 2 ) ? 1 : x + 1;
+        break;
+    }
+
+    return MakeSparseCell(x,y);
+}
+
+static SparseCell GetRandomInteriorCell( SparseSnakeGame& game )
+{
+    uint32_t x = 1 + uint32_t(NextSparseRandom(game) % ( game.m_size_x - 2 ));
+    uint32_t y = 1 + uint32_t(NextSparseRandom(game) % ( game.m_size_y - 2 ));
+
+    return MakeSparseCell(x,y);
+}
+
+static bool IsSparseCellFree( const SparseSnakeGame& game, SparseCell cell )
+{
+    return !IsSparseCellWall(game,cell) && !IsSparseCellBody(game,cell);
+}
+
+// in a big world a random cell is almost always free. only a nearly full world falls back to walking the cells
+// from the last try on, like the dense game always does.
+static void PlaceSparseFood( SparseSnakeGame& game )
+{
+    SparseCell cell = GetRandomInteriorCell(game);
+    for( uint32_t i = 1; i < SPARSE_FOOD_RANDOM_TRIES && !IsSparseCellFree(game,cell); ++i )
+        cell = GetRandomInteriorCell(game);
+
+    uint32_t x = GetSparseCellX(cell), y = GetSparseCellY(cell);
+    while( !IsSparseCellFree(game,MakeSparseCell(x,y)) )
+    {
+        if( ++x == game.m_size_x - 1 )
+        {
+            x = 1;
+            y = ( y == game.m_size_y - 2 ) ? 1 : y + 1;
+        }
+    }
+
+    game.m_food = MakeSparseCell(x,y);
+}
+
+bool InitializeSparseSnakeGame( SparseSnakeGame& game, uint32_t size_x, uint32_t size_y, uint64_t seed, uint8_t rules )
+{
+    if( size_x < SNAKE_GAME_MIN_SIZE || size_y < SNAKE_GAME_MIN_SIZE || size_x > SPARSE_MAX_SIZE ||
+        size_y > SPARSE_MAX_SIZE )
+        return false;
+
+    game.m_size_x = size_x;
+    game.m_size_y = size_y;
+    game.m_rules = rules & SNAKE_RULE_ALL;
+    game.m_chunks.clear();
+    game.m_free_chunks.clear();
+    game.m_body.clear();
+    game.m_map_keys.assign(SPARSE_INITIAL_MAP_CAPACITY,SPARSE_EMPTY_KEY);
+    game.m_map_chunks.assign(SPARSE_INITIAL_MAP_CAPACITY,SPARSE_NO_CHUNK);
+    game.m_map_mask = SPARSE_INITIAL_MAP_CAPACITY - 1;
+    game.m_map_count = 0;
+    game.m_wall_count = 0;
+
+    // splitmix64 so close seeds don't give close sequences, same as the dense game.
+    seed += 0x9e3779b97f4a7c15ULL;
+    seed = ( seed ^ ( seed >> 30 ) ) * 0xbf58476d1ce4e5b9ULL;
+    seed = ( seed ^ ( seed >> 27 ) ) * 0x94d049bb133111ebULL;
+    seed ^= seed >> 31;
+    game.m_random_state = seed ? seed : 1;
+
+    game.m_status = GAME_STATUS_CAN_BEGIN;
+
+    return true;
+}
+
+void SetSparseSnakeWall( SparseSnakeGame& game, uint32_t x, uint32_t y )
+{
+    SparseCell cell = MakeSparseCell(x,y);
+    if( x == 0 || y == 0 || x >= game.m_size_x - 1 || y >= game.m_size_y - 1 || IsSparseCellWall(game,cell) )
+        return;
+
+    SparseChunk& chunk = AcquireChunk(game,cell);
+    chunk.m_walls[y & ( SPARSE_CHUNK_SIZE - 1 )] |= uint64_t(1) << ( x & ( SPARSE_CHUNK_SIZE - 1 ) );
+    ++chunk.m_population;
+    ++game.m_wall_count;
+}
+
+void StartSparseSnakeGame( SparseSnakeGame& game )
+{
+    while( !game.m_body.empty() )
+    {
+        ClearBodyBit(game,game.m_body.back());
+        game.m_body.pop_back();
+    }
+
+    SparseCell head;
+    do
+    {
+        head = GetRandomInteriorCell(game);
+    } while( IsSparseCellWall(game,head) );
+
+    // don't start the game by facing a wall.
+    uint8_t directions[4];
+    uint8_t direction_count = 0;
+
+    for( uint8_t direction = SNAKE_DIRECTION_UP; direction <= SNAKE_DIRECTION_RIGHT; ++direction )
+    {
+        if( !IsSparseCellWall(game,GetSparseNeighbor(game,head,direction)) )
+            directions[direction_count++] = direction;
+    }
+
+    game.m_direction = direction_count ? directions[NextSparseRandom(game) % direction_count] : SNAKE_DIRECTION_UP;
+
+    game.m_body.push_front(head);
+    SetBodyBit(game,head);
+    game.m_score = 0;
+    game.m_tick = 0;
+
+    PlaceSparseFood(game);
+
+    game.m_status = GAME_STATUS_ONGOING;
+}
+
+uint8_t StepSparseSnakeGame( SparseSnakeGame& game, uint8_t direction_to_move )
+{
+    if( game.m_status != GAME_STATUS_ONGOING )
+        return game.m_status;
+
+    if( direction_to_move != SNAKE_DIRECTION_NONE && !IsOppositeDirection(game.m_direction,direction_to_move) )
+        game.m_direction = direction_to_move;
+
+    SparseCell next = GetSparseNeighbor(game,game.m_body.front(),game.m_direction);
+    SparseCell tail = game.m_body.back();
+
+    ++game.m_tick;
+
+    // the tail leaves it's cell in the same tick, so chasing our own tail is not a collision.
+    bool bites_body = next != tail && IsSparseCellBody(game,next);
+
+    if( IsSparseCellWall(game,next) || ( bites_body && !( game.m_rules & SNAKE_RULE_CUT_ITSELF ) ) )
+    {
+        game.m_status = GAME_STATUS_LOST;
+        return game.m_status;
+    }
+
+    bool eats = next == game.m_food;
+
+    if( bites_body )
+    {
+        // everything from the bitten part to the tail falls off, the head then moves into the freed cell.
+        std::size_t cut_index = 1;
+        while( game.m_body[cut_index] != next )
+            ++cut_index;
+
+        while( game.m_body.size() > cut_index )
+        {
+            ClearBodyBit(game,game.m_body.back());
+            game.m_body.pop_back();
+        }
+    }
+
+    else if( !eats )
+    {
+        ClearBodyBit(game,tail);
+        game.m_body.pop_back();
+    }
+
+    game.m_body.push_front(next);
+    SetBodyBit(game,next);
+
+    if( eats )
+    {
+        game.m_score += 10;
+
+        uint64_t free_cell_count = uint64_t(game.m_size_x - 2) * ( game.m_size_y - 2 ) - game.m_wall_count;
+        if( game.m_body.size() == free_cell_count )
+            game.m_status = GAME_STATUS_WON;
+        else
+            PlaceSparseFood(game);
+    }
+
+    return game.m_status;
+}
+
+uint32_t GetSparseChunkCount( const SparseSnakeGame& game )
+{
+    return game.m_map_count;
+}
+
+std::size_t ComputeSparseMemoryUsage( const SparseSnakeGame& game )
+{
+    return game.m_chunks.capacity() * sizeof(SparseChunk) + game.m_free_chunks.capacity() * sizeof(uint32_t) +
+           game.m_map_keys.capacity() * ( sizeof(uint64_t) + sizeof(uint32_t) ) +
+           game.m_body.size() * sizeof(SparseCell);
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+#include "snake_game.h"
+
+#define SPARSE_CHUNK_SHIFT                      6
+#define SPARSE_CHUNK_SIZE                       ( 1 << SPARSE_CHUNK_SHIFT ) // cells on each side of a chunk.
+#define SPARSE_MAX_SIZE                         0x7fffffff
+#define SPARSE_EMPTY_KEY                        UINT64_MAX
+
+// a cell of a sparse world, x in the low 32 bits and y in the high ones.
+typedef uint64_t SparseCell;
+
+inline SparseCell MakeSparseCell( uint32_t x, uint32_t y ) { return uint64_t(x) | ( uint64_t(y) << 32 ); }
+inline uint32_t GetSparseCellX( SparseCell cell ) { return uint32_t(cell); }
+inline uint32_t GetSparseCellY( SparseCell cell ) { return uint32_t(cell >> 32); }
+
+// 64x64 cells, one bit per cell and row. a chunk only exists while something is in it.
+struct SparseChunk
+{
+    uint64_t m_body[SPARSE_CHUNK_SIZE];
+    uint64_t m_walls[SPARSE_CHUNK_SIZE];
+    uint32_t m_population;      // bits set in both bitsets, the chunk is freed when it drops to 0.
+};
+
+// the same game as SnakeGameState, for worlds far too big for a byte per cell. nothing is stored for empty
+// space: the border is implicit, walls and the snake live in chunks that are allocated when the first thing is
+// put into them and recycled when the last thing leaves, and the chunks are found through an open addressing
+// hash map keyed by chunk coordinates. so memory follows the length of the snake, not the area of the world.
+// the food is just a cell, no chunk needed.
+struct SparseSnakeGame
+{
+    SparseSnakeGame() : m_size_x(0), m_size_y(0), m_map_mask(0), m_map_count(0), m_wall_count(0), m_food(0),
+                        m_score(0), m_tick(0), m_random_state(0), m_direction(SNAKE_DIRECTION_NONE),
+                        m_status(GAME_STATUS_NOT_INITIALIZED), m_rules(0) {}
+
+    uint32_t m_size_x;
+    uint32_t m_size_y;
+
+    // chunk map, linear probing. m_map_keys[i] is a chunk coordinate ( same packing as SparseCell ) or
+    // SPARSE_EMPTY_KEY, m_map_chunks[i] it's index in m_chunks.
+    std::vector<uint64_t> m_map_keys;
+    std::vector<uint32_t> m_map_chunks;
+    uint32_t m_map_mask;
+    uint32_t m_map_count;
+
+    std::vector<SparseChunk> m_chunks;
+    std::vector<uint32_t> m_free_chunks;
+
+    std::deque<SparseCell> m_body; // the head is at the front.
+    uint64_t m_wall_count;
+    SparseCell m_food;
+    int32_t m_score;
+    uint64_t m_tick;
+    uint64_t m_random_state;
+    uint8_t m_direction;
+    uint8_t m_status;
+    uint8_t m_rules;
+};
+
+// sizes count the border, like SnakeGameState does. returns false if a side is out of 4..SPARSE_MAX_SIZE.
+bool InitializeSparseSnakeGame( SparseSnakeGame& game, uint32_t size_x, uint32_t size_y, uint64_t seed,
+                                uint8_t rules = 0 );
+
+// puts a wall inside the border, before the game is started.
+void SetSparseSnakeWall( SparseSnakeGame& game, uint32_t x, uint32_t y );
+
+// removes the snake of the last game, if any, then spawns the snake and the first food.
+void StartSparseSnakeGame( SparseSnakeGame& game );
+
+// same rules as StepSnakeGame().
+uint8_t StepSparseSnakeGame( SparseSnakeGame& game, uint8_t direction_to_move );
+
+// the cell a move from cell in direction lands on, the border is a wall or wraps depending on the rules.
+SparseCell GetSparseNeighbor( const SparseSnakeGame& game, SparseCell cell, uint8_t direction );
+
+bool IsSparseCellWall( const SparseSnakeGame& game, SparseCell cell );
+bool IsSparseCellBody( const SparseSnakeGame& game, SparseCell cell );
+
+uint32_t GetSparseChunkCount( const SparseSnakeGame& game );
+
+// heap bytes the world takes right now, chunks, map and body together.
+std::size_t ComputeSparseMemoryUsage( const SparseSnakeGame& game );
@@ -0,0 +1,129 @@
+#include "terminal_output.h"
+
+#include <cerrno>
+#include <chrono>
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+
+bool OpenTerminalOutput( TerminalOutput& output )
+{
+    if( output.m_fd >= 0 )
+        return true;
+
+    const char* name = isatty(STDOUT_FILENO) ? ttyname(STDOUT_FILENO) : nullptr;
+    if( name )
+    {
+        output.m_fd = open(name,O_WRONLY | O_NONBLOCK | O_NOCTTY | O_CLOEXEC);
+        output.m_owns_fd = output.m_fd >= 0;
+    }
+
+    if( output.m_fd < 0 )
+    {
+        output.m_fd = STDOUT_FILENO;
+        output.m_owns_fd = false;
+    }
+
+    return true;
+}
+
+void CloseTerminalOutput( TerminalOutput& output )
+{
+    if( output.m_owns_fd )
+        close(output.m_fd);
+
+    output.m_fd = -1;
+    output.m_owns_fd = false;
+    output.m_size = output.m_offset = 0;
+}
+
+char* BeginTerminalFrame( TerminalOutput& output, std::size_t capacity )
+{
+    if( GetUnflushedBytes(output) )
+        return nullptr;
+
+    // nothing is unflushed, so growing can drop the old buffer.
+    if( capacity > output.m_capacity )
+    {
+        output.m_arena.Reset();
+        if( !output.m_arena.Reserve(ArenaFootprint<char>(capacity)) )
+        {
+            output.m_buffer = nullptr;
+            output.m_capacity = 0;
+            return nullptr;
+        }
+
+        output.m_buffer = output.m_arena.AllocateArray<char>(capacity);
+        output.m_capacity = capacity;
+    }
+
+    output.m_size = output.m_offset = 0;
+
+    return output.m_buffer;
+}
+
+bool SubmitTerminalFrame( TerminalOutput& output, std::size_t size )
+{
+    output.m_size = size;
+    output.m_offset = 0;
+    ++output.m_frame_count;
+
+    return WriteTerminalOutput(output);
+}
+
+bool WriteTerminalOutput( TerminalOutput& output )
+{
+    while( output.m_offset < output.m_size )
+    {
+        ssize_t result = write(output.m_fd,output.m_buffer + output.m_offset,output.m_size - output.m_offset);
+        if( result < 0 && errno == EINTR )
+            continue;
+
+        if( result < 0 && ( errno == EAGAIN || errno == EWOULDBLOCK ) )
+        {
+            ++output.m_short_write_count;
+            if( GetUnflushedBytes(output) > output.m_max_unflushed_bytes )
+                output.m_max_unflushed_bytes = GetUnflushedBytes(output);
+
+            return false;
+        }
+
+        // the terminal is gone or broken, waiting for it would never end.
+        if( result <= 0 )
+        {
+            ++output.m_failed_write_count;
+            output.m_size = output.m_offset = 0;
+            return true;
+        }
+
+        output.m_offset += result;
+    }
+
+    return true;
+}
+
+bool FlushTerminalOutput( TerminalOutput& output, int timeout_milliseconds )
+{
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_milliseconds);
+
+    while( !WriteTerminalOutput(output) )
+    {
+        int wait = -1;
+        if( timeout_milliseconds >= 0 )
+        {
+            auto left = std::chrono::duration_cast<std::chrono::milliseconds>(
+                            deadline - std::chrono::steady_clock::now()).count();
+            if( left <= 0 )
+                return false;
+
+            wait = int(left);
+        }
+
+        pollfd descriptor = { output.m_fd, POLLOUT, 0 };
+        if( poll(&descriptor,1,wait) < 0 && errno != EINTR )
+            return false;
+    }
+
+    return true;
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "arena.h"
+
+// writes whole frames to the terminal without ever blocking on it. when the terminal is slower than the game
+// ( ssh, a busy tmux ) a write only takes part of a frame, the rest stays unflushed here and is written once the
+// terminal can take more. a frame that was started is always finished, half an escape sequence would garble the
+// screen, but no new frame is started while bytes are unflushed, so the caller can drop frames instead of piling
+// them up.
+//
+// the terminal is opened again by it's name instead of using STDOUT, O_NONBLOCK is a flag of the open file and
+// STDOUT usually shares it with STDIN. when STDOUT is not a terminal it is used as it is.
+struct TerminalOutput
+{
+    TerminalOutput() : m_fd(-1), m_owns_fd(false), m_buffer(nullptr), m_capacity(0), m_size(0), m_offset(0),
+                       m_frame_count(0), m_short_write_count(0), m_failed_write_count(0),
+                       m_max_unflushed_bytes(0) {}
+
+    TerminalOutput( const TerminalOutput& other ) = delete;
+    TerminalOutput& operator=( const TerminalOutput& other ) = delete;
+
+    int m_fd;
+    bool m_owns_fd;
+    char* m_buffer;
+    std::size_t m_capacity;
+    std::size_t m_size;     // bytes of the current frame.
+    std::size_t m_offset;   // bytes of it already written.
+    GameArena m_arena;
+
+    uint64_t m_frame_count;
+    uint64_t m_short_write_count;   // writes the terminal only took part of.
+    uint64_t m_failed_write_count;  // frames given up on because the terminal returned an error.
+    std::size_t m_max_unflushed_bytes;
+};
+
+bool OpenTerminalOutput( TerminalOutput& output );
+void CloseTerminalOutput( TerminalOutput& output );
+
+// a buffer of atleast capacity bytes to build the next frame in, nullptr while the last frame is still unflushed.
+char* BeginTerminalFrame( TerminalOutput& output, std::size_t capacity );
+
+// starts writing the first size bytes of the buffer, returns true if the whole frame went out already.
+bool SubmitTerminalFrame( TerminalOutput& output, std::size_t size );
+
+// writes as much of the frame as the terminal takes without blocking, true once nothing is left.
+bool WriteTerminalOutput( TerminalOutput& output );
+
+// waits for the terminal until the frame is out, or until timeout_milliseconds pass ( -1 waits forever ).
+bool FlushTerminalOutput( TerminalOutput& output, int timeout_milliseconds );
+
+inline std::size_t GetUnflushedBytes( const TerminalOutput& output ) { return output.m_size - output.m_offset; }
@@ -0,0 +1,89 @@
+#include "tick_scheduler.h"
+
+#include <ctime>
+
+#include <poll.h>
+
+void ResetTickScheduler( TickScheduler& scheduler, std::chrono::nanoseconds period )
+{
+    auto now = std::chrono::steady_clock::now();
+
+    scheduler = TickScheduler();
+    scheduler.m_period = period;
+    scheduler.m_next_tick = now + period;
+    scheduler.m_window_start = now;
+}
+
+void SetTickPeriod( TickScheduler& scheduler, std::chrono::nanoseconds period )
+{
+    scheduler.m_next_tick += period - scheduler.m_period;
+    scheduler.m_period = period;
+}
+
+std::chrono::nanoseconds GetTickRatePeriod( uint32_t ticks_per_second )
+{
+    return std::chrono::nanoseconds(1000000000 / ( ticks_per_second ? ticks_per_second : 1 ));
+}
+
+bool IsTickDue( const TickScheduler& scheduler, std::chrono::steady_clock::time_point now )
+{
+    return now >= scheduler.m_next_tick;
+}
+
+void BeginTick( TickScheduler& scheduler, std::chrono::steady_clock::time_point now )
+{
+    scheduler.m_tick_start = now;
+    scheduler.m_next_tick += scheduler.m_period;
+
+    if( now - scheduler.m_next_tick > scheduler.m_period * TICK_MAX_CATCH_UP_PERIODS )
+    {
+        scheduler.m_next_tick = now + scheduler.m_period;
+        ++scheduler.m_late_tick_count;
+    }
+
+    ++scheduler.m_tick_count;
+    ++scheduler.m_window_tick_count;
+
+    auto window = now - scheduler.m_window_start;
+    if( window >= std::chrono::seconds(1) )
+    {
+        float seconds = std::chrono::duration<float>(window).count();
+        scheduler.m_achieved_rate = float(scheduler.m_window_tick_count) / seconds;
+        scheduler.m_window_tick_count = 0;
+        scheduler.m_window_start = now;
+    }
+}
+
+void EndTick( TickScheduler& scheduler )
+{
+    auto elapsed = std::chrono::steady_clock::now() - scheduler.m_tick_start;
+    int64_t microseconds = std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count();
+
+    scheduler.m_last_tick_microseconds = microseconds;
+    if( microseconds > scheduler.m_max_tick_microseconds )
+        scheduler.m_max_tick_microseconds = microseconds;
+
+    if( elapsed > scheduler.m_period / TICK_BUDGET_DIVISOR )
+        ++scheduler.m_over_budget_count;
+}
+
+void WaitForTickOrInput( const TickScheduler& scheduler, int fd )
+{
+    auto left = scheduler.m_next_tick - std::chrono::steady_clock::now();
+    if( left <= std::chrono::nanoseconds(0) )
+        return;
+
+    int64_t nanoseconds = std::chrono::duration_cast<std::chrono::nanoseconds>(left).count();
+    timespec timeout = { time_t(nanoseconds / 1000000000), long(nanoseconds % 1000000000) };
+
+    // a signal ends the wait early, the caller checks for it's effects anyway.
+    pollfd descriptor = { fd, POLLIN, 0 };
+    ppoll(&descriptor,1,&timeout,nullptr);
+}
+
+uint32_t ComputeTurboTickRate( uint32_t base_rate, uint32_t snake_length )
+{
+    uint32_t rate = base_rate + ( snake_length ? snake_length - 1 : 0 ) * TURBO_RAMP_HZ_PER_PART;
+
+    return rate < TURBO_MAX_TICK_RATE ? rate : TURBO_MAX_TICK_RATE;
+}
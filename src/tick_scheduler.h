@@ -0,0 +1,62 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+
+// turbo mode: ticks start at the rate picked in options and get faster as the snake grows, by
+// TURBO_RAMP_HZ_PER_PART for every part after the head, up to TURBO_MAX_TICK_RATE.
+#define TURBO_MAX_TICK_RATE                     500
+#define TURBO_RAMP_HZ_PER_PART                  2
+
+// the per tick budget: everything the game thread does for a tick ( reading input, stepping the game, the
+// autopilot's search and copying the frame for the render thread ) has to fit in 1 / TICK_BUDGET_DIVISOR of the
+// tick period, 1ms at 500 Hz. the rest is slack for waking up late. drawing is not part of it, it's on the render
+// thread and a terminal that can't keep up drops frames instead of slowing ticks down.
+#define TICK_BUDGET_DIVISOR                     2
+
+// a tick that starts this many periods late doesn't try to catch up with the ticks it missed, the schedule starts
+// over from it instead. otherwise a stall would be followed by a burst of ticks nobody could react to.
+#define TICK_MAX_CATCH_UP_PERIODS               4
+
+// starts ticks at fixed points in time: a tick is due a whole period after the one before was due, not after it
+// actually ran, so the rate doesn't drift by however late the wakeups are.
+struct TickScheduler
+{
+    TickScheduler() : m_period(std::chrono::nanoseconds(0)), m_tick_start(), m_tick_count(0), m_late_tick_count(0),
+                      m_over_budget_count(0), m_last_tick_microseconds(0), m_max_tick_microseconds(0),
+                      m_window_tick_count(0), m_achieved_rate(0.0f) {}
+
+    std::chrono::steady_clock::time_point m_next_tick;
+    std::chrono::nanoseconds m_period;
+    std::chrono::steady_clock::time_point m_tick_start;
+
+    uint64_t m_tick_count;
+    uint64_t m_late_tick_count;     // ticks that gave up catching up, see TICK_MAX_CATCH_UP_PERIODS.
+    uint64_t m_over_budget_count;   // ticks that took longer than the budget.
+    int64_t m_last_tick_microseconds;
+    int64_t m_max_tick_microseconds;
+
+    // ticks counted over the last whole second, for the achieved rate.
+    std::chrono::steady_clock::time_point m_window_start;
+    uint32_t m_window_tick_count;
+    float m_achieved_rate;
+};
+
+// the first tick is due one period from now, the metrics start over.
+void ResetTickScheduler( TickScheduler& scheduler, std::chrono::nanoseconds period );
+
+// takes effect from the next tick on.
+void SetTickPeriod( TickScheduler& scheduler, std::chrono::nanoseconds period );
+
+std::chrono::nanoseconds GetTickRatePeriod( uint32_t ticks_per_second );
+
+bool IsTickDue( const TickScheduler& scheduler, std::chrono::steady_clock::time_point now );
+
+// call around the work of a tick, the time between the two is what is held against the budget.
+void BeginTick( TickScheduler& scheduler, std::chrono::steady_clock::time_point now );
+void EndTick( TickScheduler& scheduler );
+
+// sleeps until the next tick is due or fd has input, whichever comes first.
+void WaitForTickOrInput( const TickScheduler& scheduler, int fd );
+
+uint32_t ComputeTurboTickRate( uint32_t base_rate, uint32_t snake_length );
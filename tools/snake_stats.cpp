@@ -0,0 +1,245 @@
+// reads the analytics log the game writes and prints aggregates over it:
+//
+//   snake_stats [log file] [--player name] [--difficulty n]
+//
+// the log is mapped and walked once, so millions of games take a few seconds at most. percentiles are found with
+// nth_element over the values of the games that passed the filters.
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <iostream>
+#include <vector>
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "analytics_log.h"
+
+struct ValueSummary
+{
+    ValueSummary() : m_min(0), m_max(0), m_sum(0) {}
+
+    int64_t m_min;
+    int64_t m_max;
+    int64_t m_sum;
+    std::vector<int64_t> m_values;
+};
+
+static void AddValue( ValueSummary& summary, int64_t value )
+{
+    if( summary.m_values.empty() || value < summary.m_min )
+        summary.m_min = value;
+
+    if( summary.m_values.empty() || value > summary.m_max )
+        summary.m_max = value;
+
+    summary.m_sum += value;
+    summary.m_values.push_back(value);
+}
+
+static void PrintSummary( const char* name, ValueSummary& summary )
+{
+    std::vector<int64_t>& values = summary.m_values;
+    if( values.empty() )
+        return;
+
+    // each rank is searched for in what's left above the one before it, so the three searches together cost
+    // about as much as one.
+    const double ranks[] = { 0.5, 0.9, 0.99 };
+    int64_t percentiles[3];
+    auto begin = values.begin();
+
+    for( int i = 0; i < 3; ++i )
+    {
+        auto nth = values.begin() + std::size_t(ranks[i] * double(values.size() - 1));
+        std::nth_element(begin,nth,values.end());
+        percentiles[i] = *nth;
+        begin = nth;
+    }
+
+    std::cout << name << "  mean:" << double(summary.m_sum) / double(values.size()) << " min:" << summary.m_min
+              << " p50:" << percentiles[0] << " p90:" << percentiles[1] << " p99:" << percentiles[2]
+              << " max:" << summary.m_max << '\n';
+}
+
+static const char* GetDifficultyName( uint8_t difficulty )
+{
+    static const char* names[] = { "headless", "easy", "normal", "hard", "huge", "level" };
+
+    return difficulty < sizeof(names) / sizeof(names[0]) ? names[difficulty] : "unknown";
+}
+
+// a record of a log that was damaged after it was written can hold anything, one with an end cause the game
+// doesn't have or that ended before 2020 or more than a day from now is left out.
+static bool IsPlausibleRecord( const GameAnalyticsRecord& record, uint64_t now )
+{
+    return record.m_end_cause < ANALYTICS_END_COUNT && record.m_end_time >= 1577836800 &&
+           record.m_end_time <= now + 24 * 60 * 60;
+}
+
+// writes "invalid" for a time localtime can't represent.
+static void FormatDate( char* text, std::size_t size, uint64_t time )
+{
+    std::time_t seconds = std::time_t(time);
+    const std::tm* date = std::localtime(&seconds);
+
+    if( !date || std::strftime(text,size,"%Y-%m-%d %H:%M",date) == 0 )
+        std::snprintf(text,size,"invalid");
+}
+
+int main( int argc, char** argv )
+{
+    const char* path = ANALYTICS_LOG_FILE_NAME;
+    const char* player = nullptr;
+    int difficulty = -1;
+
+    for( int i = 1; i < argc; ++i )
+    {
+        if( std::strcmp(argv[i],"--player") == 0 && i + 1 < argc )
+            player = argv[++i];
+
+        else if( std::strcmp(argv[i],"--difficulty") == 0 && i + 1 < argc )
+            difficulty = std::atoi(argv[++i]);
+
+        else if( argv[i][0] != '-' )
+            path = argv[i];
+
+        else
+        {
+            std::cerr << "usage: snake_stats [log file] [--player name] [--difficulty n]\n";
+            return EXIT_FAILURE;
+        }
+    }
+
+    auto start = std::chrono::steady_clock::now();
+
+    int fd = open(path,O_RDONLY | O_CLOEXEC);
+    struct stat file_status;
+    if( fd < 0 || fstat(fd,&file_status) != 0 )
+    {
+        std::cerr << "could not open " << path << ".\n";
+        return EXIT_FAILURE;
+    }
+
+    std::size_t size = std::size_t(file_status.st_size);
+    void* mapping = size ? mmap(nullptr,size,PROT_READ,MAP_PRIVATE,fd,0) : MAP_FAILED;
+    close(fd);
+
+    if( mapping == MAP_FAILED )
+    {
+        std::cerr << "could not map " << path << ".\n";
+        return EXIT_FAILURE;
+    }
+
+    madvise(mapping,size,MADV_SEQUENTIAL);
+
+    const uint8_t* data = static_cast<const uint8_t*>(mapping);
+    uint64_t record_count;
+    if( !ReadAnalyticsLogHeader(data,size,record_count) )
+    {
+        std::cerr << path << " is not an analytics log of version " << ANALYTICS_LOG_VERSION << ".\n";
+        munmap(mapping,size);
+        return EXIT_FAILURE;
+    }
+
+    uint64_t matched_count = 0;
+    uint64_t difficulty_counts[256] = {};
+    uint64_t end_cause_counts[ANALYTICS_END_COUNT] = {};
+    uint64_t autopilot_count = 0, resumed_count = 0, headless_count = 0;
+    uint64_t first_time = 0, last_time = 0;
+    uint64_t skipped_count = 0;
+    uint64_t now = uint64_t(std::time(nullptr));
+    ValueSummary scores, lengths, ticks, durations;
+
+    scores.m_values.reserve(record_count);
+    lengths.m_values.reserve(record_count);
+    ticks.m_values.reserve(record_count);
+    durations.m_values.reserve(record_count);
+
+    const uint8_t* record_data = data + ANALYTICS_LOG_HEADER_SIZE;
+    GameAnalyticsRecord record;
+
+    for( uint64_t i = 0; i < record_count; ++i, record_data += ANALYTICS_RECORD_SIZE )
+    {
+        DecodeAnalyticsRecord(record_data,record);
+
+        if( !IsPlausibleRecord(record,now) )
+        {
+            ++skipped_count;
+            continue;
+        }
+
+        if( ( player && std::strcmp(player,record.m_player_name) != 0 ) ||
+            ( difficulty >= 0 && record.m_difficulty != difficulty ) )
+            continue;
+
+        if( matched_count == 0 || record.m_end_time < first_time )
+            first_time = record.m_end_time;
+
+        if( matched_count == 0 || record.m_end_time > last_time )
+            last_time = record.m_end_time;
+
+        ++matched_count;
+        ++difficulty_counts[record.m_difficulty];
+        ++end_cause_counts[record.m_end_cause];
+        autopilot_count += ( record.m_flags & ANALYTICS_FLAG_AUTOPILOT ) != 0;
+        resumed_count += ( record.m_flags & ANALYTICS_FLAG_RESUMED ) != 0;
+        headless_count += ( record.m_flags & ANALYTICS_FLAG_HEADLESS ) != 0;
+
+        AddValue(scores,record.m_score);
+        AddValue(lengths,record.m_length);
+        AddValue(ticks,record.m_ticks);
+        AddValue(durations,record.m_duration_milliseconds);
+    }
+
+    std::size_t trailing_bytes = size - ANALYTICS_LOG_HEADER_SIZE - record_count * ANALYTICS_RECORD_SIZE;
+    munmap(mapping,size);
+
+    std::cout << path << ": " << record_count << " games";
+    if( trailing_bytes )
+        std::cout << " ( " << trailing_bytes << " bytes of a cut off record ignored )";
+    if( skipped_count )
+        std::cout << " ( " << skipped_count << " damaged records skipped )";
+    std::cout << ", " << matched_count << " matched\n";
+
+    if( matched_count )
+    {
+        char first_date[32], last_date[32];
+        FormatDate(first_date,sizeof(first_date),first_time);
+        FormatDate(last_date,sizeof(last_date),last_time);
+
+        std::cout << "from " << first_date << " to " << last_date << '\n';
+
+        PrintSummary("score      ",scores);
+        PrintSummary("length     ",lengths);
+        PrintSummary("ticks      ",ticks);
+        PrintSummary("duration ms",durations);
+
+        std::cout << "difficulty:";
+        for( int i = 0; i < 256; ++i )
+        {
+            if( difficulty_counts[i] )
+                std::cout << ' ' << GetDifficultyName(uint8_t(i)) << ':' << difficulty_counts[i];
+        }
+
+        std::cout << "\nended:";
+        for( uint8_t i = 0; i < ANALYTICS_END_COUNT; ++i )
+        {
+            if( end_cause_counts[i] )
+                std::cout << ' ' << GetAnalyticsEndCauseName(i) << ':' << end_cause_counts[i];
+        }
+
+        std::cout << "\nautopilot:" << autopilot_count << " resumed:" << resumed_count
+                  << " headless:" << headless_count << '\n';
+    }
+
+    std::cout << "took " << std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count()
+              << "s\n";
+
+    return EXIT_SUCCESS;
+}